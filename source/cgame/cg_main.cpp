@@ -373,7 +373,6 @@ static void CG_InitGameShared( void )
 	module_GetEntityState = CG_GS_GetEntityState;
 	module_PointContents = CG_GS_PointContents;
 	module_RoundUpToHullSize = CG_GS_RoundUpToHullSize;
-	module_PMoveTouchTriggers = CG_Predict_TouchTriggers;
 	module_GetConfigString = CG_GS_GetConfigString;
 
 	GS_InitWeapons();
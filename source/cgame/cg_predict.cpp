@@ -420,6 +420,7 @@ void CG_PredictMovement( void )
 	int ucmdExecuted, ucmdHead;
 	int frame;
 	pmove_t pm;
+	pmove_context_t pmc;
 
 	trap_NET_GetCurrentState( NULL, &ucmdHead, NULL );
 	ucmdExecuted = cg.frame.ucmdExecuted;
@@ -470,7 +471,10 @@ void CG_PredictMovement( void )
 		if( ucmdReady )
 			cg.predictingTimeStamp = pm.cmd.serverTimeStamp;
 
-		Pmove( &pm );
+		Pmove( &pm, &pmc );
+		if( pmc.touchTriggers )
+			CG_Predict_TouchTriggers( &pm, pmc.previous_origin );
+		Pmove_Finish( &pm, &pmc );
 
 		// copy for stair smoothing
 		predictedSteps[frame] = pm.step;
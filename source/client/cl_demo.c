@@ -204,6 +204,229 @@ void CL_Record_f( void )
 static int demofilehandle;
 static int demofilelen, demofilelentotal;
 
+// keyframe index, so jumping can resume from the closest nodelta frame instead of
+// parsing everything in between. It's loaded from the file the server writes next
+// to the demo, or built while the demo is being played if there's none
+#define DEMO_INDEX_GROW 256
+
+typedef struct
+{
+	int offset;                     // file offset of the message holding the frame
+	unsigned int serverTime;
+} demokeyframe_t;
+
+typedef struct
+{
+	int offset;                     // file offset of the message holding the command
+	int index;
+	char *string;
+} democonfigstring_t;
+
+static demokeyframe_t *demokeyframes;
+static int demonumkeyframes, demomaxkeyframes;
+static democonfigstring_t *democonfigstrings;
+static int demonumconfigstrings, demomaxconfigstrings;
+static int demomsgoffset;           // file offset of the message being parsed
+static int demoindexedlen;          // messages starting before this offset are indexed
+static bool demoindexing;
+
+/*
+* CL_AddDemoKeyframe
+*/
+static void CL_AddDemoKeyframe( int offset, unsigned int serverTime, void *arg )
+{
+	demokeyframe_t *keyframe;
+
+	if( demonumkeyframes == demomaxkeyframes )
+	{
+		demomaxkeyframes += DEMO_INDEX_GROW;
+		if( demokeyframes )
+			demokeyframes = Mem_Realloc( demokeyframes, demomaxkeyframes * sizeof( *demokeyframes ) );
+		else
+			demokeyframes = Mem_ZoneMalloc( demomaxkeyframes * sizeof( *demokeyframes ) );
+	}
+
+	keyframe = &demokeyframes[demonumkeyframes++];
+	keyframe->offset = offset;
+	keyframe->serverTime = serverTime;
+}
+
+/*
+* CL_AddDemoConfigString
+*/
+static void CL_AddDemoConfigString( int offset, int idx, const char *s, void *arg )
+{
+	democonfigstring_t *cs;
+
+	if( demonumconfigstrings == demomaxconfigstrings )
+	{
+		demomaxconfigstrings += DEMO_INDEX_GROW;
+		if( democonfigstrings )
+			democonfigstrings = Mem_Realloc( democonfigstrings, demomaxconfigstrings * sizeof( *democonfigstrings ) );
+		else
+			democonfigstrings = Mem_ZoneMalloc( demomaxconfigstrings * sizeof( *democonfigstrings ) );
+	}
+
+	cs = &democonfigstrings[demonumconfigstrings++];
+	cs->offset = offset;
+	cs->index = idx;
+	cs->string = ZoneCopyString( s );
+}
+
+/*
+* CL_DemoIndexFrame
+* 
+* Remembers where nodelta frames are, as delta decoding can restart from them
+*/
+void CL_DemoIndexFrame( const snapshot_t *frame )
+{
+	if( !demoindexing || frame->delta || !frame->valid )
+		return;
+
+	CL_AddDemoKeyframe( demomsgoffset, frame->serverTime, NULL );
+}
+
+/*
+* CL_DemoIndexConfigString
+* 
+* Configstring changes are logged, so their state at any keyframe can be restored
+*/
+void CL_DemoIndexConfigString( int idx, const char *s )
+{
+	if( !demoindexing )
+		return;
+
+	CL_AddDemoConfigString( demomsgoffset, idx, s, NULL );
+}
+
+/*
+* CL_FreeDemoIndex
+*/
+static void CL_FreeDemoIndex( void )
+{
+	int i;
+
+	for( i = 0; i < demonumconfigstrings; i++ )
+		Mem_ZoneFree( democonfigstrings[i].string );
+	if( democonfigstrings )
+		Mem_ZoneFree( democonfigstrings );
+	democonfigstrings = NULL;
+	demonumconfigstrings = demomaxconfigstrings = 0;
+
+	if( demokeyframes )
+		Mem_ZoneFree( demokeyframes );
+	demokeyframes = NULL;
+	demonumkeyframes = demomaxkeyframes = 0;
+
+	demomsgoffset = demoindexedlen = 0;
+	demoindexing = false;
+}
+
+/*
+* CL_LoadDemoIndex
+* 
+* Reads the keyframe index the server wrote for the demo. Demos without
+* one, or with a bad one, are indexed while they are played instead.
+*/
+static void CL_LoadDemoIndex( const char *demoname, bool absolute )
+{
+	int indexfile;
+	const char *indexname;
+
+	indexname = va( "%s" SNAP_DEMO_INDEX_EXTENSION, demoname );
+	if( absolute )
+		FS_FOpenAbsoluteFile( indexname, &indexfile, FS_READ );
+	else
+		FS_FOpenFile( indexname, &indexfile, FS_READ );
+	if( !indexfile )
+		return;
+
+	if( SNAP_ReadDemoIndex( indexfile, CL_AddDemoKeyframe, CL_AddDemoConfigString, NULL ) )
+	{
+		// the whole demo is indexed already
+		demoindexedlen = INT_MAX;
+	}
+	else
+	{
+		Com_Printf( "Ignoring invalid keyframe index for %s\n", demoname );
+		CL_FreeDemoIndex();
+	}
+
+	FS_FCloseFile( indexfile );
+}
+
+/*
+* CL_RestoreDemoConfigStrings
+* 
+* Sets the configstrings to the values they have after the message at offset.
+* Parsing that message again sets the ones it changes to the same values.
+*/
+static void CL_RestoreDemoConfigStrings( int offset )
+{
+	int i;
+	const char **values;
+	const democonfigstring_t *cs;
+
+	values = Mem_TempMalloc( MAX_CONFIGSTRINGS * sizeof( *values ) );
+
+	for( i = 0, cs = democonfigstrings; i < demonumconfigstrings; i++, cs++ )
+	{
+		if( cs->offset <= offset )
+			values[cs->index] = cs->string;
+		else if( !values[cs->index] )
+			values[cs->index] = ""; // only set later on
+	}
+
+	for( i = 0; i < MAX_CONFIGSTRINGS; i++ )
+	{
+		if( values[i] && strcmp( cl.configstrings[i], values[i] ) )
+			CL_UpdateConfigString( i, values[i] );
+	}
+
+	Mem_TempFree( values );
+}
+
+/*
+* CL_FindDemoKeyframe
+* 
+* Returns the last indexed keyframe at or before serverTime
+*/
+static const demokeyframe_t *CL_FindDemoKeyframe( unsigned int serverTime )
+{
+	int lo, hi, mid;
+
+	// keyframes are indexed in file order
+	lo = 0;
+	hi = demonumkeyframes;
+	while( lo < hi )
+	{
+		mid = ( lo + hi ) / 2;
+		if( demokeyframes[mid].serverTime <= serverTime )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo ? &demokeyframes[lo - 1] : NULL;
+}
+
+/*
+* CL_SeekDemoKeyframe
+* 
+* Moves the demo to the keyframe, or to the start of the file if there's none
+*/
+static void CL_SeekDemoKeyframe( const demokeyframe_t *keyframe )
+{
+	if( !keyframe )
+	{
+		FS_Seek( demofilehandle, 0, FS_SEEK_SET );
+		return;
+	}
+
+	FS_Seek( demofilehandle, keyframe->offset, FS_SEEK_SET );
+	CL_RestoreDemoConfigStrings( keyframe->offset );
+}
+
 /*
 * CL_BeginDemoAviDump
 */
@@ -265,6 +488,8 @@ void CL_DemoCompleted( void )
 	}
 	demofilelen = demofilelentotal = 0;
 
+	CL_FreeDemoIndex();
+
 	cls.demo.playing = false;
 	cls.demo.basetime = cls.demo.duration = cls.demo.time = 0;
 	Mem_ZoneFree( cls.demo.filename );
@@ -291,7 +516,7 @@ static void CL_ReadDemoMessage( void )
 	static uint8_t msgbuf[MAX_MSGLEN];
 	static msg_t demomsg;
 	static bool init = true;
-	int read;
+	int read, offset;
 
 	if( !demofilehandle )
 	{
@@ -305,6 +530,7 @@ static void CL_ReadDemoMessage( void )
 		init = false;
 	}
 
+	offset = FS_Tell( demofilehandle );
 	read = SNAP_ReadDemoMessage( demofilehandle, &demomsg );
 	if( read == -1 )
 	{
@@ -317,7 +543,17 @@ static void CL_ReadDemoMessage( void )
 		return;
 	}
 
+	// messages played for the first time are added to the keyframe index
+	demomsgoffset = offset;
+	demoindexing = ( offset >= demoindexedlen );
+
 	CL_ParseServerMessage( &demomsg );
+
+	if( demoindexing && demofilehandle )
+	{
+		demoindexedlen = FS_Tell( demofilehandle );
+		demoindexing = false;
+	}
 }
 
 /*
@@ -350,6 +586,9 @@ void CL_ReadDemoPackets( void )
 */
 void CL_LatchedDemoJump( void )
 {
+	unsigned int snapTime;
+	const demokeyframe_t *keyframe;
+
 	if( cls.demo.paused || ! cls.demo.play_jump_latched ) {
 		return;
 	}
@@ -361,10 +600,20 @@ void CL_LatchedDemoJump( void )
 
 	CL_AdjustServerTime( 1 );
 
-	if( cl.serverTime < cl.snapShots[cl.receivedSnapNum&UPDATE_MASK].serverTime )
+	snapTime = cl.snapShots[cl.receivedSnapNum&UPDATE_MASK].serverTime;
+	keyframe = CL_FindDemoKeyframe( cl.serverTime );
+
+	if( cl.serverTime < snapTime )
 	{
 		demofilelen = demofilelentotal;
-		FS_Seek( demofilehandle, 0, FS_SEEK_SET );
+		CL_SeekDemoKeyframe( keyframe );
+		cl.currentSnapNum = cl.receivedSnapNum = 0;
+	}
+	else if( keyframe && keyframe->serverTime > snapTime )
+	{
+		// skip the frames before the keyframe instead of parsing them all
+		cl.pendingSnapNum = 0;
+		CL_SeekDemoKeyframe( keyframe );
 		cl.currentSnapNum = cl.receivedSnapNum = 0;
 	}
 
@@ -381,6 +630,7 @@ static void CL_StartDemo( const char *demoname, bool pause_on_stop )
 	char *name, *servername;
 	const char *filename = NULL;
 	int tempdemofilehandle = 0, tempdemofilelen = -1;
+	bool absolute = false;
 
 	// have to copy the argument now, since next actions will lose it
 	servername = TempCopyString( demoname );
@@ -404,6 +654,7 @@ static void CL_StartDemo( const char *demoname, bool pause_on_stop )
 		Q_snprintfz( name, name_size, "%s", servername );
 		COM_DefaultExtension( name, APP_DEMO_EXTENSION_STR, name_size );
 		tempdemofilelen = FS_FOpenAbsoluteFile( name, &tempdemofilehandle, FS_READ|SNAP_DEMO_GZ );
+		absolute = true;
 	}
 
 	if( !tempdemofilehandle ) {
@@ -422,6 +673,9 @@ static void CL_StartDemo( const char *demoname, bool pause_on_stop )
 
 	memset( &cls.demo, 0, sizeof( cls.demo ) );
 
+	CL_FreeDemoIndex();
+	CL_LoadDemoIndex( name, absolute );
+
 	demofilehandle = tempdemofilehandle;
 	demofilelentotal = tempdemofilelen;
 	demofilelen = demofilelentotal;
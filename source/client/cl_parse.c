@@ -1051,6 +1051,9 @@ static void CL_ParseFrame( msg_t *msg )
 	{
 		cl.receivedSnapNum = snap->serverFrame;
 
+		if( cls.demo.playing )
+			CL_DemoIndexFrame( snap );
+
 		if( cls.demo.recording )
 		{
 			if( cls.demo.waiting && !snap->delta )
@@ -1169,7 +1172,7 @@ static void CL_CvarInfoRequest_f( void )
 /*
 * CL_UpdateConfigString
 */
-static void CL_UpdateConfigString( int idx, const char *s )
+void CL_UpdateConfigString( int idx, const char *s )
 {
 	if( !s )
 		return;
@@ -1195,6 +1198,9 @@ static void CL_UpdateConfigString( int idx, const char *s )
 
 	Q_strncpyz( cl.configstrings[idx], s, sizeof( cl.configstrings[idx] ) );
 
+	if( cls.demo.playing )
+		CL_DemoIndexConfigString( idx, s );
+
 	// allow cgame to update it too
 	CL_GameModule_ConfigString( idx, s );
 }
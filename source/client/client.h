@@ -568,6 +568,8 @@ void CL_PauseDemo_f( void );
 void CL_DemoJump_f( void );
 void CL_BeginDemoAviDump( void );
 size_t CL_ReadDemoMetaData( const char *demopath, char *meta_data, size_t meta_data_size );
+void CL_DemoIndexFrame( const snapshot_t *frame );
+void CL_DemoIndexConfigString( int idx, const char *s );
 char **CL_DemoComplete( const char *partial );
 #define CL_WriteAvi() ( cls.demo.avi && cls.state == CA_ACTIVE && cls.demo.playing && !cls.demo.play_jump )
 #define CL_SetDemoMetaKeyValue(k,v) cls.demo.meta_data_realsize = SNAP_SetDemoMetaKeyValue(cls.demo.meta_data, sizeof(cls.demo.meta_data), cls.demo.meta_data_realsize, k, v)
@@ -576,6 +578,7 @@ char **CL_DemoComplete( const char *partial );
 // cl_parse.c
 //
 void CL_ParseServerMessage( msg_t *msg );
+void CL_UpdateConfigString( int idx, const char *s );
 #define SHOWNET(msg,s) _SHOWNET(msg,s,cl_shownet->integer);
 
 void CL_FreeDownloadList( void );
@@ -27,9 +27,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 //
 //==========================================
 
-static short int alist[MAX_NODES];  //list contains all studied nodes, Open and Closed together
-static int alist_numNodes;
-
 enum
 {
 	NOLIST,
@@ -44,11 +41,19 @@ typedef struct
 	int H;
 
 	short int list;
+	short int heapIndex;        // position in the open list heap
+	unsigned int generation;    // the node record is only valid for the query it was stamped by
 
 } astarnode_t;
 
 astarnode_t astarnodes[MAX_NODES];
 
+static unsigned int astarGeneration;
+
+// open list, a binary heap ordered by F = G + H
+static short int openHeap[MAX_NODES];
+static int openHeap_numNodes;
+
 struct astarpath_s *Apath;
 //==========================================
 //
@@ -60,15 +65,63 @@ static short int currentNode;
 
 static int ValidLinksMask;
 #define DEFAULT_MOVETYPES_MASK ( LINK_MOVE|LINK_STAIRS|LINK_FALL|LINK_WATER|LINK_WATERJUMP|LINK_JUMPPAD|LINK_PLATFORM|LINK_TELEPORT );
+
+//==========================================
+// Per-frame path cache
+// Bots often ask for the same path many times in the same frame
+// (AI_FindCost on every goal candidate), so results are kept until
+// the next frame.
+//==========================================
+#define ASTAR_CACHE_SIZE 32
+
+typedef struct
+{
+	int origin;
+	int goal;
+	int movetypes;
+	int result;
+	astarpath_t path;
+} astarcacheentry_t;
+
+static astarcacheentry_t astarCache[ASTAR_CACHE_SIZE];
+static int astarCache_numEntries;
+static int astarCache_next;
+static unsigned int astarCache_framenum;
+static unsigned int astarCache_spawnedTimeStamp;
+static int astarCache_numNodes;
+
+//==========================================
+// Recorded queries, for astarbench
+//==========================================
+#define ASTAR_RECORD_SIZE 1024
+
+typedef struct
+{
+	int origin;
+	int goal;
+	int movetypes;
+} astarquery_t;
+
+static astarquery_t astarRecord[ASTAR_RECORD_SIZE];
+static int astarRecord_numQueries;
+static int astarRecord_next;
 //==========================================
 //
 //
 //
 //==========================================
 
+static inline int AStar_NodeList( int node )
+{
+	if( astarnodes[node].generation != astarGeneration )
+		return NOLIST;
+
+	return astarnodes[node].list;
+}
+
 int AStar_nodeIsInClosed( int node )
 {
-	if( astarnodes[node].list == CLOSEDLIST )
+	if( AStar_NodeList( node ) == CLOSEDLIST )
 		return 1;
 
 	return 0;
@@ -76,7 +129,7 @@ int AStar_nodeIsInClosed( int node )
 
 int AStar_nodeIsInOpen( int node )
 {
-	if( astarnodes[node].list == OPENLIST )
+	if( AStar_NodeList( node ) == OPENLIST )
 		return 1;
 
 	return 0;
@@ -84,9 +137,93 @@ int AStar_nodeIsInOpen( int node )
 
 static void AStar_InitLists( void )
 {
-	memset( astarnodes, 0, sizeof( astarnodes ) ); //jabot092
+	// new generation invalidates all node records at once
+	astarGeneration++;
+	if( !astarGeneration )
+	{
+		memset( astarnodes, 0, sizeof( astarnodes ) ); //jabot092
+		astarGeneration = 1;
+	}
+
 	if( Apath ) Apath->numNodes = 0;
-	alist_numNodes = 0;
+	openHeap_numNodes = 0;
+}
+
+static inline int AStar_NodeF( int node )
+{
+	return astarnodes[node].G + astarnodes[node].H;
+}
+
+static void AStar_HeapSet( int index, int node )
+{
+	openHeap[index] = node;
+	astarnodes[node].heapIndex = index;
+}
+
+static void AStar_HeapUp( int index )
+{
+	int node = openHeap[index];
+	int F = AStar_NodeF( node );
+
+	while( index > 0 )
+	{
+		int parent = ( index - 1 ) >> 1;
+		if( AStar_NodeF( openHeap[parent] ) <= F )
+			break;
+
+		AStar_HeapSet( index, openHeap[parent] );
+		index = parent;
+	}
+
+	AStar_HeapSet( index, node );
+}
+
+static void AStar_HeapDown( int index )
+{
+	int node = openHeap[index];
+	int F = AStar_NodeF( node );
+
+	while( 1 )
+	{
+		int child = ( index << 1 ) + 1;
+		if( child >= openHeap_numNodes )
+			break;
+
+		if( child + 1 < openHeap_numNodes && AStar_NodeF( openHeap[child + 1] ) < AStar_NodeF( openHeap[child] ) )
+			child++;
+		if( F <= AStar_NodeF( openHeap[child] ) )
+			break;
+
+		AStar_HeapSet( index, openHeap[child] );
+		index = child;
+	}
+
+	AStar_HeapSet( index, node );
+}
+
+static void AStar_HeapPush( int node )
+{
+	openHeap_numNodes++;
+	AStar_HeapSet( openHeap_numNodes - 1, node );
+	AStar_HeapUp( openHeap_numNodes - 1 );
+}
+
+static int AStar_HeapPop( void )
+{
+	int best;
+
+	if( !openHeap_numNodes )
+		return -1;
+
+	best = openHeap[0];
+	openHeap_numNodes--;
+	if( openHeap_numNodes )
+	{
+		AStar_HeapSet( 0, openHeap[openHeap_numNodes] );
+		AStar_HeapDown( 0 );
+	}
+
+	return best;
 }
 
 static int AStar_PLinkDistance( int n1, int n2 )
@@ -133,10 +270,12 @@ static int  Astar_HDist_ManhatanGuess( int node )
 
 static void AStar_PutInClosed( int node )
 {
-	if( !astarnodes[node].list )
+	if( astarnodes[node].generation != astarGeneration )
 	{
-		alist[alist_numNodes] = node;
-		alist_numNodes++;
+		astarnodes[node].generation = astarGeneration;
+		astarnodes[node].parent = 0;
+		astarnodes[node].G = 0;
+		astarnodes[node].H = 0;
 	}
 
 	astarnodes[node].list = CLOSEDLIST;
@@ -177,6 +316,7 @@ static void AStar_PutAdjacentsInOpen( int node )
 				{
 					astarnodes[addnode].parent = node;
 					astarnodes[addnode].G = astarnodes[node].G + plinkDist;
+					AStar_HeapUp( astarnodes[addnode].heapIndex );
 				}
 			}
 		}
@@ -197,42 +337,19 @@ static void AStar_PutAdjacentsInOpen( int node )
 				//printf("WARNING: AStar_PutAdjacentsInOpen - Couldn't find distance between nodes\n");
 			}
 
-			//put in global list
-			if( !astarnodes[addnode].list )
-			{
-				alist[alist_numNodes] = addnode;
-				alist_numNodes++;
-			}
-
+			astarnodes[addnode].generation = astarGeneration;
 			astarnodes[addnode].parent = node;
 			astarnodes[addnode].G = astarnodes[node].G + plinkDist;
 			astarnodes[addnode].H = Astar_HDist_ManhatanGuess( addnode );
 			astarnodes[addnode].list = OPENLIST;
+			AStar_HeapPush( addnode );
 		}
 	}
 }
 
 static int AStar_FindInOpen_BestF( void )
 {
-	int i;
-	int bestF = -1;
-	int best = -1;
-
-	for( i = 0; i < alist_numNodes; i++ )
-	{
-		int node = alist[i];
-
-		if( astarnodes[node].list != OPENLIST )
-			continue;
-
-		if( bestF == -1 || bestF > ( astarnodes[node].G + astarnodes[node].H ) )
-		{
-			bestF = astarnodes[node].G + astarnodes[node].H;
-			best = node;
-		}
-	}
-	//printf("BEST:%i\n", best);
-	return best;
+	return AStar_HeapPop();
 }
 
 static void AStar_ListsToPath( void )
@@ -292,7 +409,7 @@ int AStar_ResolvePath( int n1, int n2, int movetypes )
 	return 1;
 }
 
-int AStar_GetPath( int origin, int goal, int movetypes, struct astarpath_s *path )
+static int AStar_FindPath( int origin, int goal, int movetypes, struct astarpath_s *path )
 {
 	Apath = path;
 
@@ -306,3 +423,116 @@ int AStar_GetPath( int origin, int goal, int movetypes, struct astarpath_s *path
 	path->goalNode = goal;
 	return 1;
 }
+
+static void AStar_RecordQuery( int origin, int goal, int movetypes )
+{
+	astarquery_t *query = &astarRecord[astarRecord_next];
+
+	query->origin = origin;
+	query->goal = goal;
+	query->movetypes = movetypes;
+
+	astarRecord_next = ( astarRecord_next + 1 ) % ASTAR_RECORD_SIZE;
+	if( astarRecord_numQueries < ASTAR_RECORD_SIZE )
+		astarRecord_numQueries++;
+}
+
+int AStar_GetPath( int origin, int goal, int movetypes, struct astarpath_s *path )
+{
+	int i, result;
+	astarcacheentry_t *entry;
+
+	AStar_RecordQuery( origin, goal, movetypes );
+
+	// nodes and links may change at any time while editing
+	if( nav.editmode )
+		return AStar_FindPath( origin, goal, movetypes, path );
+
+	if( astarCache_framenum != level.framenum || astarCache_spawnedTimeStamp != level.spawnedTimeStamp
+		|| astarCache_numNodes != nav.num_nodes )
+	{
+		astarCache_framenum = level.framenum;
+		astarCache_spawnedTimeStamp = level.spawnedTimeStamp;
+		astarCache_numNodes = nav.num_nodes;
+		astarCache_numEntries = 0;
+		astarCache_next = 0;
+	}
+
+	for( i = 0; i < astarCache_numEntries; i++ )
+	{
+		entry = &astarCache[i];
+		if( entry->origin == origin && entry->goal == goal && entry->movetypes == movetypes )
+		{
+			if( entry->result )
+				*path = entry->path;
+			else
+				path->numNodes = 0;
+			return entry->result;
+		}
+	}
+
+	result = AStar_FindPath( origin, goal, movetypes, path );
+
+	entry = &astarCache[astarCache_next];
+	entry->origin = origin;
+	entry->goal = goal;
+	entry->movetypes = movetypes;
+	entry->result = result;
+	if( result )
+		entry->path = *path;
+
+	astarCache_next = ( astarCache_next + 1 ) % ASTAR_CACHE_SIZE;
+	if( astarCache_numEntries < ASTAR_CACHE_SIZE )
+		astarCache_numEntries++;
+
+	return result;
+}
+
+/*
+* AStar_Benchmark_Cmd
+*
+* Replays the last recorded AStar_GetPath queries on the loaded navigation
+* file, bypassing the path cache: astarbench [iterations]
+*/
+void AStar_Benchmark_Cmd( void )
+{
+	int i, j, iterations, found;
+	unsigned int start, elapsed;
+	static astarpath_t path;
+
+	if( !nav.loaded )
+	{
+		G_Printf( "No navigation file loaded\n" );
+		return;
+	}
+
+	if( !astarRecord_numQueries )
+	{
+		G_Printf( "No path queries recorded yet, add some bots first\n" );
+		return;
+	}
+
+	iterations = 1;
+	if( trap_Cmd_Argc() > 1 )
+		iterations = max( atoi( trap_Cmd_Argv( 1 ) ), 1 );
+
+	found = 0;
+	start = trap_Milliseconds();
+	for( i = 0; i < iterations; i++ )
+	{
+		for( j = 0; j < astarRecord_numQueries; j++ )
+		{
+			const astarquery_t *query = &astarRecord[j];
+
+			if( query->origin < 0 || query->origin >= nav.num_nodes || query->goal >= nav.num_nodes )
+				continue;
+			if( AStar_FindPath( query->origin, query->goal, query->movetypes, &path ) )
+				found++;
+		}
+	}
+	elapsed = trap_Milliseconds() - start;
+
+	G_Printf( "%i queries x %i iterations, %i paths found: %u ms (%.3f us per query)\n",
+		astarRecord_numQueries, iterations, found, elapsed,
+		elapsed * 1000.0 / ( (double)astarRecord_numQueries * iterations ) );
+}
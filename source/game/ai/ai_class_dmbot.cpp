@@ -1731,7 +1731,7 @@ void BOT_DMclass_InitPersistant( edict_t *self )
 	gsitem_t *item;
 	int i, w;
 
-	self->classname = "dmbot";
+	G_SetClassname( self, "dmbot" );
 
 	if( self->r.client->netname[0] )
 		self->ai->pers.netname = self->r.client->netname;
@@ -93,7 +93,7 @@ static void AI_JumpadGuess_ShowPoint( vec3_t origin, char *modelname )
 	ent->s.modelindex = trap_ModelIndex( modelname );
 	ent->nextThink = level.time + 20000000;
 	ent->think = G_FreeEdict;
-	ent->classname = "checkent";
+	G_SetClassname( ent, "checkent" );
 	ent->r.svflags &= ~SVF_NOCLIENT;
 
 	GClip_LinkEntity( ent );
@@ -371,7 +371,7 @@ static void BOT_InitPersistant( edict_t *self )
 	self->think = NULL;
 	self->nextThink = level.time + 1;
 	self->ai->type = AI_ISBOT;
-	self->classname = "bot";
+	G_SetClassname( self, "bot" );
 	self->yaw_speed = AI_DEFAULT_YAW_SPEED;
 	self->die = player_die;
 
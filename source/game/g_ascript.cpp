@@ -2234,7 +2234,7 @@ static asstring_t *objectGameEntity_getTargetname( edict_t *self )
 
 static void objectGameEntity_setTargetname( asstring_t *targetname, edict_t *self )
 {
-	self->targetname = G_RegisterLevelString( targetname->buffer );
+	G_SetTargetname( self, G_RegisterLevelString( targetname->buffer ) );
 }
 
 static asstring_t *objectGameEntity_getTarget( edict_t *self )
@@ -2259,7 +2259,7 @@ static asstring_t *objectGameEntity_getSoundName( edict_t *self )
 
 static void objectGameEntity_setClassname( asstring_t *classname, edict_t *self )
 {
-	self->classname = G_RegisterLevelString( classname->buffer );
+	G_SetClassname( self, G_RegisterLevelString( classname->buffer ) );
 }
 
 static void objectGameEntity_setMap( asstring_t *map, edict_t *self )
@@ -2695,7 +2695,7 @@ static edict_t *asFunc_G_Spawn( asstring_t *classname )
 	ent = G_Spawn();
 
 	if( classname && classname->len ) {
-		ent->classname = G_RegisterLevelString( classname->buffer );
+		G_SetClassname( ent, G_RegisterLevelString( classname->buffer ) );
 	}
 
 	ent->scriptSpawned = true;
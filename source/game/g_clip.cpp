@@ -41,59 +41,120 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	AREA_TRIGGERS	2
 
 
-#define AREA_GRID		128
-#define AREA_GRIDNODES	(AREA_GRID * AREA_GRID)
+#define AREA_GRID		128		// cells per axis on the finest level
+#define AREA_GRID_LEVELS	8		// each level halves the cells per axis, down to a single cell
+#define AREA_GRIDNODES	( ( AREA_GRID * AREA_GRID * 4 - 1 ) / 3 )	// cells of all the levels
 #define AREA_GRIDMINSIZE 64.0f	// minimum areagrid cell size, smaller values 
 								// work better for lots of small objects, higher
 								// values for large objects
 
+// every entity is linked into a single cell, in the finest level with cells
+// at least as big as the entity. Cells are loose: entities are stored at the
+// cell holding their center, so they may stick out up to half a cell, and
+// queries have to be expanded by that much. Solid and triggers share the
+// lists and are told apart at query time, so changing r.solid without
+// relinking (scripts can do that) doesn't hide an entity from queries.
 typedef struct
 {
-	link_t grid[AREA_GRIDNODES];
+	int cells;                  // cells per axis
+	vec3_t scale;
+	vec3_t halfsize;            // half of the cell size
+	link_t *grid;               // cells * cells
+	int numlinked;
+} areagridlevel_t;
+
+typedef struct
+{
+	areagridlevel_t levels[AREA_GRID_LEVELS];
+	link_t nodes[AREA_GRIDNODES];
 	link_t outside;
+	int numoutside;
 	vec3_t bias;
-	vec3_t scale;
 	vec3_t mins;
 	vec3_t maxs;
 	vec3_t size;
-	int marknumber;
-	// since the areagrid can have multiple references to one entity,
-	// we should avoid extensive checking on entities already encountered
-	int entmarknumber[MAX_EDICTS];
 } areagrid_t;
 
 static areagrid_t g_areagrid;
 
+// set while the thread is moving a player ahead of time, see G_PlayerMove_Speculate
+static ATTRIBUTE_THREAD_LOCAL gclipspeculation_t *gclip_speculation;
+
 extern cvar_t *g_antilag;
 extern cvar_t *g_antilag_maxtimedelta;
 
-#define	CFRAME_UPDATE_BACKUP	64  // copies of entity_state_t to keep buffered (1 second of backup at 62 fps).
+#define	CFRAME_UPDATE_BACKUP	64  // frames of collision data to keep buffered (1 second of backup at 62 fps).
 #define	CFRAME_UPDATE_MASK	( CFRAME_UPDATE_BACKUP-1 )
 
+#define CFRAME_MAX_POSES	( CFRAME_UPDATE_BACKUP * MAX_EDICTS )  // room for every frame full of solid entities
+#define CFRAME_POSES_MASK	( CFRAME_MAX_POSES-1 )
+
+#define CFRAME_STATE_INUSE	0x80
+
 typedef struct c4clipedict_s
 {
 	entity_state_t s;
 	entity_shared_t	r;
 } c4clipedict_t;
 
+// collision relevant data of the backed up entities, stored as
+// separate arrays so bounds checks don't pull in the rest
+typedef struct c4poses_s
+{
+	vec3_t absmin[CFRAME_MAX_POSES];
+	vec3_t absmax[CFRAME_MAX_POSES];
+	vec3_t origin[CFRAME_MAX_POSES];
+	vec3_t angles[CFRAME_MAX_POSES];
+	vec3_t mins[CFRAME_MAX_POSES];
+	vec3_t maxs[CFRAME_MAX_POSES];
+	int modelindex[CFRAME_MAX_POSES];
+	uint8_t type[CFRAME_MAX_POSES];
+} c4poses_t;
+
 //backups of all server frames areas and edicts
 typedef struct c4frame_s
 {
-	c4clipedict_t clipEdicts[MAX_EDICTS];   // fixme: there is a g_maxentities cvar. We have to adjust to it
 	int numedicts;
+	uint8_t state[MAX_EDICTS];          // inuse and solid, to detect respawns and such
+	short pose[MAX_EDICTS];             // offset from firstPose, -1 if not backed up
+
+	unsigned int firstPose;             // into the poses ring, grows forever
+	int numPoses;
 
 	unsigned int timestamp;
 	unsigned int framenum;
 } c4frame_t;
 
-c4frame_t sv_collisionframes[CFRAME_UPDATE_BACKUP];
+// the point in time a query looks at
+typedef struct c4backtime_s
+{
+	int frame;                          // backed up frames to step back, 0 for current time
+	bool lerp;                          // interpolate towards the next newer frame
+	float lerpFrac;
+} c4backtime_t;
+
+static c4frame_t sv_collisionframes[CFRAME_UPDATE_BACKUP];
+static c4poses_t sv_collisionposes;
+static unsigned int sv_collisionPoseNum = 0;
 static unsigned int sv_collisionFrameNum = 0;
 
+static inline bool GClip_EntityHasBackup( const edict_t *ent, int entNum )
+{
+	return ent->r.inuse && ent->r.solid != SOLID_NOT 
+		&& ( ent->r.solid != SOLID_TRIGGER || ( entNum >= 1 && entNum <= gs.maxclients ) );
+}
+
+static inline uint8_t GClip_EntityBackupState( const edict_t *ent )
+{
+	return ( ent->r.inuse ? CFRAME_STATE_INUSE : 0 ) | ( ent->r.solid & ~CFRAME_STATE_INUSE );
+}
+
 void GClip_BackUpCollisionFrame( void )
 {
 	c4frame_t *cframe;
+	c4poses_t *poses = &sv_collisionposes;
 	edict_t	*svedict;
-	int i;
+	int i, p;
 
 	if( !g_antilag->integer )
 		return;
@@ -105,53 +166,55 @@ void GClip_BackUpCollisionFrame( void )
 	cframe->framenum = sv_collisionFrameNum;
 	sv_collisionFrameNum++;
 
-	//memset( cframe->clipEdicts, 0, sizeof(cframe->clipEdicts) );
+	cframe->numedicts = game.numentities;
+	cframe->firstPose = sv_collisionPoseNum;
+	cframe->numPoses = 0;
 
 	//backup edicts
-	for( i = 0; i < game.numentities; i++ )
+	for( i = 0; i < cframe->numedicts; i++ )
 	{
 		svedict = &game.edicts[i];
 
-		cframe->clipEdicts[i].r.inuse = svedict->r.inuse;
-		cframe->clipEdicts[i].r.solid = svedict->r.solid;
-		if( !svedict->r.inuse || svedict->r.solid == SOLID_NOT 
-			|| ( svedict->r.solid == SOLID_TRIGGER && !(i >= 1 && i <= gs.maxclients) ) )
+		cframe->state[i] = GClip_EntityBackupState( svedict );
+		if( !GClip_EntityHasBackup( svedict, i ) )
+		{
+			cframe->pose[i] = -1;
 			continue;
+		}
 
-		cframe->clipEdicts[i].r = svedict->r;
-		cframe->clipEdicts[i].s = svedict->s;
+		p = ( cframe->firstPose + cframe->numPoses ) & CFRAME_POSES_MASK;
+		cframe->pose[i] = cframe->numPoses++;
+
+		VectorCopy( svedict->r.absmin, poses->absmin[p] );
+		VectorCopy( svedict->r.absmax, poses->absmax[p] );
+		VectorCopy( svedict->s.origin, poses->origin[p] );
+		VectorCopy( svedict->s.angles, poses->angles[p] );
+		VectorCopy( svedict->r.mins, poses->mins[p] );
+		VectorCopy( svedict->r.maxs, poses->maxs[p] );
+		poses->modelindex[p] = svedict->s.modelindex;
+		poses->type[p] = svedict->s.type;
 	}
-	cframe->numedicts = game.numentities;
+
+	sv_collisionPoseNum += cframe->numPoses;
 }
 
-static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime )
+/*
+* GClip_SetupBackTime
+* 
+* Finds the backed up frames around the given time delta, once for all the
+* entities looked up by a query.
+*/
+static void GClip_SetupBackTime( int deltaTime, c4backtime_t *bt )
 {
-	static int index = 0;
-	static c4clipedict_t clipEnts[8];
-	static c4clipedict_t *clipent;
-	static c4clipedict_t clipentNewer; // for interpolation
-	c4frame_t *cframe = NULL;
-	unsigned int backTime, cframenum, bf, i;
-	edict_t	*ent = game.edicts + entNum;
+	c4frame_t *cframe = NULL, *cframeNewer;
+	unsigned int backTime, cframenum, bf;
 
-	// pick one of the 8 slots to prevent overwritings
-	clipent = &clipEnts[index];
-	index = ( index + 1 )&7;
-
-	if( !entNum || deltaTime >= 0 || !g_antilag->integer )
-	{                                                    // current time entity
-		clipent->r = ent->r;
-		clipent->s = ent->s;
-		return clipent;
-	}
+	bt->frame = 0;
+	bt->lerp = false;
+	bt->lerpFrac = 0;
 
-	if( !ent->r.inuse || ent->r.solid == SOLID_NOT 
-		|| ( ent->r.solid == SOLID_TRIGGER && !(entNum >= 1 && entNum <= gs.maxclients) ) )
-	{
-		clipent->r = ent->r;
-		clipent->s = ent->s;
-		return clipent;
-	}
+	if( deltaTime >= 0 || !g_antilag->integer )
+		return; // current time
 
 	// clamp delta time inside the backed up limits
 	backTime = abs( deltaTime );
@@ -167,81 +230,180 @@ static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime
 	cframenum = sv_collisionFrameNum;
 	for( bf = 1; bf < CFRAME_UPDATE_BACKUP && bf < sv_collisionFrameNum; bf++ ) // never overpass limits
 	{
-		cframe = &sv_collisionframes[( cframenum-bf ) & CFRAME_UPDATE_MASK];
+		c4frame_t *frame = &sv_collisionframes[( cframenum-bf ) & CFRAME_UPDATE_MASK];
 
-		// if solid has changed, we can't keep moving backwards
-		if( ent->r.solid != cframe->clipEdicts[entNum].r.solid 
-			|| ent->r.inuse != cframe->clipEdicts[entNum].r.inuse )
+		// the poses of this one have been overwritten already, can't happen
+		// unless CFRAME_MAX_POSES is lowered below the worst case
+		if( sv_collisionPoseNum - frame->firstPose > CFRAME_MAX_POSES )
 		{
-			bf--;
-			if( bf == 0 )
-			{
-				// we can't step back from first
-				cframe = NULL;
-			}
-			else
-			{
-				cframe = &sv_collisionframes[( cframenum-bf ) & CFRAME_UPDATE_MASK];
-			}
+			if( developer->integer )
+				G_Printf( "GClip_SetupBackTime: antilag history overwritten after %i frames\n", bf - 1 );
 			break;
 		}
 
+		cframe = frame;
+		bt->frame = bf;
 		if( game.serverTime >= cframe->timestamp + backTime )
 			break;
 	}
 
-	if( !cframe )
-	{
-		// current time entity
-		clipent->r = ent->r;
-		clipent->s = ent->s;
-		return clipent;
-	}
-
-	// setup with older for the data that is not interpolated
-	*clipent = cframe->clipEdicts[entNum];
-
 	// if we found an older than desired backtime frame, interpolate to find a more precise position.
-	if( game.serverTime > cframe->timestamp+backTime )
+	if( cframe && game.serverTime > cframe->timestamp + backTime )
 	{
-		float lerpFrac;
-
-		if( bf == 1 )
+		bt->lerp = true;
+		if( bt->frame == 1 )
 		{
 			// interpolate from 1st backed up to current
-			lerpFrac = (float)( ( game.serverTime - backTime ) - cframe->timestamp ) 
+			bt->lerpFrac = (float)( ( game.serverTime - backTime ) - cframe->timestamp ) 
 				/ (float)( game.serverTime - cframe->timestamp );
-			clipentNewer.r = ent->r;
-			clipentNewer.s = ent->s;
 		}
 		else
 		{
 			// interpolate between 2 backed up
-			c4frame_t *cframeNewer = &sv_collisionframes[( cframenum-( bf-1 ) ) & CFRAME_UPDATE_MASK];
-			lerpFrac = (float)( ( game.serverTime - backTime ) - cframe->timestamp ) 
+			cframeNewer = &sv_collisionframes[( cframenum-( bt->frame-1 ) ) & CFRAME_UPDATE_MASK];
+			bt->lerpFrac = (float)( ( game.serverTime - backTime ) - cframe->timestamp ) 
 				/ (float)( cframeNewer->timestamp - cframe->timestamp );
-			clipentNewer = cframeNewer->clipEdicts[entNum];
 		}
+	}
 
 #if 0
-		G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i lerfrac:%f\n",
-			backTime, game.serverTime - cframe->timestamp, backframes, lerpFrac );
+	G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i lerfrac:%f\n",
+		backTime, cframe ? game.serverTime - cframe->timestamp : 0, bt->frame, bt->lerpFrac );
 #endif
+}
 
-		// interpolate
-		VectorLerp( clipent->s.origin, lerpFrac, clipentNewer.s.origin, clipent->s.origin );
-		VectorLerp( clipent->r.mins, lerpFrac, clipentNewer.r.mins, clipent->r.mins );
-		VectorLerp( clipent->r.maxs, lerpFrac, clipentNewer.r.maxs, clipent->r.maxs );
-		for( i = 0; i < 3; i++ )
-			clipent->s.angles[i] = LerpAngle( clipent->s.angles[i], clipentNewer.s.angles[i], lerpFrac );
+/*
+* GClip_BackTimeFrameForEntity
+* 
+* Returns how many frames the entity can be stepped back, and
+* whether it has to be interpolated with the newer one.
+*/
+static int GClip_BackTimeFrameForEntity( int entNum, const c4backtime_t *bt, bool *lerp )
+{
+	const edict_t *ent = game.edicts + entNum;
+	const c4frame_t *cframe;
+	uint8_t state;
+	int bf;
+
+	*lerp = false;
+	if( !entNum || !bt || !bt->frame || !GClip_EntityHasBackup( ent, entNum ) )
+		return 0;
+
+	state = GClip_EntityBackupState( ent );
+	for( bf = 1; bf <= bt->frame; bf++ )
+	{
+		cframe = &sv_collisionframes[( sv_collisionFrameNum-bf ) & CFRAME_UPDATE_MASK];
+
+		// if solid has changed, we can't keep moving backwards
+		if( entNum >= cframe->numedicts || cframe->state[entNum] != state )
+			return bf - 1;
 	}
 
-#if 0
-	G_Printf( "backTime:%i cframeBackTime:%i backFrames:%i\n", backTime,
-		game.serverTime - cframe->timestamp, backframes );
-#endif
+	*lerp = bt->lerp;
+	return bt->frame;
+}
+
+static inline int GClip_BackUpPoseIndex( int entNum, int bf )
+{
+	const c4frame_t *cframe = &sv_collisionframes[( sv_collisionFrameNum-bf ) & CFRAME_UPDATE_MASK];
+
+	assert( cframe->pose[entNum] >= 0 );
+	return ( cframe->firstPose + cframe->pose[entNum] ) & CFRAME_POSES_MASK;
+}
+
+/*
+* GClip_BackTimeBounds
+* 
+* Absolute bounds of the entity at the back time, without interpolation
+*/
+static void GClip_BackTimeBounds( int entNum, const c4backtime_t *bt, const float **absmin, const float **absmax )
+{
+	const edict_t *ent = game.edicts + entNum;
+	bool lerp;
+	int bf, p;
+
+	bf = GClip_BackTimeFrameForEntity( entNum, bt, &lerp );
+	if( !bf )
+	{
+		*absmin = ent->r.absmin;
+		*absmax = ent->r.absmax;
+		return;
+	}
+
+	p = GClip_BackUpPoseIndex( entNum, bf );
+	*absmin = sv_collisionposes.absmin[p];
+	*absmax = sv_collisionposes.absmax[p];
+}
+
+/*
+* GClip_BackTimeClipEdict
+*/
+static void GClip_BackTimeClipEdict( int entNum, const c4backtime_t *bt, c4clipedict_t *clipent )
+{
+	const edict_t *ent = game.edicts + entNum;
+	const c4poses_t *poses = &sv_collisionposes;
+	const float *newerOrigin, *newerAngles, *newerMins, *newerMaxs;
+	bool lerp;
+	int bf, p, pn, i;
+
+	clipent->r = ent->r;
+	clipent->s = ent->s;
+
+	bf = GClip_BackTimeFrameForEntity( entNum, bt, &lerp );
+	if( !bf )
+		return; // current time entity
+
+	// setup with older for the data that is not interpolated
+	p = GClip_BackUpPoseIndex( entNum, bf );
+	VectorCopy( poses->absmin[p], clipent->r.absmin );
+	VectorCopy( poses->absmax[p], clipent->r.absmax );
+	VectorCopy( poses->origin[p], clipent->s.origin );
+	VectorCopy( poses->angles[p], clipent->s.angles );
+	VectorCopy( poses->mins[p], clipent->r.mins );
+	VectorCopy( poses->maxs[p], clipent->r.maxs );
+	clipent->s.modelindex = poses->modelindex[p];
+	clipent->s.type = poses->type[p];
+
+	if( !lerp )
+		return;
+
+	if( bf == 1 )
+	{
+		newerOrigin = ent->s.origin;
+		newerAngles = ent->s.angles;
+		newerMins = ent->r.mins;
+		newerMaxs = ent->r.maxs;
+	}
+	else
+	{
+		pn = GClip_BackUpPoseIndex( entNum, bf - 1 );
+		newerOrigin = poses->origin[pn];
+		newerAngles = poses->angles[pn];
+		newerMins = poses->mins[pn];
+		newerMaxs = poses->maxs[pn];
+	}
+
+	// interpolate
+	VectorLerp( clipent->s.origin, bt->lerpFrac, newerOrigin, clipent->s.origin );
+	VectorLerp( clipent->r.mins, bt->lerpFrac, newerMins, clipent->r.mins );
+	VectorLerp( clipent->r.maxs, bt->lerpFrac, newerMaxs, clipent->r.maxs );
+	for( i = 0; i < 3; i++ )
+		clipent->s.angles[i] = LerpAngle( clipent->s.angles[i], newerAngles[i], bt->lerpFrac );
+}
+
+static c4clipedict_t *GClip_GetClipEdictForDeltaTime( int entNum, int deltaTime )
+{
+	static int index = 0;
+	static c4clipedict_t clipEnts[8];
+	c4clipedict_t *clipent;
+	c4backtime_t bt;
 
-	// back time entity
+	// pick one of the 8 slots to prevent overwritings
+	clipent = &clipEnts[index];
+	index = ( index + 1 )&7;
+
+	GClip_SetupBackTime( deltaTime, &bt );
+	GClip_BackTimeClipEdict( entNum, &bt, clipent );
 	return clipent;
 }
 
@@ -273,12 +435,8 @@ static void GClip_InsertLinkBefore( link_t *l, link_t *before, int entNum )
 */
 static void GClip_Init_AreaGrid( areagrid_t *areagrid, const vec3_t world_mins, const vec3_t world_maxs )
 {
-	int i;
-
-	// the areagrid_marknumber is not allowed to be 0
-	if( areagrid->marknumber < 1 ) {
-		areagrid->marknumber = 1;
-	}
+	int i, j, numnodes;
+	areagridlevel_t *level;
 
 	// choose either the world box size, or a larger box to ensure the grid isn't too fine
 	areagrid->size[0] = max( world_maxs[0] - world_mins[0], AREA_GRID * AREA_GRIDMINSIZE );
@@ -295,25 +453,35 @@ static void GClip_Init_AreaGrid( areagrid_t *areagrid, const vec3_t world_mins,
 
 	// now calculate the actual useful info from that
 	VectorNegate( areagrid->mins, areagrid->bias );
-	areagrid->scale[0] = AREA_GRID / areagrid->size[0];
-	areagrid->scale[1] = AREA_GRID / areagrid->size[1];
-	areagrid->scale[2] = AREA_GRID / areagrid->size[2];
+
+	numnodes = 0;
+	for( i = 0; i < AREA_GRID_LEVELS; i++ ) {
+		level = &areagrid->levels[i];
+		level->cells = AREA_GRID >> i;
+		for( j = 0; j < 3; j++ ) {
+			level->scale[j] = level->cells / areagrid->size[j];
+			level->halfsize[j] = areagrid->size[j] * 0.5f / level->cells;
+		}
+		level->grid = areagrid->nodes + numnodes;
+		numnodes += level->cells * level->cells;
+		level->numlinked = 0;
+	}
+	assert( numnodes == AREA_GRIDNODES );
 
 	GClip_ClearLink( &areagrid->outside );
+	areagrid->numoutside = 0;
 	for( i = 0; i < AREA_GRIDNODES; i++ ) {
-		GClip_ClearLink( &areagrid->grid[i] );
+		GClip_ClearLink( &areagrid->nodes[i] );
 	}
 
-	memset( areagrid->entmarknumber, 0, sizeof( areagrid->entmarknumber ) );
-
 	if( developer->integer ) {
-		Com_Printf( "areagrid settings: divisions %ix%ix1 : box %f %f %f "
+		Com_Printf( "areagrid settings: divisions %ix%ix1 in %i levels : box %f %f %f "
 			": %f %f %f size %f %f %f grid %f %f %f (mingrid %f)\n", 
-			AREA_GRID, AREA_GRID, 
+			AREA_GRID, AREA_GRID, AREA_GRID_LEVELS, 
 			areagrid->mins[0], areagrid->mins[1], areagrid->mins[2],
 			areagrid->maxs[0], areagrid->maxs[1], areagrid->maxs[2], 
 			areagrid->size[0], areagrid->size[1], areagrid->size[2], 
-			1.0f / areagrid->scale[0], 1.0f / areagrid->scale[1], 1.0f / areagrid->scale[2], 
+			areagrid->levels[0].halfsize[0] * 2, areagrid->levels[0].halfsize[1] * 2, areagrid->levels[0].halfsize[2] * 2, 
 			AREA_GRIDMINSIZE );
 	}
 }
@@ -321,14 +489,19 @@ static void GClip_Init_AreaGrid( areagrid_t *areagrid, const vec3_t world_mins,
 /*
 * GClip_UnlinkEntity_AreaGrid
 */
-static void GClip_UnlinkEntity_AreaGrid( edict_t *ent )
+static void GClip_UnlinkEntity_AreaGrid( areagrid_t *areagrid, edict_t *ent )
 {
-	for( int i = 0; i < MAX_ENT_AREAS; i++ ) {
-		if( !ent->areagrid[i].prev ) {
-			break;
-		}
-		GClip_RemoveLink( &ent->areagrid[i] );
-		ent->areagrid[i].prev = ent->areagrid[i].next = NULL;
+	if( !ent->areagrid.prev ) {
+		return;
+	}
+
+	GClip_RemoveLink( &ent->areagrid );
+	ent->areagrid.prev = ent->areagrid.next = NULL;
+
+	if( ent->areagridlevel < 0 ) {
+		areagrid->numoutside--;
+	} else {
+		areagrid->levels[ent->areagridlevel].numlinked--;
 	}
 }
 
@@ -337,8 +510,10 @@ static void GClip_UnlinkEntity_AreaGrid( edict_t *ent )
 */
 static void GClip_LinkEntity_AreaGrid( areagrid_t *areagrid, edict_t *ent )
 {
-	link_t *grid;
-	int igrid[3], igridmins[3], igridmaxs[3], gridnum, entitynumber;
+	areagridlevel_t *level;
+	vec3_t center;
+	float extent;
+	int i, entitynumber, igrid[2];
 	
 	entitynumber = NUM_FOR_EDICT( ent );
 	if( entitynumber <= 0 || entitynumber >= game.maxentities || EDICT_NUM( entitynumber ) != ent )
@@ -349,145 +524,540 @@ static void GClip_LinkEntity_AreaGrid( areagrid_t *areagrid, edict_t *ent )
 		return;
 	}
 
-	igridmins[0] = (int) floor( (ent->r.absmin[0] + areagrid->bias[0]) * areagrid->scale[0] );
-	igridmins[1] = (int) floor( (ent->r.absmin[1] + areagrid->bias[1]) * areagrid->scale[1] );
-	//igridmins[2] = (int) floor( (ent->r.absmin[2] + areagrid->bias[2]) * areagrid->scale[2] );
-	igridmaxs[0] = (int) floor( (ent->r.absmax[0] + areagrid->bias[0]) * areagrid->scale[0] ) + 1;
-	igridmaxs[1] = (int) floor( (ent->r.absmax[1] + areagrid->bias[1]) * areagrid->scale[1] ) + 1;
-	//igridmaxs[2] = (int) floor( (ent->r.absmax[2] + areagrid->bias[2]) * areagrid->scale[2] ) + 1;
+	extent = max( ent->r.absmax[0] - ent->r.absmin[0], ent->r.absmax[1] - ent->r.absmin[1] );
+	VectorAdd( ent->r.absmin, ent->r.absmax, center );
+	VectorScale( center, 0.5f, center );
+
+	for( i = 0; i < AREA_GRID_LEVELS; i++ ) {
+		level = &areagrid->levels[i];
+		if( extent > level->halfsize[0] * 2 || extent > level->halfsize[1] * 2 ) {
+			continue; // too big for this level
+		}
+
+		igrid[0] = (int) floor( (center[0] + areagrid->bias[0]) * level->scale[0] );
+		igrid[1] = (int) floor( (center[1] + areagrid->bias[1]) * level->scale[1] );
+		if( igrid[0] < 0 || igrid[0] >= level->cells || igrid[1] < 0 || igrid[1] >= level->cells ) {
+			break; // all levels cover the same box
+		}
+
+		GClip_InsertLinkBefore( &ent->areagrid, &level->grid[igrid[1] * level->cells + igrid[0]], entitynumber );
+		level->numlinked++;
+		ent->areagridlevel = i;
+		return;
+	}
+
+	// wow, something outside the grid or bigger than all of it, store it as such
+	GClip_InsertLinkBefore( &ent->areagrid, &areagrid->outside, entitynumber );
+	areagrid->numoutside++;
+	ent->areagridlevel = -1;
+}
+
+/*
+* GClip_EntitiesInCell_AreaGrid
+*/
+static int GClip_EntitiesInCell_AreaGrid( const link_t *grid, const vec3_t mins, const vec3_t maxs, 
+	const float *org, float radius, int *list, int maxcount, int numlist, int areatype, const c4backtime_t *bt )
+{
+	const link_t *l;
+	const edict_t *ent;
+	const float *absmin, *absmax;
+
+	for( l = grid->next; l != grid; l = l->next ) {
+		// inuse and solid never change along the backed up frames we step into
+		ent = game.edicts + l->entNum;
+		if( !ent->r.inuse ) {
+			continue; // deactivated
+		}
+		if( areatype == AREA_TRIGGERS && ent->r.solid != SOLID_TRIGGER ) {
+			continue;
+		}
+		if( areatype == AREA_SOLID && 
+			( ent->r.solid == SOLID_TRIGGER || ent->r.solid == SOLID_NOT ) ) {
+			continue;
+		}
+
+		GClip_BackTimeBounds( l->entNum, bt, &absmin, &absmax );
+		if( !BoundsIntersect( mins, maxs, absmin, absmax ) ) {
+			continue;
+		}
+		if( org && !BoundsAndSphereIntersect( absmin, absmax, org, radius ) ) {
+			continue;
+		}
+
+		if( numlist < maxcount ) {
+			list[numlist] = l->entNum;
+		}
+		numlist++;
+	}
+
+	return numlist;
+}
+
+/*
+* GClip_EntitiesInBox_AreaGrid
+* 
+* When org is set, only the entities also touching the sphere of the given radius are returned
+*/
+static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, const vec3_t mins, const vec3_t maxs, 
+	const float *org, float radius, int *list, int maxcount, int areatype, const c4backtime_t *bt )
+{
+	int i, numlist;
+	const areagridlevel_t *level;
+	const link_t *grid;
+	int igrid[2], igridmins[2], igridmaxs[2];
+
+	numlist = 0;
+
+	// add entities not linked into areagrid because they are too big or
+	// outside the grid bounds
+	if( areagrid->numoutside ) {
+		numlist = GClip_EntitiesInCell_AreaGrid( &areagrid->outside, mins, maxs, 
+			org, radius, list, maxcount, numlist, areatype, bt );
+	}
+
+	// add grid linked entities
+	for( i = 0; i < AREA_GRID_LEVELS; i++ ) {
+		level = &areagrid->levels[i];
+		if( !level->numlinked ) {
+			continue;
+		}
+
+		// loose cells: the entities may stick out half a cell
+		igridmins[0] = (int) floor( (mins[0] - level->halfsize[0] + areagrid->bias[0]) * level->scale[0] );
+		igridmins[1] = (int) floor( (mins[1] - level->halfsize[1] + areagrid->bias[1]) * level->scale[1] );
+		igridmaxs[0] = (int) floor( (maxs[0] + level->halfsize[0] + areagrid->bias[0]) * level->scale[0] ) + 1;
+		igridmaxs[1] = (int) floor( (maxs[1] + level->halfsize[1] + areagrid->bias[1]) * level->scale[1] ) + 1;
+		igridmins[0] = max( 0, igridmins[0] );
+		igridmins[1] = max( 0, igridmins[1] );
+		igridmaxs[0] = min( level->cells, igridmaxs[0] );
+		igridmaxs[1] = min( level->cells, igridmaxs[1] );
+
+		for( igrid[1] = igridmins[1]; igrid[1] < igridmaxs[1]; igrid[1]++ ) {
+			grid = level->grid + igrid[1] * level->cells + igridmins[0];
+			for( igrid[0] = igridmins[0]; igrid[0] < igridmaxs[0]; igrid[0]++, grid++ ) {
+				if( grid->next == grid ) {
+					continue;
+				}
+				numlist = GClip_EntitiesInCell_AreaGrid( grid, mins, maxs, 
+					org, radius, list, maxcount, numlist, areatype, bt );
+			}
+		}
+	}
+
+	return numlist;
+}
+
+// the fixed 128x128 grid the loose grid replaced, only kept as the areabench baseline.
+// Entities are linked into every cell they overlap, queries mark them to skip duplicates.
+#define AREA_FLATGRID_MAXCELLS	16	// entities overlapping more cells go to the outside list
+
+typedef struct
+{
+	link_t grid[AREA_GRID * AREA_GRID];
+	link_t outside;
+	link_t links[MAX_EDICTS][AREA_FLATGRID_MAXCELLS];
+	vec3_t bias;
+	vec3_t scale;
+	int marknumber;
+	int entmarknumber[MAX_EDICTS];
+} areaflatgrid_t;
+
+/*
+* GClip_Init_FlatGrid
+*/
+static void GClip_Init_FlatGrid( areaflatgrid_t *flatgrid, const areagrid_t *areagrid )
+{
+	int i;
+
+	VectorCopy( areagrid->bias, flatgrid->bias );
+	flatgrid->scale[0] = AREA_GRID / areagrid->size[0];
+	flatgrid->scale[1] = AREA_GRID / areagrid->size[1];
+	flatgrid->scale[2] = AREA_GRID / areagrid->size[2];
+
+	GClip_ClearLink( &flatgrid->outside );
+	for( i = 0; i < AREA_GRID * AREA_GRID; i++ ) {
+		GClip_ClearLink( &flatgrid->grid[i] );
+	}
+
+	flatgrid->marknumber = 1;
+	memset( flatgrid->entmarknumber, 0, sizeof( flatgrid->entmarknumber ) );
+}
+
+/*
+* GClip_LinkEntity_FlatGrid
+*/
+static void GClip_LinkEntity_FlatGrid( areaflatgrid_t *flatgrid, edict_t *ent )
+{
+	link_t *grid, *links;
+	int igrid[2], igridmins[2], igridmaxs[2], gridnum, entitynumber;
+
+	entitynumber = NUM_FOR_EDICT( ent );
+	links = flatgrid->links[entitynumber];
+
+	igridmins[0] = (int) floor( (ent->r.absmin[0] + flatgrid->bias[0]) * flatgrid->scale[0] );
+	igridmins[1] = (int) floor( (ent->r.absmin[1] + flatgrid->bias[1]) * flatgrid->scale[1] );
+	igridmaxs[0] = (int) floor( (ent->r.absmax[0] + flatgrid->bias[0]) * flatgrid->scale[0] ) + 1;
+	igridmaxs[1] = (int) floor( (ent->r.absmax[1] + flatgrid->bias[1]) * flatgrid->scale[1] ) + 1;
 	if( igridmins[0] < 0 || igridmaxs[0] > AREA_GRID 
 		|| igridmins[1] < 0 || igridmaxs[1] > AREA_GRID 
-		|| ((igridmaxs[0] - igridmins[0]) * (igridmaxs[1] - igridmins[1])) > MAX_ENT_AREAS )
+		|| ((igridmaxs[0] - igridmins[0]) * (igridmaxs[1] - igridmins[1])) > AREA_FLATGRID_MAXCELLS )
 	{
-		// wow, something outside the grid, store it as such
-		GClip_InsertLinkBefore( &ent->areagrid[0], &areagrid->outside, entitynumber );
+		GClip_InsertLinkBefore( &links[0], &flatgrid->outside, entitynumber );
 		return;
 	}
 
 	gridnum = 0;
 	for( igrid[1] = igridmins[1]; igrid[1] < igridmaxs[1]; igrid[1]++ ) {
-		grid = areagrid->grid + igrid[1] * AREA_GRID + igridmins[0];
+		grid = flatgrid->grid + igrid[1] * AREA_GRID + igridmins[0];
 		for( igrid[0] = igridmins[0]; igrid[0] < igridmaxs[0]; igrid[0]++, grid++, gridnum++ )
-			GClip_InsertLinkBefore( &ent->areagrid[gridnum], grid, entitynumber );
+			GClip_InsertLinkBefore( &links[gridnum], grid, entitynumber );
 	}
 }
 
 /*
-* GClip_EntitiesInBox_AreaGrid
+* GClip_EntitiesInList_FlatGrid
 */
-static int GClip_EntitiesInBox_AreaGrid( areagrid_t *areagrid, const vec3_t mins, const vec3_t maxs, 
-	int *list, int maxcount, int areatype, int timeDelta )
+static int GClip_EntitiesInList_FlatGrid( areaflatgrid_t *flatgrid, const link_t *grid, const vec3_t mins, const vec3_t maxs, 
+	const float *org, float radius, int *list, int maxcount, int numlist, int areatype )
+{
+	const link_t *l;
+	const edict_t *ent;
+
+	for( l = grid->next; l != grid; l = l->next ) {
+		if( flatgrid->entmarknumber[l->entNum] == flatgrid->marknumber ) {
+			continue;
+		}
+		flatgrid->entmarknumber[l->entNum] = flatgrid->marknumber;
+
+		ent = game.edicts + l->entNum;
+		if( !ent->r.inuse ) {
+			continue;
+		}
+		if( areatype == AREA_TRIGGERS && ent->r.solid != SOLID_TRIGGER ) {
+			continue;
+		}
+		if( areatype == AREA_SOLID && 
+			( ent->r.solid == SOLID_TRIGGER || ent->r.solid == SOLID_NOT ) ) {
+			continue;
+		}
+		if( !BoundsIntersect( mins, maxs, ent->r.absmin, ent->r.absmax ) ) {
+			continue;
+		}
+		if( org && !BoundsAndSphereIntersect( ent->r.absmin, ent->r.absmax, org, radius ) ) {
+			continue;
+		}
+
+		if( numlist < maxcount ) {
+			list[numlist] = l->entNum;
+		}
+		numlist++;
+	}
+
+	return numlist;
+}
+
+/*
+* GClip_EntitiesInBox_FlatGrid
+*/
+static int GClip_EntitiesInBox_FlatGrid( areaflatgrid_t *flatgrid, const vec3_t mins, const vec3_t maxs, 
+	const float *org, float radius, int *list, int maxcount, int areatype )
 {
 	int numlist;
-	link_t *grid;
-	link_t *l;
-	c4clipedict_t *clipEnt;
-	vec3_t paddedmins, paddedmaxs;
-	int igrid[3], igridmins[3], igridmaxs[3];
-
-	// LordHavoc: discovered this actually causes its own bugs (dm6 teleporters 
-	// being too close to info_teleport_destination)
-	//VectorSet( paddedmins, mins[0] - 1.0f, mins[1] - 1.0f, mins[2] - 1.0f );
-	//VectorSet( paddedmaxs, maxs[0] + 1.0f, maxs[1] + 1.0f, maxs[2] + 1.0f );
-	VectorCopy( mins, paddedmins );
-	VectorCopy( maxs, paddedmaxs );
-
-	// FIXME: if areagrid_marknumber wraps, all entities need their
-	// ent->priv.server->areagridmarknumber reset
-	areagrid->marknumber++;
-
-	igridmins[0] = (int) floor( (paddedmins[0] + areagrid->bias[0]) * areagrid->scale[0] );
-	igridmins[1] = (int) floor( (paddedmins[1] + areagrid->bias[1]) * areagrid->scale[1] );
-	//igridmins[2] = (int) ( (paddedmins[2] + areagrid->bias[2]) * areagrid->scale[2] );
-	igridmaxs[0] = (int) floor( (paddedmaxs[0] + areagrid->bias[0]) * areagrid->scale[0] ) + 1;
-	igridmaxs[1] = (int) floor( (paddedmaxs[1] + areagrid->bias[1]) * areagrid->scale[1] ) + 1;
-	//igridmaxs[2] = (int) ( (paddedmaxs[2] + areagrid->bias[2]) * areagrid->scale[2] ) + 1;
+	const link_t *grid;
+	int igrid[2], igridmins[2], igridmaxs[2];
+
+	flatgrid->marknumber++;
+
+	igridmins[0] = (int) floor( (mins[0] + flatgrid->bias[0]) * flatgrid->scale[0] );
+	igridmins[1] = (int) floor( (mins[1] + flatgrid->bias[1]) * flatgrid->scale[1] );
+	igridmaxs[0] = (int) floor( (maxs[0] + flatgrid->bias[0]) * flatgrid->scale[0] ) + 1;
+	igridmaxs[1] = (int) floor( (maxs[1] + flatgrid->bias[1]) * flatgrid->scale[1] ) + 1;
 	igridmins[0] = max( 0, igridmins[0] );
 	igridmins[1] = max( 0, igridmins[1] );
-	//igridmins[2] = max( 0, igridmins[2] );
 	igridmaxs[0] = min( AREA_GRID, igridmaxs[0] );
 	igridmaxs[1] = min( AREA_GRID, igridmaxs[1] );
-	//igridmaxs[2] = min( AREA_GRID, igridmaxs[2] );
 
-	// paranoid debugging
-	//VectorSet( igridmins, 0, 0, 0 );VectorSet( igridmaxs, AREA_GRID, AREA_GRID, AREA_GRID );
+	numlist = GClip_EntitiesInList_FlatGrid( flatgrid, &flatgrid->outside, mins, maxs, 
+		org, radius, list, maxcount, 0, areatype );
 
-	numlist = 0;
+	for( igrid[1] = igridmins[1]; igrid[1] < igridmaxs[1]; igrid[1]++ ) {
+		grid = flatgrid->grid + igrid[1] * AREA_GRID + igridmins[0];
+		for( igrid[0] = igridmins[0]; igrid[0] < igridmaxs[0]; igrid[0]++, grid++ ) {
+			numlist = GClip_EntitiesInList_FlatGrid( flatgrid, grid, mins, maxs, 
+				org, radius, list, maxcount, numlist, areatype );
+		}
+	}
 
-	// add entities not linked into areagrid because they are too big or
-	// outside the grid bounds
-	if( areagrid->outside.next )
+	return numlist;
+}
+
+/*
+* GClip_Benchmark_Cmd
+* 
+* Runs the box, radius and trigger queries the game does for every linked entity
+* through the area grid and through the fixed grid it replaced: areabench [iterations]
+*/
+void GClip_Benchmark_Cmd( void )
+{
+	int i, j, n, iterations, found[2];
+	unsigned int start, elapsed[2];
+	edict_t *ent;
+	vec3_t mins, maxs;
+	areaflatgrid_t *flatgrid;
+	static int list[MAX_EDICTS];
+
+	iterations = 1;
+	if( trap_Cmd_Argc() > 1 )
+		iterations = max( atoi( trap_Cmd_Argv( 1 ) ), 1 );
+
+	// link the current entities into the old grid, the same way GClip_LinkEntity did
+	flatgrid = ( areaflatgrid_t * )G_Malloc( sizeof( *flatgrid ) );
+	GClip_Init_FlatGrid( flatgrid, &g_areagrid );
+	for( j = 1, ent = game.edicts + 1; j < game.numentities; j++, ent++ )
 	{
-		grid = &areagrid->outside;
-		for( l = grid->next; l != grid; l = l->next ) {
-			clipEnt = GClip_GetClipEdictForDeltaTime( l->entNum, timeDelta );
+		if( ent->r.inuse && ent->linked )
+			GClip_LinkEntity_FlatGrid( flatgrid, ent );
+	}
 
-			if( areagrid->entmarknumber[l->entNum] == areagrid->marknumber ) {
-				continue;
-			}
-			areagrid->entmarknumber[l->entNum] = areagrid->marknumber;
+	for( n = 0; n < 2; n++ )
+	{
+		found[n] = 0;
+		start = trap_Milliseconds();
+		for( i = 0; i < iterations; i++ )
+		{
+			for( j = 1, ent = game.edicts + 1; j < game.numentities; j++, ent++ )
+			{
+				if( !ent->r.inuse || !ent->linked )
+					continue;
 
-			if( !clipEnt->r.inuse ) {
-				continue; // deactivated
-			}
-			if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
-				continue;
-			}
-			if( areatype == AREA_SOLID && 
-				( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
-				continue;
-			}
+				// a short trace, a splash and the triggers around
+				VectorSet( mins, ent->r.absmin[0] - 64, ent->r.absmin[1] - 64, ent->r.absmin[2] - 64 );
+				VectorSet( maxs, ent->r.absmax[0] + 64, ent->r.absmax[1] + 64, ent->r.absmax[2] + 64 );
 
-			if( BoundsIntersect( paddedmins, paddedmaxs, clipEnt->r.absmin, clipEnt->r.absmax )) {
-				if( numlist < maxcount ) {
-					list[numlist] = l->entNum;
+				if( !n )
+				{
+					found[n] += GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs, NULL, 0, 
+						list, MAX_EDICTS, AREA_SOLID, NULL );
+					found[n] += GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs, ent->s.origin, 64, 
+						list, MAX_EDICTS, AREA_ALL, NULL );
+					found[n] += GClip_EntitiesInBox_AreaGrid( &g_areagrid, ent->r.absmin, ent->r.absmax, NULL, 0, 
+						list, MAX_EDICTS, AREA_TRIGGERS, NULL );
+				}
+				else
+				{
+					found[n] += GClip_EntitiesInBox_FlatGrid( flatgrid, mins, maxs, NULL, 0, 
+						list, MAX_EDICTS, AREA_SOLID );
+					found[n] += GClip_EntitiesInBox_FlatGrid( flatgrid, mins, maxs, ent->s.origin, 64, 
+						list, MAX_EDICTS, AREA_ALL );
+					found[n] += GClip_EntitiesInBox_FlatGrid( flatgrid, ent->r.absmin, ent->r.absmax, NULL, 0, 
+						list, MAX_EDICTS, AREA_TRIGGERS );
 				}
-				numlist++;
 			}
 		}
+		elapsed[n] = trap_Milliseconds() - start;
 	}
 
-	// add grid linked entities
-	for( igrid[1] = igridmins[1]; igrid[1] < igridmaxs[1]; igrid[1]++ ) {
-		grid = areagrid->grid + igrid[1] * AREA_GRID + igridmins[0];
+	G_Free( flatgrid );
 
-		for( igrid[0] = igridmins[0]; igrid[0] < igridmaxs[0]; igrid[0]++, grid++ ) {
-			if( !grid->next ) {
-				continue;
-			}
+	G_Printf( "%i entities x %i iterations\n", game.numentities, iterations );
+	G_Printf( "loose grid: %u ms, %i found\n", elapsed[0], found[0] );
+	G_Printf( "fixed grid: %u ms, %i found\n", elapsed[1], found[1] );
+	if( found[0] != found[1] )
+		G_Printf( S_COLOR_RED "the grids disagree\n" );
+	for( i = 0; i < AREA_GRID_LEVELS; i++ )
+	{
+		G_Printf( "level %i (%ix%i cells of %.0f units): %i linked\n", i, 
+			g_areagrid.levels[i].cells, g_areagrid.levels[i].cells, g_areagrid.levels[i].halfsize[0] * 2, 
+			g_areagrid.levels[i].numlinked );
+	}
+	G_Printf( "outside: %i linked\n", g_areagrid.numoutside );
+}
 
-			for( l = grid->next; l != grid; l = l->next ) {
-				clipEnt = GClip_GetClipEdictForDeltaTime( l->entNum, timeDelta );
+//===========================================================================
 
-				if( areagrid->entmarknumber[l->entNum] == areagrid->marknumber ) {
-					continue;
-				}
-				areagrid->entmarknumber[l->entNum] = areagrid->marknumber;
+#define TRACECACHE_SIZE		1024	// must be a power of two
+#define TRACECACHE_MASK		( TRACECACHE_SIZE-1 )
 
-				if( !clipEnt->r.inuse ) {
-					continue; // deactivated
-				}
-				if( areatype == AREA_TRIGGERS && clipEnt->r.solid != SOLID_TRIGGER ) {
-					continue;
-				}
-				if( areatype == AREA_SOLID && 
-					( clipEnt->r.solid == SOLID_TRIGGER || clipEnt->r.solid == SOLID_NOT ) ) {
-					continue;
-				}
+// the world model never moves, but brush models are entities and aren't
+// part of these, so only the world part of traces and point contents is cached
+typedef struct
+{
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	int contentmask;
+} tracecachekey_t;
 
-				if( BoundsIntersect( paddedmins, paddedmaxs, clipEnt->r.absmin, clipEnt->r.absmax )) {
-					if( numlist < maxcount ) {
-						list[numlist] = l->entNum;
-					}
-					numlist++;
-				}
-			}
-		}
+typedef struct
+{
+	tracecachekey_t key;
+	unsigned int generation;    // the entry is valid while it matches the cache generation
+	trace_t trace;
+} tracecacheentry_t;
+
+typedef struct
+{
+	vec3_t point;
+	unsigned int generation;
+	int contents;
+} contentscacheentry_t;
+
+typedef struct
+{
+	unsigned int generation;    // bumped every game frame and on map changes
+	unsigned int framenum;
+
+	tracecacheentry_t traces[TRACECACHE_SIZE];
+	contentscacheentry_t contents[TRACECACHE_SIZE];
+
+	unsigned int numTraces, numTraceHits;
+	unsigned int numContents, numContentsHits;
+} tracecache_t;
+
+static tracecache_t g_tracecache;
+
+/*
+* GClip_TraceCacheHash
+*/
+static inline unsigned int GClip_TraceCacheHash( const void *key, size_t size )
+{
+	size_t i;
+	unsigned int hash = 2166136261u;
+	const uint8_t *data = ( const uint8_t * )key;
+
+	for( i = 0; i < size; i++ )
+		hash = ( hash ^ data[i] ) * 16777619u;
+	return hash;
+}
+
+/*
+* GClip_TraceCacheValidate
+* 
+* Drops everything cached in previous frames
+*/
+static inline void GClip_TraceCacheValidate( void )
+{
+	if( g_tracecache.framenum != level.framenum || !g_tracecache.generation )
+	{
+		g_tracecache.framenum = level.framenum;
+		g_tracecache.generation++;
 	}
+}
 
-	return numlist;
+/*
+* GClip_ClearTraceCache
+*/
+static void GClip_ClearTraceCache( void )
+{
+	g_tracecache.generation++;
+}
+
+/*
+* GClip_WorldTrace
+* 
+* Traces against the world model alone, reusing the result of identical
+* traces done in the same game frame
+*/
+static void GClip_WorldTrace( trace_t *tr, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int contentmask )
+{
+	tracecachekey_t key;
+	tracecacheentry_t *entry;
+
+	if( !g_tracecache_enable->integer )
+	{
+		trap_CM_TransformedBoxTrace( tr, start, end, mins, maxs, NULL, contentmask, NULL, NULL );
+		return;
+	}
+
+	memset( &key, 0, sizeof( key ) );
+	VectorCopy( start, key.start );
+	VectorCopy( end, key.end );
+	VectorCopy( mins, key.mins );
+	VectorCopy( maxs, key.maxs );
+	key.contentmask = contentmask;
+
+	entry = &g_tracecache.traces[GClip_TraceCacheHash( &key, sizeof( key ) ) & TRACECACHE_MASK];
+
+	// moves run ahead of time share the cache between threads, they only read it.
+	// The world doesn't change, so an entry left from a previous frame is still right
+	if( gclip_speculation )
+	{
+		if( entry->generation == g_tracecache.generation && !memcmp( &entry->key, &key, sizeof( key ) ) )
+			*tr = entry->trace;
+		else
+			trap_CM_TransformedBoxTrace( tr, start, end, mins, maxs, NULL, contentmask, NULL, NULL );
+		return;
+	}
+
+	GClip_TraceCacheValidate();
+
+	g_tracecache.numTraces++;
+
+	if( entry->generation == g_tracecache.generation && !memcmp( &entry->key, &key, sizeof( key ) ) )
+	{
+		g_tracecache.numTraceHits++;
+		*tr = entry->trace;
+		return;
+	}
+
+	trap_CM_TransformedBoxTrace( tr, start, end, mins, maxs, NULL, contentmask, NULL, NULL );
+
+	entry->key = key;
+	entry->generation = g_tracecache.generation;
+	entry->trace = *tr;
+}
+
+/*
+* GClip_WorldPointContents
+*/
+static int GClip_WorldPointContents( vec3_t p )
+{
+	contentscacheentry_t *entry;
+
+	if( !g_tracecache_enable->integer )
+		return trap_CM_TransformedPointContents( p, NULL, NULL, NULL );
+
+	entry = &g_tracecache.contents[GClip_TraceCacheHash( p, sizeof( vec3_t ) ) & TRACECACHE_MASK];
+
+	if( gclip_speculation )
+	{
+		if( entry->generation == g_tracecache.generation && VectorCompare( entry->point, p ) )
+			return entry->contents;
+		return trap_CM_TransformedPointContents( p, NULL, NULL, NULL );
+	}
+
+	GClip_TraceCacheValidate();
+
+	g_tracecache.numContents++;
+
+	if( entry->generation == g_tracecache.generation && VectorCompare( entry->point, p ) )
+	{
+		g_tracecache.numContentsHits++;
+		return entry->contents;
+	}
+
+	VectorCopy( p, entry->point );
+	entry->generation = g_tracecache.generation;
+	entry->contents = trap_CM_TransformedPointContents( p, NULL, NULL, NULL );
+	return entry->contents;
 }
 
+/*
+* GClip_TraceCacheStats_Cmd
+* 
+* Prints and resets the hit counters of the world trace cache
+*/
+void GClip_TraceCacheStats_Cmd( void )
+{
+	G_Printf( "traces: %u, %u cached (%.1f%%)\n", g_tracecache.numTraces, g_tracecache.numTraceHits, 
+		g_tracecache.numTraces ? g_tracecache.numTraceHits * 100.0 / g_tracecache.numTraces : 0.0 );
+	G_Printf( "point contents: %u, %u cached (%.1f%%)\n", g_tracecache.numContents, g_tracecache.numContentsHits, 
+		g_tracecache.numContents ? g_tracecache.numContentsHits * 100.0 / g_tracecache.numContents : 0.0 );
+	if( !g_tracecache_enable->integer )
+		G_Printf( "g_tracecache is disabled\n" );
+
+	g_tracecache.numTraces = g_tracecache.numTraceHits = 0;
+	g_tracecache.numContents = g_tracecache.numContentsHits = 0;
+}
 
 /*
 * GClip_ClearWorld
@@ -502,6 +1072,8 @@ void GClip_ClearWorld( void )
 	trap_CM_InlineModelBounds( world_model, world_mins, world_maxs );
 
 	GClip_Init_AreaGrid( &g_areagrid, world_mins, world_maxs );
+
+	GClip_ClearTraceCache();
 }
 
 /*
@@ -513,7 +1085,7 @@ void GClip_UnlinkEntity( edict_t *ent )
 {
 	if( !ent->linked )
 		return; // not linked in anywhere
-	GClip_UnlinkEntity_AreaGrid( ent );
+	GClip_UnlinkEntity_AreaGrid( &g_areagrid, ent );
 	ent->linked = false;
 }
 
@@ -715,12 +1287,27 @@ void GClip_SetAreaPortalState( edict_t *ent, bool open )
 * ??? does this always return the world?
 */
 static int GClip_AreaEdicts( const vec3_t mins, const vec3_t maxs, 
-	int *list, int maxcount, int areatype, int timeDelta )
+	int *list, int maxcount, int areatype, const c4backtime_t *bt )
 {
 	int count;
 
-	count = GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs, 
-		list, maxcount, areatype, timeDelta );
+	if( gclip_speculation && areatype == AREA_SOLID )
+	{
+		if( !gclip_speculation->queried )
+		{
+			VectorCopy( mins, gclip_speculation->mins );
+			VectorCopy( maxs, gclip_speculation->maxs );
+			gclip_speculation->queried = true;
+		}
+		else
+		{
+			AddPointToBounds( mins, gclip_speculation->mins, gclip_speculation->maxs );
+			AddPointToBounds( maxs, gclip_speculation->mins, gclip_speculation->maxs );
+		}
+	}
+
+	count = GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs, NULL, 0, 
+		list, maxcount, areatype, bt );
 
 	return min( count, maxcount );
 }
@@ -731,14 +1318,14 @@ static int GClip_AreaEdicts( const vec3_t mins, const vec3_t maxs,
 * Returns a collision model that can be used for testing or clipping an
 * object of mins/maxs size.
 */
-static struct cmodel_s *GClip_CollisionModelForEntity( entity_state_t *s, entity_shared_t *r )
+static struct cmodel_s *GClip_CollisionModelForEntity( int modelindex, int type, vec3_t mins, vec3_t maxs )
 {
 	struct cmodel_s	*model;
 
-	if( ISBRUSHMODEL( s->modelindex ) )
+	if( ISBRUSHMODEL( modelindex ) )
 	{ 
 		// explicit hulls in the BSP model
-		model = trap_CM_InlineModel( s->modelindex );
+		model = trap_CM_InlineModel( modelindex );
 		if( !model )
 			G_Error( "MOVETYPE_PUSH with a non bsp model" );
 
@@ -746,10 +1333,10 @@ static struct cmodel_s *GClip_CollisionModelForEntity( entity_state_t *s, entity
 	}
 
 	// create a temp hull from bounding box sizes
-	if( s->type == ET_PLAYER || s->type == ET_CORPSE )
-		return trap_CM_OctagonModelForBBox( r->mins, r->maxs );
+	if( type == ET_PLAYER || type == ET_CORPSE )
+		return trap_CM_OctagonModelForBBox( mins, maxs );
 	else
-		return trap_CM_ModelForBBox( r->mins, r->maxs );
+		return trap_CM_ModelForBBox( mins, maxs );
 }
 
 
@@ -760,29 +1347,47 @@ static struct cmodel_s *GClip_CollisionModelForEntity( entity_state_t *s, entity
 */
 static int GClip_PointContents( vec3_t p, int timeDelta )
 {
-	c4clipedict_t *clipEnt;
+	c4backtime_t bt;
+	c4clipedict_t clipEnt;
 	int touch[MAX_EDICTS];
 	int i, num;
 	int contents, c2;
 	struct cmodel_s	*cmodel;
 
 	// get base contents from world
-	contents = trap_CM_TransformedPointContents( p, NULL, NULL, NULL );
+	contents = GClip_WorldPointContents( p );
 
 	// or in contents from all the other entities
-	num = GClip_AreaEdicts( p, p, touch, MAX_EDICTS, AREA_SOLID, timeDelta );
+	GClip_SetupBackTime( timeDelta, &bt );
+	num = GClip_AreaEdicts( p, p, touch, MAX_EDICTS, AREA_SOLID, &bt );
 
 	for( i = 0; i < num; i++ )
 	{
-		clipEnt = GClip_GetClipEdictForDeltaTime( touch[i], timeDelta );
+		// a player moved ahead of time isn't where it is linked yet
+		if( gclip_speculation && touch[i] == gclip_speculation->self.number )
+			continue;
+
+		GClip_BackTimeClipEdict( touch[i], &bt, &clipEnt );
 
 		// might intersect, so do an exact clip
-		cmodel = GClip_CollisionModelForEntity( &clipEnt->s, &clipEnt->r );
+		cmodel = GClip_CollisionModelForEntity( clipEnt.s.modelindex, clipEnt.s.type, clipEnt.r.mins, clipEnt.r.maxs );
 
-		c2 = trap_CM_TransformedPointContents( p, cmodel, clipEnt->s.origin, clipEnt->s.angles );
+		c2 = trap_CM_TransformedPointContents( p, cmodel, clipEnt.s.origin, clipEnt.s.angles );
 		contents |= c2;
 	}
 
+	if( gclip_speculation )
+	{
+		gclipsolid_t *self = &gclip_speculation->self;
+
+		if( self->inuse && self->solid != SOLID_TRIGGER && self->solid != SOLID_NOT && 
+			BoundsIntersect( p, p, self->absmin, self->absmax ) )
+		{
+			cmodel = GClip_CollisionModelForEntity( self->modelindex, self->type, self->mins, self->maxs );
+			contents |= trap_CM_TransformedPointContents( p, cmodel, self->origin, self->angles );
+		}
+	}
+
 	return contents;
 }
 
@@ -815,19 +1420,21 @@ typedef struct
 /*static*/ void GClip_ClipMoveToEntities( moveclip_t *clip, int timeDelta )
 {
 	int i, num;
-	c4clipedict_t *touch;
+	c4backtime_t bt;
+	c4clipedict_t touchEnt, *touch = &touchEnt;
 	int touchlist[MAX_EDICTS];
 	trace_t	trace;
 	struct cmodel_s	*cmodel;
 	float *angles;
 
-	num = GClip_AreaEdicts( clip->boxmins, clip->boxmaxs, touchlist, MAX_EDICTS, AREA_SOLID, timeDelta );
+	GClip_SetupBackTime( timeDelta, &bt );
+	num = GClip_AreaEdicts( clip->boxmins, clip->boxmaxs, touchlist, MAX_EDICTS, AREA_SOLID, &bt );
 
 	// be careful, it is possible to have an entity in this
 	// list removed before we get to it (killtriggered)
 	for( i = 0; i < num; i++ )
 	{
-		touch = GClip_GetClipEdictForDeltaTime( touchlist[i], timeDelta );
+		GClip_BackTimeClipEdict( touchlist[i], &bt, touch );
 		if( clip->passent >= 0 )
 		{
 			// when they are offseted in time, they can be a different pointer but be the same entity
@@ -848,7 +1455,7 @@ typedef struct
 			continue;
 
 		// might intersect, so do an exact clip
-		cmodel = GClip_CollisionModelForEntity( &touch->s, &touch->r );
+		cmodel = GClip_CollisionModelForEntity( touch->s.modelindex, touch->s.type, touch->r.mins, touch->r.maxs );
 
 		if( ISBRUSHMODEL( touch->s.modelindex ) )
 			angles = touch->s.angles;
@@ -934,7 +1541,7 @@ static void GClip_Trace( trace_t *tr, vec3_t start, vec3_t mins, vec3_t maxs,
 	else
 	{
 		// clip to world
-		trap_CM_TransformedBoxTrace( tr, start, end, mins, maxs, NULL, contentmask, NULL, NULL );
+		GClip_WorldTrace( tr, start, mins, maxs, end, contentmask );
 		tr->ent = tr->fraction < 1.0 ? world->s.number : -1;
 		if( tr->fraction == 0 )
 			return; // blocked by the world
@@ -1064,7 +1671,7 @@ void GClip_TouchTriggers( edict_t *ent )
 	VectorAdd( ent->s.origin, ent->r.maxs, maxs );
 
 	// FIXME: should be s.origin + mins and s.origin + maxs because of absmin and absmax padding?
-	num = GClip_AreaEdicts( ent->r.absmin, ent->r.absmax, touch, MAX_EDICTS, AREA_TRIGGERS, 0 );
+	num = GClip_AreaEdicts( ent->r.absmin, ent->r.absmax, touch, MAX_EDICTS, AREA_TRIGGERS, NULL );
 
 	// be careful, it is possible to have an entity in this
 	// list removed before we get to it (killtriggered)
@@ -1143,7 +1750,7 @@ void G_PMoveTouchTriggers( pmove_t *pm, vec3_t previous_origin )
 		}
 	}
 
-	num = GClip_AreaEdicts( mins, maxs, touch, MAX_EDICTS, AREA_TRIGGERS, 0 );
+	num = GClip_AreaEdicts( mins, maxs, touch, MAX_EDICTS, AREA_TRIGGERS, NULL );
 
 	// be careful, it is possible to have an entity in this
 	// list removed before we get to it (killtriggered)
@@ -1172,34 +1779,19 @@ void G_PMoveTouchTriggers( pmove_t *pm, vec3_t previous_origin )
 */
 int GClip_FindInRadius4D( vec3_t org, float rad, int *list, int maxcount, int timeDelta )
 {
-	int i, num;
-	int listnum;
-	edict_t *check;
+	int num;
 	vec3_t mins, maxs;
 	float rad_ = rad * 1.42;
-	int touch[MAX_EDICTS];
+	c4backtime_t bt;
 
 	VectorSet( mins, org[0] - (rad_ + 1), org[1] - (rad_ + 1), org[2] - (rad_ + 1) );
 	VectorSet( maxs, org[0] + (rad_ + 1), org[1] + (rad_ + 1), org[2] + (rad_ + 1) );
 
-	listnum = 0;
-	num = GClip_AreaEdicts( mins, maxs, touch, MAX_EDICTS, AREA_ALL, timeDelta );
-
-	for( i = 0; i < num; i++ )
-	{
-		check = EDICT_NUM( touch[i] );
-
-		// make absolute mins and maxs
-		if( !BoundsAndSphereIntersect( check->r.absmin, check->r.absmax, org, rad ) )
-			continue;
-
-		if( listnum < maxcount ) {
-			list[listnum] = touch[i];
-		}
-		listnum++;
-	}
+	// the sphere is tested against the bounds at the same time
+	GClip_SetupBackTime( timeDelta, &bt );
+	num = GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs, org, rad, list, maxcount, AREA_ALL, &bt );
 
-	return listnum;
+	return num;
 }
 
 /*
@@ -1231,8 +1823,74 @@ entity_state_t *G_GetEntityStateForDeltaTime( int entNum, int deltaTime )
 
 	assert( entNum >= 0 && entNum < MAX_EDICTS );
 
+	// same as the backed up copy at the current time, and doesn't
+	// touch the shared slots when moving players from several threads
+	if( deltaTime >= 0 || !g_antilag->integer )
+		return &game.edicts[entNum].s;
+
 	clipEnt = GClip_GetClipEdictForDeltaTime( entNum, deltaTime );
 
 	return &clipEnt->s;
 }
 
+/*
+* GClip_SaveSolid
+* 
+* Copies what clipping against the entity depends on
+*/
+void GClip_SaveSolid( const edict_t *ent, gclipsolid_t *solid )
+{
+	memset( solid, 0, sizeof( *solid ) );
+	solid->number = ent - game.edicts;
+	solid->inuse = ent->r.inuse;
+	solid->solid = ent->r.solid;
+	solid->svflags = ent->r.svflags;
+	solid->owner = ent->r.owner ? ENTNUM( ent->r.owner ) : -1;
+	solid->type = ent->s.type;
+	solid->modelindex = ent->s.modelindex;
+	VectorCopy( ent->s.origin, solid->origin );
+	VectorCopy( ent->s.angles, solid->angles );
+	VectorCopy( ent->r.mins, solid->mins );
+	VectorCopy( ent->r.maxs, solid->maxs );
+	VectorCopy( ent->r.absmin, solid->absmin );
+	VectorCopy( ent->r.absmax, solid->absmax );
+}
+
+/*
+* GClip_SaveSolidsInBox
+* 
+* Saves the solid entities a query of the box would return, in the same order,
+* skipping the ignored one. Returns the number of entities found, which may be
+* larger than maxcount.
+*/
+int GClip_SaveSolidsInBox( const vec3_t mins, const vec3_t maxs, int ignore, gclipsolid_t *list, int maxcount )
+{
+	int i, num, count;
+	int touch[MAX_EDICTS];
+
+	num = GClip_EntitiesInBox_AreaGrid( &g_areagrid, mins, maxs, NULL, 0, touch, MAX_EDICTS, AREA_SOLID, NULL );
+	num = min( num, MAX_EDICTS );
+
+	for( i = 0, count = 0; i < num; i++ )
+	{
+		if( touch[i] == ignore )
+			continue;
+		if( count < maxcount )
+			GClip_SaveSolid( game.edicts + touch[i], &list[count] );
+		count++;
+	}
+
+	return count;
+}
+
+/*
+* GClip_SetSpeculation
+* 
+* While set, the solid queries of the calling thread are gathered into spec,
+* the trace cache is only read, and point contents see spec->self instead of
+* the linked entity
+*/
+void GClip_SetSpeculation( gclipspeculation_t *spec )
+{
+	gclip_speculation = spec;
+}
@@ -722,6 +722,8 @@ static void G_RunClients( void )
 		step = 1;
 	}
 
+	G_PlayerMove_Speculate();
+
 	for( ; i < gs.maxclients && i >= 0; i += step )
 	{
 		ent = game.edicts + 1 + i;
@@ -735,6 +737,8 @@ static void G_RunClients( void )
 		else
 			ent->s.effects &= ~EF_TAKEDAMAGE;
 	}
+
+	G_PlayerMove_EndFrame();
 }
 
 /*
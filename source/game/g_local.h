@@ -362,6 +362,8 @@ extern cvar_t *g_deadbody_followkiller;
 extern cvar_t *g_deadbody_autogib_delay;
 extern cvar_t *g_antilag_timenudge;
 extern cvar_t *g_antilag_maxtimedelta;
+extern cvar_t *g_tracecache_enable;
+extern cvar_t *g_movethreads;
 
 extern cvar_t *g_teams_maxplayers;
 extern cvar_t *g_teams_allow_uneven;
@@ -607,12 +609,18 @@ void G_DropSpawnpointToFloor( edict_t *ent );
 void G_InitEdict( edict_t *e );
 edict_t *G_Spawn( void );
 void G_FreeEdict( edict_t *e );
+void G_SetClassname( edict_t *ent, const char *classname );
+void G_SetTargetname( edict_t *ent, const char *targetname );
+void G_SyncEntityNames( edict_t *ent );
+void G_ResetEdictIndexes( void );
 
 void G_LevelInitPool( size_t size );
 void G_LevelFreePool( void );
 void *_G_LevelMalloc( size_t size, const char *filename, int fileline );
 void _G_LevelFree( void *data, const char *filename, int fileline );
 char *_G_LevelCopyString( const char *in, const char *filename, int fileline );
+void G_LevelMemStats_Cmd( void );
+void G_EntityIndexBenchmark_Cmd( void );
 void G_LevelGarbageCollect( void );
 
 void G_StringPoolInit( void );
@@ -730,8 +738,6 @@ void SP_trigger_gravity( edict_t *ent );
 //
 // g_clip.c
 //
-#define MAX_ENT_AREAS 16
-
 typedef struct link_s
 {
 	struct link_s *prev, *next;
@@ -752,9 +758,38 @@ void GClip_LinkEntity( edict_t *ent );
 void GClip_UnlinkEntity( edict_t *ent );
 void GClip_TouchTriggers( edict_t *ent );
 void G_PMoveTouchTriggers( pmove_t *pm, vec3_t previous_origin );
+void GClip_Benchmark_Cmd( void );
+void GClip_TraceCacheStats_Cmd( void );
 entity_state_t *G_GetEntityStateForDeltaTime( int entNum, int deltaTime );
 int GClip_FindInRadius( vec3_t org, float rad, int *list, int maxcount );
 
+// what clipping against a solid entity depends on
+typedef struct
+{
+	int number;
+	bool inuse;
+	int solid;
+	int svflags;
+	int owner;                  // entity number, -1 for none
+	int type;
+	int modelindex;
+	vec3_t origin, angles;
+	vec3_t mins, maxs;
+	vec3_t absmin, absmax;
+} gclipsolid_t;
+
+// a player move run ahead of time on a pool thread
+typedef struct
+{
+	gclipsolid_t self;          // the player as it will be linked when the move is due
+	bool queried;
+	vec3_t mins, maxs;          // union of the solid entity queries of the move
+} gclipspeculation_t;
+
+void GClip_SaveSolid( const edict_t *ent, gclipsolid_t *solid );
+int GClip_SaveSolidsInBox( const vec3_t mins, const vec3_t maxs, int ignore, gclipsolid_t *list, int maxcount );
+void GClip_SetSpeculation( gclipspeculation_t *spec );
+
 //
 // g_combat.c
 //
@@ -858,6 +893,17 @@ void ClientCommand( edict_t *ent );
 void G_PredictedEvent( int entNum, int ev, int parm );
 void G_TeleportPlayer( edict_t *player, edict_t *dest );
 bool G_PlayerCanTeleport( edict_t *player );
+int G_Client_PMoveType( const edict_t *ent );
+
+//
+// p_move.c
+//
+void G_PlayerMove_Speculate( void );
+void G_PlayerMove_EndFrame( void );
+void G_PlayerMove( edict_t *ent, pmove_t *pm, pmove_context_t *pmc );
+bool G_PlayerMove_DeferEvent( int entNum, int ev, int parm );
+void G_PlayerMove_Benchmark_Cmd( void );
+void G_PlayerMove_Shutdown( void );
 
 //
 // g_player.c
@@ -1299,8 +1345,9 @@ struct edict_s
 
 	int linkcount;
 
-	// physics grid areas this edict is linked into
-	link_t areagrid[MAX_ENT_AREAS];
+	// physics grid cell this edict is linked into
+	link_t areagrid;
+	int areagridlevel;              // -1 when outside of the grid
 
 	entity_state_t olds; // state in the last sent frame snap
 
@@ -74,6 +74,8 @@ cvar_t *g_maxtimeouts;
 cvar_t *g_antilag;
 cvar_t *g_antilag_maxtimedelta;
 cvar_t *g_antilag_timenudge;
+cvar_t *g_tracecache_enable;
+cvar_t *g_movethreads;
 cvar_t *g_autorecord;
 cvar_t *g_autorecord_maxdemos;
 
@@ -219,7 +221,6 @@ static void G_InitGameShared( void )
 	module_GetEntityState = G_GetEntityStateForDeltaTime;
 	module_PointContents = G_PointContents4D;
 	module_RoundUpToHullSize = G_GS_RoundUpToHullSize;
-	module_PMoveTouchTriggers = G_PMoveTouchTriggers;
 	module_GetConfigString = trap_GetConfigString;
 }
 
@@ -298,6 +299,8 @@ void G_Init( unsigned int seed, unsigned int framemsec, int protocol, const char
 	g_antilag_maxtimedelta->modified = true;
 	g_antilag_timenudge = trap_Cvar_Get( "g_antilag_timenudge", "0", CVAR_ARCHIVE );
 	g_antilag_timenudge->modified = true;
+	g_tracecache_enable = trap_Cvar_Get( "g_tracecache", "1", CVAR_ARCHIVE );
+	g_movethreads = trap_Cvar_Get( "g_movethreads", "0", CVAR_ARCHIVE );
 
 	g_allow_spectator_voting = trap_Cvar_Get( "g_allow_spectator_voting", "1", CVAR_ARCHIVE );
 
@@ -417,6 +420,8 @@ void G_Shutdown( void )
 			G_FreeEdict( &game.edicts[i] );
 	}
 
+	G_PlayerMove_Shutdown();
+
 	G_Free( game.edicts );
 	G_Free( game.clients );
 }
@@ -443,7 +448,7 @@ static edict_t *CreateTargetChangeLevel( const char *map )
 	edict_t *ent;
 
 	ent = G_Spawn();
-	ent->classname = "target_changelevel";
+	G_SetClassname( ent, "target_changelevel" );
 	Q_strncpyz( level.nextmap, map, sizeof( level.nextmap ) );
 	ent->map = level.nextmap;
 	return ent;
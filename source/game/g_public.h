@@ -20,7 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 // g_public.h -- game dll information visible to server
 
-#define	GAME_API_VERSION    50
+#define	GAME_API_VERSION    51
 
 //===============================================================
 
@@ -36,6 +36,7 @@ typedef struct stat_query_api_s stat_query_api_t;
 */
 struct stat_query_api_s;
 struct stat_query_s;
+struct qthreadpool_s;
 
 typedef struct
 {
@@ -180,6 +181,13 @@ typedef struct
 	void ( *DropClient )( struct edict_s *ent, int type, const char *message );
 	int ( *GetClientState )( int numClient );
 	void ( *ExecuteClientThinks )( int clientNum );
+	int ( *GetPendingClientThinks )( int clientNum, usercmd_t *ucmds, int maxucmds );
+
+	// worker threads, the job of ThreadPool_Run gets ( arg, index, worker )
+	struct qthreadpool_s *( *ThreadPool_Create )( int numThreads );
+	void ( *ThreadPool_Destroy )( struct qthreadpool_s **ppool );
+	int ( *ThreadPool_NumWorkers )( struct qthreadpool_s *pool );
+	void ( *ThreadPool_Run )( struct qthreadpool_s *pool, void ( *job )( void *, int, int ), void *arg, int count );
 
 	// The edict array is allocated in the game dll so it
 	// can vary in size from one game to another.
@@ -497,6 +497,8 @@ static char *ED_ParseEdict( char *data, edict_t *ent )
 	if( ent->classname && ent->helpmessage )
 		ent->mapmessage_index = G_RegisterHelpMessage( ent->helpmessage );
 
+	G_SyncEntityNames( ent );
+
 	return data;
 }
 
@@ -746,6 +748,8 @@ static void G_FreeEntities( void )
 	}
 	
 	game.numentities = gs.maxclients + 1;
+
+	G_ResetEdictIndexes();
 }
 
 /*
@@ -823,7 +827,7 @@ static void G_SpawnEntities( void )
 				if( G_Gametype_CanSpawnItem( item ) )
 				{
 					// override entity's classname with whatever item specifies
-					ent->classname = item->classname;
+					G_SetClassname( ent, item->classname );
 					PrecacheItem( item );
 					continue;
 				}
@@ -1014,6 +1018,7 @@ static void SP_worldspawn( edict_t *ent )
 	ent->movetype = MOVETYPE_PUSH;
 	ent->r.solid = SOLID_YES;
 	ent->r.inuse = true;       // since the world doesn't use G_Spawn()
+	G_SyncEntityNames( ent );  // ED_ParseEdict synced it while not in use
 	VectorClear( ent->s.origin );
 	VectorClear( ent->s.angles );
 	GClip_SetBrushModel( ent, "*0" ); // sets mins / maxs and modelindex 1
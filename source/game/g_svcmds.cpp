@@ -403,6 +403,12 @@ void G_AddServerCommands( void )
 	trap_Cmd_AddCommand( "addnode", AITools_AddNode_Cmd );
 	trap_Cmd_AddCommand( "dropnode", AITools_AddNode_Cmd );
 	trap_Cmd_AddCommand( "addbotroam", AITools_AddBotRoamNode_Cmd );
+	trap_Cmd_AddCommand( "astarbench", AStar_Benchmark_Cmd );
+	trap_Cmd_AddCommand( "areabench", GClip_Benchmark_Cmd );
+	trap_Cmd_AddCommand( "movebench", G_PlayerMove_Benchmark_Cmd );
+	trap_Cmd_AddCommand( "tracecachestats", GClip_TraceCacheStats_Cmd );
+	trap_Cmd_AddCommand( "levelmemstats", G_LevelMemStats_Cmd );
+	trap_Cmd_AddCommand( "entbench", G_EntityIndexBenchmark_Cmd );
 
 	trap_Cmd_AddCommand( "dumpASapi", G_asDumpAPI_f );
 
@@ -438,6 +444,12 @@ void G_RemoveCommands( void )
 	trap_Cmd_RemoveCommand( "addnode" );
 	trap_Cmd_RemoveCommand( "dropnode" );
 	trap_Cmd_RemoveCommand( "addbotroam" );
+	trap_Cmd_RemoveCommand( "astarbench" );
+	trap_Cmd_RemoveCommand( "areabench" );
+	trap_Cmd_RemoveCommand( "movebench" );
+	trap_Cmd_RemoveCommand( "tracecachestats" );
+	trap_Cmd_RemoveCommand( "levelmemstats" );
+	trap_Cmd_RemoveCommand( "entbench" );
 
 	trap_Cmd_RemoveCommand( "dumpASapi" );
 
@@ -370,6 +370,31 @@ static inline void trap_ExecuteClientThinks( int clientNum )
 	GAME_IMPORT.ExecuteClientThinks( clientNum );
 }
 
+static inline int trap_GetPendingClientThinks( int clientNum, usercmd_t *ucmds, int maxucmds )
+{
+	return GAME_IMPORT.GetPendingClientThinks( clientNum, ucmds, maxucmds );
+}
+
+static inline struct qthreadpool_s *trap_ThreadPool_Create( int numThreads )
+{
+	return GAME_IMPORT.ThreadPool_Create( numThreads );
+}
+
+static inline void trap_ThreadPool_Destroy( struct qthreadpool_s **ppool )
+{
+	GAME_IMPORT.ThreadPool_Destroy( ppool );
+}
+
+static inline int trap_ThreadPool_NumWorkers( struct qthreadpool_s *pool )
+{
+	return GAME_IMPORT.ThreadPool_NumWorkers( pool );
+}
+
+static inline void trap_ThreadPool_Run( struct qthreadpool_s *pool, void ( *job )( void *, int, int ), void *arg, int count )
+{
+	GAME_IMPORT.ThreadPool_Run( pool, job, arg, count );
+}
+
 static inline void trap_DropClient( edict_t *ent, int type, const char *message )
 {
 	GAME_IMPORT.DropClient( ent, type, message );
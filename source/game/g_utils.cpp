@@ -32,11 +32,18 @@ contiguous free memblocks.
 The rover can be left pointing at a non-empty block.
 
 Ported over from Quake 1 and Quake 3.
+
+Small allocations don't go through the rover: they are served from
+per-size-class slabs, which are themselves carved out of the zone as
+regular TAG_LEVEL blocks, so the whole pool is still released at once.
+Every chunk carries a memblock_t header and trash tester like zone blocks do.
 ==============================================================================
 */
 
 #define TAG_FREE	0
 #define TAG_LEVEL	1
+#define TAG_SLAB	2		// chunk of a slab, in use
+#define TAG_SLABFREE	3	// chunk of a slab, on its class free list
 
 #define	ZONEID		0x1d4a11
 #define MINFRAGMENT 64
@@ -215,6 +222,151 @@ static void *G_Z_Malloc( int size, const char *filename, int fileline )
 
 //==============================================================================
 
+#define SLAB_SIZE			16384
+#define SLAB_GRANULARITY	32
+#define SLAB_MAX_CHUNK		2048
+
+// chunk sizes, including the block header and the trash tester
+static const int slab_chunksizes[] = {
+	64, 96, 128, 160, 192, 256, 320, 384, 512, 640, 768, 1024, 1280, 1536, 2048
+};
+
+#define SLAB_NUM_CLASSES	( sizeof( slab_chunksizes ) / sizeof( slab_chunksizes[0] ) )
+
+typedef struct
+{
+	memblock_t *freelist;
+	uint8_t *bump, *bumpend;	// uncarved part of the newest slab
+	int slabs;
+	int inuse, peak;
+	unsigned allocs;
+} slabclass_t;
+
+static slabclass_t slab_classes[SLAB_NUM_CLASSES];
+static uint8_t slab_classforsize[SLAB_MAX_CHUNK / SLAB_GRANULARITY + 1];
+static unsigned slab_fallbacks;
+
+/*
+* G_Slab_Init
+*/
+static void G_Slab_Init( void )
+{
+	unsigned i, c;
+
+	memset( slab_classes, 0, sizeof( slab_classes ) );
+	slab_fallbacks = 0;
+
+	for( i = 0, c = 0; i < sizeof( slab_classforsize ); i++ )
+	{
+		while( (int)( i * SLAB_GRANULARITY ) > slab_chunksizes[c] )
+			c++;
+		slab_classforsize[i] = c;
+	}
+}
+
+/*
+* G_Slab_Malloc
+* 
+* Returns NULL if the size doesn't fit a class or the zone is out of room for a new slab
+*/
+static void *G_Slab_Malloc( int size, const char *filename, int fileline )
+{
+	int chunksize;
+	slabclass_t *sc;
+	memblock_t *block;
+
+	chunksize = size + sizeof( memblock_t ) + 4;
+	if( chunksize > SLAB_MAX_CHUNK )
+		return NULL;
+
+	sc = &slab_classes[slab_classforsize[( chunksize + SLAB_GRANULARITY - 1 ) / SLAB_GRANULARITY]];
+	chunksize = slab_chunksizes[sc - slab_classes];
+
+	block = sc->freelist;
+	if( block )
+	{
+		sc->freelist = block->next;
+	}
+	else
+	{
+		if( !sc->bump || sc->bump + chunksize > sc->bumpend )
+		{
+			uint8_t *slab = ( uint8_t * )G_Z_TagMalloc( SLAB_SIZE, TAG_LEVEL, filename, fileline );
+			if( !slab )
+				return NULL;
+			sc->bump = slab;
+			sc->bumpend = slab + SLAB_SIZE;
+			sc->slabs++;
+		}
+
+		block = ( memblock_t * )sc->bump;
+		sc->bump += chunksize;
+		block->size = chunksize;
+		block->id = ZONEID;
+	}
+
+	block->tag = TAG_SLAB;
+	block->next = block->prev = NULL;
+
+	// marker for memory trash testing
+	*(int *)((uint8_t *)block + block->size - 4) = ZONEID;
+
+	sc->allocs++;
+	if( ++sc->inuse > sc->peak )
+		sc->peak = sc->inuse;
+
+	return (void *) ((uint8_t *)block + sizeof(memblock_t));
+}
+
+/*
+* G_Slab_Free
+*/
+static void G_Slab_Free( memblock_t *block, const char *filename, int fileline )
+{
+	slabclass_t *sc;
+
+	if ( *(int *)((uint8_t *)block + block->size - 4 ) != ZONEID )
+		G_Error( "G_Slab_Free: memory block wrote past end (file %s at line %i)", filename, fileline );
+
+	sc = &slab_classes[slab_classforsize[block->size / SLAB_GRANULARITY]];
+
+	block->tag = TAG_SLABFREE;
+	block->next = sc->freelist;
+	sc->freelist = block;
+	sc->inuse--;
+}
+
+/*
+* G_LevelMemStats_Cmd
+*/
+void G_LevelMemStats_Cmd( void )
+{
+	unsigned i;
+	int inuse = 0, slabs = 0;
+	const slabclass_t *sc;
+
+	if( !levelzone )
+	{
+		G_Printf( "Level pool is not allocated\n" );
+		return;
+	}
+
+	G_Printf( "Level pool: %i bytes, %i bytes in %i zone blocks\n", levelzone->size, levelzone->used, levelzone->count );
+	G_Printf( " chunk   slabs   inuse    peak     allocs\n" );
+	for( i = 0, sc = slab_classes; i < SLAB_NUM_CLASSES; i++, sc++ )
+	{
+		if( !sc->slabs )
+			continue;
+		G_Printf( "%6i %7i %7i %7i %10u\n", slab_chunksizes[i], sc->slabs, sc->inuse, sc->peak, sc->allocs );
+		inuse += sc->inuse * slab_chunksizes[i];
+		slabs += sc->slabs;
+	}
+	G_Printf( "%i slabs (%i bytes), %i bytes in use, %u allocations too big for a slab\n", 
+		slabs, slabs * SLAB_SIZE, inuse, slab_fallbacks );
+}
+
+//==============================================================================
+
 /*
 * G_LevelInitPool
 */
@@ -224,6 +376,7 @@ void G_LevelInitPool( size_t size )
 
 	levelzone = ( memzone_t * )G_Malloc( size );
 	G_Z_ClearZone( levelzone, size );
+	G_Slab_Init();
 }
 
 /*
@@ -236,6 +389,7 @@ void G_LevelFreePool( void )
 		G_Free( levelzone );
 		levelzone = NULL;
 	}
+	G_Slab_Init();
 }
 
 /* 
@@ -243,6 +397,16 @@ void G_LevelFreePool( void )
 */
 void *_G_LevelMalloc( size_t size, const char *filename, int fileline )
 {
+	void *buf;
+
+	buf = G_Slab_Malloc( size, filename, fileline );
+	if( buf )
+	{
+		memset( buf, 0, size );
+		return buf;
+	}
+
+	slab_fallbacks++;
 	return G_Z_Malloc( size, filename, fileline );
 }
 
@@ -251,7 +415,21 @@ void *_G_LevelMalloc( size_t size, const char *filename, int fileline )
 */
 void _G_LevelFree( void *data, const char *filename, int fileline )
 {
-	G_Z_Free( data, filename, fileline );
+	memblock_t *block;
+
+	if( !data )
+		G_Error( "G_LevelFree: NULL pointer (file %s at line %i)", filename, fileline );
+
+	block = (memblock_t *) ( (uint8_t *)data - sizeof(memblock_t));
+	if( block->id != ZONEID )
+		G_Error( "G_LevelFree: freed a pointer without ZONEID (file %s at line %i)", filename, fileline );
+	if( block->tag == TAG_SLABFREE )
+		G_Error( "G_LevelFree: freed a freed pointer (file %s at line %i)", filename, fileline );
+
+	if( block->tag == TAG_SLAB )
+		G_Slab_Free( block, filename, fileline );
+	else
+		G_Z_Free( data, filename, fileline );
 }
 
 /*
@@ -529,19 +707,185 @@ void G_ProjectSource( vec3_t point, vec3_t distance, vec3_t forward, vec3_t righ
 }
 
 
+//==============================================================================
+//
+// ENTITY NAME INDEX
+//
+// classname and targetname of in-use entities are hashed, each bucket chaining
+// its entities in ascending entity number so G_Find keeps its scan order.
+// Links are stored outside of edict_t, so clearing an edict can't corrupt them,
+// and G_SyncEntityNames relinks an entity whenever its name pointers changed.
+// All values are stored +1 so that zero means none.
+//
+//==============================================================================
+
+#define ENTNAME_HASH_SIZE	1024
+
+enum
+{
+	ENTNAME_CLASSNAME,
+	ENTNAME_TARGETNAME,
+
+	ENTNAME_NUMKEYS
+};
+
+typedef struct
+{
+	const char *name;		// string pointer the entity was indexed with
+	int bucket;
+	int prev, next;
+} entnamelink_t;
+
+static entnamelink_t g_entnamelinks[ENTNAME_NUMKEYS][MAX_EDICTS];
+static int g_entnamebuckets[ENTNAME_NUMKEYS][ENTNAME_HASH_SIZE];
+
 /*
-* G_Find
-* 
-* Searches all active entities for the next one that holds
-* the matching string at fieldofs (use the FOFS() macro) in the structure.
+* G_EntNameHash
+*/
+static int G_EntNameHash( const char *name )
+{
+	unsigned hash = 2166136261u;
+
+	while( *name )
+	{
+		hash ^= ( unsigned char )tolower( ( unsigned char )*name++ );
+		hash *= 16777619u;
+	}
+	return (int)( hash & ( ENTNAME_HASH_SIZE - 1 ) );
+}
+
+/*
+* G_EntNameKeyForField
+*/
+static inline int G_EntNameKeyForField( size_t fieldofs )
+{
+	if( fieldofs == FOFS( classname ) )
+		return ENTNAME_CLASSNAME;
+	if( fieldofs == FOFS( targetname ) )
+		return ENTNAME_TARGETNAME;
+	return -1;
+}
+
+/*
+* G_EntNameField
+*/
+static inline const char *G_EntNameField( const edict_t *ent, int key )
+{
+	return key == ENTNAME_CLASSNAME ? ent->classname : ent->targetname;
+}
+
+/*
+* G_UnlinkEntityName
+*/
+static void G_UnlinkEntityName( int key, int num )
+{
+	entnamelink_t *links = g_entnamelinks[key];
+	entnamelink_t *link = &links[num];
+
+	if( !link->bucket )
+		return;
+
+	if( link->prev )
+		links[link->prev - 1].next = link->next;
+	else
+		g_entnamebuckets[key][link->bucket - 1] = link->next;
+	if( link->next )
+		links[link->next - 1].prev = link->prev;
+
+	memset( link, 0, sizeof( *link ) );
+}
+
+/*
+* G_LinkEntityName
+*/
+static void G_LinkEntityName( int key, int num, const char *name )
+{
+	int bucket, prev, next;
+	entnamelink_t *links = g_entnamelinks[key];
+	entnamelink_t *link = &links[num];
+
+	bucket = G_EntNameHash( name );
+
+	// keep the chain sorted by entity number
+	prev = 0;
+	next = g_entnamebuckets[key][bucket];
+	while( next && next - 1 < num )
+	{
+		prev = next;
+		next = links[next - 1].next;
+	}
+
+	link->name = name;
+	link->bucket = bucket + 1;
+	link->prev = prev;
+	link->next = next;
+	if( prev )
+		links[prev - 1].next = num + 1;
+	else
+		g_entnamebuckets[key][bucket] = num + 1;
+	if( next )
+		links[next - 1].prev = num + 1;
+}
+
+/*
+* G_SyncEntityNames
 * 
-* Searches beginning at the edict after from, or the beginning if NULL
-* NULL will be returned if the end of the list is reached.
+* Must be called after changing the classname or targetname of an entity
+* without G_SetClassname/G_SetTargetname
+*/
+void G_SyncEntityNames( edict_t *ent )
+{
+	int key, num;
+	const char *name;
+
+	num = ENTNUM( ent );
+	for( key = 0; key < ENTNAME_NUMKEYS; key++ )
+	{
+		name = ent->r.inuse ? G_EntNameField( ent, key ) : NULL;
+		if( name == g_entnamelinks[key][num].name )
+			continue;
+
+		G_UnlinkEntityName( key, num );
+		if( name )
+			G_LinkEntityName( key, num, name );
+	}
+}
+
+/*
+* G_SetClassname
+*/
+void G_SetClassname( edict_t *ent, const char *classname )
+{
+	ent->classname = classname;
+	G_SyncEntityNames( ent );
+}
+
+/*
+* G_SetTargetname
+*/
+void G_SetTargetname( edict_t *ent, const char *targetname )
+{
+	ent->targetname = targetname;
+	G_SyncEntityNames( ent );
+}
+
+/*
+* G_ClearEntityNames
+*/
+static void G_ClearEntityNames( void )
+{
+	memset( g_entnamelinks, 0, sizeof( g_entnamelinks ) );
+	memset( g_entnamebuckets, 0, sizeof( g_entnamebuckets ) );
+}
+
+/*
+* G_FindLinear
 * 
+* Scans all entities, for fields which aren't indexed
 */
-edict_t *G_Find( edict_t *from, size_t fieldofs, const char *match )
+static edict_t *G_FindLinear( edict_t *from, size_t fieldofs, const char *match )
 {
-	char *s;
+	const char *s;
 
 	if( !from )
 		from = world;
@@ -552,7 +896,7 @@ edict_t *G_Find( edict_t *from, size_t fieldofs, const char *match )
 	{
 		if( !from->r.inuse )
 			continue;
-		s = *(char **) ( (uint8_t *)from + fieldofs );
+		s = *(const char **) ( (uint8_t *)from + fieldofs );
 		if( !s )
 			continue;
 		if( !Q_stricmp( s, match ) )
@@ -562,6 +906,56 @@ edict_t *G_Find( edict_t *from, size_t fieldofs, const char *match )
 	return NULL;
 }
 
+/*
+* G_Find
+* 
+* Searches all active entities for the next one that holds
+* the matching string at fieldofs (use the FOFS() macro) in the structure.
+* 
+* Searches beginning at the edict after from, or the beginning if NULL
+* NULL will be returned if the end of the list is reached.
+* 
+*/
+edict_t *G_Find( edict_t *from, size_t fieldofs, const char *match )
+{
+	int key, bucket, num, fromnum;
+	const char *s;
+	edict_t *e;
+	const entnamelink_t *links;
+
+	key = G_EntNameKeyForField( fieldofs );
+	if( key < 0 )
+		return G_FindLinear( from, fieldofs, match );
+
+	links = g_entnamelinks[key];
+	bucket = G_EntNameHash( match );
+	fromnum = from ? ENTNUM( from ) : -1;
+
+	if( from && links[fromnum].bucket == bucket + 1 )
+	{
+		// continuing a previous search, pick up the chain where we left it
+		num = links[fromnum].next;
+	}
+	else
+	{
+		num = g_entnamebuckets[key][bucket];
+		while( num && num - 1 <= fromnum )
+			num = links[num - 1].next;
+	}
+
+	for( ; num && num - 1 < game.numentities; num = links[num - 1].next )
+	{
+		e = &game.edicts[num - 1];
+		if( !e->r.inuse )
+			continue;
+		s = G_EntNameField( e, key );
+		if( s && s == links[num - 1].name && !Q_stricmp( s, match ) )
+			return e;
+	}
+
+	return NULL;
+}
+
 /*
 * G_PickTarget
 * 
@@ -638,7 +1032,7 @@ void G_UseTargets( edict_t *ent, edict_t *activator )
 	{
 		// create a temp object to fire at a later time
 		t = G_Spawn();
-		t->classname = "delayed_use";
+		G_SetClassname( t, "delayed_use" );
 		t->nextThink = level.time + 1000 * ent->delay;
 		t->think = Think_Delay;
 		t->activator = activator;
@@ -781,6 +1175,181 @@ char *_G_CopyString( const char *in, const char *filename, int fileline )
 	return out;
 }
 
+//==============================================================================
+//
+// FREE EDICTS
+//
+// Freed edicts which can already be reused are kept in a bitmap, so G_Spawn
+// picks the lowest numbered one like a linear scan would. Recently freed
+// ones wait in a queue ordered by freetime until the reuse policy allows them.
+// As above, queue links are stored +1.
+//
+//==============================================================================
+
+#define FREEEDICT_QUEUED	1
+#define FREEEDICT_REUSABLE	2
+
+typedef struct
+{
+	int prev, next;
+	int state;
+} freeedictlink_t;
+
+static freeedictlink_t g_freeedictlinks[MAX_EDICTS];
+static int g_freeedicts_head, g_freeedicts_tail;
+static unsigned g_freeedicts_bits[MAX_EDICTS/32];		// all free edicts
+static unsigned g_reusableedicts_bits[MAX_EDICTS/32];	// free edicts that satisfy the reuse policy
+
+/*
+* G_EdictReusable
+* 
+* Try to avoid reusing an entity that was recently freed, because it
+* can cause the client to think the entity morphed into something else
+* instead of being removed and recreated, which can cause interpolated
+* angles and bad trails.
+*/
+static inline bool G_EdictReusable( unsigned int freetime )
+{
+	// the first couple seconds of server time can involve a lot of
+	// freeing and allocating, so relax the replacement policy
+	return freetime < level.spawnedTimeStamp + 2000 || game.realtime > freetime + 500;
+}
+
+/*
+* G_FirstSetEdictBit
+*/
+static int G_FirstSetEdictBit( const unsigned *bits, int start, int end )
+{
+	int i, word;
+	unsigned mask;
+
+	for( i = start; i < end; )
+	{
+		word = i >> 5;
+		mask = bits[word] >> ( i & 31 );
+		if( !mask )
+		{
+			i = ( word + 1 ) << 5;
+			continue;
+		}
+		while( !( mask & 1 ) )
+		{
+			mask >>= 1;
+			i++;
+		}
+		return i < end ? i : -1;
+	}
+
+	return -1;
+}
+
+/*
+* G_RemoveFreeEdict
+*/
+static void G_RemoveFreeEdict( int num )
+{
+	freeedictlink_t *link = &g_freeedictlinks[num];
+
+	if( link->state == FREEEDICT_QUEUED )
+	{
+		if( link->prev )
+			g_freeedictlinks[link->prev - 1].next = link->next;
+		else
+			g_freeedicts_head = link->next;
+		if( link->next )
+			g_freeedictlinks[link->next - 1].prev = link->prev;
+		else
+			g_freeedicts_tail = link->prev;
+	}
+
+	g_freeedicts_bits[num >> 5] &= ~( 1u << ( num & 31 ) );
+	g_reusableedicts_bits[num >> 5] &= ~( 1u << ( num & 31 ) );
+	memset( link, 0, sizeof( *link ) );
+}
+
+/*
+* G_AddFreeEdict
+*/
+static void G_AddFreeEdict( int num )
+{
+	freeedictlink_t *link = &g_freeedictlinks[num];
+
+	if( link->state )
+		G_RemoveFreeEdict( num );
+
+	g_freeedicts_bits[num >> 5] |= 1u << ( num & 31 );
+
+	if( G_EdictReusable( game.edicts[num].freetime ) )
+	{
+		link->state = FREEEDICT_REUSABLE;
+		g_reusableedicts_bits[num >> 5] |= 1u << ( num & 31 );
+		return;
+	}
+
+	// freetime is the current time, so appending keeps the queue sorted
+	link->state = FREEEDICT_QUEUED;
+	link->prev = g_freeedicts_tail;
+	link->next = 0;
+	if( g_freeedicts_tail )
+		g_freeedictlinks[g_freeedicts_tail - 1].next = num + 1;
+	else
+		g_freeedicts_head = num + 1;
+	g_freeedicts_tail = num + 1;
+}
+
+/*
+* G_PromoteFreeEdicts
+* 
+* Moves queued edicts which have waited long enough to the reusable set
+*/
+static void G_PromoteFreeEdicts( void )
+{
+	int num;
+
+	while( g_freeedicts_head )
+	{
+		num = g_freeedicts_head - 1;
+		if( !G_EdictReusable( game.edicts[num].freetime ) )
+			break;
+
+		G_RemoveFreeEdict( num );
+		g_freeedicts_bits[num >> 5] |= 1u << ( num & 31 );
+		g_reusableedicts_bits[num >> 5] |= 1u << ( num & 31 );
+		g_freeedictlinks[num].state = FREEEDICT_REUSABLE;
+	}
+}
+
+/*
+* G_ClearFreeEdicts
+*/
+static void G_ClearFreeEdicts( void )
+{
+	memset( g_freeedictlinks, 0, sizeof( g_freeedictlinks ) );
+	memset( g_freeedicts_bits, 0, sizeof( g_freeedicts_bits ) );
+	memset( g_reusableedicts_bits, 0, sizeof( g_reusableedicts_bits ) );
+	g_freeedicts_head = g_freeedicts_tail = 0;
+}
+
+/*
+* G_ResetEdictIndexes
+* 
+* Called when the entity list is reset as a whole
+*/
+void G_ResetEdictIndexes( void )
+{
+	int i;
+
+	G_ClearFreeEdicts();
+	G_ClearEntityNames();
+
+	// clients are kept across maps
+	for( i = 0; i < game.maxentities; i++ )
+	{
+		if( game.edicts[i].r.inuse )
+			G_SyncEntityNames( &game.edicts[i] );
+	}
+}
+
 /*
 * G_FreeEdict
 * 
@@ -789,6 +1358,7 @@ char *_G_CopyString( const char *in, const char *filename, int fileline )
 void G_FreeEdict( edict_t *ed )
 {
 	bool evt = ISEVENTENTITY( &ed->s );
+	int num = ENTNUM( ed );
 
 	GClip_UnlinkEntity( ed );   // unlink from world
 
@@ -799,12 +1369,17 @@ void G_FreeEdict( edict_t *ed )
 
 	memset( ed, 0, sizeof( *ed ) );
 	ed->r.inuse = false;
-	ed->s.number = ENTNUM( ed );
+	ed->s.number = num;
 	ed->r.svflags = SVF_NOCLIENT;
 	ed->scriptSpawned = false;
 
 	if( !evt && ( level.spawnedTimeStamp != game.realtime ) )
 		ed->freetime = game.realtime; // ET_EVENT or ET_SOUND don't need to wait to be reused
+
+	G_SyncEntityNames( ed );
+
+	if( num > gs.maxclients && num < game.numentities )
+		G_AddFreeEdict( num );
 }
 
 /*
@@ -812,10 +1387,15 @@ void G_FreeEdict( edict_t *ed )
 */
 void G_InitEdict( edict_t *e )
 {
+	int num = ENTNUM( e );
+
+	if( g_freeedictlinks[num].state )
+		G_RemoveFreeEdict( num );
+
 	e->r.inuse = true;
 	e->classname = NULL;
 	e->gravity = 1.0;
-	e->s.number = ENTNUM( e );
+	e->s.number = num;
 	e->timeDelta = 0;
 	e->s.team = 0;
 	e->deadflag = DEAD_NO;
@@ -840,63 +1420,257 @@ void G_InitEdict( edict_t *e )
 
 	//wsw clean up the backpack counts
 	memset( e->invpak, 0, sizeof( e->invpak ) );
+
+	G_SyncEntityNames( e );
+}
+
+/*
+* G_TakeFreeEdict
+* 
+* Returns the edict a linear scan from gs.maxclients+1 would have picked, or
+* NULL if a new one should be allocated at the end of the list
+*/
+static edict_t *G_TakeFreeEdict( void )
+{
+	int num;
+
+	G_PromoteFreeEdicts();
+
+	for( ;; )
+	{
+		num = G_FirstSetEdictBit( g_reusableedicts_bits, gs.maxclients + 1, game.numentities );
+
+		// this is going to be our second chance to spawn an entity in case all free
+		// entities have been freed only recently
+		if( num < 0 && game.numentities == game.maxentities )
+			num = G_FirstSetEdictBit( g_freeedicts_bits, gs.maxclients + 1, game.numentities );
+		if( num < 0 )
+			return NULL;
+
+		G_RemoveFreeEdict( num );
+		if( !game.edicts[num].r.inuse )
+			return &game.edicts[num];
+	}
 }
 
 /*
 * G_Spawn
 * 
 * Either finds a free edict, or allocates a new one.
-* Try to avoid reusing an entity that was recently freed, because it
-* can cause the client to think the entity morphed into something else
-* instead of being removed and recreated, which can cause interpolated
-* angles and bad trails.
 */
 edict_t *G_Spawn( void )
 {
-	int i;
-	edict_t	*e, *freed;
+	edict_t	*e;
 
 	if( !level.canSpawnEntities )
 		G_Printf( "WARNING: Spawning entity before map entities have been spawned\n" );
 
+	e = G_TakeFreeEdict();
+	if( e )
+	{
+		G_InitEdict( e );
+		return e;
+	}
+
+	if( game.numentities == game.maxentities )
+		G_Error( "G_Spawn: no free edicts" );
+
+	e = &game.edicts[game.numentities];
+	game.numentities++;
+
+	trap_LocateEntities( game.edicts, sizeof( game.edicts[0] ), game.numentities, game.maxentities );
+
+	G_InitEdict( e );
+
+	return e;
+}
+
+/*
+* G_SpawnLinear
+* 
+* The reference scan G_Spawn used to do, returns the edict it would have
+* picked or NULL if it would have grown the list. Only used by entbench.
+*/
+static edict_t *G_SpawnLinear( void )
+{
+	int i;
+	edict_t	*e, *freed;
+
 	freed = NULL;
 	e = &game.edicts[gs.maxclients+1];
 	for( i = gs.maxclients + 1; i < game.numentities; i++, e++ )
 	{
 		if( e->r.inuse )
 			continue;
-
-		// the first couple seconds of server time can involve a lot of
-		// freeing and allocating, so relax the replacement policy
-		if( e->freetime < level.spawnedTimeStamp + 2000 || game.realtime > e->freetime + 500 )
-		{
-			G_InitEdict( e );
+		if( G_EdictReusable( e->freetime ) )
 			return e;
-		}
-
-		// this is going to be our second chance to spawn an entity in case all free
-		// entities have been freed only recently
 		if( !freed )
 			freed = e;
 	}
 
 	if( i == game.maxentities )
+		return freed;
+	return NULL;
+}
+
+/*
+* G_BenchSpawnWave
+* 
+* Spawns up to count short-lived entities, finds them all by classname and frees them.
+* When checked, every spawn is compared against the linear scan. Returns the number
+* of mismatches.
+*/
+static int G_BenchSpawnWave( int count, bool checked )
+{
+	int i, spawned, mismatches;
+	edict_t *e, *expected;
+	edict_t *spawnedEnts[MAX_EDICTS];
+
+	mismatches = 0;
+	for( spawned = 0; spawned < count; spawned++ )
 	{
-		if( freed )
+		expected = NULL;
+		if( checked )
 		{
-			G_InitEdict( freed );
-			return freed;
+			expected = G_SpawnLinear();
+			if( !expected )
+			{
+				if( game.numentities == game.maxentities )
+					break;
+				expected = &game.edicts[game.numentities];
+			}
 		}
-		G_Error( "G_Spawn: no free edicts" );
+		else if( game.numentities == game.maxentities
+			&& G_FirstSetEdictBit( g_freeedicts_bits, gs.maxclients + 1, game.numentities ) < 0 )
+		{
+			break;
+		}
+
+		e = G_Spawn();
+		if( checked && e != expected )
+			mismatches++;
+		G_SetClassname( e, "entbench_rocket" );
+		spawnedEnts[spawned] = e;
 	}
 
-	game.numentities++;
+	for( e = NULL; ( e = ( checked ? G_FindLinear : G_Find )( e, FOFS( classname ), "entbench_rocket" ) ) != NULL; );
 
-	trap_LocateEntities( game.edicts, sizeof( game.edicts[0] ), game.numentities, game.maxentities );
+	for( i = 0; i < spawned; i++ )
+		G_FreeEdict( spawnedEnts[i] );
 
-	G_InitEdict( e );
+	return mismatches;
+}
 
-	return e;
+/*
+* G_BenchMapLoadLookups
+* 
+* Looks up the target and the classname of every entity, returns the number of lookups
+*/
+static int G_BenchMapLoadLookups( edict_t *( *find )( edict_t *, size_t, const char * ) )
+{
+	int i, k, lookups = 0;
+	edict_t *e;
+	const char *name;
+	const size_t fields[2] = { FOFS( targetname ), FOFS( classname ) };
+
+	for( i = 0; i < game.numentities; i++ )
+	{
+		if( !game.edicts[i].r.inuse )
+			continue;
+
+		for( k = 0; k < 2; k++ )
+		{
+			name = k ? game.edicts[i].classname : game.edicts[i].target;
+			if( !name )
+				continue;
+
+			lookups++;
+			for( e = NULL; ( e = find( e, fields[k], name ) ) != NULL; );
+		}
+	}
+
+	return lookups;
+}
+
+/*
+* G_EntityIndexBenchmark_Cmd
+* 
+* Simulates rocket spam with short-lived entities and a map load worth of
+* target lookups, comparing against the linear scans. The entity list is
+* left grown by the spam waves.
+*/
+void G_EntityIndexBenchmark_Cmd( void )
+{
+	int i, k, r, count, rounds, mismatches, lookups = 0;
+	unsigned int t, indexTime, linearTime;
+	edict_t *e, *l;
+	const char *name;
+	const size_t fields[2] = { FOFS( targetname ), FOFS( classname ) };
+
+	count = trap_Cmd_Argc() > 1 ? atoi( trap_Cmd_Argv( 1 ) ) : 200;
+	rounds = trap_Cmd_Argc() > 2 ? atoi( trap_Cmd_Argv( 2 ) ) : 1000;
+	clamp( count, 1, MAX_EDICTS );
+	clamp( rounds, 1, 100000 );
+
+	// rocket spam: spawn a wave, look it up by classname, free it
+	mismatches = 0;
+	t = trap_Milliseconds();
+	for( r = 0; r < rounds; r++ )
+		G_BenchSpawnWave( count, false );
+	indexTime = trap_Milliseconds() - t;
+
+	t = trap_Milliseconds();
+	for( r = 0; r < rounds; r++ )
+		mismatches += G_BenchSpawnWave( count, true );
+	linearTime = trap_Milliseconds() - t;
+
+	G_Printf( "rocket spam: %i rounds of %i entities: %u msec indexed, %u msec with linear scans, %i mismatches\n",
+		rounds, count, indexTime, linearTime, mismatches );
+
+	// map load: resolve the target and the classname of every entity
+	t = trap_Milliseconds();
+	for( r = 0; r < rounds; r++ )
+		lookups = G_BenchMapLoadLookups( G_Find );
+	indexTime = trap_Milliseconds() - t;
+
+	t = trap_Milliseconds();
+	for( r = 0; r < rounds; r++ )
+		G_BenchMapLoadLookups( G_FindLinear );
+	linearTime = trap_Milliseconds() - t;
+
+	// compare the full result sets once, the world isn't spawned
+	// through G_Spawn so check it explicitly
+	mismatches = 0;
+	if( G_Find( NULL, FOFS( classname ), "worldspawn" ) != G_FindLinear( NULL, FOFS( classname ), "worldspawn" ) )
+		mismatches++;
+	for( i = 0; i < game.numentities; i++ )
+	{
+		if( !game.edicts[i].r.inuse )
+			continue;
+
+		for( k = 0; k < 2; k++ )
+		{
+			name = k ? game.edicts[i].classname : game.edicts[i].target;
+			if( !name )
+				continue;
+
+			for( e = l = NULL;; )
+			{
+				e = G_Find( e, fields[k], name );
+				l = G_FindLinear( l, fields[k], name );
+				if( e != l )
+				{
+					mismatches++;
+					break;
+				}
+				if( !e )
+					break;
+			}
+		}
+	}
+
+	G_Printf( "map load: %i lookups: %u msec indexed, %u msec linear, %i mismatches\n",
+		lookups, indexTime, linearTime, mismatches );
 }
 
 /*
@@ -122,7 +122,7 @@ void G_InitBodyQueue( void )
 	for( i = 0; i < BODY_QUEUE_SIZE; i++ )
 	{
 		ent = G_Spawn();
-		ent->classname = "bodyque";
+		G_SetClassname( ent, "bodyque" );
 	}
 }
 
@@ -212,7 +212,7 @@ static edict_t *CopyToBodyQue( edict_t *ent, edict_t *attacker, int damage )
 
 	//init body edict
 	G_InitEdict( body );
-	body->classname = "body";
+	G_SetClassname( body, "body" );
 	body->health = ent->health;
 	body->mass = ent->mass;
 	body->r.owner = ent->r.owner;
@@ -570,12 +570,12 @@ void G_ClientRespawn( edict_t *self, bool ghost )
 	if( AI_GetType( self->ai ) == AI_ISBOT )
 	{
 		self->think = NULL;
-		self->classname = "bot";
+		G_SetClassname( self, "bot" );
 	}
 	else if( self->r.svflags & SVF_FAKECLIENT )
-		self->classname = "fakeclient";
+		G_SetClassname( self, "fakeclient" );
 	else
-		self->classname = "player";
+		G_SetClassname( self, "player" );
 
 	VectorCopy( playerbox_stand_mins, self->r.mins );
 	VectorCopy( playerbox_stand_maxs, self->r.maxs );
@@ -1424,6 +1424,7 @@ void ClientDisconnect( edict_t *ent, const char *reason )
 
 	ent->r.inuse = false;
 	ent->r.svflags = SVF_NOCLIENT;
+	G_SyncEntityNames( ent );
 
 	memset( ent->r.client, 0, sizeof( *ent->r.client ) );
 	ent->r.client->ps.playerNum = PLAYERNUM( ent );
@@ -1511,6 +1512,10 @@ void G_PredictedEvent( int entNum, int ev, int parm )
 	edict_t	*ent;
 	vec3_t upDir = { 0, 0, 1 };
 
+	// moves run ahead of time keep their events until the move is used
+	if( G_PlayerMove_DeferEvent( entNum, ev, parm ) )
+		return;
+
 	ent = &game.edicts[entNum];
 	switch( ev )
 	{
@@ -1594,6 +1599,21 @@ bool ClientMultiviewChanged( edict_t *ent, bool multiview )
 	return true;
 }
 
+/*
+* G_Client_PMoveType
+*/
+int G_Client_PMoveType( const edict_t *ent )
+{
+	if( GS_MatchState() >= MATCH_STATE_POSTMATCH || GS_MatchPaused() 
+		|| ( ent->movetype != MOVETYPE_PLAYER && ent->movetype != MOVETYPE_NOCLIP ) )
+		return PM_FREEZE;
+	if( ent->s.type == ET_GIB )
+		return PM_GIB;
+	if( ent->movetype == MOVETYPE_NOCLIP || ent->r.client->isTV )
+		return PM_SPECTATOR;
+	return PM_NORMAL;
+}
+
 /*
 * ClientThink
 */
@@ -1601,7 +1621,8 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 {
 	gclient_t *client;
 	int i, j;
-	static pmove_t pm;
+	pmove_t pm;
+	pmove_context_t pmc;
 	int delta, count;
 
 	client = ent->r.client;
@@ -1672,16 +1693,7 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 	VectorCopy( ent->s.angles, client->ps.viewangles );
 
 	client->ps.pmove.gravity = level.gravity;
-
-	if( GS_MatchState() >= MATCH_STATE_POSTMATCH || GS_MatchPaused() 
-		|| ( ent->movetype != MOVETYPE_PLAYER && ent->movetype != MOVETYPE_NOCLIP ) )
-		client->ps.pmove.pm_type = PM_FREEZE;
-	else if( ent->s.type == ET_GIB )
-		client->ps.pmove.pm_type = PM_GIB;
-	else if( ent->movetype == MOVETYPE_NOCLIP || client->isTV )
-		client->ps.pmove.pm_type = PM_SPECTATOR;
-	else
-		client->ps.pmove.pm_type = PM_NORMAL;
+	client->ps.pmove.pm_type = G_Client_PMoveType( ent );
 
 	// set up for pmove
 	memset( &pm, 0, sizeof( pmove_t ) );
@@ -1693,8 +1705,13 @@ void ClientThink( edict_t *ent, usercmd_t *ucmd, int timeDelta )
 	if( memcmp( &client->old_pmove, &client->ps.pmove, sizeof( pmove_state_t ) ) )
 		pm.snapinitial = true;
 
-	// perform a pmove
-	Pmove( &pm );
+	// perform a pmove, its result may have been worked out ahead of time
+	G_PlayerMove( ent, &pm, &pmc );
+
+	// execute the triggers touched along the way before finishing the move
+	if( pmc.touchTriggers )
+		G_PMoveTouchTriggers( &pm, pmc.previous_origin );
+	Pmove_Finish( &pm, &pmc );
 
 	// save results of pmove
 	client->old_pmove = client->ps.pmove;
@@ -0,0 +1,678 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#include "g_local.h"
+
+/*
+===============================================================================
+
+PLAYER MOVES AHEAD OF TIME
+
+The usercmds of the clients are all known when the frame starts, so with
+g_movethreads set their moves are worked out on pool threads before the
+clients are run. Each thread moves a copy of the player state and only reads
+the world. The clients then run one at a time as usual, and ClientThink takes
+the result worked out ahead of time only if the move starts from exactly the
+same usercmd and player state, the player is linked the same way and the solid
+entities around everything the move looked at are the same. Otherwise the move
+is run again in place. The triggers, the predicted events and the rest of the
+think happen in order on the main thread either way, so the outcome is the same
+as moving the players one at a time.
+
+Bots decide their usercmds while thinking, so they are always moved in place.
+
+===============================================================================
+*/
+
+#define G_MOVE_MAX_THREADS	16
+#define G_MOVE_MAX_CMDS		4		// usercmds moved ahead per client and frame
+#define G_MOVE_MAX_EVENTS	8
+#define G_MOVE_MAX_SOLIDS	16
+
+// the part of the player state Pmove reads and writes
+typedef struct
+{
+	pmove_state_t pmove;
+	vec3_t viewangles;
+	float viewheight;
+} gmovestate_t;
+
+typedef struct
+{
+	int numEvents;
+	struct
+	{
+		int ev, parm;
+	} events[G_MOVE_MAX_EVENTS];
+} gmoveevents_t;
+
+typedef struct
+{
+	// what the move starts from
+	usercmd_t cmd;
+	bool snapinitial;
+	int gameflags;
+	gmovestate_t in;
+	gclipspeculation_t clip;
+
+	// what it ended with
+	bool valid;
+	gmovestate_t out;
+	pmove_t pm;
+	pmove_context_t pmc;
+	gmoveevents_t events;
+
+	// the solid entities around what the move looked at, but the player itself
+	int numSolids;
+	gclipsolid_t solids[G_MOVE_MAX_SOLIDS];
+} gmovespec_t;
+
+typedef struct
+{
+	int numSpecs;
+	int nextSpec;
+	gmovespec_t specs[G_MOVE_MAX_CMDS];
+} gmoveclient_t;
+
+static struct qthreadpool_s *g_movePool;
+static int g_moveNumThreads;
+
+static gmoveclient_t *g_moveClients;        // [gs.maxclients]
+static int g_moveJobs[MAX_CLIENTS];         // client numbers
+
+static unsigned int g_moveNumMoves, g_moveNumUsed;
+
+// set while the thread works out a move ahead of time
+static ATTRIBUTE_THREAD_LOCAL gmoveevents_t *g_moveEvents;
+
+/*
+* G_PlayerMove_Shutdown
+*/
+void G_PlayerMove_Shutdown( void )
+{
+	if( g_movePool )
+		trap_ThreadPool_Destroy( &g_movePool );
+	g_moveNumThreads = 0;
+
+	if( g_moveClients )
+	{
+		G_Free( g_moveClients );
+		g_moveClients = NULL;
+	}
+}
+
+/*
+* G_PlayerMove_AllocClients
+*/
+static void G_PlayerMove_AllocClients( void )
+{
+	if( !g_moveClients )
+		g_moveClients = ( gmoveclient_t * )G_Malloc( sizeof( *g_moveClients ) * gs.maxclients );
+}
+
+/*
+* G_PlayerMove_CheckThreads
+*/
+static void G_PlayerMove_CheckThreads( void )
+{
+	int numThreads;
+
+	numThreads = g_movethreads->integer;
+	clamp( numThreads, 0, G_MOVE_MAX_THREADS );
+	if( numThreads == g_moveNumThreads )
+		return;
+
+	if( g_movePool )
+		trap_ThreadPool_Destroy( &g_movePool );
+	g_moveNumThreads = numThreads;
+
+	if( numThreads )
+	{
+		g_movePool = trap_ThreadPool_Create( numThreads );
+		G_PlayerMove_AllocClients();
+	}
+}
+
+/*
+* G_PlayerMove_SaveState
+*/
+static void G_PlayerMove_SaveState( const player_state_t *ps, gmovestate_t *state )
+{
+	memset( state, 0, sizeof( *state ) );
+	state->pmove = ps->pmove;
+	VectorCopy( ps->viewangles, state->viewangles );
+	state->viewheight = ps->viewheight;
+}
+
+/*
+* G_PlayerMove_SetupSpec
+*
+* The first move of the frame starts from the player as ClientThink will find it
+*/
+static void G_PlayerMove_SetupSpec( edict_t *ent, const usercmd_t *ucmd, gmovespec_t *spec )
+{
+	gclient_t *client = ent->r.client;
+
+	memset( &spec->cmd, 0, sizeof( spec->cmd ) );
+	if( !client->isTV )
+		spec->cmd = *ucmd;
+
+	G_PlayerMove_SaveState( &client->ps, &spec->in );
+	VectorCopy( ent->s.origin, spec->in.pmove.origin );
+	VectorCopy( ent->velocity, spec->in.pmove.velocity );
+	VectorCopy( ent->s.angles, spec->in.viewangles );
+	spec->in.pmove.gravity = level.gravity;
+	spec->in.pmove.pm_type = G_Client_PMoveType( ent );
+
+	spec->snapinitial = memcmp( &client->old_pmove, &spec->in.pmove, sizeof( pmove_state_t ) ) != 0;
+	spec->gameflags = gs.gameState.stats[GAMESTAT_FLAGS];
+	GClip_SaveSolid( ent, &spec->clip.self );
+}
+
+/*
+* G_PlayerMove_RunSpec
+*/
+static void G_PlayerMove_RunSpec( edict_t *ent, gmovespec_t *spec, player_state_t *ps, pmove_t *pm )
+{
+	memset( ps, 0, sizeof( *ps ) );
+	ps->pmove = spec->in.pmove;
+	VectorCopy( spec->in.viewangles, ps->viewangles );
+	ps->viewheight = spec->in.viewheight;
+	ps->POVnum = ENTNUM( ent );
+
+	memset( pm, 0, sizeof( *pm ) );
+	pm->playerState = ps;
+	pm->cmd = spec->cmd;
+	pm->snapinitial = spec->snapinitial;
+
+	spec->clip.queried = false;
+	spec->events.numEvents = 0;
+
+	GClip_SetSpeculation( &spec->clip );
+	g_moveEvents = &spec->events;
+
+	Pmove( pm, &spec->pmc );
+
+	GClip_SetSpeculation( NULL );
+	g_moveEvents = NULL;
+
+	G_PlayerMove_SaveState( ps, &spec->out );
+	spec->pm = *pm;
+
+	spec->numSolids = 0;
+	if( spec->clip.queried )
+		spec->numSolids = GClip_SaveSolidsInBox( spec->clip.mins, spec->clip.maxs, ENTNUM( ent ),
+			spec->solids, G_MOVE_MAX_SOLIDS );
+
+	spec->valid = spec->numSolids <= G_MOVE_MAX_SOLIDS && spec->events.numEvents <= G_MOVE_MAX_EVENTS;
+}
+
+/*
+* G_PlayerMove_NextSpec
+*
+* Where the next move starts from when no trigger or anything else
+* gets in the way after this one
+*/
+static void G_PlayerMove_NextSpec( const gmovespec_t *spec, player_state_t *ps, pmove_t *pm, gmovespec_t *next )
+{
+	int i;
+	pmove_context_t pmc;
+	gmoveevents_t events;
+	gclipsolid_t *self = &next->clip.self;
+
+	// the fall events are fired when ClientThink finishes the move
+	pmc = spec->pmc;
+	g_moveEvents = &events;
+	Pmove_Finish( pm, &pmc );
+	g_moveEvents = NULL;
+
+	G_PlayerMove_SaveState( ps, &next->in );
+	next->in.pmove.pm_type = spec->in.pmove.pm_type;
+	next->snapinitial = false;
+	next->gameflags = spec->gameflags;
+
+	// linked by ClientThink the same way
+	*self = spec->clip.self;
+	VectorCopy( ps->pmove.origin, self->origin );
+	VectorCopy( ps->viewangles, self->angles );
+	VectorCopy( pm->mins, self->mins );
+	VectorCopy( pm->maxs, self->maxs );
+	VectorAdd( self->origin, self->mins, self->absmin );
+	VectorAdd( self->origin, self->maxs, self->absmax );
+	for( i = 0; i < 3; i++ )
+	{
+		self->absmin[i] -= 1;
+		self->absmax[i] += 1;
+	}
+}
+
+/*
+* G_PlayerMove_SpeculateJob
+*/
+static void G_PlayerMove_SpeculateJob( void *arg, int index, int worker )
+{
+	int k, clientNum;
+	edict_t *ent;
+	gmoveclient_t *mc;
+	player_state_t ps;
+	pmove_t pm;
+
+	clientNum = g_moveJobs[index];
+	ent = game.edicts + 1 + clientNum;
+	mc = &g_moveClients[clientNum];
+
+	for( k = 0; k < mc->numSpecs; k++ )
+	{
+		G_PlayerMove_RunSpec( ent, &mc->specs[k], &ps, &pm );
+		if( !mc->specs[k].valid )
+		{
+			mc->numSpecs = k + 1;
+			break;
+		}
+
+		if( k + 1 < mc->numSpecs )
+			G_PlayerMove_NextSpec( &mc->specs[k], &ps, &pm, &mc->specs[k + 1] );
+	}
+}
+
+/*
+* G_PlayerMove_Speculate
+*
+* Works out the moves of the pending usercmds of the clients on the pool threads
+*/
+void G_PlayerMove_Speculate( void )
+{
+	int i, k, numJobs;
+	edict_t *ent;
+	gmoveclient_t *mc;
+	usercmd_t ucmds[G_MOVE_MAX_CMDS];
+
+	G_PlayerMove_CheckThreads();
+	if( !g_movePool )
+		return;
+
+	numJobs = 0;
+	for( i = 0; i < gs.maxclients; i++ )
+	{
+		ent = game.edicts + 1 + i;
+		mc = &g_moveClients[i];
+		mc->numSpecs = mc->nextSpec = 0;
+
+		if( !ent->r.inuse || !ent->r.client || ( ent->r.svflags & SVF_FAKECLIENT ) )
+			continue;
+
+		mc->numSpecs = trap_GetPendingClientThinks( i, ucmds, G_MOVE_MAX_CMDS );
+		if( !mc->numSpecs )
+			continue;
+
+		G_PlayerMove_SetupSpec( ent, &ucmds[0], &mc->specs[0] );
+		for( k = 1; k < mc->numSpecs; k++ )
+		{
+			memset( &mc->specs[k].cmd, 0, sizeof( mc->specs[k].cmd ) );
+			if( !ent->r.client->isTV )
+				mc->specs[k].cmd = ucmds[k];
+		}
+
+		g_moveJobs[numJobs++] = i;
+	}
+
+	if( numJobs )
+		trap_ThreadPool_Run( g_movePool, G_PlayerMove_SpeculateJob, NULL, numJobs );
+}
+
+/*
+* G_PlayerMove_EndFrame
+*
+* Drops the moves nobody asked for
+*/
+void G_PlayerMove_EndFrame( void )
+{
+	int i;
+
+	if( !g_moveClients )
+		return;
+
+	for( i = 0; i < gs.maxclients; i++ )
+		g_moveClients[i].numSpecs = g_moveClients[i].nextSpec = 0;
+}
+
+/*
+* G_PlayerMove_FindSpec
+*
+* Returns the move worked out ahead of time if it is the one about to be made
+*/
+static gmovespec_t *G_PlayerMove_FindSpec( edict_t *ent, const pmove_t *pm )
+{
+	gmoveclient_t *mc;
+	gmovespec_t *spec;
+	gmovestate_t state;
+	gclipsolid_t self;
+	gclipsolid_t solids[G_MOVE_MAX_SOLIDS];
+
+	if( !g_moveClients )
+		return NULL;
+
+	mc = &g_moveClients[PLAYERNUM( ent )];
+	if( mc->nextSpec >= mc->numSpecs )
+		return NULL;
+
+	spec = &mc->specs[mc->nextSpec++];
+	if( !spec->valid )
+		return NULL;
+
+	if( memcmp( &spec->cmd, &pm->cmd, sizeof( usercmd_t ) ) || spec->snapinitial != pm->snapinitial )
+		return NULL;
+	if( spec->gameflags != gs.gameState.stats[GAMESTAT_FLAGS] )
+		return NULL;
+
+	G_PlayerMove_SaveState( pm->playerState, &state );
+	if( memcmp( &spec->in, &state, sizeof( state ) ) )
+		return NULL;
+
+	GClip_SaveSolid( ent, &self );
+	if( memcmp( &spec->clip.self, &self, sizeof( self ) ) )
+		return NULL;
+
+	if( spec->clip.queried )
+	{
+		if( GClip_SaveSolidsInBox( spec->clip.mins, spec->clip.maxs, ENTNUM( ent ), solids, G_MOVE_MAX_SOLIDS ) != spec->numSolids )
+			return NULL;
+		if( memcmp( spec->solids, solids, sizeof( gclipsolid_t ) * spec->numSolids ) )
+			return NULL;
+	}
+
+	return spec;
+}
+
+/*
+* G_PlayerMove_UseSpec
+*/
+static void G_PlayerMove_UseSpec( const gmovespec_t *spec, pmove_t *pm, pmove_context_t *pmc )
+{
+	player_state_t *ps = pm->playerState;
+
+	*pm = spec->pm;
+	pm->playerState = ps;
+	*pmc = spec->pmc;
+
+	ps->pmove = spec->out.pmove;
+	VectorCopy( spec->out.viewangles, ps->viewangles );
+	ps->viewheight = spec->out.viewheight;
+}
+
+/*
+* G_PlayerMove
+*
+* Pmove for ClientThink, taking the result worked out ahead of time when it is right
+*/
+void G_PlayerMove( edict_t *ent, pmove_t *pm, pmove_context_t *pmc )
+{
+	int i;
+	gmovespec_t *spec;
+
+	if( !g_movePool || ( ent->r.svflags & SVF_FAKECLIENT ) )
+	{
+		Pmove( pm, pmc );
+		return;
+	}
+
+	g_moveNumMoves++;
+
+	spec = G_PlayerMove_FindSpec( ent, pm );
+	if( !spec )
+	{
+		Pmove( pm, pmc );
+		return;
+	}
+
+	g_moveNumUsed++;
+
+	G_PlayerMove_UseSpec( spec, pm, pmc );
+
+	// the events the move would have fired
+	for( i = 0; i < spec->events.numEvents; i++ )
+		G_PredictedEvent( ENTNUM( ent ), spec->events.events[i].ev, spec->events.events[i].parm );
+}
+
+/*
+* G_PlayerMove_DeferEvent
+*
+* Keeps the predicted events of a move worked out ahead of time
+*/
+bool G_PlayerMove_DeferEvent( int entNum, int ev, int parm )
+{
+	gmoveevents_t *events = g_moveEvents;
+
+	if( !events )
+		return false;
+
+	if( events->numEvents < G_MOVE_MAX_EVENTS )
+	{
+		events->events[events->numEvents].ev = ev;
+		events->events[events->numEvents].parm = parm;
+	}
+	events->numEvents++;
+	return true;
+}
+
+/*
+* G_PlayerMove_Benchmark_Cmd
+*
+* Moves every player G_MOVE_MAX_CMDS times with its last usercmd, ahead of time
+* on the pool threads and then one at a time the way ClientThink does, without
+* touching triggers. Every move worked out ahead of time that ClientThink would
+* take must give exactly the same result: movebench [iterations]
+*/
+void G_PlayerMove_Benchmark_Cmd( void )
+{
+	int i, k, n, iterations, numPlayers, numJobs;
+	int numMoves, numUsed, numMismatches;
+	unsigned int start, elapsed[2];
+	unsigned int numFrameMoves, numFrameUsed;
+	edict_t *ent;
+	gclient_t *client;
+	gmoveclient_t *mc;
+	gmovespec_t *spec;
+	pmove_t pm, specpm;
+	pmove_context_t pmc;
+	gmovestate_t state;
+	gmoveevents_t events, discarded;
+	usercmd_t ucmd;
+	typedef struct
+	{
+		player_state_t ps;
+		pmove_state_t old_pmove;
+		entity_state_t s;
+		vec3_t velocity, mins, maxs;
+		float viewheight;
+		int waterlevel, watertype;
+		edict_t *groundentity;
+		int groundentity_linkcount;
+		int linkcount;
+	} gmovesaved_t;
+	gmovesaved_t *saved;
+
+	iterations = 1;
+	if( trap_Cmd_Argc() > 1 )
+		iterations = max( atoi( trap_Cmd_Argv( 1 ) ), 1 );
+
+	G_PlayerMove_CheckThreads();
+	G_PlayerMove_AllocClients();
+
+	numFrameMoves = g_moveNumMoves;
+	numFrameUsed = g_moveNumUsed;
+
+	saved = ( gmovesaved_t * )G_Malloc( sizeof( *saved ) * gs.maxclients );
+
+	numPlayers = numMoves = numUsed = numMismatches = 0;
+	elapsed[0] = elapsed[1] = 0;
+
+	for( n = 0; n < iterations; n++ )
+	{
+		// work out the moves ahead of time
+		start = trap_Milliseconds();
+
+		numJobs = 0;
+		for( i = 0; i < gs.maxclients; i++ )
+		{
+			ent = game.edicts + 1 + i;
+			mc = &g_moveClients[i];
+			mc->numSpecs = mc->nextSpec = 0;
+
+			if( !ent->r.inuse || !ent->r.client || trap_GetClientState( i ) < CS_SPAWNED )
+				continue;
+
+			ucmd = ent->r.client->ucmd;
+			if( !ucmd.msec )
+				ucmd.msec = game.frametime;
+
+			mc->numSpecs = G_MOVE_MAX_CMDS;
+			G_PlayerMove_SetupSpec( ent, &ucmd, &mc->specs[0] );
+			for( k = 1; k < mc->numSpecs; k++ )
+				mc->specs[k].cmd = mc->specs[0].cmd;
+
+			g_moveJobs[numJobs++] = i;
+		}
+
+		trap_ThreadPool_Run( g_movePool, G_PlayerMove_SpeculateJob, NULL, numJobs );
+
+		elapsed[0] += trap_Milliseconds() - start;
+		numPlayers = numJobs;
+
+		// move them one at a time
+		for( i = 0; i < numJobs; i++ )
+		{
+			ent = game.edicts + 1 + g_moveJobs[i];
+			client = ent->r.client;
+
+			saved[i].ps = client->ps;
+			saved[i].old_pmove = client->old_pmove;
+			saved[i].s = ent->s;
+			VectorCopy( ent->velocity, saved[i].velocity );
+			VectorCopy( ent->r.mins, saved[i].mins );
+			VectorCopy( ent->r.maxs, saved[i].maxs );
+			saved[i].viewheight = ent->viewheight;
+			saved[i].waterlevel = ent->waterlevel;
+			saved[i].watertype = ent->watertype;
+			saved[i].groundentity = ent->groundentity;
+			saved[i].groundentity_linkcount = ent->groundentity_linkcount;
+			saved[i].linkcount = ent->linkcount;
+		}
+
+		for( i = 0; i < numJobs; i++ )
+		{
+			ent = game.edicts + 1 + g_moveJobs[i];
+			client = ent->r.client;
+			mc = &g_moveClients[g_moveJobs[i]];
+
+			for( k = 0; k < G_MOVE_MAX_CMDS; k++ )
+			{
+				// what ClientThink does
+				VectorCopy( ent->s.origin, client->ps.pmove.origin );
+				VectorCopy( ent->velocity, client->ps.pmove.velocity );
+				VectorCopy( ent->s.angles, client->ps.viewangles );
+				client->ps.pmove.gravity = level.gravity;
+				client->ps.pmove.pm_type = G_Client_PMoveType( ent );
+
+				memset( &pm, 0, sizeof( pmove_t ) );
+				pm.playerState = &client->ps;
+				pm.cmd = mc->specs[0].cmd;
+				if( memcmp( &client->old_pmove, &client->ps.pmove, sizeof( pmove_state_t ) ) )
+					pm.snapinitial = true;
+
+				numMoves++;
+				spec = G_PlayerMove_FindSpec( ent, &pm );
+
+				start = trap_Milliseconds();
+				events.numEvents = 0;
+				g_moveEvents = &events;
+				Pmove( &pm, &pmc );
+				g_moveEvents = NULL;
+				elapsed[1] += trap_Milliseconds() - start;
+
+				if( spec )
+				{
+					numUsed++;
+
+					specpm = spec->pm;
+					specpm.playerState = pm.playerState;
+					G_PlayerMove_SaveState( &client->ps, &state );
+					if( memcmp( &spec->out, &state, sizeof( state ) ) || memcmp( &specpm, &pm, sizeof( pm ) ) ||
+						memcmp( &spec->pmc, &pmc, sizeof( pmc ) ) || spec->events.numEvents != events.numEvents ||
+						memcmp( spec->events.events, events.events, sizeof( events.events[0] ) * min( events.numEvents, G_MOVE_MAX_EVENTS ) ) )
+					{
+						numMismatches++;
+					}
+				}
+
+				g_moveEvents = &discarded;
+				Pmove_Finish( &pm, &pmc );
+				g_moveEvents = NULL;
+
+				client->old_pmove = client->ps.pmove;
+
+				VectorCopy( client->ps.pmove.origin, ent->s.origin );
+				VectorCopy( client->ps.pmove.velocity, ent->velocity );
+				VectorCopy( client->ps.viewangles, ent->s.angles );
+				ent->viewheight = client->ps.viewheight;
+				VectorCopy( pm.mins, ent->r.mins );
+				VectorCopy( pm.maxs, ent->r.maxs );
+				GClip_LinkEntity( ent );
+			}
+		}
+
+		// put everybody back
+		for( i = 0; i < numJobs; i++ )
+		{
+			ent = game.edicts + 1 + g_moveJobs[i];
+			client = ent->r.client;
+
+			client->ps = saved[i].ps;
+			client->old_pmove = saved[i].old_pmove;
+			ent->s = saved[i].s;
+			VectorCopy( saved[i].velocity, ent->velocity );
+			VectorCopy( saved[i].mins, ent->r.mins );
+			VectorCopy( saved[i].maxs, ent->r.maxs );
+			ent->viewheight = saved[i].viewheight;
+			ent->waterlevel = saved[i].waterlevel;
+			ent->watertype = saved[i].watertype;
+			ent->groundentity = saved[i].groundentity;
+			ent->groundentity_linkcount = saved[i].groundentity_linkcount;
+			GClip_LinkEntity( ent );
+			ent->linkcount = saved[i].linkcount;
+		}
+
+		G_PlayerMove_EndFrame();
+	}
+
+	G_Free( saved );
+
+	g_moveNumMoves = g_moveNumUsed = 0;
+
+	G_Printf( "%i players x %i moves x %i iterations\n", numPlayers, G_MOVE_MAX_CMDS, iterations );
+	G_Printf( "ahead of time on %i threads: %u ms\n", trap_ThreadPool_NumWorkers( g_movePool ), elapsed[0] );
+	G_Printf( "one at a time: %u ms\n", elapsed[1] );
+	G_Printf( "%i of %i moves taken from ahead of time, %i mismatching\n", numUsed, numMoves, numMismatches );
+	if( numMismatches )
+		G_Printf( S_COLOR_RED "the moves worked out ahead of time differ\n" );
+	G_Printf( "frames since the last movebench: %u of %u client moves taken from ahead of time\n",
+		numFrameUsed, numFrameMoves );
+	if( !g_movePool )
+		G_Printf( "g_movethreads is 0, the moves ahead of time ran on the main thread\n" );
+}
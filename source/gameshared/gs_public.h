@@ -37,7 +37,6 @@ extern void ( *module_Trace )( trace_t *t, vec3_t start, vec3_t mins, vec3_t max
 extern entity_state_t *( *module_GetEntityState )( int entNum, int deltaTime );
 extern int ( *module_PointContents )( vec3_t point, int timeDelta );
 extern void ( *module_PredictedEvent )( int entNum, int ev, int parm );
-extern void ( *module_PMoveTouchTriggers )( pmove_t *pm, vec3_t previous_origin );
 extern void ( *module_RoundUpToHullSize )( vec3_t mins, vec3_t maxs );
 extern const char *( *module_GetConfigString )( int index );
 
@@ -276,7 +275,21 @@ enum {
 	GS_MAXBUNNIES
 };
 
-void Pmove( pmove_t *pmove );
+// what Pmove hands over to Pmove_Finish. The module touches the triggers
+// between the two calls, so that Pmove itself only reads the world
+typedef struct
+{
+	bool touchTriggers;         // false when the player doesn't touch triggers this move
+	vec3_t previous_origin;     // triggers swept from here to the new origin are touched
+
+	int oldGroundEntity;
+	float fallvelocity;
+	float velocityZ;
+	int groundsurfFlags;
+} pmove_context_t;
+
+void Pmove( pmove_t *pmove, pmove_context_t *pmc );
+void Pmove_Finish( pmove_t *pmove, pmove_context_t *pmc );
 
 //===============================================================
 
@@ -443,14 +443,17 @@ typedef int socket_handle_t;
 #define ATTRIBUTE_ALIGNED( x ) __attribute__( ( aligned( x ) ) )
 #define ATTRIBUTE_NOINLINE     __attribute__((noinline))
 #define ATTRIBUTE_NAKED
+#define ATTRIBUTE_THREAD_LOCAL __thread
 #elif defined ( _MSC_VER )
 #define ATTRIBUTE_ALIGNED( x ) __declspec( align( x ) )
 #define ATTRIBUTE_NOINLINE
 #define ATTRIBUTE_NAKED        __declspec( naked )
+#define ATTRIBUTE_THREAD_LOCAL __declspec( thread )
 #else
 #define ATTRIBUTE_ALIGNED( x )
 #define ATTRIBUTE_NOINLINE
 #define ATTRIBUTE_NAKED
+#define ATTRIBUTE_THREAD_LOCAL
 #endif
 
 #ifdef HAVE___STRTOI64
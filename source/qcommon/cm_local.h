@@ -29,6 +29,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // and to avoid various numeric issues
 #define	SURFACE_CLIP_EPSILON	(0.125)
 
+// test 4 brush sides at once when clipping against brushes
+#if ( defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 ) ) && !defined( CM_NO_SIMD )
+#define CM_USE_SSE
+#endif
+
+// brush planes are also stored in blocks of 4 sides: normal[0], normal[1], normal[2] and dist
+#define CM_SIMDPLANES_FLOATS( numsides )	( ALIGN( ( numsides ), 4 ) * 4 )
+
+#define CM_MAX_TRACE_RECORDS	4096	// traces kept for CM_TraceBenchmark
+
 typedef struct
 {
 	char *name;
@@ -51,16 +61,15 @@ typedef struct
 typedef struct
 {
 	int contents;
-	int checkcount;             // to avoid repeated testings
 
 	int numsides;
 	cbrushside_t *brushsides;
+	float *simdplanes;          // [CM_SIMDPLANES_FLOATS( numsides )], NULL for the box and octagon hulls
 } cbrush_t;
 
 typedef struct
 {
 	int contents;
-	int checkcount;             // to avoid repeated testings
 
 	vec3_t mins, maxs;
 
@@ -107,7 +116,6 @@ typedef struct
 
 struct cmodel_state_s
 {
-	int checkcount;
 	int refcount;
 	struct mempool_s *mempool;
 
@@ -142,6 +150,7 @@ struct cmodel_state_s
 
 	int numbrushes;
 	cbrush_t *map_brushes;
+	float *map_brushplanes;         // simdplanes of all the brushes
 
 	int numfaces;
 	cface_t	*map_faces;
@@ -173,23 +182,15 @@ struct cmodel_state_s
 
 	uint8_t *cmod_base;
 
+	// precompiled collision model mapped from the cache, see CM_LoadMapCache
+	int cache_file;
+	uint8_t *cache_data;
+	cbrush_t *map_cachefacets;          // facets of all patches
+	cbrushside_t *map_cachefacetsides;
+
 	// cm_trace.c
-	cplane_t box_planes[6];
-	cbrushside_t box_brushsides[6];
-	cbrush_t box_brush[1];
-	cbrush_t *box_markbrushes[1];
-	cmodel_t box_cmodel[1];
-
-	cplane_t oct_planes[10];
-	cbrushside_t oct_brushsides[10];
-	cbrush_t oct_brush[1];
-	cbrush_t *oct_markbrushes[1];
-	cmodel_t oct_cmodel[1];
-
-	int leaf_count, leaf_maxcount;
-	int *leaf_list;
-	float *leaf_mins, *leaf_maxs;
-	int leaf_topnode;
+	int numtracerecords;
+	struct cmtracerecord_s *trace_records;  // [CM_MAX_TRACE_RECORDS] ring of the last traces
 
 	// optional special handling of line tracing and point contents
 	void ( *CM_TransformedBoxTrace )( struct cmodel_state_s *cms, trace_t *tr, vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, struct cmodel_s *cmodel, int brushmask, vec3_t origin, vec3_t angles );
@@ -199,7 +200,10 @@ struct cmodel_state_s
 
 //=======================================================================
 
-void	CM_InitBoxHull( cmodel_state_t *cms );
-void	CM_InitOctagonHull( cmodel_state_t *cms );
+extern cvar_t *cm_mapCache;
+
+bool	CM_LoadMapCache( cmodel_state_t *cms, const char *name );
+void	CM_WriteMapCache( cmodel_state_t *cms, const char *name );
+void	CM_FreeMapCache( cmodel_state_t *cms );
 
 void	CM_FloodAreaConnections( cmodel_state_t *cms );
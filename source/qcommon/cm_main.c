@@ -29,6 +29,8 @@ static mempool_t *cmap_mempool;
 
 static cvar_t *cm_noAreas;
 cvar_t *cm_noCurves;
+cvar_t *cm_noSIMD;
+cvar_t *cm_mapCache;
 
 void CM_LoadQ3BrushModel( cmodel_state_t *cms, void *parent, void *buffer, bspFormatDesc_t *format );
 
@@ -56,6 +58,8 @@ static void CM_Clear( cmodel_state_t *cms )
 {
 	int i;
 
+	CM_FreeMapCache( cms );
+
 	if( cms->map_shaderrefs )
 	{
 		Mem_Free( cms->map_shaderrefs[0].name );
@@ -147,6 +151,19 @@ static void CM_Clear( cmodel_state_t *cms )
 		cms->numbrushes = 0;
 	}
 
+	if( cms->map_brushplanes )
+	{
+		Mem_Free( cms->map_brushplanes );
+		cms->map_brushplanes = NULL;
+	}
+
+	if( cms->trace_records )
+	{
+		Mem_Free( cms->trace_records );
+		cms->trace_records = NULL;
+		cms->numtracerecords = 0;
+	}
+
 	if( cms->map_pvs )
 	{
 		Mem_Free( cms->map_pvs );
@@ -186,7 +203,7 @@ MAP LOADING
 cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, bool clientload, unsigned *checksum )
 {
 	int length;
-	unsigned *buf;
+	const void *buf;
 	char *header;
 	const modelFormatDescr_t *descr;
 	bspFormatDesc_t *bspFormat = NULL;
@@ -221,7 +238,7 @@ cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, bool clientload, un
 	//
 	// load the file
 	//
-	length = FS_LoadFile( name, ( void ** )&buf, NULL, 0 );
+	length = FS_LoadMappedFile( name, &buf );
 	if( !buf )
 		Com_Error( ERR_DROP, "Couldn't load %s", name );
 
@@ -247,10 +264,16 @@ cmodel_t *CM_LoadMap( cmodel_state_t *cms, const char *name, bool clientload, un
 
 	Mem_TempFree( header );
 
-	descr->loader( cms, NULL, buf, bspFormat );
+	// try the precompiled collision model first
+	cms->cmap_bspFormat = bspFormat;
+	if( !CM_LoadMapCache( cms, name ) )
+	{
+		CM_Clear( cms );
+		descr->loader( cms, NULL, ( void * )buf, bspFormat );
+		CM_WriteMapCache( cms, name );
+	}
 
-	CM_InitBoxHull( cms );
-	CM_InitOctagonHull( cms );
+	FS_FreeMappedFile( buf );
 
 	if( cms->numareas )
 	{
@@ -930,6 +953,8 @@ void CM_Init( void )
 
 	cm_noAreas =	    Cvar_Get( "cm_noAreas", "0", CVAR_CHEAT );
 	cm_noCurves =	    Cvar_Get( "cm_noCurves", "0", CVAR_CHEAT );
+	cm_noSIMD =	    Cvar_Get( "cm_noSIMD", "0", 0 );
+	cm_mapCache =	    Cvar_Get( "cm_mapCache", "1", CVAR_ARCHIVE );
 
 	cm_initialized = true;
 }
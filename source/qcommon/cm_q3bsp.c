@@ -25,6 +25,39 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define MAX_FACET_PLANES 32
 
+/*
+* CM_SetupBrushSIMDPlanes
+* 
+* Copies the brush planes to blocks of 4 sides for the SIMD collision code,
+* returns the end of the written data
+*/
+static float *CM_SetupBrushSIMDPlanes( cbrush_t *brush, float *out )
+{
+	int i, j;
+	float *block;
+	cplane_t *p;
+
+	brush->simdplanes = out;
+
+	for( i = 0; i < brush->numsides; i++ )
+	{
+		p = brush->brushsides[i].plane;
+		block = out + ( i & ~3 ) * 4 + ( i & 3 );
+
+		for( j = 0; j < 3; j++ )
+		{
+			// axial planes are only checked against the mins on their axis
+			if( p->type < 3 )
+				block[j*4] = ( j == p->type ) ? 1.0f : 0.0f;
+			else
+				block[j*4] = p->normal[j];
+		}
+		block[12] = p->dist;
+	}
+
+	return out + CM_SIMDPLANES_FLOATS( brush->numsides );
+}
+
 /*
 * CM_CreateFacetFromPoints
 */
@@ -41,6 +74,7 @@ static int CM_CreateFacetFromPoints( cmodel_state_t *cms, cbrush_t *facet, vec3_
 	// set default values for brush
 	facet->numsides = 0;
 	facet->brushsides = NULL;
+	facet->simdplanes = NULL;
 	facet->contents = shaderref->contents;
 
 	// calculate plane for this triangle
@@ -264,10 +298,17 @@ static void CM_CreatePatch( cmodel_state_t *cms, cface_t *patch, cshaderref_t *s
 	if( patch->numfacets )
 	{
 		uint8_t *data;
+		float *simdplanes;
+		size_t simdsize;
+
+		for( i = 0, simdsize = 0; i < patch->numfacets; i++ )
+			simdsize += CM_SIMDPLANES_FLOATS( facets[i].numsides ) * sizeof( float );
 
-		data = Mem_Alloc( cms->mempool, patch->numfacets * sizeof( cbrush_t ) + totalsides * ( sizeof( cbrushside_t ) + sizeof( cplane_t ) ) );
+		// the facets must come first, CM_Clear frees them through patch->facets
+		data = Mem_Alloc( cms->mempool, patch->numfacets * sizeof( cbrush_t ) + simdsize + totalsides * ( sizeof( cbrushside_t ) + sizeof( cplane_t ) ) );
 
 		patch->facets = ( cbrush_t * )data; data += patch->numfacets * sizeof( cbrush_t );
+		simdplanes = ( float * )data; data += simdsize;
 		memcpy( patch->facets, facets, patch->numfacets * sizeof( cbrush_t ) );
 		for( i = 0, k = 0, facet = patch->facets; i < patch->numfacets; i++, facet++ )
 		{
@@ -286,6 +327,8 @@ static void CM_CreatePatch( cmodel_state_t *cms, cface_t *patch, cshaderref_t *s
 				CategorizePlane( s->plane );
 				s->surfFlags = shaderref->flags;
 			}
+
+			simdplanes = CM_SetupBrushSIMDPlanes( facet, simdplanes );
 		}
 
 		patch->contents = shaderref->contents;
@@ -802,6 +845,8 @@ static void CMod_LoadBrushes( cmodel_state_t *cms, lump_t *l )
 	dbrush_t *in;
 	cbrush_t *out;
 	int shaderref;
+	size_t numsimdplanes;
+	float *simdplanes;
 
 	in = ( void * )( cms->cmod_base + l->fileofs );
 	if( l->filelen % sizeof( *in ) )
@@ -813,13 +858,18 @@ static void CMod_LoadBrushes( cmodel_state_t *cms, lump_t *l )
 	out = cms->map_brushes = Mem_Alloc( cms->mempool, count * sizeof( *out ) );
 	cms->numbrushes = count;
 
-	for( i = 0; i < count; i++, out++, in++ )
+	for( i = 0, numsimdplanes = 0; i < count; i++, out++, in++ )
 	{
 		shaderref = LittleLong( in->shadernum );
 		out->contents = cms->map_shaderrefs[shaderref].contents;
 		out->numsides = LittleLong( in->numsides );
 		out->brushsides = cms->map_brushsides + LittleLong( in->firstside );
+		numsimdplanes += CM_SIMDPLANES_FLOATS( out->numsides );
 	}
+
+	simdplanes = cms->map_brushplanes = Mem_Alloc( cms->mempool, max( numsimdplanes, 1 ) * sizeof( float ) );
+	for( i = 0, out = cms->map_brushes; i < count; i++, out++ )
+		simdplanes = CM_SetupBrushSIMDPlanes( out, simdplanes );
 }
 
 /*
@@ -895,8 +945,737 @@ void CM_LoadQ3BrushModel( cmodel_state_t *cms, void *parent, void *buf, bspForma
 	CMod_LoadVisibility( cms, &header.lumps[LUMP_VISIBILITY] );
 	CMod_LoadEntityString( cms, &header.lumps[LUMP_ENTITIES] );
 
-	FS_FreeFile( buf );
-
 	if( cms->numvertexes )
 		Mem_Free( cms->map_verts );
 }
+
+/*
+===============================================================================
+
+PRECOMPILED COLLISION MODEL CACHE
+
+Once a map has been loaded from the bsp, its collision model is written
+to the cache directory with all pointers turned into indices. Later loads
+of the same bsp map that file read-only and use the planes, the SIMD
+planes of brushes and patch facets and the vis data in place, so that
+processes running the same map share those pages. Only the small arrays
+holding pointers are rebuilt, patches aren't tessellated again.
+
+===============================================================================
+*/
+
+#define CM_CACHE_ID			"QFCM"
+#define CM_CACHE_VERSION	1		// bump whenever the loaded collision data changes
+#define CM_CACHE_EXTENSION	".cmc"
+#define CM_CACHE_ALIGN		16
+
+enum
+{
+	CMC_SHADERREFS,
+	CMC_SHADERNAMES,
+	CMC_PLANES,
+	CMC_BRUSHSIDES,
+	CMC_BRUSHES,
+	CMC_BRUSHPLANES,
+	CMC_MARKBRUSHES,
+	CMC_FACETPLANES,
+	CMC_FACETSIDES,
+	CMC_FACETS,
+	CMC_FACETSIMDPLANES,
+	CMC_FACES,
+	CMC_MARKFACES,
+	CMC_LEAFS,
+	CMC_NODES,
+	CMC_MODELS,
+	CMC_MODELMARKFACES,
+	CMC_MODELMARKBRUSHES,
+	CMC_VISIBILITY,
+	CMC_ENTITIES,
+
+	CMC_NUM_LUMPS
+};
+
+typedef struct
+{
+	char id[4];
+	int version;
+	int layout;                     // sizeof( cplane_t ), planes are used in place
+	unsigned int checksum;          // of the bsp
+	vec3_t world_mins, world_maxs;
+	int numareas;
+	lump_t lumps[CMC_NUM_LUMPS];
+} cmcheader_t;
+
+typedef struct
+{
+	int name;                       // offset in CMC_SHADERNAMES
+	int contents;
+	int flags;
+} cmcshaderref_t;
+
+typedef struct
+{
+	int planenum;
+	int surfFlags;
+} cmcbrushside_t;
+
+typedef struct
+{
+	int contents;
+	int firstside, numsides;        // SIMD planes follow in the same order
+} cmcbrush_t;
+
+typedef struct
+{
+	int contents;
+	vec3_t mins, maxs;
+	int firstfacet, numfacets;
+} cmcface_t;
+
+typedef struct
+{
+	int contents;
+	int cluster;
+	int area;
+	int firstmarkbrush, nummarkbrushes;
+	int firstmarkface, nummarkfaces;
+} cmcleaf_t;
+
+typedef struct
+{
+	int planenum;
+	int children[2];
+} cmcnode_t;
+
+typedef struct
+{
+	vec3_t mins, maxs;
+	int firstmarkface, nummarkfaces;
+	int firstmarkbrush, nummarkbrushes;
+} cmcmodel_t;
+
+/*
+* CM_MapCacheName
+*/
+static char *CM_MapCacheName( const char *name )
+{
+	char *cachename;
+	size_t cachename_size;
+
+	cachename_size = strlen( name ) + strlen( CM_CACHE_EXTENSION ) + 1;
+	cachename = Mem_TempMalloc( cachename_size );
+	Q_strncpyz( cachename, name, cachename_size );
+	COM_ReplaceExtension( cachename, CM_CACHE_EXTENSION, cachename_size );
+
+	return cachename;
+}
+
+/*
+* CM_WriteCacheLump
+*/
+static void CM_WriteCacheLump( int file, cmcheader_t *header, int lump, const void *data, size_t size )
+{
+	static const uint8_t zeros[CM_CACHE_ALIGN];
+	int pos, pad;
+
+	pos = FS_Tell( file );
+	pad = ALIGN( pos, CM_CACHE_ALIGN ) - pos;
+	if( pad )
+		FS_Write( zeros, pad, file );
+
+	header->lumps[lump].fileofs = pos + pad;
+	header->lumps[lump].filelen = size;
+	if( size )
+		FS_Write( data, size, file );
+}
+
+/*
+* CM_WriteMapCache
+*/
+void CM_WriteMapCache( cmodel_state_t *cms, const char *name )
+{
+	int i, j, k, n, file;
+	int numfacets, numfacetsides, numfacetsimdplanes;
+	int nummodelmarkfaces, nummodelmarkbrushes;
+	size_t namesize, brushplanessize, tempname_size;
+	char *cachename, *tempname;
+	cmcheader_t header;
+	cmcshaderref_t *shaderrefs;
+	cmcbrushside_t *sides;
+	cmcbrush_t *brushes;
+	cmcface_t *faces;
+	cmcleaf_t *leafs;
+	cmcnode_t *nodes;
+	cmcmodel_t *models;
+	cplane_t *planes;
+	float *simdplanes;
+	int *marks;
+	const cface_t *face;
+	const cbrush_t *brush;
+	const cleaf_t *leaf;
+	const cmodel_t *cmodel;
+
+	if( !cm_mapCache->integer || cms->cache_data )
+		return;
+
+	cachename = CM_MapCacheName( name );
+	tempname_size = strlen( cachename ) + 16;
+	tempname = Mem_TempMalloc( tempname_size );
+	Q_snprintfz( tempname, tempname_size, "%s.%i.tmp", cachename, Sys_GetCurrentProcessId() );
+
+	if( FS_FOpenFile( tempname, &file, FS_WRITE|FS_CACHE ) == -1 )
+	{
+		Com_DPrintf( "CM_WriteMapCache: couldn't open %s for writing\n", tempname );
+		Mem_TempFree( tempname );
+		Mem_TempFree( cachename );
+		return;
+	}
+
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.id, CM_CACHE_ID, sizeof( header.id ) );
+	header.version = CM_CACHE_VERSION;
+	header.layout = sizeof( cplane_t );
+	header.checksum = cms->checksum;
+	VectorCopy( cms->world_mins, header.world_mins );
+	VectorCopy( cms->world_maxs, header.world_maxs );
+	header.numareas = cms->numareas;
+	FS_Write( &header, sizeof( header ), file );
+
+	// shaders, the names are stored in a single buffer in the same order
+	shaderrefs = Mem_TempMalloc( cms->numshaderrefs * sizeof( *shaderrefs ) );
+	for( i = 0, namesize = 0; i < cms->numshaderrefs; i++ )
+	{
+		shaderrefs[i].name = cms->map_shaderrefs[i].name - cms->map_shaderrefs[0].name;
+		shaderrefs[i].contents = cms->map_shaderrefs[i].contents;
+		shaderrefs[i].flags = cms->map_shaderrefs[i].flags;
+		namesize = shaderrefs[i].name + strlen( cms->map_shaderrefs[i].name ) + 1;
+	}
+	CM_WriteCacheLump( file, &header, CMC_SHADERREFS, shaderrefs, cms->numshaderrefs * sizeof( *shaderrefs ) );
+	CM_WriteCacheLump( file, &header, CMC_SHADERNAMES, cms->map_shaderrefs[0].name, namesize );
+	Mem_TempFree( shaderrefs );
+
+	// brushes
+	CM_WriteCacheLump( file, &header, CMC_PLANES, cms->map_planes, cms->numplanes * sizeof( cplane_t ) );
+
+	sides = Mem_TempMalloc( cms->numbrushsides * sizeof( *sides ) );
+	for( i = 0; i < cms->numbrushsides; i++ )
+	{
+		sides[i].planenum = cms->map_brushsides[i].plane - cms->map_planes;
+		sides[i].surfFlags = cms->map_brushsides[i].surfFlags;
+	}
+	CM_WriteCacheLump( file, &header, CMC_BRUSHSIDES, sides, cms->numbrushsides * sizeof( *sides ) );
+	Mem_TempFree( sides );
+
+	brushes = Mem_TempMalloc( cms->numbrushes * sizeof( *brushes ) );
+	for( i = 0, brushplanessize = 0, brush = cms->map_brushes; i < cms->numbrushes; i++, brush++ )
+	{
+		brushes[i].contents = brush->contents;
+		brushes[i].firstside = brush->brushsides - cms->map_brushsides;
+		brushes[i].numsides = brush->numsides;
+		brushplanessize += CM_SIMDPLANES_FLOATS( brush->numsides ) * sizeof( float );
+	}
+	CM_WriteCacheLump( file, &header, CMC_BRUSHES, brushes, cms->numbrushes * sizeof( *brushes ) );
+	CM_WriteCacheLump( file, &header, CMC_BRUSHPLANES, cms->map_brushplanes, brushplanessize );
+	Mem_TempFree( brushes );
+
+	marks = Mem_TempMalloc( cms->nummarkbrushes * sizeof( *marks ) );
+	for( i = 0; i < cms->nummarkbrushes; i++ )
+		marks[i] = cms->map_markbrushes[i] - cms->map_brushes;
+	CM_WriteCacheLump( file, &header, CMC_MARKBRUSHES, marks, cms->nummarkbrushes * sizeof( *marks ) );
+	Mem_TempFree( marks );
+
+	// patches, the facets of all faces are gathered in single arrays
+	numfacets = numfacetsides = numfacetsimdplanes = 0;
+	for( i = 0, face = cms->map_faces; i < cms->numfaces; i++, face++ )
+	{
+		for( j = 0, brush = face->facets; j < face->numfacets; j++, brush++ )
+		{
+			numfacetsides += brush->numsides;
+			numfacetsimdplanes += CM_SIMDPLANES_FLOATS( brush->numsides );
+		}
+		numfacets += face->numfacets;
+	}
+
+	planes = Mem_TempMalloc( max( numfacetsides, 1 ) * sizeof( *planes ) );
+	sides = Mem_TempMalloc( max( numfacetsides, 1 ) * sizeof( *sides ) );
+	brushes = Mem_TempMalloc( max( numfacets, 1 ) * sizeof( *brushes ) );
+	simdplanes = Mem_TempMalloc( max( numfacetsimdplanes, 1 ) * sizeof( *simdplanes ) );
+	faces = Mem_TempMalloc( cms->numfaces * sizeof( *faces ) );
+
+	numfacets = numfacetsides = numfacetsimdplanes = 0;
+	for( i = 0, face = cms->map_faces; i < cms->numfaces; i++, face++ )
+	{
+		faces[i].contents = face->contents;
+		VectorCopy( face->mins, faces[i].mins );
+		VectorCopy( face->maxs, faces[i].maxs );
+		faces[i].firstfacet = numfacets;
+		faces[i].numfacets = face->numfacets;
+
+		for( j = 0, brush = face->facets; j < face->numfacets; j++, brush++ )
+		{
+			brushes[numfacets].contents = brush->contents;
+			brushes[numfacets].firstside = numfacetsides;
+			brushes[numfacets].numsides = brush->numsides;
+			numfacets++;
+
+			for( k = 0; k < brush->numsides; k++ )
+			{
+				planes[numfacetsides] = *brush->brushsides[k].plane;
+				sides[numfacetsides].planenum = numfacetsides;
+				sides[numfacetsides].surfFlags = brush->brushsides[k].surfFlags;
+				numfacetsides++;
+			}
+
+			n = CM_SIMDPLANES_FLOATS( brush->numsides );
+			memcpy( simdplanes + numfacetsimdplanes, brush->simdplanes, n * sizeof( float ) );
+			numfacetsimdplanes += n;
+		}
+	}
+
+	CM_WriteCacheLump( file, &header, CMC_FACETPLANES, planes, numfacetsides * sizeof( *planes ) );
+	CM_WriteCacheLump( file, &header, CMC_FACETSIDES, sides, numfacetsides * sizeof( *sides ) );
+	CM_WriteCacheLump( file, &header, CMC_FACETS, brushes, numfacets * sizeof( *brushes ) );
+	CM_WriteCacheLump( file, &header, CMC_FACETSIMDPLANES, simdplanes, numfacetsimdplanes * sizeof( *simdplanes ) );
+	CM_WriteCacheLump( file, &header, CMC_FACES, faces, cms->numfaces * sizeof( *faces ) );
+	Mem_TempFree( faces );
+	Mem_TempFree( simdplanes );
+	Mem_TempFree( brushes );
+	Mem_TempFree( sides );
+	Mem_TempFree( planes );
+
+	// bsp tree
+	marks = Mem_TempMalloc( cms->nummarkfaces * sizeof( *marks ) );
+	for( i = 0; i < cms->nummarkfaces; i++ )
+		marks[i] = cms->map_markfaces[i] - cms->map_faces;
+	CM_WriteCacheLump( file, &header, CMC_MARKFACES, marks, cms->nummarkfaces * sizeof( *marks ) );
+	Mem_TempFree( marks );
+
+	leafs = Mem_TempMalloc( cms->numleafs * sizeof( *leafs ) );
+	for( i = 0, leaf = cms->map_leafs; i < cms->numleafs; i++, leaf++ )
+	{
+		leafs[i].contents = leaf->contents;
+		leafs[i].cluster = leaf->cluster;
+		leafs[i].area = leaf->area;
+		leafs[i].firstmarkbrush = leaf->markbrushes - cms->map_markbrushes;
+		leafs[i].nummarkbrushes = leaf->nummarkbrushes;
+		leafs[i].firstmarkface = leaf->markfaces - cms->map_markfaces;
+		leafs[i].nummarkfaces = leaf->nummarkfaces;
+	}
+	CM_WriteCacheLump( file, &header, CMC_LEAFS, leafs, cms->numleafs * sizeof( *leafs ) );
+	Mem_TempFree( leafs );
+
+	nodes = Mem_TempMalloc( cms->numnodes * sizeof( *nodes ) );
+	for( i = 0; i < cms->numnodes; i++ )
+	{
+		nodes[i].planenum = cms->map_nodes[i].plane - cms->map_planes;
+		nodes[i].children[0] = cms->map_nodes[i].children[0];
+		nodes[i].children[1] = cms->map_nodes[i].children[1];
+	}
+	CM_WriteCacheLump( file, &header, CMC_NODES, nodes, cms->numnodes * sizeof( *nodes ) );
+	Mem_TempFree( nodes );
+
+	// inline models
+	models = Mem_TempMalloc( cms->numcmodels * sizeof( *models ) );
+	for( i = 0, nummodelmarkfaces = nummodelmarkbrushes = 0, cmodel = cms->map_cmodels; i < cms->numcmodels; i++, cmodel++ )
+	{
+		VectorCopy( cmodel->mins, models[i].mins );
+		VectorCopy( cmodel->maxs, models[i].maxs );
+		models[i].firstmarkface = nummodelmarkfaces;
+		models[i].nummarkfaces = cmodel->nummarkfaces;
+		models[i].firstmarkbrush = nummodelmarkbrushes;
+		models[i].nummarkbrushes = cmodel->nummarkbrushes;
+		nummodelmarkfaces += cmodel->nummarkfaces;
+		nummodelmarkbrushes += cmodel->nummarkbrushes;
+	}
+	CM_WriteCacheLump( file, &header, CMC_MODELS, models, cms->numcmodels * sizeof( *models ) );
+	Mem_TempFree( models );
+
+	marks = Mem_TempMalloc( max( nummodelmarkfaces, 1 ) * sizeof( *marks ) );
+	for( i = 0, n = 0, cmodel = cms->map_cmodels; i < cms->numcmodels; i++, cmodel++ )
+	{
+		for( j = 0; j < cmodel->nummarkfaces; j++ )
+			marks[n++] = cmodel->markfaces[j] - cms->map_faces;
+	}
+	CM_WriteCacheLump( file, &header, CMC_MODELMARKFACES, marks, nummodelmarkfaces * sizeof( *marks ) );
+	Mem_TempFree( marks );
+
+	marks = Mem_TempMalloc( max( nummodelmarkbrushes, 1 ) * sizeof( *marks ) );
+	for( i = 0, n = 0, cmodel = cms->map_cmodels; i < cms->numcmodels; i++, cmodel++ )
+	{
+		for( j = 0; j < cmodel->nummarkbrushes; j++ )
+			marks[n++] = cmodel->markbrushes[j] - cms->map_brushes;
+	}
+	CM_WriteCacheLump( file, &header, CMC_MODELMARKBRUSHES, marks, nummodelmarkbrushes * sizeof( *marks ) );
+	Mem_TempFree( marks );
+
+	CM_WriteCacheLump( file, &header, CMC_VISIBILITY, cms->map_pvs, cms->map_pvs ? cms->map_visdatasize : 0 );
+	CM_WriteCacheLump( file, &header, CMC_ENTITIES, cms->map_entitystring, cms->numentitychars );
+
+	FS_Seek( file, 0, FS_SEEK_SET );
+	FS_Write( &header, sizeof( header ), file );
+	FS_FCloseFile( file );
+
+	// other processes may be loading the same map, so only complete files get the real name
+#ifdef _WIN32
+	// rename doesn't replace existing files, get rid of the stale cache first
+	FS_RemoveCacheFile( cachename );
+#endif
+	if( !FS_MoveCacheFile( tempname, cachename ) )
+	{
+		Com_DPrintf( "CM_WriteMapCache: couldn't rename %s to %s\n", tempname, cachename );
+		FS_RemoveCacheFile( tempname );
+	}
+
+	Mem_TempFree( tempname );
+	Mem_TempFree( cachename );
+}
+
+/*
+* CM_CacheLump
+*
+* Returns a pointer to the lump in the mapped cache, count is set to -1
+* if the lump isn't a whole number of elements
+*/
+static void *CM_CacheLump( cmodel_state_t *cms, int lump, size_t elemsize, int *count )
+{
+	const lump_t *l = &( ( const cmcheader_t * )cms->cache_data )->lumps[lump];
+
+	*count = ( l->filelen % elemsize ) ? -1 : (int)( l->filelen / elemsize );
+	return cms->cache_data + l->fileofs;
+}
+
+/*
+* CM_LoadCachedBrushes
+*/
+static bool CM_LoadCachedBrushes( cmodel_state_t *cms, const cmcbrushside_t *insides, int numinsides, cplane_t *planes, int numplanes,
+	const cmcbrush_t *in, int count, float *simdplanes, int numsimdplanes, cbrushside_t *sides, cbrush_t *out )
+{
+	int i;
+
+	for( i = 0; i < numinsides; i++ )
+	{
+		if( insides[i].planenum < 0 || insides[i].planenum >= numplanes )
+			return false;
+		sides[i].plane = planes + insides[i].planenum;
+		sides[i].surfFlags = insides[i].surfFlags;
+	}
+
+	for( i = 0; i < count; i++, in++, out++ )
+	{
+		if( in->numsides < 0 || in->firstside < 0 || in->firstside + in->numsides > numinsides )
+			return false;
+		if( numsimdplanes < CM_SIMDPLANES_FLOATS( in->numsides ) )
+			return false;
+
+		out->contents = in->contents;
+		out->numsides = in->numsides;
+		out->brushsides = sides + in->firstside;
+		out->simdplanes = simdplanes;
+
+		simdplanes += CM_SIMDPLANES_FLOATS( in->numsides );
+		numsimdplanes -= CM_SIMDPLANES_FLOATS( in->numsides );
+	}
+
+	return numsimdplanes == 0;
+}
+
+/*
+* CM_LoadMapCache
+*
+* Returns false if there's no valid cache for the map, the caller
+* must then clear the collision model and load the bsp instead
+*/
+bool CM_LoadMapCache( cmodel_state_t *cms, const char *name )
+{
+	int i, j, file, length, count, numsides, numsimdplanes, numfacetplanes, nummarks, numnames;
+	char *cachename;
+	uint8_t *data;
+	const cmcheader_t *header;
+	const cmcshaderref_t *inshaderrefs;
+	const char *names;
+	const cmcbrushside_t *insides;
+	const cmcbrush_t *inbrushes;
+	const cmcface_t *infaces;
+	const cmcleaf_t *inleafs;
+	const cmcnode_t *innodes;
+	const cmcmodel_t *inmodels;
+	const int *inmarks, *inmodelmarkfaces, *inmodelmarkbrushes;
+	int nummodelmarkfaces, nummodelmarkbrushes;
+	cplane_t *facetplanes;
+	float *simdplanes;
+	char *buffer;
+
+	if( !cm_mapCache->integer )
+		return false;
+
+	cachename = CM_MapCacheName( name );
+	length = FS_FOpenFile( cachename, &file, FS_READ|FS_CACHE );
+	Mem_TempFree( cachename );
+	if( !file )
+		return false;
+
+	data = length >= (int)sizeof( *header ) ? FS_MMapBaseFile( file, length, 0 ) : NULL;
+	if( !data )
+	{
+		FS_FCloseFile( file );
+		return false;
+	}
+
+	cms->cache_file = file;
+	cms->cache_data = data;
+
+	header = ( const cmcheader_t * )data;
+	if( memcmp( header->id, CM_CACHE_ID, sizeof( header->id ) ) || header->version != CM_CACHE_VERSION ||
+		header->layout != sizeof( cplane_t ) || header->checksum != cms->checksum )
+		return false;
+
+	for( i = 0; i < CMC_NUM_LUMPS; i++ )
+	{
+		const lump_t *l = &header->lumps[i];
+
+		if( l->fileofs < (int)sizeof( *header ) || l->filelen < 0 || l->fileofs % CM_CACHE_ALIGN ||
+			l->filelen > length - l->fileofs )
+			return false;
+	}
+
+	// shaders
+	inshaderrefs = CM_CacheLump( cms, CMC_SHADERREFS, sizeof( *inshaderrefs ), &count );
+	names = CM_CacheLump( cms, CMC_SHADERNAMES, 1, &numnames );
+	if( count < 1 || numnames < 1 || inshaderrefs[0].name != 0 || names[numnames-1] != '\0' )
+		return false;
+
+	buffer = Mem_Alloc( cms->mempool, numnames );
+	memcpy( buffer, names, numnames );
+	cms->map_shaderrefs = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_shaderrefs ) );
+	cms->map_shaderrefs[0].name = buffer;
+	cms->numshaderrefs = count;
+	for( i = 0; i < count; i++ )
+	{
+		if( inshaderrefs[i].name < 0 || inshaderrefs[i].name >= numnames )
+			return false;
+		cms->map_shaderrefs[i].name = buffer + inshaderrefs[i].name;
+		cms->map_shaderrefs[i].contents = inshaderrefs[i].contents;
+		cms->map_shaderrefs[i].flags = inshaderrefs[i].flags;
+	}
+
+	// brushes
+	cms->map_planes = CM_CacheLump( cms, CMC_PLANES, sizeof( cplane_t ), &cms->numplanes );
+	insides = CM_CacheLump( cms, CMC_BRUSHSIDES, sizeof( *insides ), &numsides );
+	inbrushes = CM_CacheLump( cms, CMC_BRUSHES, sizeof( *inbrushes ), &count );
+	cms->map_brushplanes = CM_CacheLump( cms, CMC_BRUSHPLANES, sizeof( float ), &numsimdplanes );
+	if( cms->numplanes < 1 || numsides < 1 || count < 1 || numsimdplanes < 0 )
+		return false;
+
+	cms->map_brushsides = Mem_Alloc( cms->mempool, numsides * sizeof( *cms->map_brushsides ) );
+	cms->numbrushsides = numsides;
+	cms->map_brushes = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_brushes ) );
+	cms->numbrushes = count;
+	if( !CM_LoadCachedBrushes( cms, insides, numsides, cms->map_planes, cms->numplanes, inbrushes, count,
+		cms->map_brushplanes, numsimdplanes, cms->map_brushsides, cms->map_brushes ) )
+		return false;
+
+	inmarks = CM_CacheLump( cms, CMC_MARKBRUSHES, sizeof( int ), &count );
+	if( count < 1 )
+		return false;
+	cms->map_markbrushes = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_markbrushes ) );
+	cms->nummarkbrushes = count;
+	for( i = 0; i < count; i++ )
+	{
+		if( inmarks[i] < 0 || inmarks[i] >= cms->numbrushes )
+			return false;
+		cms->map_markbrushes[i] = cms->map_brushes + inmarks[i];
+	}
+
+	// patches
+	facetplanes = CM_CacheLump( cms, CMC_FACETPLANES, sizeof( cplane_t ), &numfacetplanes );
+	insides = CM_CacheLump( cms, CMC_FACETSIDES, sizeof( *insides ), &numsides );
+	inbrushes = CM_CacheLump( cms, CMC_FACETS, sizeof( *inbrushes ), &count );
+	simdplanes = CM_CacheLump( cms, CMC_FACETSIMDPLANES, sizeof( float ), &numsimdplanes );
+	if( numfacetplanes < 0 || numsides < 0 || count < 0 || numsimdplanes < 0 )
+		return false;
+
+	if( count )
+	{
+		cms->map_cachefacetsides = Mem_Alloc( cms->mempool, max( numsides, 1 ) * sizeof( *cms->map_cachefacetsides ) );
+		cms->map_cachefacets = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_cachefacets ) );
+	}
+	if( !CM_LoadCachedBrushes( cms, insides, numsides, facetplanes, numfacetplanes, inbrushes, count,
+		simdplanes, numsimdplanes, cms->map_cachefacetsides, cms->map_cachefacets ) )
+		return false;
+
+	infaces = CM_CacheLump( cms, CMC_FACES, sizeof( *infaces ), &j );
+	if( j < 1 )
+		return false;
+	cms->map_faces = Mem_Alloc( cms->mempool, j * sizeof( *cms->map_faces ) );
+	cms->numfaces = j;
+	for( i = 0; i < cms->numfaces; i++, infaces++ )
+	{
+		if( infaces->numfacets < 0 || infaces->firstfacet < 0 || infaces->firstfacet + infaces->numfacets > count )
+			return false;
+
+		cms->map_faces[i].contents = infaces->contents;
+		VectorCopy( infaces->mins, cms->map_faces[i].mins );
+		VectorCopy( infaces->maxs, cms->map_faces[i].maxs );
+		cms->map_faces[i].numfacets = infaces->numfacets;
+		cms->map_faces[i].facets = infaces->numfacets ? cms->map_cachefacets + infaces->firstfacet : NULL;
+	}
+
+	// bsp tree
+	inmarks = CM_CacheLump( cms, CMC_MARKFACES, sizeof( int ), &count );
+	if( count < 1 )
+		return false;
+	cms->map_markfaces = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_markfaces ) );
+	cms->nummarkfaces = count;
+	for( i = 0; i < count; i++ )
+	{
+		if( inmarks[i] < 0 || inmarks[i] >= cms->numfaces )
+			return false;
+		cms->map_markfaces[i] = cms->map_faces + inmarks[i];
+	}
+
+	inleafs = CM_CacheLump( cms, CMC_LEAFS, sizeof( *inleafs ), &count );
+	if( count < 1 )
+		return false;
+	cms->map_leafs = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_leafs ) );
+	cms->numleafs = count;
+	for( i = 0; i < count; i++, inleafs++ )
+	{
+		cleaf_t *out = &cms->map_leafs[i];
+
+		if( inleafs->nummarkbrushes < 0 || inleafs->firstmarkbrush < 0 || inleafs->firstmarkbrush + inleafs->nummarkbrushes > cms->nummarkbrushes )
+			return false;
+		if( inleafs->nummarkfaces < 0 || inleafs->firstmarkface < 0 || inleafs->firstmarkface + inleafs->nummarkfaces > cms->nummarkfaces )
+			return false;
+		if( inleafs->area >= header->numareas )
+			return false;
+
+		out->contents = inleafs->contents;
+		out->cluster = inleafs->cluster;
+		out->area = inleafs->area;
+		out->markbrushes = cms->map_markbrushes + inleafs->firstmarkbrush;
+		out->nummarkbrushes = inleafs->nummarkbrushes;
+		out->markfaces = cms->map_markfaces + inleafs->firstmarkface;
+		out->nummarkfaces = inleafs->nummarkfaces;
+	}
+	cms->numareas = header->numareas;
+
+	innodes = CM_CacheLump( cms, CMC_NODES, sizeof( *innodes ), &count );
+	if( count < 1 )
+		return false;
+	cms->map_nodes = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_nodes ) );
+	cms->numnodes = count;
+	for( i = 0; i < count; i++, innodes++ )
+	{
+		if( innodes->planenum < 0 || innodes->planenum >= cms->numplanes )
+			return false;
+		for( j = 0; j < 2; j++ )
+		{
+			if( innodes->children[j] >= cms->numnodes || -1 - innodes->children[j] >= cms->numleafs )
+				return false;
+			cms->map_nodes[i].children[j] = innodes->children[j];
+		}
+		cms->map_nodes[i].plane = cms->map_planes + innodes->planenum;
+	}
+	VectorCopy( header->world_mins, cms->world_mins );
+	VectorCopy( header->world_maxs, cms->world_maxs );
+
+	// inline models
+	inmodels = CM_CacheLump( cms, CMC_MODELS, sizeof( *inmodels ), &count );
+	inmodelmarkfaces = CM_CacheLump( cms, CMC_MODELMARKFACES, sizeof( int ), &nummodelmarkfaces );
+	inmodelmarkbrushes = CM_CacheLump( cms, CMC_MODELMARKBRUSHES, sizeof( int ), &nummodelmarkbrushes );
+	if( count < 1 || nummodelmarkfaces < 0 || nummodelmarkbrushes < 0 )
+		return false;
+	cms->map_cmodels = Mem_Alloc( cms->mempool, count * sizeof( *cms->map_cmodels ) );
+	cms->numcmodels = count;
+	for( i = 0; i < count; i++, inmodels++ )
+	{
+		cmodel_t *out = &cms->map_cmodels[i];
+
+		if( inmodels->nummarkfaces < 0 || inmodels->firstmarkface < 0 || inmodels->firstmarkface + inmodels->nummarkfaces > nummodelmarkfaces )
+			return false;
+		if( inmodels->nummarkbrushes < 0 || inmodels->firstmarkbrush < 0 || inmodels->firstmarkbrush + inmodels->nummarkbrushes > nummodelmarkbrushes )
+			return false;
+
+		VectorCopy( inmodels->mins, out->mins );
+		VectorCopy( inmodels->maxs, out->maxs );
+
+		out->nummarkfaces = inmodels->nummarkfaces;
+		out->markfaces = Mem_Alloc( cms->mempool, out->nummarkfaces * sizeof( cface_t * ) );
+		for( j = 0; j < out->nummarkfaces; j++ )
+		{
+			nummarks = inmodelmarkfaces[inmodels->firstmarkface + j];
+			if( nummarks < 0 || nummarks >= cms->numfaces )
+				return false;
+			out->markfaces[j] = cms->map_faces + nummarks;
+		}
+
+		out->nummarkbrushes = inmodels->nummarkbrushes;
+		out->markbrushes = Mem_Alloc( cms->mempool, out->nummarkbrushes * sizeof( cbrush_t * ) );
+		for( j = 0; j < out->nummarkbrushes; j++ )
+		{
+			nummarks = inmodelmarkbrushes[inmodels->firstmarkbrush + j];
+			if( nummarks < 0 || nummarks >= cms->numbrushes )
+				return false;
+			out->markbrushes[j] = cms->map_brushes + nummarks;
+		}
+	}
+
+	// vis is used in place, the entity string is handed out for writing
+	cms->map_pvs = CM_CacheLump( cms, CMC_VISIBILITY, 1, &cms->map_visdatasize );
+	if( !cms->map_visdatasize )
+		cms->map_pvs = NULL;
+	else if( cms->map_visdatasize < (int)offsetof( dvis_t, data ) )
+		return false;
+
+	buffer = CM_CacheLump( cms, CMC_ENTITIES, 1, &count );
+	cms->numentitychars = count;
+	if( count )
+	{
+		cms->map_entitystring = Mem_Alloc( cms->mempool, count );
+		memcpy( cms->map_entitystring, buffer, count );
+	}
+
+	return true;
+}
+
+/*
+* CM_FreeMapCache
+*
+* Drops the pointers into the mapped cache and unmaps it, the rest
+* of the collision model is freed by the caller
+*/
+void CM_FreeMapCache( cmodel_state_t *cms )
+{
+	int i;
+
+	if( !cms->cache_data )
+		return;
+
+	cms->map_planes = NULL;
+	cms->numplanes = 0;
+	cms->map_brushplanes = NULL;
+	cms->map_pvs = NULL;
+
+	if( cms->map_faces )
+	{
+		for( i = 0; i < cms->numfaces; i++ )
+			cms->map_faces[i].facets = NULL;
+	}
+
+	if( cms->map_cachefacets )
+	{
+		Mem_Free( cms->map_cachefacets );
+		cms->map_cachefacets = NULL;
+	}
+
+	if( cms->map_cachefacetsides )
+	{
+		Mem_Free( cms->map_cachefacetsides );
+		cms->map_cachefacetsides = NULL;
+	}
+
+	FS_UnMMapBaseFile( cms->cache_file, cms->cache_data );
+	FS_FCloseFile( cms->cache_file );
+	cms->cache_data = NULL;
+	cms->cache_file = 0;
+}
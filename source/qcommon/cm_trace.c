@@ -22,39 +22,67 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "qcommon.h"
 #include "cm_local.h"
 
+#ifdef CM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+/*
+* The box and octagon hulls are rewritten by every CM_ModelForBBox and
+* CM_OctagonModelForBBox call, each thread gets its own so that traces
+* can be run from several threads at once
+*/
+typedef struct
+{
+	cplane_t box_planes[6];
+	cbrushside_t box_brushsides[6];
+	cbrush_t box_brush[1];
+	cbrush_t *box_markbrushes[1];
+	cmodel_t box_cmodel[1];
+
+	cplane_t oct_planes[10];
+	cbrushside_t oct_brushsides[10];
+	cbrush_t oct_brush[1];
+	cbrush_t *oct_markbrushes[1];
+	cmodel_t oct_cmodel[1];
+
+	bool initialized;
+} cmhulls_t;
+
+static ATTRIBUTE_THREAD_LOCAL cmhulls_t cm_hulls;
+
 /*
 * CM_InitBoxHull
 *
 * Set up the planes so that the six floats of a bounding box
 * can just be stored out and get a proper clipping hull structure.
 */
-void CM_InitBoxHull( cmodel_state_t *cms )
+static void CM_InitBoxHull( cmhulls_t *hulls )
 {
 	int i;
 	cplane_t *p;
 	cbrushside_t *s;
 
-	cms->box_brush->numsides = 6;
-	cms->box_brush->brushsides = cms->box_brushsides;
-	cms->box_brush->contents = CONTENTS_BODY;
+	hulls->box_brush->numsides = 6;
+	hulls->box_brush->brushsides = hulls->box_brushsides;
+	hulls->box_brush->contents = CONTENTS_BODY;
 
-	cms->box_markbrushes[0] = cms->box_brush;
+	hulls->box_markbrushes[0] = hulls->box_brush;
 
-	cms->box_cmodel->builtin = true;
-	cms->box_cmodel->nummarkfaces = 0;
-	cms->box_cmodel->markfaces = NULL;
-	cms->box_cmodel->markbrushes = cms->box_markbrushes;
-	cms->box_cmodel->nummarkbrushes = 1;
+	hulls->box_cmodel->builtin = true;
+	hulls->box_cmodel->nummarkfaces = 0;
+	hulls->box_cmodel->markfaces = NULL;
+	hulls->box_cmodel->markbrushes = hulls->box_markbrushes;
+	hulls->box_cmodel->nummarkbrushes = 1;
 
 	for( i = 0; i < 6; i++ )
 	{
 		// brush sides
-		s = cms->box_brushsides + i;
-		s->plane = cms->box_planes + i;
+		s = hulls->box_brushsides + i;
+		s->plane = hulls->box_planes + i;
 		s->surfFlags = 0;
 
 		// planes
-		p = &cms->box_planes[i];
+		p = &hulls->box_planes[i];
 		VectorClear( p->normal );
 
 		if( ( i & 1 ) )
@@ -78,7 +106,7 @@ void CM_InitBoxHull( cmodel_state_t *cms )
 * Set up the planes so that the six floats of a bounding box
 * can just be stored out and get a proper clipping hull structure.
 */
-void CM_InitOctagonHull( cmodel_state_t *cms )
+static void CM_InitOctagonHull( cmhulls_t *hulls )
 {
 	int i;
 	cplane_t *p;
@@ -90,28 +118,28 @@ void CM_InitOctagonHull( cmodel_state_t *cms )
 		{  1, -1, 0 }
 	};
 
-	cms->oct_brush->numsides = 10;
-	cms->oct_brush->brushsides = cms->oct_brushsides;
-	cms->oct_brush->contents = CONTENTS_BODY;
+	hulls->oct_brush->numsides = 10;
+	hulls->oct_brush->brushsides = hulls->oct_brushsides;
+	hulls->oct_brush->contents = CONTENTS_BODY;
 
-	cms->oct_markbrushes[0] = cms->oct_brush;
+	hulls->oct_markbrushes[0] = hulls->oct_brush;
 
-	cms->oct_cmodel->builtin = true;
-	cms->oct_cmodel->nummarkfaces = 0;
-	cms->oct_cmodel->markfaces = NULL;
-	cms->oct_cmodel->markbrushes = cms->oct_markbrushes;
-	cms->oct_cmodel->nummarkbrushes = 1;
+	hulls->oct_cmodel->builtin = true;
+	hulls->oct_cmodel->nummarkfaces = 0;
+	hulls->oct_cmodel->markfaces = NULL;
+	hulls->oct_cmodel->markbrushes = hulls->oct_markbrushes;
+	hulls->oct_cmodel->nummarkbrushes = 1;
 
 	// axial planes
 	for( i = 0; i < 6; i++ )
 	{
 		// brush sides
-		s = cms->oct_brushsides + i;
-		s->plane = cms->oct_planes + i;
+		s = hulls->oct_brushsides + i;
+		s->plane = hulls->oct_planes + i;
 		s->surfFlags = 0;
 
 		// planes
-		p = &cms->oct_planes[i];
+		p = &hulls->oct_planes[i];
 		VectorClear( p->normal );
 
 		if( ( i & 1 ) )
@@ -131,12 +159,12 @@ void CM_InitOctagonHull( cmodel_state_t *cms )
 	// non-axial planes
 	for( i = 6; i < 10; i++ ) {
 		// brush sides
-		s = cms->oct_brushsides + i;
-		s->plane = cms->oct_planes + i;
+		s = hulls->oct_brushsides + i;
+		s->plane = hulls->oct_planes + i;
 		s->surfFlags = 0;
 
 		// planes
-		p = &cms->oct_planes[i];
+		p = &hulls->oct_planes[i];
 		VectorCopy( oct_dirs[i-6], p->normal );
 
 		p->type = PLANE_NONAXIAL;
@@ -144,6 +172,22 @@ void CM_InitOctagonHull( cmodel_state_t *cms )
 	}
 }
 
+/*
+* CM_Hulls
+*/
+static cmhulls_t *CM_Hulls( void )
+{
+	cmhulls_t *hulls = &cm_hulls;
+
+	if( !hulls->initialized )
+	{
+		CM_InitBoxHull( hulls );
+		CM_InitOctagonHull( hulls );
+		hulls->initialized = true;
+	}
+	return hulls;
+}
+
 /*
 * CM_ModelForBBox
 * 
@@ -151,17 +195,19 @@ void CM_InitOctagonHull( cmodel_state_t *cms )
 */
 cmodel_t *CM_ModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs )
 {
-	cms->box_planes[0].dist = maxs[0];
-	cms->box_planes[1].dist = -mins[0];
-	cms->box_planes[2].dist = maxs[1];
-	cms->box_planes[3].dist = -mins[1];
-	cms->box_planes[4].dist = maxs[2];
-	cms->box_planes[5].dist = -mins[2];
+	cmhulls_t *hulls = CM_Hulls();
 
-	VectorCopy( mins, cms->box_cmodel->mins );
-	VectorCopy( maxs, cms->box_cmodel->maxs );
+	hulls->box_planes[0].dist = maxs[0];
+	hulls->box_planes[1].dist = -mins[0];
+	hulls->box_planes[2].dist = maxs[1];
+	hulls->box_planes[3].dist = -mins[1];
+	hulls->box_planes[4].dist = maxs[2];
+	hulls->box_planes[5].dist = -mins[2];
 
-	return cms->box_cmodel;
+	VectorCopy( mins, hulls->box_cmodel->mins );
+	VectorCopy( maxs, hulls->box_cmodel->maxs );
+
+	return hulls->box_cmodel;
 }
 
 /*
@@ -176,6 +222,7 @@ cmodel_t *CM_OctagonModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs
 	float a, b, d, t;
 	float sina, cosa;
 	vec3_t offset, size[2];
+	cmhulls_t *hulls = CM_Hulls();
 
 	for( i = 0; i < 3; i++ ) {
 		offset[i] = ( mins[i] + maxs[i] ) * 0.5;
@@ -183,16 +230,16 @@ cmodel_t *CM_OctagonModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs
 		size[1][i] = maxs[i] - offset[i];
 	}
 
-	VectorCopy( offset, cms->oct_cmodel->cyl_offset );
-	VectorCopy( size[0], cms->oct_cmodel->mins );
-	VectorCopy( size[1], cms->oct_cmodel->maxs );
+	VectorCopy( offset, hulls->oct_cmodel->cyl_offset );
+	VectorCopy( size[0], hulls->oct_cmodel->mins );
+	VectorCopy( size[1], hulls->oct_cmodel->maxs );
 
-	cms->oct_planes[0].dist = size[1][0];
-	cms->oct_planes[1].dist = -size[0][0];
-	cms->oct_planes[2].dist = size[1][1];
-	cms->oct_planes[3].dist = -size[0][1];
-	cms->oct_planes[4].dist = size[1][2];
-	cms->oct_planes[5].dist = -size[0][2];
+	hulls->oct_planes[0].dist = size[1][0];
+	hulls->oct_planes[1].dist = -size[0][0];
+	hulls->oct_planes[2].dist = size[1][1];
+	hulls->oct_planes[3].dist = -size[0][1];
+	hulls->oct_planes[4].dist = size[1][2];
+	hulls->oct_planes[5].dist = -size[0][2];
 
 	a = size[1][0]; // halfx
 	b = size[1][1]; // halfy
@@ -212,19 +259,19 @@ cmodel_t *CM_OctagonModelForBBox( cmodel_state_t *cms, vec3_t mins, vec3_t maxs
 
 	// the following should match normals and signbits set in CM_InitOctagonHull
 
-	VectorSet( cms->oct_planes[6].normal, cosa, sina, 0 );
-	cms->oct_planes[6].dist = d;
+	VectorSet( hulls->oct_planes[6].normal, cosa, sina, 0 );
+	hulls->oct_planes[6].dist = d;
 
-	VectorSet( cms->oct_planes[7].normal, -cosa, sina, 0 );
-	cms->oct_planes[7].dist = d;
+	VectorSet( hulls->oct_planes[7].normal, -cosa, sina, 0 );
+	hulls->oct_planes[7].dist = d;
 
-	VectorSet( cms->oct_planes[8].normal, -cosa, -sina, 0 );
-	cms->oct_planes[8].dist = d;
+	VectorSet( hulls->oct_planes[8].normal, -cosa, -sina, 0 );
+	hulls->oct_planes[8].dist = d;
 
-	VectorSet( cms->oct_planes[9].normal, cosa, -sina, 0 );
-	cms->oct_planes[9].dist = d;
+	VectorSet( hulls->oct_planes[9].normal, cosa, -sina, 0 );
+	hulls->oct_planes[9].dist = d;
 
-	return cms->oct_cmodel;
+	return hulls->oct_cmodel;
 }
 
 /*
@@ -248,12 +295,20 @@ int CM_PointLeafnum( cmodel_state_t *cms, const vec3_t p )
 	return -1 - num;
 }
 
+typedef struct
+{
+	int count, maxcount;
+	int *list;
+	float *mins, *maxs;
+	int topnode;
+} cboxleafnums_t;
+
 /*
 * CM_BoxLeafnums
 *
 * Fills in a list of all the leafs touched
 */
-static void CM_BoxLeafnums_r( cmodel_state_t *cms, int nodenum )
+static void CM_BoxLeafnums_r( cmodel_state_t *cms, cboxleafnums_t *bl, int nodenum )
 {
 	int s;
 	cnode_t	*node;
@@ -261,7 +316,7 @@ static void CM_BoxLeafnums_r( cmodel_state_t *cms, int nodenum )
 	while( nodenum >= 0 )
 	{
 		node = &cms->map_nodes[nodenum];
-		s = BOX_ON_PLANE_SIDE( cms->leaf_mins, cms->leaf_maxs, node->plane ) - 1;
+		s = BOX_ON_PLANE_SIDE( bl->mins, bl->maxs, node->plane ) - 1;
 
 		if( s < 2 )
 		{
@@ -270,35 +325,40 @@ static void CM_BoxLeafnums_r( cmodel_state_t *cms, int nodenum )
 		}
 
 		// go down both sides
-		if( cms->leaf_topnode == -1 )
-			cms->leaf_topnode = nodenum;
-		CM_BoxLeafnums_r( cms, node->children[0] );
+		if( bl->topnode == -1 )
+			bl->topnode = nodenum;
+		CM_BoxLeafnums_r( cms, bl, node->children[0] );
 		nodenum = node->children[1];
 	}
 
-	if( cms->leaf_count < cms->leaf_maxcount )
-		cms->leaf_list[cms->leaf_count++] = -1 - nodenum;
+	if( bl->count < bl->maxcount )
+		bl->list[bl->count++] = -1 - nodenum;
 }
 
 /*
 * CM_BoxLeafnums
+*
+* The traversal state is kept on the stack so that this can
+* be called from several threads at once.
 */
 int CM_BoxLeafnums( cmodel_state_t *cms, vec3_t mins, vec3_t maxs, int *list, int listsize, int *topnode )
 {
-	cms->leaf_list = list;
-	cms->leaf_count = 0;
-	cms->leaf_maxcount = listsize;
-	cms->leaf_mins = mins;
-	cms->leaf_maxs = maxs;
+	cboxleafnums_t bl;
 
-	cms->leaf_topnode = -1;
+	bl.list = list;
+	bl.count = 0;
+	bl.maxcount = listsize;
+	bl.mins = mins;
+	bl.maxs = maxs;
 
-	CM_BoxLeafnums_r( cms, 0 );
+	bl.topnode = -1;
+
+	CM_BoxLeafnums_r( cms, &bl, 0 );
 
 	if( topnode )
-		*topnode = cms->leaf_topnode;
+		*topnode = bl.topnode;
 
-	return cms->leaf_count;
+	return bl.count;
 }
 
 /*
@@ -488,19 +548,121 @@ BOX TRACING
 #endif
 #define RADIUS_EPSILON		1.0f
 
-static vec3_t trace_start, trace_end;
-static vec3_t trace_mins, trace_maxs;
-static vec3_t trace_startmins, trace_endmins;
-static vec3_t trace_startmaxs, trace_endmaxs;
-static vec3_t trace_absmins, trace_absmaxs;
-static vec3_t trace_extents;
+// the state of the trace in progress, kept per thread so that
+// the game can trace from several threads at once
+static ATTRIBUTE_THREAD_LOCAL vec3_t trace_start, trace_end;
+static ATTRIBUTE_THREAD_LOCAL vec3_t trace_mins, trace_maxs;
+static ATTRIBUTE_THREAD_LOCAL vec3_t trace_startmins, trace_endmins;
+static ATTRIBUTE_THREAD_LOCAL vec3_t trace_startmaxs, trace_endmaxs;
+static ATTRIBUTE_THREAD_LOCAL vec3_t trace_absmins, trace_absmaxs;
+static ATTRIBUTE_THREAD_LOCAL vec3_t trace_extents;
 
-static trace_t	*trace_trace;
+static ATTRIBUTE_THREAD_LOCAL trace_t *trace_trace;
 #ifdef TRACEVICFIX
-static float trace_realfraction;
+static ATTRIBUTE_THREAD_LOCAL float trace_realfraction;
+#endif
+static ATTRIBUTE_THREAD_LOCAL int trace_contents;
+static ATTRIBUTE_THREAD_LOCAL bool trace_ispoint;      // optimized case
+
+// brushes and patches are shared by all the leafs they cross, a trace
+// remembers the ones it has already tested in a small open addressing set.
+// An entry belongs to the current trace when its count matches trace_checkcount.
+#define TRACE_CHECKED_SIZE		1024	// power of two
+#define TRACE_CHECKED_PROBES	8
+
+typedef struct
+{
+	const void *ptr;
+	unsigned int checkcount;
+} cmcheckedentry_t;
+
+static ATTRIBUTE_THREAD_LOCAL cmcheckedentry_t trace_checked[TRACE_CHECKED_SIZE];
+static ATTRIBUTE_THREAD_LOCAL unsigned int trace_checkcount;
+
+typedef struct cmtracerecord_s
+{
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	vec3_t origin, angles;
+	int cmodelnum;                  // into map_cmodels
+	int brushmask;
+} cmtracerecord_t;
+
+static bool trace_replaying;    // don't record the traces replayed by CM_TraceBenchmark
+static int trace_forcesimd = -1;    // overrides cm_noSIMD while benchmarking
+
+#ifdef CM_USE_SSE
+static ATTRIBUTE_THREAD_LOCAL bool trace_simd;
+static ATTRIBUTE_THREAD_LOCAL __m128 trace_vstartmins[3], trace_vstartmaxs[3];
+static ATTRIBUTE_THREAD_LOCAL __m128 trace_vendmins[3], trace_vendmaxs[3];
+
+#define CM_SSE_SELECT( mask, a, b ) _mm_or_ps( _mm_and_ps( ( mask ), ( a ) ), _mm_andnot_ps( ( mask ), ( b ) ) )
+
+/*
+* CM_BrushSideDistances_SSE
+* 
+* Distances from the box corners at the start and the end of the move to 4 brush
+* sides, picking the corners by normal signs. The operations are done in the same
+* order as in the scalar code, so the results are exactly the same.
+*/
+static inline void CM_BrushSideDistances_SSE( const float *planes, float *d1, float *d2 )
+{
+	int i;
+	__m128 n, neg, ds, de;
+	const __m128 zero = _mm_setzero_ps();
+
+	n = _mm_loadu_ps( planes );
+	neg = _mm_cmplt_ps( n, zero );
+	ds = _mm_mul_ps( n, CM_SSE_SELECT( neg, trace_vstartmaxs[0], trace_vstartmins[0] ) );
+	de = _mm_mul_ps( n, CM_SSE_SELECT( neg, trace_vendmaxs[0], trace_vendmins[0] ) );
+
+	for( i = 1; i < 3; i++ )
+	{
+		n = _mm_loadu_ps( planes + i * 4 );
+		neg = _mm_cmplt_ps( n, zero );
+		ds = _mm_add_ps( ds, _mm_mul_ps( n, CM_SSE_SELECT( neg, trace_vstartmaxs[i], trace_vstartmins[i] ) ) );
+		de = _mm_add_ps( de, _mm_mul_ps( n, CM_SSE_SELECT( neg, trace_vendmaxs[i], trace_vendmins[i] ) ) );
+	}
+
+	n = _mm_loadu_ps( planes + 12 );
+	_mm_storeu_ps( d1, _mm_sub_ps( ds, n ) );
+	_mm_storeu_ps( d2, _mm_sub_ps( de, n ) );
+}
+
+/*
+* CM_BoxOutsideBrush_SSE
+* 
+* Returns true if the box at the start of the move is in front of any of the brush sides
+*/
+static bool CM_BoxOutsideBrush_SSE( const float *planes, int numsides )
+{
+	int i, j, mask;
+	__m128 n, neg, d;
+	const __m128 zero = _mm_setzero_ps();
+
+	for( i = 0; i < numsides; i += 4, planes += 16 )
+	{
+		n = _mm_loadu_ps( planes );
+		neg = _mm_cmplt_ps( n, zero );
+		d = _mm_mul_ps( n, CM_SSE_SELECT( neg, trace_vstartmaxs[0], trace_vstartmins[0] ) );
+
+		for( j = 1; j < 3; j++ )
+		{
+			n = _mm_loadu_ps( planes + j * 4 );
+			neg = _mm_cmplt_ps( n, zero );
+			d = _mm_add_ps( d, _mm_mul_ps( n, CM_SSE_SELECT( neg, trace_vstartmaxs[j], trace_vstartmins[j] ) ) );
+		}
+
+		mask = _mm_movemask_ps( _mm_cmpgt_ps( d, _mm_loadu_ps( planes + 12 ) ) );
+		if( numsides - i < 4 )
+			mask &= ( 1 << ( numsides - i ) ) - 1; // padding
+		if( mask )
+			return true;
+	}
+
+	return false;
+}
 #endif
-static int trace_contents;
-static bool trace_ispoint;      // optimized case
 
 /*
 * CM_ClipBoxToBrush
@@ -516,6 +678,10 @@ static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
 	float d1, d2, f;
 	bool getout, startout;
 	cbrushside_t *side, *leadside;
+#ifdef CM_USE_SSE
+	float d1s[4], d2s[4];
+	const bool simd = trace_simd && brush->simdplanes;
+#endif
 
 	if( !brush->numsides )
 		return;
@@ -535,6 +701,16 @@ static void CM_ClipBoxToBrush( cmodel_state_t *cms, cbrush_t *brush )
 	{
 		p = side->plane;
 
+#ifdef CM_USE_SSE
+		if( simd )
+		{
+			if( !( i & 3 ) )
+				CM_BrushSideDistances_SSE( brush->simdplanes + i * 4, d1s, d2s );
+			d1 = d1s[i & 3];
+			d2 = d2s[i & 3];
+		}
+		else
+#endif
 		// push the plane out apropriately for mins/maxs
 		if( p->type < 3 )
 		{
@@ -693,6 +869,20 @@ static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
 	if( !brush->numsides )
 		return;
 
+#ifdef CM_USE_SSE
+	if( trace_simd && brush->simdplanes )
+	{
+		if( CM_BoxOutsideBrush_SSE( brush->simdplanes, brush->numsides ) )
+			return;
+
+		// inside this brush
+		trace_trace->startsolid = trace_trace->allsolid = true;
+		trace_trace->fraction = 0;
+		trace_trace->contents = brush->contents;
+		return;
+	}
+#endif
+
 	side = brush->brushsides;
 	for( i = 0; i < brush->numsides; i++, side++ )
 	{
@@ -754,6 +944,47 @@ static void CM_TestBoxInBrush( cmodel_state_t *cms, cbrush_t *brush )
 	trace_trace->contents = brush->contents;
 }
 
+/*
+* CM_NewCheckedSet
+*/
+static inline void CM_NewCheckedSet( void )
+{
+	if( !++trace_checkcount )
+	{
+		// wrapped around, the old counts would match again
+		memset( trace_checked, 0, sizeof( trace_checked ) );
+		trace_checkcount = 1;
+	}
+}
+
+/*
+* CM_MarkChecked
+*
+* Returns true if the brush or patch was already tested by this trace.
+* When the probes run out the surface is simply tested again, which
+* gives the same result.
+*/
+static inline bool CM_MarkChecked( const void *ptr )
+{
+	unsigned int i, hash;
+	cmcheckedentry_t *entry;
+
+	hash = ( (unsigned int)( (uintptr_t)ptr >> 3 ) * 2654435761u ) >> 22;
+	for( i = 0; i < TRACE_CHECKED_PROBES; i++ )
+	{
+		entry = &trace_checked[( hash + i ) & ( TRACE_CHECKED_SIZE - 1 )];
+		if( entry->checkcount != trace_checkcount )
+		{
+			entry->ptr = ptr;
+			entry->checkcount = trace_checkcount;
+			return false;
+		}
+		if( entry->ptr == ptr )
+			return true;
+	}
+	return false;
+}
+
 /*
 * CM_CollideBox
 */
@@ -769,9 +1000,8 @@ static void CM_CollideBox( cmodel_state_t *cms, cbrush_t **markbrushes, int numm
 	for( i = 0; i < nummarkbrushes; i++ )
 	{
 		b = markbrushes[i];
-		if( b->checkcount == cms->checkcount )
+		if( CM_MarkChecked( b ) )
 			continue; // already checked this brush
-		b->checkcount = cms->checkcount;
 		if( !( b->contents & trace_contents ) )
 			continue;
 		func( cms, b );
@@ -786,9 +1016,8 @@ static void CM_CollideBox( cmodel_state_t *cms, cbrush_t **markbrushes, int numm
 	for( i = 0; i < nummarkfaces; i++ )
 	{
 		patch = markfaces[i];
-		if( patch->checkcount == cms->checkcount )
+		if( CM_MarkChecked( patch ) )
 			continue; // already checked this patch
-		patch->checkcount = cms->checkcount;
 		if( !( patch->contents & trace_contents ) )
 			continue;
 		if( !BoundsIntersect( patch->mins, patch->maxs, trace_absmins, trace_absmaxs ) )
@@ -949,8 +1178,8 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 
 	notworld = ( cmodel != cms->map_cmodels ? true : false );
 
-	cms->checkcount++;  // for multi-check avoidance
-	c_traces++;     // for statistics, may be zeroed
+	CM_NewCheckedSet(); // for multi-check avoidance
+	c_traces++;     // for statistics, may be zeroed, not exact when tracing from several threads
 
 	// fill in a default trace
 	memset( tr, 0, sizeof( *tr ) );
@@ -984,6 +1213,22 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 	VectorAdd( end, trace_maxs, trace_endmaxs );
 	AddPointToBounds( trace_endmaxs, trace_absmins, trace_absmaxs );
 
+#ifdef CM_USE_SSE
+	trace_simd = trace_forcesimd >= 0 ? trace_forcesimd != 0 : !cm_noSIMD->integer;
+	if( trace_simd )
+	{
+		int i;
+
+		for( i = 0; i < 3; i++ )
+		{
+			trace_vstartmins[i] = _mm_set1_ps( trace_startmins[i] );
+			trace_vstartmaxs[i] = _mm_set1_ps( trace_startmaxs[i] );
+			trace_vendmins[i] = _mm_set1_ps( trace_endmins[i] );
+			trace_vendmaxs[i] = _mm_set1_ps( trace_endmaxs[i] );
+		}
+	}
+#endif
+
 	//
 	// check for position test special case
 	//
@@ -1070,6 +1315,28 @@ static void CM_BoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec3_t
 	}
 }
 
+/*
+* CM_RecordTrace
+*/
+static void CM_RecordTrace( cmodel_state_t *cms, vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
+						   cmodel_t *cmodel, int brushmask, vec3_t origin, vec3_t angles )
+{
+	cmtracerecord_t *record;
+
+	if( !cms->trace_records )
+		cms->trace_records = Mem_Alloc( cms->mempool, CM_MAX_TRACE_RECORDS * sizeof( cmtracerecord_t ) );
+
+	record = &cms->trace_records[cms->numtracerecords++ % CM_MAX_TRACE_RECORDS];
+	VectorCopy( start, record->start );
+	VectorCopy( end, record->end );
+	VectorCopy( mins ? mins : vec3_origin, record->mins );
+	VectorCopy( maxs ? maxs : vec3_origin, record->maxs );
+	VectorCopy( origin, record->origin );
+	VectorCopy( angles, record->angles );
+	record->cmodelnum = cmodel - cms->map_cmodels;
+	record->brushmask = brushmask;
+}
+
 /*
 * CM_TransformedBoxTrace
 *
@@ -1108,8 +1375,13 @@ void CM_TransformedBoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec
 		return;
 	}
 
+	// the box and octagon hulls change with every trace, so they can't be replayed.
+	// The ring is only written from the main thread, pool threads trace unrecorded
+	if( !cmodel->builtin && !trace_replaying && !QThreadPool_IsWorkerThread() )
+		CM_RecordTrace( cms, start, end, mins, maxs, cmodel, brushmask, origin, angles );
+
 	// cylinder offset
-	if( cmodel == cms->oct_cmodel )
+	if( cmodel == cm_hulls.oct_cmodel )
 	{
 		VectorSubtract( start, cmodel->cyl_offset, start_l );
 		VectorSubtract( end, cmodel->cyl_offset, end_l );
@@ -1174,3 +1446,75 @@ void CM_TransformedBoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec
 #endif
 	}
 }
+
+/*
+* CM_TraceBenchmark
+* 
+* Replays the last recorded traces with the scalar and the SIMD brush
+* clipping, timing both and checking that they give the same results
+*/
+void CM_TraceBenchmark( cmodel_state_t *cms, int iterations )
+{
+	int i, j, k, numrecords, mismatches;
+	uint64_t start, elapsed[2];
+	cmtracerecord_t *records, *record;
+	trace_t *results, tr;
+
+	numrecords = min( cms->numtracerecords, CM_MAX_TRACE_RECORDS );
+	if( !numrecords )
+	{
+		Com_Printf( "No traces recorded\n" );
+		return;
+	}
+
+	iterations = max( iterations, 1 );
+
+	// take a copy, the map could be traced again while we are at it
+	records = Mem_TempMalloc( numrecords * sizeof( *records ) );
+	memcpy( records, cms->trace_records, numrecords * sizeof( *records ) );
+	results = Mem_TempMalloc( numrecords * 2 * sizeof( *results ) );
+
+	trace_replaying = true;
+
+	for( k = 0; k < 2; k++ )
+	{
+		trace_forcesimd = k;
+		start = Sys_Microseconds();
+		for( i = 0; i < iterations; i++ )
+		{
+			for( j = 0, record = records; j < numrecords; j++, record++ )
+			{
+				if( record->cmodelnum < 0 || record->cmodelnum >= cms->numcmodels )
+					continue;
+
+				CM_TransformedBoxTrace( cms, &tr, record->start, record->end, record->mins, record->maxs,
+					&cms->map_cmodels[record->cmodelnum], record->brushmask, record->origin, record->angles );
+				if( !i )
+					results[k * numrecords + j] = tr;
+			}
+		}
+		elapsed[k] = Sys_Microseconds() - start;
+	}
+
+	trace_forcesimd = -1;
+	trace_replaying = false;
+
+	mismatches = 0;
+	for( j = 0; j < numrecords; j++ )
+	{
+		if( memcmp( &results[j], &results[numrecords + j], sizeof( trace_t ) ) )
+			mismatches++;
+	}
+
+	Com_Printf( "%i traces x %i iterations\n", numrecords, iterations );
+	Com_Printf( "scalar: %.3f ms\n", elapsed[0] / 1000.0 );
+#ifdef CM_USE_SSE
+	Com_Printf( "SSE:    %.3f ms\n", elapsed[1] / 1000.0 );
+#else
+	Com_Printf( "SIMD brush clipping is not compiled in\n" );
+#endif
+	Com_Printf( "%i mismatching results\n", mismatches );
+
+	Mem_TempFree( results );
+	Mem_TempFree( records );
+}
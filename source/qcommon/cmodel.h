@@ -21,6 +21,7 @@
 typedef struct cmodel_state_s cmodel_state_t;
 
 extern cvar_t *cm_noCurves;
+extern cvar_t *cm_noSIMD;
 
 // debug/performance counter vars
 int c_pointcontents, c_traces, c_brush_traces;
@@ -52,6 +53,9 @@ void CM_TransformedBoxTrace( cmodel_state_t *cms, trace_t *tr, vec3_t start, vec
 
 void CM_RoundUpToHullSize( cmodel_state_t *cms, vec3_t mins, vec3_t maxs, struct cmodel_s *cmodel );
 
+// replays the last traces with and without SIMD, checking the results match
+void CM_TraceBenchmark( cmodel_state_t *cms, int iterations );
+
 int CM_ClusterRowSize( cmodel_state_t *cms );
 int CM_AreaRowSize( cmodel_state_t *cms );
 int CM_PointLeafnum( cmodel_state_t *cms, const vec3_t p );
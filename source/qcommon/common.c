@@ -42,6 +42,7 @@ static char com_errormsg[MAX_PRINTMSG];
 static bool com_quit;
 
 static jmp_buf abortframe;     // an ERR_DROP occured, exit the entire frame
+static ATTRIBUTE_THREAD_LOCAL jmp_buf *com_threadabortframe;  // ERR_DROP target of a worker, see Com_SetThreadAbortFrame
 
 cvar_t *host_speeds;
 cvar_t *developer;
@@ -293,6 +294,19 @@ void Com_Error( com_error_code_t code, const char *format, ... )
 	const size_t sizeof_msg = sizeof( com_errormsg );
 	static bool	recursive = false;
 
+	// a worker thread can't unwind the main loop, drop only its own job
+	if( code == ERR_DROP && com_threadabortframe )
+	{
+		char workermsg[MAX_PRINTMSG];
+
+		va_start( argptr, format );
+		Q_vsnprintfz( workermsg, sizeof( workermsg ), format, argptr );
+		va_end( argptr );
+
+		Com_Printf( "ERROR: %s\n", workermsg );
+		longjmp( *com_threadabortframe, -1 );
+	}
+
 	if( recursive )
 	{
 		Com_Printf( "recursive error after: %s", msg ); // wsw : jal : log it
@@ -329,6 +343,18 @@ void Com_Error( com_error_code_t code, const char *format, ... )
 	Sys_Error( "%s", msg );
 }
 
+/*
+* Com_SetThreadAbortFrame
+*
+* Makes ERR_DROP errors raised by the calling thread jump to frame instead
+* of the main loop, so that jobs running on worker threads can fail on their
+* own. The frame must be reset to NULL before the function that set it returns.
+*/
+void Com_SetThreadAbortFrame( jmp_buf *frame )
+{
+	com_threadabortframe = frame;
+}
+
 /*
 * Com_DeferQuit
 */
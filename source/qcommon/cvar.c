@@ -49,6 +49,15 @@ static bool Cvar_CheatsAllowed()
 		( Com_ServerState() && Cvar_Value( "sv_cheats" ) ); // local server, sv_cheats
 }
 
+/*
+* Cvar_InfoModified
+*/
+static void Cvar_InfoModified( const cvar_t *var )
+{
+	if( Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) || Cvar_FlagIsSet( var->flags, CVAR_SERVERINFO ) )
+		info_modcount++;
+}
+
 static int Cvar_PatternMatches( void *cvar, void *pattern )
 {
 	return !pattern || Com_GlobMatch( (const char *) pattern, ( (cvar_t *) cvar )->name, false );
@@ -187,6 +196,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 				var->string = ZoneCopyString( (char *) var_value );
 				var->value = atof( var->string );
 				var->integer = Q_rint( var->value );
+				Cvar_InfoModified( var );
 			}
 			var->flags = flags;
 		}
@@ -194,6 +204,10 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 		if( Cvar_FlagIsSet( flags, CVAR_USERINFO ) && !Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) )
 			userinfo_modified = true; // transmit at next oportunity
 
+		if( ( Cvar_FlagIsSet( flags, CVAR_USERINFO ) && !Cvar_FlagIsSet( var->flags, CVAR_USERINFO ) ) ||
+			( Cvar_FlagIsSet( flags, CVAR_SERVERINFO ) && !Cvar_FlagIsSet( var->flags, CVAR_SERVERINFO ) ) )
+			info_modcount++;
+
 		Cvar_FlagSet( &var->flags, flags );
 		return var;
 	}
@@ -216,6 +230,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, cvar_flag_t flags
 	var->integer = Q_rint( var->value );
 	var->flags = flags;
 	Cvar_SetModified( var );
+	Cvar_InfoModified( var );
 
 	QMutex_Lock( cvar_mutex );
 	Trie_Insert( cvar_trie, var_name, var );
@@ -314,6 +329,7 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, bool force )
 					var->value = atof( var->string );
 					var->integer = Q_rint( var->value );
 					Cvar_SetModified( var );
+					Cvar_InfoModified( var );
 				}
 			}
 			return var;
@@ -340,6 +356,7 @@ static cvar_t *Cvar_Set2( const char *var_name, const char *value, bool force )
 	var->value = atof( var->string );
 	var->integer = Q_rint( var->value );
 	Cvar_SetModified( var );
+	Cvar_InfoModified( var );
 
 	return var;
 }
@@ -373,6 +390,7 @@ cvar_t *Cvar_FullSet( const char *var_name, const char *value, cvar_flag_t flags
 	if( !var )
 		return Cvar_Get( var_name, value, flags );
 
+	Cvar_InfoModified( var );
 	if( overwrite_flags )
 	{
 		var->flags = flags;
@@ -381,6 +399,7 @@ cvar_t *Cvar_FullSet( const char *var_name, const char *value, cvar_flag_t flags
 	{
 		Cvar_FlagSet( &var->flags, flags );
 	}
+	Cvar_InfoModified( var );
 
 	// if we overwrite the flags, we will also force the value
 	return Cvar_Set2( var_name, value, overwrite_flags );
@@ -436,6 +455,7 @@ void Cvar_GetLatchedVars( cvar_flag_t flags )
 		var->latched_string = NULL;
 		var->value = atof( var->string );
 		var->integer = Q_rint( var->value );
+		Cvar_InfoModified( var );
 	}
 	Trie_FreeDump( dump );
 }
@@ -465,6 +485,7 @@ void Cvar_FixCheatVars( void )
 		var->string = ZoneCopyString( var->dvalue );
 		var->value = atof( var->string );
 		var->integer = Q_rint( var->value );
+		Cvar_InfoModified( var );
 	}
 	Trie_FreeDump( dump );
 }
@@ -730,6 +751,7 @@ static void Cvar_ArchiveList_f( void )
 #endif
 
 bool userinfo_modified;
+unsigned int info_modcount;
 
 static char *Cvar_BitInfo( int bit )
 {
@@ -90,12 +90,13 @@ typedef struct
 #define FS_PACKFILE_COHERENT	    2
 #define FS_PACKFILE_DIRECTORY		4
 
-#define FS_PACKFILE_NUM_THREADS		4     // including the main thread
+#define FS_PACKFILE_NUM_THREADS		8     // including the main thread
 
 typedef struct packfile_s
 {
 	char *name;
 	char *pakname;
+	struct pack_s *pack;
 	void *vfsHandle;			// handle to the pack in VFS
 	unsigned flags;
 	unsigned compressedSize;    // compressed size
@@ -121,6 +122,11 @@ typedef struct pack_s
 	packfile_t *files;
 	char *fileNames;
 	trie_t *trie;
+	uint8_t *mapData;			// whole archive mapped read-only, on first use
+	size_t mapSize;
+	size_t mapOffset;
+	void *mapping;
+	bool mapFailed;
 } pack_t;
 
 typedef struct filehandle_s
@@ -129,6 +135,7 @@ typedef struct filehandle_s
 	packfile_t *pakFile;
 	void *vfsHandle;
 	unsigned pakOffset;
+	const uint8_t *pakData;			// entry data inside the mapped pak, if any
 	unsigned uncompressedSize;		// uncompressed size
 	unsigned offset;				// current read/write pos
 	zipEntry_t *zipEntry;
@@ -173,11 +180,65 @@ static cvar_t *fs_usehomedir;
 static cvar_t *fs_usedownloadsdir;
 static cvar_t *fs_basegame;
 static cvar_t *fs_game;
+static cvar_t *fs_mmappaks;
 
 static searchpath_t *fs_basepaths = NULL;       // directories without gamedirs
 static searchpath_t *fs_searchpaths = NULL;     // game search directories, plus paks
 static qmutex_t *fs_searchpaths_mutex;
 
+//
+// merged index of all pak entries, resolved with the same precedence rules
+// as a full searchpath walk; rebuilt on demand after the searchpath changes
+//
+typedef struct
+{
+	unsigned hash;
+	const char *name;
+	searchpath_t *pureSearch;		// winning pure pak: first explicit, else first implicit
+	packfile_t *pureFile;
+	int pureOrder;
+	searchpath_t *search;			// first non-pure pak in searchpath order
+	packfile_t *file;
+	int order;
+} fs_pakindexentry_t;
+
+typedef struct
+{
+	unsigned size;					// number of slots, power of two
+	unsigned numEntries;
+	fs_pakindexentry_t *entries;
+	int numDirs;
+	searchpath_t **dirs;			// directories in searchpath order
+	int *dirOrders;
+} fs_pakindex_t;
+
+static fs_pakindex_t *fs_pakindex;
+static bool fs_pakindex_dirty = true;
+
+//
+// persistent cache of pk3 central directories and checksums, keyed by (path, size, mtime)
+//
+#define FS_PAKCACHE_FILENAME	"pk3cache.dat"
+#define FS_PAKCACHE_MAGIC		( ( 'C' << 24 ) + ( '3' << 16 ) + ( 'K' << 8 ) + 'P' )
+#define FS_PAKCACHE_VERSION		1
+
+typedef struct
+{
+	char *filename;
+	unsigned fileSize;
+	int64_t mtime;
+	unsigned checksum;
+	int numFiles;
+	unsigned byteBeforeTheZipFile;
+	unsigned centralDirSize;
+	uint8_t *centralDir;
+} fs_pakcacheentry_t;
+
+static trie_t *fs_pakcache_trie;
+static qmutex_t *fs_pakcache_mutex;
+static bool fs_pakcache_dirty;
+static cvar_t *fs_pakcache;
+
 static searchpath_t *fs_base_searchpaths;       // same as above, but without extra gamedirs
 static searchpath_t *fs_root_searchpath;        // base path directory
 static searchpath_t *fs_write_searchpath;       // write directory
@@ -425,94 +486,295 @@ static int FS_FileLength( FILE *f, bool close )
 }
 
 /*
-* FS_SearchPathForFile
+* FS_PakIndexHash
+*/
+static unsigned FS_PakIndexHash( const char *name )
+{
+	unsigned hash = 2166136261u;
+
+	while( *name )
+	{
+		hash ^= ( unsigned char )tolower( ( unsigned char )*name++ );
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/*
+* FS_PakIndexSlot
 * 
-* Gives the searchpath element where this file exists, or NULL if it doesn't
+* Returns the slot holding the name, or the empty slot where it would go
 */
-static searchpath_t *FS_SearchPathForFile( const char *filename, packfile_t **pout, char *path, size_t path_size, void **vfsHandle, int mode )
+static fs_pakindexentry_t *FS_PakIndexSlot( const fs_pakindex_t *index, const char *name, unsigned hash )
 {
-	searchpath_t *search;
-	packfile_t *search_pak;
-	searchpath_t *implicitpure;
-	packfile_t *implicitpure_pak;
-	bool purepass;
-	searchpath_t *result;
+	unsigned i, mask = index->size - 1;
+	fs_pakindexentry_t *entry;
 
-	if( !COM_ValidateRelativeFilename( filename ) )
+	for( i = hash & mask;; i = ( i + 1 ) & mask )
+	{
+		entry = &index->entries[i];
+		if( !entry->name )
+			return entry;
+		if( entry->hash == hash && !Q_stricmp( entry->name, name ) )
+			return entry;
+	}
+}
+
+/*
+* FS_PakIndexFind
+*/
+static const fs_pakindexentry_t *FS_PakIndexFind( const fs_pakindex_t *index, const char *name )
+{
+	const fs_pakindexentry_t *entry;
+
+	if( !index || !index->numEntries )
 		return NULL;
 
-	if( pout )
-		*pout = NULL;
-	if( path && path_size )
-		path[0] = '\0';
+	entry = FS_PakIndexSlot( index, name, FS_PakIndexHash( name ) );
+	return entry->name ? entry : NULL;
+}
 
-	result = NULL;
-	purepass = true;
-	implicitpure = NULL;
-	implicitpure_pak = NULL;
+/*
+* FS_InvalidatePakIndex
+* 
+* Must be called with fs_searchpaths_mutex held whenever paks are added,
+* removed or change their purity
+*/
+static void FS_InvalidatePakIndex( void )
+{
+	fs_pakindex_dirty = true;
+}
 
-	// search through the path, one element at a time
-	QMutex_Lock( fs_searchpaths_mutex );
-	search = fs_searchpaths;
-	while( search )
+/*
+* FS_FreePakIndex
+*/
+static void FS_FreePakIndex( void )
+{
+	if( fs_pakindex )
+	{
+		FS_Free( fs_pakindex );
+		fs_pakindex = NULL;
+	}
+	fs_pakindex_dirty = true;
+}
+
+/*
+* FS_BuildPakIndex
+*/
+static fs_pakindex_t *FS_BuildPakIndex( void )
+{
+	int order, numDirs;
+	unsigned i, size, totalFiles;
+	searchpath_t *search;
+	pack_t *pack;
+	packfile_t *file;
+	fs_pakindex_t *index;
+	fs_pakindexentry_t *entry;
+
+	totalFiles = 0;
+	numDirs = 0;
+	for( search = fs_searchpaths; search; search = search->next )
 	{
-		// is the element a pak file?
 		if( search->pack )
 		{
-			if( mode & FS_SEARCH_PAKS )
+			if( !search->pack->deferred_load )
+				totalFiles += search->pack->numFiles;
+		}
+		else
+		{
+			numDirs++;
+		}
+	}
+
+	// keep the load factor at or below one half
+	for( size = 16; size < totalFiles * 2; size <<= 1 );
+
+	index = ( fs_pakindex_t * )FS_Malloc( sizeof( *index ) + size * sizeof( fs_pakindexentry_t ) +
+		numDirs * ( sizeof( searchpath_t * ) + sizeof( int ) ) );
+	index->size = size;
+	index->entries = ( fs_pakindexentry_t * )( ( uint8_t * )index + sizeof( *index ) );
+	index->dirs = ( searchpath_t ** )( ( uint8_t * )index->entries + size * sizeof( fs_pakindexentry_t ) );
+	index->dirOrders = ( int * )( ( uint8_t * )index->dirs + numDirs * sizeof( searchpath_t * ) );
+
+	for( search = fs_searchpaths, order = 0; search; search = search->next, order++ )
+	{
+		pack = search->pack;
+		if( !pack )
+		{
+			index->dirs[index->numDirs] = search;
+			index->dirOrders[index->numDirs] = order;
+			index->numDirs++;
+			continue;
+		}
+		if( pack->deferred_load )
+			continue;
+
+		for( i = 0, file = pack->files; i < ( unsigned )pack->numFiles; i++, file++ )
+		{
+			unsigned hash = FS_PakIndexHash( file->name );
+
+			entry = FS_PakIndexSlot( index, file->name, hash );
+			if( !entry->name )
 			{
-				if( (search->pack->pure > FS_PURE_NONE) == purepass )
+				entry->hash = hash;
+				entry->name = file->name;
+				index->numEntries++;
+			}
+
+			if( pack->pure > FS_PURE_NONE )
+			{
+				if( !entry->pureSearch || entry->pureSearch == search ||
+					( pack->pure == FS_PURE_EXPLICIT && entry->pureSearch->pack->pure != FS_PURE_EXPLICIT ) )
 				{
-					if( FS_SearchPakForFile( search->pack, filename, &search_pak ) )
-					{
-						// if we find an explicitly pure pak, return immediately
-						if( !purepass || search->pack->pure == FS_PURE_EXPLICIT ) {
-							if( pout ) *pout = search_pak;
-							result = search;
-							goto return_result;
-						}
-						// otherwise store the pointer but keep searching for an explicit pak
-						else if( implicitpure == NULL )
-						{
-							implicitpure = search;
-							implicitpure_pak = search_pak;
-						}
-					}
+					// duplicate names within the same pak: the last one wins, like in the trie
+					entry->pureSearch = search;
+					entry->pureFile = file;
+					entry->pureOrder = order;
 				}
 			}
-		}
-		else
-		{
-			if( mode & FS_SEARCH_DIRS )
+			else
 			{
-				if( !purepass )
+				if( !entry->search || entry->search == search )
 				{
-					if( FS_SearchDirectoryForFile( search, filename, path, path_size, vfsHandle ) ) {
-						result = search;
-						goto return_result;
-					}
+					entry->search = search;
+					entry->file = file;
+					entry->order = order;
 				}
 			}
 		}
+	}
 
-		if( !search->next && purepass )
+	return index;
+}
+
+/*
+* FS_PakIndex
+* 
+* Returns the current index, rebuilding it if the searchpath has changed.
+* Must be called with fs_searchpaths_mutex held.
+*/
+static const fs_pakindex_t *FS_PakIndex( void )
+{
+	fs_pakindex_t *index;
+
+	if( fs_pakindex_dirty || !fs_pakindex )
+	{
+		index = FS_BuildPakIndex();
+		if( fs_pakindex )
+			FS_Free( fs_pakindex );
+		fs_pakindex = index;
+		fs_pakindex_dirty = false;
+	}
+
+	return fs_pakindex;
+}
+
+/*
+* FS_SearchPakListForFile
+* 
+* Walks every pak in the searchpath, the way lookups worked before the merged index.
+* Only used to verify and benchmark the index.
+*/
+static searchpath_t *FS_SearchPakListForFile( const char *filename, packfile_t **pout )
+{
+	searchpath_t *search;
+	packfile_t *search_pak;
+	searchpath_t *implicitpure = NULL;
+	packfile_t *implicitpure_pak = NULL;
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( !search->pack || search->pack->pure == FS_PURE_NONE )
+			continue;
+		if( FS_SearchPakForFile( search->pack, filename, &search_pak ) )
 		{
-			if( implicitpure )
-			{
-				// return file from an implicitly pure pak
-				if( pout ) *pout = implicitpure_pak;
-				result = implicitpure;
-				goto return_result;
+			if( search->pack->pure == FS_PURE_EXPLICIT ) {
+				*pout = search_pak;
+				return search;
+			}
+			if( !implicitpure ) {
+				implicitpure = search;
+				implicitpure_pak = search_pak;
 			}
-			search = fs_searchpaths;
-			purepass = false;
 		}
-		else
+	}
+
+	if( implicitpure ) {
+		*pout = implicitpure_pak;
+		return implicitpure;
+	}
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( !search->pack || search->pack->pure != FS_PURE_NONE )
+			continue;
+		if( FS_SearchPakForFile( search->pack, filename, &search_pak ) ) {
+			*pout = search_pak;
+			return search;
+		}
+	}
+
+	*pout = NULL;
+	return NULL;
+}
+
+/*
+* FS_SearchPathForFile
+* 
+* Gives the searchpath element where this file exists, or NULL if it doesn't
+* 
+* Pure paks win over everything else (explicitly pure ones first), then
+* directories and non-pure paks are tried in searchpath order.
+*/
+static searchpath_t *FS_SearchPathForFile( const char *filename, packfile_t **pout, char *path, size_t path_size, void **vfsHandle, int mode )
+{
+	int i, maxOrder;
+	const fs_pakindex_t *index;
+	const fs_pakindexentry_t *entry;
+	searchpath_t *result;
+
+	if( !COM_ValidateRelativeFilename( filename ) )
+		return NULL;
+
+	if( pout )
+		*pout = NULL;
+	if( path && path_size )
+		path[0] = '\0';
+
+	result = NULL;
+
+	QMutex_Lock( fs_searchpaths_mutex );
+
+	index = FS_PakIndex();
+	entry = ( mode & FS_SEARCH_PAKS ) ? FS_PakIndexFind( index, filename ) : NULL;
+
+	if( entry && entry->pureSearch )
+	{
+		if( pout ) *pout = entry->pureFile;
+		result = entry->pureSearch;
+		goto return_result;
+	}
+
+	// only directories that precede the first non-pure pak containing the file can override it
+	maxOrder = entry && entry->search ? entry->order : INT_MAX;
+
+	if( mode & FS_SEARCH_DIRS )
+	{
+		for( i = 0; i < index->numDirs && index->dirOrders[i] < maxOrder; i++ )
 		{
-			search = search->next;
+			if( FS_SearchDirectoryForFile( index->dirs[i], filename, path, path_size, vfsHandle ) ) {
+				result = index->dirs[i];
+				goto return_result;
+			}
 		}
 	}
 
+	if( entry && entry->search )
+	{
+		if( pout ) *pout = entry->file;
+		result = entry->search;
+	}
+
 return_result:
 	QMutex_Unlock( fs_searchpaths_mutex );
 	return result;
@@ -780,11 +1042,11 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 {
 	char **filenames;           // slots for testable filenames
 	size_t filename_size;       // size of one slot
-	int i;
+	int i, j, best, bestOrder;
+	bool bestExplicit, isExplicit;
 	size_t max_extension_length;
-	searchpath_t *search;
-	bool purepass;
-	const char *implicitpure;
+	const fs_pakindex_t *index;
+	const fs_pakindexentry_t **entries;
 	const char *result;
 
 	assert( filename && extensions );
@@ -821,69 +1083,66 @@ const char *FS_FirstExtension( const char *filename, const char *extensions[], i
 		COM_ReplaceExtension( filenames[i], extensions[i], filename_size );
 	}
 
+	entries = ( const fs_pakindexentry_t ** )alloca( sizeof( *entries ) * num_extensions );
+
 	result = NULL;
-	purepass = true;
-	implicitpure = NULL;
 
-	// search through the path, one element at a time
 	QMutex_Lock( fs_searchpaths_mutex );
-	search = fs_searchpaths;
-	while( search )
+
+	index = FS_PakIndex();
+	for( i = 0; i < num_extensions; i++ )
+		entries[i] = FS_PakIndexFind( index, filenames[i] );
+
+	// pure pass: the first explicitly pure pak wins, else the first implicitly pure one
+	best = -1;
+	bestOrder = INT_MAX;
+	bestExplicit = false;
+	for( i = 0; i < num_extensions; i++ )
 	{
-		if( search->pack ) // is the element a pak file?
+		if( !entries[i] || !entries[i]->pureSearch )
+			continue;
+		isExplicit = entries[i]->pureSearch->pack->pure == FS_PURE_EXPLICIT;
+		if( best < 0 || ( isExplicit && !bestExplicit ) ||
+			( isExplicit == bestExplicit && entries[i]->pureOrder < bestOrder ) )
 		{
-			if( (search->pack->pure > FS_PURE_NONE) == purepass )
-			{
-				for( i = 0; i < num_extensions; i++ )
-				{
-					if( FS_SearchPakForFile( search->pack, filenames[i], NULL ) )
-					{
-						if( !purepass || search->pack->pure == FS_PURE_EXPLICIT )
-						{
-							result = extensions[i];
-							goto return_result;
-						}
-						else if( implicitpure == NULL )
-						{
-							implicitpure = extensions[i];
-							break;
-						}
-					}
-				}
-			}
+			best = i;
+			bestOrder = entries[i]->pureOrder;
+			bestExplicit = isExplicit;
 		}
-		else
+	}
+	if( best >= 0 )
+	{
+		result = extensions[best];
+		goto return_result;
+	}
+
+	// non-pure pass: directories and non-pure paks in searchpath order
+	bestOrder = INT_MAX;
+	for( i = 0; i < num_extensions; i++ )
+	{
+		if( entries[i] && entries[i]->search && entries[i]->order < bestOrder )
 		{
-			if( !purepass )
-			{
-				for( i = 0; i < num_extensions; i++ )
-				{
-					void *vfsHandle = NULL; // search in VFS as well
-					if( FS_SearchDirectoryForFile( search, filenames[i], NULL, 0, &vfsHandle ) )
-					{
-						result = extensions[i];
-						goto return_result;
-					}
-				}
-			}
+			best = i;
+			bestOrder = entries[i]->order;
 		}
+	}
 
-		if( !search->next && purepass )
+	for( j = 0; j < index->numDirs && index->dirOrders[j] < bestOrder; j++ )
+	{
+		for( i = 0; i < num_extensions; i++ )
 		{
-			if( implicitpure )
+			void *vfsHandle = NULL; // search in VFS as well
+			if( FS_SearchDirectoryForFile( index->dirs[j], filenames[i], NULL, 0, &vfsHandle ) )
 			{
-				result = implicitpure;
+				result = extensions[i];
 				goto return_result;
 			}
-			search = fs_searchpaths;
-			purepass = false;
-		}
-		else
-		{
-			search = search->next;
 		}
 	}
-	
+
+	if( best >= 0 )
+		result = extensions[best];
+
 return_result:
 	QMutex_Unlock( fs_searchpaths_mutex );
 
@@ -1075,6 +1334,44 @@ static void FS_StreamDoneSimpleCb( wswcurl_req *req, int status, void *customp )
 	fh->streamDone = true;
 }
 
+/*
+* FS_MapPakFile
+* 
+* Maps the whole archive read-only, once, so entries can be read without going through stdio
+*/
+static const uint8_t *FS_MapPakFile( pack_t *pack )
+{
+	FILE *f;
+	int size;
+
+	QMutex_Lock( fs_searchpaths_mutex );
+
+	if( !pack->mapData && !pack->mapFailed )
+	{
+		pack->mapFailed = true;
+
+		f = fopen( pack->vfsHandle ? Sys_VFS_VFSName( pack->vfsHandle ) : pack->filename, "rb" );
+		if( f )
+		{
+			size = FS_FileLength( f, false );
+			if( size > 0 )
+			{
+				pack->mapData = Sys_FS_MMapFile( Sys_FS_FileNo( f ), size, 0, &pack->mapping, &pack->mapOffset );
+				if( pack->mapData )
+				{
+					pack->mapSize = size;
+					pack->mapFailed = false;
+				}
+			}
+			fclose( f );
+		}
+	}
+
+	QMutex_Unlock( fs_searchpaths_mutex );
+
+	return pack->mapData;
+}
+
 /*
 * _FS_FOpenPakFile
 */
@@ -1111,6 +1408,15 @@ static int _FS_FOpenPakFile( packfile_t *pakFile, int *filenum )
 	}
 	file->pakOffset = Sys_VFS_FileOffset( pakFile->vfsHandle ) + pakFile->offset;
 
+	if( fs_mmappaks->integer && pakFile->pack )
+	{
+		const uint8_t *data = FS_MapPakFile( pakFile->pack );
+		size_t size = ( pakFile->flags & FS_PACKFILE_DEFLATED ) ? pakFile->compressedSize : pakFile->uncompressedSize;
+
+		if( data && (size_t)file->pakOffset + size <= pakFile->pack->mapSize )
+			file->pakData = data + file->pakOffset;
+	}
+
 	if( pakFile->flags & FS_PACKFILE_DEFLATED )
 	{
 		file->zipEntry = ( zipEntry_t* )Mem_Alloc( fs_mempool, sizeof( zipEntry_t ) );
@@ -1474,8 +1780,23 @@ static int FS_ReadPK3File( uint8_t *buf, size_t len, filehandle_t *fh )
 	zipEntry->zstream.avail_out = (uInt)len;
 
 	totalOutBefore = zipEntry->zstream.total_out;
-	flush = ((len == fh->uncompressedSize) 
-		&& (zipEntry->restReadCompressed <= FS_ZIP_BUFSIZE) && !zipEntry->zstream.avail_in ? Z_FINISH : Z_SYNC_FLUSH);
+
+	if( fh->pakData )
+	{
+		// inflate straight from the mapped archive into the caller's buffer
+		if( zipEntry->restReadCompressed )
+		{
+			zipEntry->zstream.next_in = (Bytef *)( fh->pakData + zipEntry->compressedSize - zipEntry->restReadCompressed );
+			zipEntry->zstream.avail_in = (uInt)zipEntry->restReadCompressed;
+			zipEntry->restReadCompressed = 0;
+		}
+		flush = len == fh->uncompressedSize ? Z_FINISH : Z_SYNC_FLUSH;
+	}
+	else
+	{
+		flush = ((len == fh->uncompressedSize) 
+			&& (zipEntry->restReadCompressed <= FS_ZIP_BUFSIZE) && !zipEntry->zstream.avail_in ? Z_FINISH : Z_SYNC_FLUSH);
+	}
 
 	do
 	{
@@ -1512,6 +1833,12 @@ static int FS_ReadPK3File( uint8_t *buf, size_t len, filehandle_t *fh )
 */
 static int FS_ReadFile( uint8_t *buf, size_t len, filehandle_t *fh )
 {
+	if( fh->pakData )
+	{
+		// stored pak entry, len has already been clamped to the entry size
+		memcpy( buf, fh->pakData + fh->offset, len );
+		return (int)len;
+	}
 	return (int)fread( buf, 1, len, fh->fstream );
 }
 
@@ -1771,7 +2098,7 @@ int FS_Eof( int file )
 	if( fh->streamHandle )
 		return wswcurl_eof( fh->streamHandle );
 	if( fh->zipEntry )
-		return fh->zipEntry->restReadCompressed == 0;
+		return fh->pakData ? fh->offset >= fh->uncompressedSize : fh->zipEntry->restReadCompressed == 0;
 	if( fh->gzstream )
 		return qgzeof( fh->gzstream );
 	if( fh->fstream )
@@ -1908,6 +2235,71 @@ int FS_LoadBaseFileExt( const char *path, int flags, void **buffer, void *stack,
 	return _FS_LoadFile( fhandle, len, buffer, stack, stackSize, filename, fileline );
 }
 
+/*
+* FS_LoadMappedFile
+* 
+* Like FS_LoadFile, but entries stored uncompressed in a pak are returned as a
+* direct pointer into the mapped archive. The data is read-only and, unlike
+* FS_LoadFile, not guaranteed to be zero-terminated. It stays valid until the
+* pak is unloaded and must be released with FS_FreeMappedFile.
+*/
+int FS_LoadMappedFile( const char *path, const void **buffer )
+{
+	int len;
+	int fhandle;
+	filehandle_t *fh;
+
+	len = FS_FOpenFile( path, &fhandle, FS_READ );
+	if( !fhandle )
+	{
+		*buffer = NULL;
+		return -1;
+	}
+
+	fh = FS_FileHandleForNum( fhandle );
+	if( fh->pakData && !fh->zipEntry
+#if !defined( __i386__ ) && !defined( __x86_64__ ) && !defined( _M_IX86 ) && !defined( _M_AMD64 )
+		// stored entries are rarely word aligned inside the archive
+		&& !( ( uintptr_t )fh->pakData & 3 )
+#endif
+		)
+	{
+		*buffer = fh->pakData;
+		FS_FCloseFile( fhandle );
+		return len;
+	}
+
+	return _FS_LoadFile( fhandle, len, ( void ** )buffer, NULL, 0, __FILE__, __LINE__ );
+}
+
+/*
+* FS_FreeMappedFile
+*/
+void FS_FreeMappedFile( const void *buffer )
+{
+	searchpath_t *search;
+	pack_t *pack;
+
+	if( !buffer )
+		return;
+
+	QMutex_Lock( fs_searchpaths_mutex );
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		pack = search->pack;
+		if( pack && pack->mapData &&
+			( const uint8_t * )buffer >= pack->mapData && ( const uint8_t * )buffer < pack->mapData + pack->mapSize )
+		{
+			// points into a mapped pak, nothing to free
+			QMutex_Unlock( fs_searchpaths_mutex );
+			return;
+		}
+	}
+	QMutex_Unlock( fs_searchpaths_mutex );
+
+	FS_FreeFile( ( void * )buffer );
+}
+
 /*
 * FS_MMapBaseFile
 */
@@ -2083,7 +2475,10 @@ bool FS_AddPurePak( unsigned checksum )
 		if( search->pack && search->pack->checksum == checksum )
 		{
 			if( search->pack->pure < FS_PURE_IMPLICIT )
+			{
 				search->pack->pure = FS_PURE_IMPLICIT;
+				FS_InvalidatePakIndex();
+			}
 			result = true;
 			break;
 		}
@@ -2109,6 +2504,8 @@ void FS_RemovePurePaks( void )
 			search->pack->pure = FS_PURE_NONE;
 	}
 
+	FS_InvalidatePakIndex();
+
 	QMutex_Unlock( fs_searchpaths_mutex );
 }
 
@@ -2154,7 +2551,7 @@ bool FS_RemoveAbsoluteFile( const char *filename )
 /*
 * _FS_RemoveFile
 */
-static bool _FS_RemoveFile( const char *filename, bool base )
+static bool _FS_RemoveFile( const char *filename, bool base, const char *dir )
 {
 	const char *fullname;
 	
@@ -2166,7 +2563,7 @@ static bool _FS_RemoveFile( const char *filename, bool base )
 	if( !fullname )
 		return false;
 
-	if( strncmp( fullname, FS_WriteDirectory(), strlen( FS_WriteDirectory() ) ) )
+	if( strncmp( fullname, dir, strlen( dir ) ) )
 		return false;
 
 	return ( FS_RemoveAbsoluteFile( fullname ) );
@@ -2177,7 +2574,7 @@ static bool _FS_RemoveFile( const char *filename, bool base )
 */
 bool FS_RemoveBaseFile( const char *filename )
 {
-	return _FS_RemoveFile( filename, true );
+	return _FS_RemoveFile( filename, true, FS_WriteDirectory() );
 }
 
 /*
@@ -2185,7 +2582,15 @@ bool FS_RemoveBaseFile( const char *filename )
 */
 bool FS_RemoveFile( const char *filename )
 {
-	return _FS_RemoveFile( filename, false );
+	return _FS_RemoveFile( filename, false, FS_WriteDirectory() );
+}
+
+/*
+* FS_RemoveCacheFile
+*/
+bool FS_RemoveCacheFile( const char *filename )
+{
+	return _FS_RemoveFile( filename, false, FS_CacheDirectory() );
 }
 
 /*
@@ -2226,7 +2631,7 @@ bool _FS_CopyFile( const char *src, const char *dst, bool base, bool absolute )
 
 	if( length != 0 )
 	{
-		_FS_RemoveFile( dst, base );
+		_FS_RemoveFile( dst, base, FS_WriteDirectory() );
 		return false;
 	}
 
@@ -2506,20 +2911,21 @@ static time_t FS_DosTimeToUnixtime( unsigned dosDateTime )
 /*
 * FS_PK3GetFileInfo
 * 
-* Get Info about the current file in the zipfile, with internal only info
+* Get Info about the current file in the zipfile, with internal only info.
+* pos is relative to the start of the central directory, which is already in memory.
 */
-static unsigned FS_PK3GetFileInfo( FILE *f, void *vfsHandle, unsigned pos, unsigned byteBeforeTheZipFile, 
+static unsigned FS_PK3GetFileInfo( const uint8_t *centralDir, unsigned centralDirSize, unsigned pos, unsigned byteBeforeTheZipFile, 
 	packfile_t *file, size_t *fileNameLen, int *crc )
 {
 	size_t sizeRead;
 	unsigned dosDateTime;
 	unsigned compressed;
-	unsigned char infoHeader[46]; // we can't use a struct here because of packing
+	unsigned itemSize;
+	const uint8_t *infoHeader;
 
-	if( fseek( f, Sys_VFS_FileOffset( vfsHandle ) + pos, SEEK_SET ) != 0 )
-		return 0;
-	if( fread( infoHeader, 1, sizeof( infoHeader ), f ) != sizeof( infoHeader ) )
+	if( pos >= centralDirSize || centralDirSize - pos < FS_ZIP_SIZECENTRALDIRITEM )
 		return 0;
+	infoHeader = centralDir + pos;
 
 	// check the magic
 	if( LittleLongRaw( &infoHeader[0] ) != FS_ZIP_CENTRALHEADERMAGIC )
@@ -2531,6 +2937,15 @@ static unsigned FS_PK3GetFileInfo( FILE *f, void *vfsHandle, unsigned pos, unsig
 
 	dosDateTime = LittleLongRaw( &infoHeader[12] );
 
+	sizeRead = ( size_t )LittleShortRaw( &infoHeader[28] );
+	if( !sizeRead )
+		return 0;
+
+	itemSize = FS_ZIP_SIZECENTRALDIRITEM + ( unsigned )LittleShortRaw( &infoHeader[28] ) +
+		( unsigned )LittleShortRaw( &infoHeader[30] ) + ( unsigned )LittleShortRaw( &infoHeader[32] );
+	if( centralDirSize - pos < itemSize )
+		return 0;
+
 	if( crc )
 		*crc = LittleLongRaw( &infoHeader[16] );
 	if( file )
@@ -2543,25 +2958,74 @@ static unsigned FS_PK3GetFileInfo( FILE *f, void *vfsHandle, unsigned pos, unsig
 		file->mtime = FS_DosTimeToUnixtime( dosDateTime );
 	}
 
-	sizeRead = ( size_t )LittleShortRaw( &infoHeader[28] );
-	if( !sizeRead )
-		return 0;
-
 	if( fileNameLen )
 		*fileNameLen = sizeRead;
 
 	if( file )
 	{
-		if( fread( file->name, 1, sizeRead, f ) != sizeRead )
-			return 0;
-
+		memcpy( file->name, infoHeader + FS_ZIP_SIZECENTRALDIRITEM, sizeRead );
 		*( file->name + sizeRead ) = 0;
 		if( *( file->name + sizeRead - 1 ) == '/' )
 			file->flags |= FS_PACKFILE_DIRECTORY;
 	}
 
-	return FS_ZIP_SIZECENTRALDIRITEM + ( unsigned )LittleShortRaw( &infoHeader[28] ) +
-		( unsigned )LittleShortRaw( &infoHeader[30] ) + ( unsigned )LittleShortRaw( &infoHeader[32] );
+	return itemSize;
+}
+
+/*
+* FS_FindPakCacheEntry
+* 
+* Returns the cached central directory for the pak if its size and mtime still match
+*/
+static const fs_pakcacheentry_t *FS_FindPakCacheEntry( const char *packfilename, unsigned fileSize, int64_t mtime )
+{
+	fs_pakcacheentry_t *entry = NULL;
+
+	if( !fs_pakcache_trie )
+		return NULL;
+
+	QMutex_Lock( fs_pakcache_mutex );
+	if( Trie_Find( fs_pakcache_trie, packfilename, TRIE_EXACT_MATCH, ( void ** )&entry ) != TRIE_OK )
+		entry = NULL;
+	else if( entry->fileSize != fileSize || entry->mtime != mtime )
+		entry = NULL;
+	QMutex_Unlock( fs_pakcache_mutex );
+
+	return entry;
+}
+
+/*
+* FS_AddPakCacheEntry
+*/
+static void FS_AddPakCacheEntry( const char *packfilename, unsigned fileSize, int64_t mtime, unsigned checksum, 
+	int numFiles, unsigned byteBeforeTheZipFile, const uint8_t *centralDir, unsigned centralDirSize )
+{
+	size_t nameSize = strlen( packfilename ) + 1;
+	fs_pakcacheentry_t *entry, *old = NULL;
+
+	if( !fs_pakcache_trie )
+		return;
+
+	entry = ( fs_pakcacheentry_t * )FS_Malloc( sizeof( *entry ) + nameSize + centralDirSize );
+	entry->filename = ( char * )( ( uint8_t * )entry + sizeof( *entry ) );
+	entry->centralDir = ( uint8_t * )entry->filename + nameSize;
+	memcpy( entry->filename, packfilename, nameSize );
+	memcpy( entry->centralDir, centralDir, centralDirSize );
+	entry->fileSize = fileSize;
+	entry->mtime = mtime;
+	entry->checksum = checksum;
+	entry->numFiles = numFiles;
+	entry->byteBeforeTheZipFile = byteBeforeTheZipFile;
+	entry->centralDirSize = centralDirSize;
+
+	QMutex_Lock( fs_pakcache_mutex );
+	if( Trie_Replace( fs_pakcache_trie, entry->filename, entry, ( void ** )&old ) == TRIE_KEY_NOT_FOUND )
+		Trie_Insert( fs_pakcache_trie, entry->filename, entry );
+	fs_pakcache_dirty = true;
+	QMutex_Unlock( fs_pakcache_mutex );
+
+	if( old )
+		FS_Free( old );
 }
 
 /*
@@ -2588,6 +3052,10 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 	int manifestFilesize;
 	void *handle = NULL;
 	void *vfsHandle = NULL;
+	unsigned fileSize = 0;
+	int64_t mtime = 0;
+	const fs_pakcacheentry_t *cached = NULL;
+	uint8_t *centralDir = NULL;
 
 	if( FS_AbsoluteFileExists( packfilename ) == -1 )
 		vfsHandle = FS_VFSHandleForPakName( packfilename );
@@ -2609,6 +3077,26 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 		if( !silent ) Com_Printf( "Error opening PK3 file: %s\n", packfilename );
 		goto error;
 	}
+
+	// packs inside the VFS are never cached, their containers are immutable anyway
+	if( !vfsHandle )
+	{
+		fileSize = FS_FileLength( fin, false );
+		mtime = Sys_FS_FileMTime( packfilename );
+		cached = FS_FindPakCacheEntry( packfilename, fileSize, mtime );
+	}
+
+	if( cached )
+	{
+		fclose( fin );
+		fin = NULL;
+
+		numFiles = cached->numFiles;
+		byteBeforeTheZipFile = cached->byteBeforeTheZipFile;
+		sizeCentralDir = cached->centralDirSize;
+		goto parse_central_dir;
+	}
+
 	centralPos = FS_PK3SearchCentralDir( fin, vfsHandle );
 	if( centralPos == 0 )
 	{
@@ -2652,9 +3140,22 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 	}
 	byteBeforeTheZipFile = centralPos - offsetCentralDir - sizeCentralDir;
 
-	for( i = 0, namesLen = 0, centralPos = offsetCentralDir + byteBeforeTheZipFile; i < numFiles; i++, centralPos += offset )
+	// read the whole central directory at once, entries are parsed from memory
+	centralDir = ( uint8_t * )Mem_TempMallocExt( sizeCentralDir + 1, 0 );
+	if( fseek( fin, Sys_VFS_FileOffset( vfsHandle ) + offsetCentralDir + byteBeforeTheZipFile, SEEK_SET ) != 0 
+		|| fread( centralDir, 1, sizeCentralDir, fin ) != sizeCentralDir )
+	{
+		if( !silent ) Com_Printf( "Error reading PK3 file: %s\n", packfilename );
+		goto error;
+	}
+
+	fclose( fin );
+	fin = NULL;
+
+parse_central_dir:
+	for( i = 0, namesLen = 0, centralPos = 0; i < numFiles; i++, centralPos += offset )
 	{
-		offset = FS_PK3GetFileInfo( fin, vfsHandle, centralPos, byteBeforeTheZipFile, NULL, &len, NULL );
+		offset = FS_PK3GetFileInfo( cached ? cached->centralDir : centralDir, sizeCentralDir, centralPos, byteBeforeTheZipFile, NULL, &len, NULL );
 		if( !offset )
 		{
 			if( !silent ) Com_Printf( "%s is not a valid pk3 file\n", packfilename );
@@ -2688,7 +3189,7 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 	manifestFilesize = -1;
 
 	// add all files to the trie
-	for( i = 0, file = pack->files, centralPos = offsetCentralDir + byteBeforeTheZipFile; i < numFiles; i++, file++, centralPos += offset, names += len + 1 )
+	for( i = 0, file = pack->files, centralPos = 0; i < numFiles; i++, file++, centralPos += offset, names += len + 1 )
 	{
 		const char *ext;
 		trie_error_t trie_err;
@@ -2696,9 +3197,10 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 
 		file->name = names;
 		file->pakname = pack->filename;
+		file->pack = pack;
 		file->vfsHandle = vfsHandle;
 
-		offset = FS_PK3GetFileInfo( fin, vfsHandle, centralPos, byteBeforeTheZipFile, file, &len, &checksums[i] );
+		offset = FS_PK3GetFileInfo( cached ? cached->centralDir : centralDir, sizeCentralDir, centralPos, byteBeforeTheZipFile, file, &len, &checksums[i] );
 
 		if( !COM_ValidateRelativeFilename( file->name ) )
 		{
@@ -2729,11 +3231,15 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 		}
 	}
 
-	fclose( fin );
-	fin = NULL;
-
-	checksums[numFiles] = 0x1234567; // add some pseudo-random stuff
-	pack->checksum = FS_ChecksumPK3File( pack->filename, numFiles + 1, checksums );
+	if( cached )
+	{
+		pack->checksum = cached->checksum;
+	}
+	else
+	{
+		checksums[numFiles] = 0x1234567; // add some pseudo-random stuff
+		pack->checksum = FS_ChecksumPK3File( pack->filename, numFiles + 1, checksums );
+	}
 
 	if( !pack->checksum )
 	{
@@ -2741,7 +3247,12 @@ static pack_t *FS_LoadPK3File( const char *packfilename, bool silent )
 		goto error;
 	}
 
+	if( !cached && !vfsHandle )
+		FS_AddPakCacheEntry( packfilename, fileSize, mtime, pack->checksum, numFiles, byteBeforeTheZipFile, centralDir, sizeCentralDir );
+
 	Mem_TempFree( checksums );
+	if( centralDir )
+		Mem_TempFree( centralDir );
 
 	// read manifest file if it's a module pk3
 	if( modulepack && manifestFilesize > 0 )
@@ -2764,6 +3275,8 @@ error:
 	}
 	if( checksums )
 		Mem_TempFree( checksums );
+	if( centralDir )
+		Mem_TempFree( centralDir );
 	if( handle != NULL )
 		Sys_FS_UnlockFile( handle );
 
@@ -2883,6 +3396,8 @@ return_result:
 */
 static void FS_FreePakFile( pack_t *pack )
 {
+	if( pack->mapData )
+		Sys_FS_UnMMapFile( pack->mapping, pack->mapData, pack->mapSize, pack->mapOffset );
 	if( pack->sysHandle )
 		Sys_FS_UnlockFile( pack->sysHandle );
 	Trie_Destroy( pack->trie );
@@ -3752,6 +4267,8 @@ freename:
 		Mem_ZoneFree( paknames );
 	}
 
+	FS_InvalidatePakIndex();
+
 	QMutex_Unlock( fs_searchpaths_mutex );
 
 	return newpaks;
@@ -3808,6 +4325,8 @@ static void FS_ReplaceDeferredPaks( void )
 		search = search->next;
 	}
 
+	FS_InvalidatePakIndex();
+
 	QMutex_Unlock( fs_searchpaths_mutex );
 }
 
@@ -3935,9 +4454,183 @@ static void FS_RemoveExtraPaks( searchpath_t *old )
 		compare = compare->next;
 	}
 
+	FS_InvalidatePakIndex();
+
 	QMutex_Unlock( fs_searchpaths_mutex );
 }
 
+/*
+* FS_PakCachePath
+*/
+static const char *FS_PakCachePath( char *path, size_t path_size )
+{
+	Q_snprintfz( path, path_size, "%s/%s", FS_CacheDirectory(), FS_PAKCACHE_FILENAME );
+	return path;
+}
+
+/*
+* FS_LoadPakCache
+*/
+static void FS_LoadPakCache( void )
+{
+	int i, numEntries;
+	int size;
+	FILE *f;
+	uint8_t *buf, *p, *end;
+	char path[FS_MAX_PATH];
+
+	fs_pakcache_mutex = QMutex_Create();
+	Trie_Create( TRIE_CASE_SENSITIVE, &fs_pakcache_trie );
+
+	f = fopen( FS_PakCachePath( path, sizeof( path ) ), "rb" );
+	if( !f )
+		return;
+
+	size = FS_FileLength( f, false );
+	buf = size > 12 ? ( uint8_t * )Mem_TempMallocExt( size, 0 ) : NULL;
+	if( !buf || (int)fread( buf, 1, size, f ) != size )
+		goto done;
+
+	if( LittleLongRaw( buf ) != FS_PAKCACHE_MAGIC || LittleLongRaw( buf + 4 ) != FS_PAKCACHE_VERSION )
+		goto done;
+
+	numEntries = LittleLongRaw( buf + 8 );
+	p = buf + 12;
+	end = buf + size;
+
+	for( i = 0; i < numEntries; i++ )
+	{
+		const char *filename;
+		unsigned nameSize, fileSize, checksum, byteBeforeTheZipFile, centralDirSize;
+		int numFiles;
+		int64_t mtime;
+
+		if( end - p < 4 )
+			break;
+		nameSize = LittleLongRaw( p );
+		p += 4;
+		if( !nameSize || nameSize > FS_MAX_PATH || (size_t)( end - p ) < nameSize + 28 || p[nameSize - 1] )
+			break;
+		filename = ( const char * )p;
+		p += nameSize;
+
+		fileSize = LittleLongRaw( p );
+		mtime = ( int64_t )( ( ( uint64_t )( unsigned )LittleLongRaw( p + 8 ) << 32 ) | ( unsigned )LittleLongRaw( p + 4 ) );
+		checksum = LittleLongRaw( p + 12 );
+		numFiles = LittleLongRaw( p + 16 );
+		byteBeforeTheZipFile = LittleLongRaw( p + 20 );
+		centralDirSize = LittleLongRaw( p + 24 );
+		p += 28;
+
+		if( (size_t)( end - p ) < centralDirSize )
+			break;
+
+		FS_AddPakCacheEntry( filename, fileSize, mtime, checksum, numFiles, byteBeforeTheZipFile, p, centralDirSize );
+		p += centralDirSize;
+	}
+
+done:
+	if( buf )
+		Mem_TempFree( buf );
+	fclose( f );
+
+	fs_pakcache_dirty = false;
+}
+
+/*
+* FS_WritePakCacheLong
+*/
+static void FS_WritePakCacheLong( FILE *f, unsigned l )
+{
+	int le = LittleLong( (int)l );
+	fwrite( &le, sizeof( le ), 1, f );
+}
+
+/*
+* FS_SavePakCache
+*/
+static void FS_SavePakCache( void )
+{
+	unsigned i;
+	FILE *f;
+	struct trie_dump_s *dump = NULL;
+	char path[FS_MAX_PATH];
+
+	if( !fs_pakcache_trie || !fs_pakcache->integer )
+		return;
+
+	QMutex_Lock( fs_pakcache_mutex );
+
+	if( !fs_pakcache_dirty )
+		goto done;
+
+	FS_PakCachePath( path, sizeof( path ) );
+	FS_CreateAbsolutePath( path );
+
+	f = fopen( path, "wb" );
+	if( !f )
+	{
+		Com_DPrintf( "FS_SavePakCache: couldn't open %s for writing\n", path );
+		goto done;
+	}
+
+	if( Trie_Dump( fs_pakcache_trie, "", TRIE_DUMP_VALUES, &dump ) == TRIE_OK )
+	{
+		FS_WritePakCacheLong( f, FS_PAKCACHE_MAGIC );
+		FS_WritePakCacheLong( f, FS_PAKCACHE_VERSION );
+		FS_WritePakCacheLong( f, dump->size );
+
+		for( i = 0; i < dump->size; i++ )
+		{
+			const fs_pakcacheentry_t *entry = ( const fs_pakcacheentry_t * )dump->key_value_vector[i].value;
+			unsigned nameSize = strlen( entry->filename ) + 1;
+
+			FS_WritePakCacheLong( f, nameSize );
+			fwrite( entry->filename, 1, nameSize, f );
+			FS_WritePakCacheLong( f, entry->fileSize );
+			FS_WritePakCacheLong( f, ( unsigned )( ( uint64_t )entry->mtime & 0xFFFFFFFF ) );
+			FS_WritePakCacheLong( f, ( unsigned )( ( uint64_t )entry->mtime >> 32 ) );
+			FS_WritePakCacheLong( f, entry->checksum );
+			FS_WritePakCacheLong( f, entry->numFiles );
+			FS_WritePakCacheLong( f, entry->byteBeforeTheZipFile );
+			FS_WritePakCacheLong( f, entry->centralDirSize );
+			fwrite( entry->centralDir, 1, entry->centralDirSize, f );
+		}
+
+		Trie_FreeDump( dump );
+	}
+
+	fclose( f );
+	fs_pakcache_dirty = false;
+
+done:
+	QMutex_Unlock( fs_pakcache_mutex );
+}
+
+/*
+* FS_FreePakCache
+*/
+static void FS_FreePakCache( void )
+{
+	unsigned i;
+	struct trie_dump_s *dump = NULL;
+
+	if( !fs_pakcache_trie )
+		return;
+
+	if( Trie_Dump( fs_pakcache_trie, "", TRIE_DUMP_VALUES, &dump ) == TRIE_OK )
+	{
+		for( i = 0; i < dump->size; i++ )
+			FS_Free( dump->key_value_vector[i].value );
+		Trie_FreeDump( dump );
+	}
+
+	Trie_Destroy( fs_pakcache_trie );
+	fs_pakcache_trie = NULL;
+
+	QMutex_Destroy( &fs_pakcache_mutex );
+}
+
 /*
 * FS_TouchGameDirectory
 */
@@ -3966,7 +4659,10 @@ static int FS_TouchGameDirectory( const char *gamedir, bool initial )
 
 	// possibly spawn a few threads to load deferred packs in parallel
 	if( newpaks )
+	{
 		FS_LoadDeferredPaks( newpaks );
+		FS_SavePakCache();
+	}
 
 	// FIXME: remove the initial check?
 	// not sure whether removing pak files on the fly is such a good idea
@@ -4049,6 +4745,7 @@ bool FS_SetGameDirectory( const char *dir, bool force )
 		FS_Free( fs_searchpaths );
 		fs_searchpaths = next;
 	}
+	FS_InvalidatePakIndex();
 	QMutex_Unlock( fs_searchpaths_mutex );
 
 	if( !strcmp( dir, fs_basegame->string ) || ( *dir == 0 ) )
@@ -4149,6 +4846,89 @@ void FS_AddFileToMedia( const char *filename )
 	Sys_FS_AddFileToMedia( filename );
 }
 
+/*
+* Cmd_FS_LookupBench_f
+* 
+* Resolves every file found in paks through the merged index and through
+* a walk of all paks, and compares the two
+*/
+static void Cmd_FS_LookupBench_f( void )
+{
+	int i, iter, iterations;
+	unsigned j;
+	int numNames, mismatches;
+	const char **names;
+	const fs_pakindex_t *index;
+	const fs_pakindexentry_t *entry;
+	searchpath_t *search, *indexSearch;
+	packfile_t *pakFile, *indexFile;
+	uint64_t start, indexTime, listTime;
+
+	iterations = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 10;
+	if( iterations < 1 )
+		iterations = 1;
+
+	QMutex_Lock( fs_searchpaths_mutex );
+
+	start = Sys_Microseconds();
+	index = FS_PakIndex();
+	Com_Printf( "Index: %u entries in %u slots, %i directories, built in %u usec\n",
+		index->numEntries, index->size, index->numDirs, (unsigned)( Sys_Microseconds() - start ) );
+
+	if( !index->numEntries )
+	{
+		QMutex_Unlock( fs_searchpaths_mutex );
+		return;
+	}
+
+	names = ( const char ** )Mem_TempMalloc( sizeof( *names ) * index->numEntries );
+	for( j = 0, numNames = 0; j < index->size; j++ )
+	{
+		if( index->entries[j].name )
+			names[numNames++] = index->entries[j].name;
+	}
+
+	mismatches = 0;
+	for( i = 0; i < numNames; i++ )
+	{
+		entry = FS_PakIndexFind( index, names[i] );
+		indexSearch = entry ? ( entry->pureSearch ? entry->pureSearch : entry->search ) : NULL;
+		indexFile = entry ? ( entry->pureSearch ? entry->pureFile : entry->file ) : NULL;
+		search = FS_SearchPakListForFile( names[i], &pakFile );
+		if( search != indexSearch || pakFile != indexFile )
+		{
+			if( mismatches < 10 )
+				Com_Printf( "Mismatch: %s\n", names[i] );
+			mismatches++;
+		}
+	}
+
+	start = Sys_Microseconds();
+	for( iter = 0; iter < iterations; iter++ )
+	{
+		for( i = 0; i < numNames; i++ )
+			FS_PakIndexFind( index, names[i] );
+	}
+	indexTime = Sys_Microseconds() - start;
+
+	start = Sys_Microseconds();
+	for( iter = 0; iter < iterations; iter++ )
+	{
+		for( i = 0; i < numNames; i++ )
+			FS_SearchPakListForFile( names[i], &pakFile );
+	}
+	listTime = Sys_Microseconds() - start;
+
+	QMutex_Unlock( fs_searchpaths_mutex );
+
+	Mem_TempFree( names );
+
+	Com_Printf( "%i lookups x %i: index %.3f usec/lookup, pak walk %.3f usec/lookup, %i mismatches\n",
+		numNames, iterations,
+		(double)indexTime / ( (double)numNames * iterations ),
+		(double)listTime / ( (double)numNames * iterations ), mismatches );
+}
+
 /*
 * Cmd_FS_Search_f
 */
@@ -4311,6 +5091,7 @@ void FS_Init( void )
 	Cmd_AddCommand( "fs_search", Cmd_FS_Search_f );
 	Cmd_AddCommand( "fs_checksum", Cmd_FileChecksum_f );
 	Cmd_AddCommand( "fs_mtime", Cmd_FileMTime_f );
+	Cmd_AddCommand( "fs_lookupbench", Cmd_FS_LookupBench_f );
 
 	fs_numsearchfiles = FS_MIN_SEARCHFILES;
 	fs_searchfiles = ( searchfile_t* )FS_Malloc( sizeof( searchfile_t ) * fs_numsearchfiles );
@@ -4339,6 +5120,8 @@ void FS_Init( void )
 		fs_usehomedir = Cvar_Get( "fs_usehomedir", "0", CVAR_NOSET );
 #endif
 	fs_usedownloadsdir = Cvar_Get( "fs_usedownloadsdir", "1", CVAR_NOSET );
+	fs_mmappaks = Cvar_Get( "fs_mmappaks", "1", CVAR_NOSET );
+	fs_pakcache = Cvar_Get( "fs_pakcache", "1", CVAR_NOSET );
 
 	fs_downloads_searchpath = NULL;
 	if( fs_usedownloadsdir->integer ) {
@@ -4371,6 +5154,9 @@ void FS_Init( void )
 
 	Sys_VFS_Init();
 
+	if( fs_pakcache->integer )
+		FS_LoadPakCache();
+
 	//
 	// set game directories
 	//
@@ -4439,6 +5225,7 @@ void FS_Shutdown( void )
 	Cmd_RemoveCommand( "fs_search" );
 	Cmd_RemoveCommand( "fs_checksum" );
 	Cmd_RemoveCommand( "fs_mtime" );
+	Cmd_RemoveCommand( "fs_lookupbench" );
 
 	FS_FreeSearchFiles();
 	FS_Free( fs_searchfiles );
@@ -4457,8 +5244,12 @@ void FS_Shutdown( void )
 		FS_Free( search );
 	}
 
+	FS_FreePakIndex();
+
 	QMutex_Unlock( fs_searchpaths_mutex );
 
+	FS_FreePakCache();
+
 	while( fs_basepaths )
 	{
 		search = fs_basepaths;
@@ -285,23 +285,15 @@ char *MSG_ReadStringLine( msg_t *msg )
 //==================================================
 
 /*
-* MSG_WriteDeltaEntity
+* MSG_DeltaEntityBits
 * 
-* Writes part of a packetentities message.
-* Can delta from either a baseline or a previous packet_entity
+* Returns the header bits of a delta update, without the U_MOREBITS flags.
+* SNAP_ComputeDeltaBits must be kept in sync with this.
 */
-void MSG_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, msg_t *msg, bool force, bool updateOtherOrigin )
+int MSG_DeltaEntityBits( const entity_state_t *from, const entity_state_t *to, bool updateOtherOrigin )
 {
 	int bits;
 
-	if( !to->number )
-		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Unset entity number" );
-	else if( to->number >= MAX_EDICTS )
-		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Entity number >= MAX_EDICTS" );
-	else if( to->number < 0 )
-		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Invalid Entity number" );
-
-	// send an update
 	bits = 0;
 
 	if( to->number & 0xFF00 )
@@ -403,6 +395,23 @@ void MSG_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, msg_t *msg,
 	if( to->team != from->team )
 		bits |= U_TEAM;
 
+	return bits;
+}
+
+/*
+* MSG_WriteDeltaEntityBits
+* 
+* Writes an entity update with header bits from MSG_DeltaEntityBits
+*/
+void MSG_WriteDeltaEntityBits( const entity_state_t *to, int bits, msg_t *msg, bool force )
+{
+	if( !to->number )
+		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Unset entity number" );
+	else if( to->number >= MAX_EDICTS )
+		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Entity number >= MAX_EDICTS" );
+	else if( to->number < 0 )
+		Com_Error( ERR_FATAL, "MSG_WriteDeltaEntity: Invalid Entity number" );
+
 	//
 	// write the message
 	//
@@ -577,6 +586,17 @@ void MSG_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, msg_t *msg,
 	}
 }
 
+/*
+* MSG_WriteDeltaEntity
+* 
+* Writes part of a packetentities message.
+* Can delta from either a baseline or a previous packet_entity
+*/
+void MSG_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, msg_t *msg, bool force, bool updateOtherOrigin )
+{
+	MSG_WriteDeltaEntityBits( to, MSG_DeltaEntityBits( from, to, updateOtherOrigin ), msg, force );
+}
+
 /*
 * MSG_ReadEntityBits
 * 
@@ -18,9 +18,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#ifdef __linux__
+#define _GNU_SOURCE     // recvmmsg, sendmmsg
+#endif
+
 #include "qcommon.h"
 
 #include "sys_net.h"
+#include "sys_threads.h"
 
 #ifdef _WIN32
 #include "../win32/winquake.h"
@@ -35,6 +40,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <sys/time.h>
 #endif
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#define NET_USE_EPOLL
+#define NET_USE_MMSG
+#endif
+
 #define	MAX_LOOPBACK	4
 
 #if !defined SHUT_RDWR && defined SD_BOTH
@@ -67,6 +78,8 @@ static loopback_t loopbacks[2];
 static char errorstring[MAX_PRINTMSG];
 static bool	net_initialized = false;
 
+static volatile int net_socketSerial;
+
 #define MAX_IPS 16
 static int numIP;
 static uint8_t localIP[MAX_IPS][4];
@@ -96,6 +109,15 @@ static const char *GetLastErrorString( void )
 	}
 }
 
+/*
+* NET_NextSocketSerial
+*/
+static unsigned int NET_NextSocketSerial( void )
+{
+	int serial = Sys_Atomic_Add( &net_socketSerial, 1, NULL ) + 1;
+	return serial ? (unsigned int)serial : 1;
+}
+
 /*
 * GetLocalAddress
 */
@@ -382,6 +404,227 @@ static int NET_UDP_GetPacket( const socket_t *socket, netadr_t *address, msg_t *
 	return 1;
 }
 
+/*
+* NET_UDP_GetPackets
+*
+* Reads up to count datagrams with a single call when possible. Packets
+* which fail to be read are dropped, so the stored ones are always
+* at the start of the arrays.
+*/
+static int NET_UDP_GetPackets( const socket_t *socket, netadr_t *addresses, msg_t *messages, int count )
+{
+#ifdef NET_USE_MMSG
+	struct mmsghdr hdrs[NET_MAX_PACKET_BATCH];
+	struct iovec iovs[NET_MAX_PACKET_BATCH];
+	struct sockaddr_storage from[NET_MAX_PACKET_BATCH];
+	msg_t tmp;
+	int i, ret, numPackets;
+
+	assert( socket && socket->open && socket->type == SOCKET_UDP );
+	assert( addresses );
+	assert( messages );
+
+	count = min( count, NET_MAX_PACKET_BATCH );
+	memset( hdrs, 0, sizeof( hdrs[0] ) * count );
+	for( i = 0; i < count; i++ )
+	{
+		assert( messages[i].data );
+		assert( messages[i].maxsize > 0 );
+
+		iovs[i].iov_base = messages[i].data;
+		iovs[i].iov_len = messages[i].maxsize;
+		hdrs[i].msg_hdr.msg_name = &from[i];
+		hdrs[i].msg_hdr.msg_namelen = sizeof( from[i] );
+		hdrs[i].msg_hdr.msg_iov = &iovs[i];
+		hdrs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	ret = recvmmsg( socket->handle, hdrs, count, MSG_DONTWAIT, NULL );
+	if( ret == SOCKET_ERROR )
+	{
+		net_error_t err;
+
+		NET_SetErrorStringFromLastError( "recvmmsg" );
+
+		err = Sys_NET_GetLastError();
+		if( err == NET_ERR_WOULDBLOCK || err == NET_ERR_CONNRESET )  // would block
+			return 0;
+
+		return -1;
+	}
+
+	numPackets = 0;
+	for( i = 0; i < ret; i++ )
+	{
+		if( hdrs[i].msg_len >= messages[i].maxsize || ( hdrs[i].msg_hdr.msg_flags & MSG_TRUNC ) )
+		{
+			NET_SetErrorString( "Oversized packet" );
+			continue;
+		}
+
+		if( !SockaddressToAddress( (struct sockaddr*)&from[i], &addresses[numPackets] ) )
+			continue;
+
+		if( numPackets != i )
+		{
+			// keep the buffers, just move the packet to the next free slot
+			tmp = messages[numPackets];
+			messages[numPackets] = messages[i];
+			messages[i] = tmp;
+		}
+
+		messages[numPackets].readcount = 0;
+		messages[numPackets].cursize = hdrs[i].msg_len;
+		numPackets++;
+	}
+
+	// everything we've got was broken
+	if( ret > 0 && !numPackets )
+		return -1;
+
+	return numPackets;
+#else
+	int ret, numPackets;
+
+	for( numPackets = 0; numPackets < count; numPackets++ )
+	{
+		ret = NET_UDP_GetPacket( socket, &addresses[numPackets], &messages[numPackets] );
+		if( ret == 0 )
+			break;
+		if( ret == -1 )
+			return numPackets ? numPackets : -1;
+	}
+
+	return numPackets;
+#endif
+}
+
+/*
+=============================================================================
+
+Batched sending
+
+UDP packets sent between NET_BeginSendBatch and NET_FlushSendBatch are
+queued and sent with as few system calls as possible. Only meant to be
+used from the main thread.
+
+=============================================================================
+*/
+
+#ifdef NET_USE_MMSG
+typedef struct
+{
+	socket_handle_t handle;
+	struct sockaddr_storage addr;
+	socklen_t addrlen;
+	size_t length;
+	uint8_t data[MAX_PACKETLEN];
+} netqueuedpacket_t;
+
+static netqueuedpacket_t net_sendQueue[NET_MAX_PACKET_BATCH];
+static int net_sendQueueLength;
+#endif
+
+static int net_sendBatchDepth;
+
+/*
+* NET_BeginSendBatch
+*/
+void NET_BeginSendBatch( void )
+{
+	net_sendBatchDepth++;
+}
+
+/*
+* NET_UDP_FlushSendQueue
+*/
+static void NET_UDP_FlushSendQueue( void )
+{
+#ifdef NET_USE_MMSG
+	struct mmsghdr hdrs[NET_MAX_PACKET_BATCH];
+	struct iovec iovs[NET_MAX_PACKET_BATCH];
+	int i, first, last, ret;
+
+	if( !net_sendQueueLength )
+		return;
+
+	memset( hdrs, 0, sizeof( hdrs[0] ) * net_sendQueueLength );
+	for( i = 0; i < net_sendQueueLength; i++ )
+	{
+		iovs[i].iov_base = net_sendQueue[i].data;
+		iovs[i].iov_len = net_sendQueue[i].length;
+		hdrs[i].msg_hdr.msg_name = &net_sendQueue[i].addr;
+		hdrs[i].msg_hdr.msg_namelen = net_sendQueue[i].addrlen;
+		hdrs[i].msg_hdr.msg_iov = &iovs[i];
+		hdrs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	// one call per run of packets going out through the same socket
+	for( first = 0; first < net_sendQueueLength; first = last )
+	{
+		for( last = first + 1; last < net_sendQueueLength; last++ )
+		{
+			if( net_sendQueue[last].handle != net_sendQueue[first].handle )
+				break;
+		}
+
+		while( first < last )
+		{
+			ret = sendmmsg( net_sendQueue[first].handle, &hdrs[first], last - first, 0 );
+			if( ret == SOCKET_ERROR )
+			{
+				// skip the failing packet
+				NET_SetErrorStringFromLastError( "sendmmsg" );
+				Com_Printf( "NET_SendPacket: Error: %s\n", NET_ErrorString() );
+				ret = 1;
+			}
+			first += ret;
+		}
+	}
+
+	net_sendQueueLength = 0;
+#endif
+}
+
+/*
+* NET_FlushSendBatch
+*/
+void NET_FlushSendBatch( void )
+{
+	assert( net_sendBatchDepth > 0 );
+
+	if( net_sendBatchDepth > 0 )
+		net_sendBatchDepth--;
+	if( !net_sendBatchDepth )
+		NET_UDP_FlushSendQueue();
+}
+
+/*
+* NET_UDP_QueuePacket
+*/
+static bool NET_UDP_QueuePacket( const socket_t *socket, const void *data, size_t length, const struct sockaddr_storage *addr, socklen_t addrlen )
+{
+#ifdef NET_USE_MMSG
+	netqueuedpacket_t *packet;
+
+	if( !net_sendBatchDepth || length > MAX_PACKETLEN )
+		return false;
+
+	if( net_sendQueueLength == NET_MAX_PACKET_BATCH )
+		NET_UDP_FlushSendQueue();
+
+	packet = &net_sendQueue[net_sendQueueLength++];
+	packet->handle = socket->handle;
+	packet->addr = *addr;
+	packet->addrlen = addrlen;
+	packet->length = length;
+	memcpy( packet->data, data, length );
+	return true;
+#else
+	return false;
+#endif
+}
+
 /*
 * NET_UDP_SendPacket
 */
@@ -399,6 +642,9 @@ static bool NET_UDP_SendPacket( const socket_t *socket, const void *data, size_t
 		return false;
 
 	addrlen = ( addr.ss_family == AF_INET6 ? sizeof( struct sockaddr_in6 ) : sizeof( struct sockaddr_in ) );
+	if( NET_UDP_QueuePacket( socket, data, length, &addr, addrlen ) )
+		return true;
+
 	if( sendto( socket->handle, data, length, 0, (struct sockaddr *)&addr, addrlen ) == SOCKET_ERROR )
 	{
 		NET_SetErrorStringFromLastError( "sendto" );
@@ -487,6 +733,7 @@ static bool NET_IP_OpenSocket( socket_t *sock, const netadr_t *address, socket_t
 	sock->address = *address;
 	sock->server = server;
 	sock->handle = newsocket;
+	sock->serial = NET_NextSocketSerial();
 
 	return true;
 }
@@ -501,6 +748,9 @@ static void NET_UDP_CloseSocket( socket_t *socket )
 	if( !socket->open )
 		return;
 
+	// don't let queued packets go out through a reused handle
+	NET_UDP_FlushSendQueue();
+
 	Sys_NET_SocketClose( socket->handle );
 	socket->handle = 0;
 	socket->open = false;
@@ -789,6 +1039,7 @@ static int NET_TCP_Accept( const socket_t *socket, socket_t *newsocket, netadr_t
 	newsocket->address = socket->address;
 	newsocket->remoteAddress = *address;
 	newsocket->handle = handle;
+	newsocket->serial = NET_NextSocketSerial();
 
 	return 1;
 }
@@ -827,6 +1078,27 @@ static int NET_TCP_SetNoDelay( socket_t *socket, int nodelay )
 	return 1;
 }
 
+/*
+* NET_TCP_SetLinger
+*/
+static int NET_TCP_SetLinger( socket_t *socket, int linger )
+{
+	struct linger ling;
+
+	assert( socket && socket->type == SOCKET_TCP );
+
+	ling.l_onoff = linger >= 0 ? 1 : 0;
+	ling.l_linger = linger >= 0 ? linger : 0;
+
+	if( setsockopt( socket->handle, SOL_SOCKET, SO_LINGER, (char *)&ling, sizeof( ling ) ) < 0 )
+	{
+		NET_SetErrorStringFromLastError( "socket" );
+		return -1;
+	}
+
+	return 1;
+}
+
 #endif // TCP_SUPPORT
 
 //===================================================================
@@ -1011,6 +1283,37 @@ int NET_GetPacket( const socket_t *socket, netadr_t *address, msg_t *message )
 	}
 }
 
+/*
+* NET_GetPackets
+*
+* Reads up to count packets into the messages array, addresses are stored
+* in the matching slots. Returns the number of packets read, 0 if there is
+* no data ready or -1 on error.
+*/
+int NET_GetPackets( const socket_t *socket, netadr_t *addresses, msg_t *messages, int count )
+{
+	int i, ret;
+
+	assert( socket->open );
+
+	if( !socket->open )
+		return -1;
+
+	if( socket->type == SOCKET_UDP )
+		return NET_UDP_GetPackets( socket, addresses, messages, count );
+
+	for( i = 0; i < count; i++ )
+	{
+		ret = NET_GetPacket( socket, &addresses[i], &messages[i] );
+		if( ret == 0 )
+			break;
+		if( ret == -1 )
+			return i ? i : -1;
+	}
+
+	return i;
+}
+
 /*
 * NET_Get
 * 
@@ -1792,6 +2095,33 @@ int NET_SetSocketNoDelay( socket_t *socket, int nodelay )
 	return 0;
 }
 
+/*
+* NET_SetSocketLinger
+*
+* Sets how many seconds closing a TCP socket may block while unsent data
+* is still queued, a negative value makes it return at once and leaves
+* the data to the system.
+*/
+int NET_SetSocketLinger( socket_t *socket, int linger )
+{
+	switch( socket->type )
+	{
+	case SOCKET_LOOPBACK:
+		break;
+	case SOCKET_UDP:
+		break;
+#ifdef TCP_SUPPORT
+	case SOCKET_TCP:
+		return NET_TCP_SetLinger( socket, linger );
+#endif
+	default:
+		assert( false );
+		NET_SetErrorString( "Unknown socket type" );
+		return -1;
+	}
+	return 0;
+}
+
 /*
 * NET_Sleep
 */
@@ -1919,6 +2249,356 @@ int NET_Monitor( int msec, socket_t *sockets[], void (*read_cb)(socket_t *, void
 	return ret;
 }
 
+/*
+=============================================================================
+
+Persistent socket monitors
+
+=============================================================================
+*/
+
+#define NET_POLL_MAX_EVENTS	256
+
+typedef struct
+{
+	socket_t *socket;
+	unsigned int serial;
+	unsigned int events;
+	unsigned int stamp;         // equals the poll stamp if in the last list
+	int index;                  // into the last list
+} netpollfd_t;
+
+struct netpoll_s
+{
+	char name[32];
+
+	// wakeup statistics
+	unsigned int numWaits;
+	unsigned int numTimeouts;
+	unsigned int numEvents;
+	uint64_t totalSleep;        // microseconds
+	uint64_t totalLatency;      // microseconds slept past the timeout
+	uint64_t maxLatency;
+
+#ifdef NET_USE_EPOLL
+	int epfd;
+	unsigned int stamp;
+
+	int numFds;                 // size of the fds array, indexed by handle
+	netpollfd_t *fds;
+
+	int numRegistered;
+	int maxRegistered;
+	int *registered;            // registered handles
+
+	struct epoll_event events[NET_POLL_MAX_EVENTS];
+#endif
+
+	struct netpoll_s *next;
+};
+
+static qmutex_t *net_pollsMutex;
+static netpoll_t *net_polls;
+
+/*
+* NET_CreatePoll
+*/
+netpoll_t *NET_CreatePoll( const char *name )
+{
+	netpoll_t *poll;
+
+	poll = Mem_ZoneMalloc( sizeof( *poll ) );
+	Q_strncpyz( poll->name, name, sizeof( poll->name ) );
+
+#ifdef NET_USE_EPOLL
+	poll->epfd = epoll_create( NET_POLL_MAX_EVENTS );
+	if( poll->epfd < 0 )
+		Com_Printf( "Warning: epoll_create failed for %s, using select\n", name );
+#endif
+
+	QMutex_Lock( net_pollsMutex );
+	poll->next = net_polls;
+	net_polls = poll;
+	QMutex_Unlock( net_pollsMutex );
+
+	return poll;
+}
+
+/*
+* NET_DestroyPoll
+*/
+void NET_DestroyPoll( netpoll_t **ppoll )
+{
+	netpoll_t *poll, **prev;
+
+	if( !ppoll || !*ppoll )
+		return;
+
+	poll = *ppoll;
+	*ppoll = NULL;
+
+	QMutex_Lock( net_pollsMutex );
+	for( prev = &net_polls; *prev; prev = &( *prev )->next )
+	{
+		if( *prev == poll )
+		{
+			*prev = poll->next;
+			break;
+		}
+	}
+	QMutex_Unlock( net_pollsMutex );
+
+#ifdef NET_USE_EPOLL
+	if( poll->epfd >= 0 )
+		close( poll->epfd );
+	if( poll->fds )
+		Mem_Free( poll->fds );
+	if( poll->registered )
+		Mem_Free( poll->registered );
+#endif
+
+	Mem_Free( poll );
+}
+
+#ifdef NET_USE_EPOLL
+/*
+* NET_Poll_Register
+*
+* Makes the epoll set match the list of sockets, touching only the
+* sockets that joined or left it since the last call.
+*/
+static void NET_Poll_Register( netpoll_t *poll, socket_t *sockets[], unsigned int events )
+{
+	int i, fd;
+	netpollfd_t *pfd;
+	struct epoll_event ev;
+
+	poll->stamp++;
+	if( !poll->stamp )
+		poll->stamp = 1;
+
+	for( i = 0; sockets[i]; i++ )
+	{
+		if( !sockets[i]->open )
+			continue;
+		if( sockets[i]->type != SOCKET_UDP
+#ifdef TCP_SUPPORT
+			&& sockets[i]->type != SOCKET_TCP
+#endif
+			)
+			continue;
+
+		fd = sockets[i]->handle;
+		assert( fd > 0 );
+
+		if( fd >= poll->numFds )
+		{
+			int numFds = max( fd + 1, poll->numFds * 2 );
+			netpollfd_t *fds = Mem_ZoneMalloc( numFds * sizeof( *fds ) );
+
+			if( poll->fds )
+			{
+				memcpy( fds, poll->fds, poll->numFds * sizeof( *fds ) );
+				Mem_Free( poll->fds );
+			}
+			poll->fds = fds;
+			poll->numFds = numFds;
+		}
+
+		pfd = &poll->fds[fd];
+		memset( &ev, 0, sizeof( ev ) );
+		ev.events = events;
+		ev.data.fd = fd;
+
+		if( !pfd->socket )
+		{
+			// new handle
+			if( poll->numRegistered == poll->maxRegistered )
+			{
+				int maxRegistered = max( 64, poll->maxRegistered * 2 );
+				int *registered = Mem_ZoneMalloc( maxRegistered * sizeof( *registered ) );
+
+				if( poll->registered )
+				{
+					memcpy( registered, poll->registered, poll->numRegistered * sizeof( *registered ) );
+					Mem_Free( poll->registered );
+				}
+				poll->registered = registered;
+				poll->maxRegistered = maxRegistered;
+			}
+			poll->registered[poll->numRegistered++] = fd;
+
+			epoll_ctl( poll->epfd, EPOLL_CTL_ADD, fd, &ev );
+		}
+		else if( pfd->socket != sockets[i] || pfd->serial != sockets[i]->serial )
+		{
+			// the handle was closed and reused, which silently drops it from the set
+			epoll_ctl( poll->epfd, EPOLL_CTL_DEL, fd, &ev );
+			epoll_ctl( poll->epfd, EPOLL_CTL_ADD, fd, &ev );
+		}
+		else if( pfd->events != events )
+		{
+			epoll_ctl( poll->epfd, EPOLL_CTL_MOD, fd, &ev );
+		}
+
+		pfd->socket = sockets[i];
+		pfd->serial = sockets[i]->serial;
+		pfd->events = events;
+		pfd->stamp = poll->stamp;
+		pfd->index = i;
+	}
+
+	// drop the sockets which left the list
+	for( i = 0; i < poll->numRegistered; )
+	{
+		fd = poll->registered[i];
+		pfd = &poll->fds[fd];
+		if( pfd->stamp == poll->stamp )
+		{
+			i++;
+			continue;
+		}
+
+		// may fail if already closed, that's fine
+		epoll_ctl( poll->epfd, EPOLL_CTL_DEL, fd, NULL );
+		memset( pfd, 0, sizeof( *pfd ) );
+		poll->registered[i] = poll->registered[--poll->numRegistered];
+	}
+}
+
+/*
+* NET_Poll_Wait
+*/
+static int NET_Poll_Wait( netpoll_t *poll, int msec, socket_t *sockets[], void (*read_cb)(socket_t *, void*), 
+	void (*write_cb)(socket_t *, void*), void (*exception_cb)(socket_t *, void*), void *privatep[] )
+{
+	int i, ret;
+	unsigned int events;
+	netpollfd_t *pfd;
+	socket_t *socket;
+	void *priv;
+
+	events = EPOLLIN;
+	if( write_cb )
+		events |= EPOLLOUT;
+	if( exception_cb )
+		events |= EPOLLPRI;
+
+	NET_Poll_Register( poll, sockets, events );
+
+	ret = epoll_wait( poll->epfd, poll->events, NET_POLL_MAX_EVENTS, msec );
+	if( ret <= 0 || !( read_cb || write_cb || exception_cb ) )
+		return ret;
+
+	// launch callbacks
+	for( i = 0; i < ret; i++ )
+	{
+		events = poll->events[i].events;
+		pfd = &poll->fds[poll->events[i].data.fd];
+		if( pfd->stamp != poll->stamp )
+			continue;
+
+		socket = pfd->socket;
+		priv = privatep ? privatep[pfd->index] : NULL;
+
+		if( exception_cb && ( events & EPOLLPRI ) )
+			exception_cb( socket, priv );
+		// errors and hangups are reported as readable by select too
+		if( read_cb && ( events & ( EPOLLIN|EPOLLERR|EPOLLHUP ) ) )
+			read_cb( socket, priv );
+		if( write_cb && ( events & EPOLLOUT ) )
+			write_cb( socket, priv );
+	}
+
+	return ret;
+}
+#endif
+
+/*
+* NET_PollMonitor
+*
+* Same as NET_Monitor, but keeps the sockets registered between calls.
+*/
+int NET_PollMonitor( netpoll_t *poll, int msec, socket_t *sockets[], void (*read_cb)(socket_t *, void*), 
+	void (*write_cb)(socket_t *, void*), void (*exception_cb)(socket_t *, void*), void *privatep[] )
+{
+	int ret;
+	uint64_t start, slept;
+
+	if( !poll )
+		return NET_Monitor( msec, sockets, read_cb, write_cb, exception_cb, privatep );
+	if( !sockets || !sockets[0] )
+		return 0;
+
+	start = Sys_Microseconds();
+
+#ifdef NET_USE_EPOLL
+	if( poll->epfd >= 0 )
+		ret = NET_Poll_Wait( poll, msec, sockets, read_cb, write_cb, exception_cb, privatep );
+	else
+#endif
+		ret = NET_Monitor( msec, sockets, read_cb, write_cb, exception_cb, privatep );
+
+	slept = Sys_Microseconds() - start;
+
+	poll->numWaits++;
+	poll->totalSleep += slept;
+	if( ret > 0 )
+	{
+		poll->numEvents++;
+	}
+	else if( ret == 0 )
+	{
+		uint64_t latency = slept > (uint64_t)msec * 1000 ? slept - (uint64_t)msec * 1000 : 0;
+
+		poll->numTimeouts++;
+		poll->totalLatency += latency;
+		poll->maxLatency = max( poll->maxLatency, latency );
+	}
+
+	return ret;
+}
+
+/*
+* NET_PollSleep
+*/
+void NET_PollSleep( netpoll_t *poll, int msec, socket_t *sockets[] )
+{
+	if( !poll )
+	{
+		NET_Sleep( msec, sockets );
+		return;
+	}
+
+	NET_PollMonitor( poll, msec, sockets, NULL, NULL, NULL, NULL );
+}
+
+/*
+* NET_PollStats_f
+*/
+static void NET_PollStats_f( void )
+{
+	netpoll_t *poll;
+
+	QMutex_Lock( net_pollsMutex );
+	for( poll = net_polls; poll; poll = poll->next )
+	{
+		Com_Printf( "%s (%s): %u waits, %u woken by sockets, %u timeouts\n", poll->name,
+#ifdef NET_USE_EPOLL
+			poll->epfd >= 0 ? "epoll" : "select",
+#else
+			"select",
+#endif
+			poll->numWaits, poll->numEvents, poll->numTimeouts );
+		if( poll->numWaits )
+			Com_Printf( "  average sleep %.3f ms\n", poll->totalSleep / ( 1000.0 * poll->numWaits ) );
+		if( poll->numTimeouts )
+			Com_Printf( "  timeout wakeup latency: average %.3f ms, max %.3f ms\n",
+				poll->totalLatency / ( 1000.0 * poll->numTimeouts ), poll->maxLatency / 1000.0 );
+	}
+	QMutex_Unlock( net_pollsMutex );
+}
+
 /*
 * NET_SendFile
 */
@@ -1967,6 +2647,9 @@ void NET_Init( void )
 
 	GetLocalAddress();
 
+	net_pollsMutex = QMutex_Create();
+	Cmd_AddCommand( "net_pollstats", NET_PollStats_f );
+
 	net_initialized = true;
 }
 
@@ -1980,6 +2663,9 @@ void NET_Shutdown( void )
 
 	errorstring[0] = '\0';
 
+	Cmd_RemoveCommand( "net_pollstats" );
+	QMutex_Destroy( &net_pollsMutex );
+
 	Sys_NET_Shutdown();
 
 	net_initialized = false;
@@ -149,12 +149,121 @@ static uint8_t msg_process_data[MAX_MSGLEN];
 
 #include "compression.h"
 
+#define NETCHAN_DICT_FILENAME		"netdict.dat"
+#define NETCHAN_DICT_MAX_SIZE		( 1 << MAX_WBITS )	// deflate can't reference anything farther back
+#define NETCHAN_DICT_TRAIN_SIZE		( 8 * 1024 )
+#define NETCHAN_DICT_LEVEL			1					// the dictionary does most of the work on small packets
+#define NETCHAN_DICT_WBITS			14					// room for the dictionary and a typical snapshot
+#define NETCHAN_DICT_MEMLEVEL		5
+#define NETCHAN_DICT_ARENA_SIZE		( 96 * 1024 )		// a copy of the primed deflate state at the settings above
+
+typedef struct
+{
+	uint8_t *data;
+	size_t size;
+	unsigned int checksum;
+	z_stream stream;		// deflate state with the dictionary already hashed, copied for every message
+} netchan_dict_t;
+
+static netchan_dict_t *netchan_dict;
+
+// the per-message copies of the primed state are carved out of a per-thread arena,
+// so that the snapshot workers don't go through the zone allocator for every datagram
+static ATTRIBUTE_THREAD_LOCAL uint64_t netchan_dictArena[NETCHAN_DICT_ARENA_SIZE / sizeof( uint64_t )];
+static ATTRIBUTE_THREAD_LOCAL size_t netchan_dictArenaUsed;
+static ATTRIBUTE_THREAD_LOCAL bool netchan_dictArenaActive;
+
+/*
+* Netchan_DictAlloc
+*/
+static voidpf Netchan_DictAlloc( voidpf opaque, uInt items, uInt size )
+{
+	void *ptr;
+	size_t bytes = ( (size_t)items * size + 15 ) & ~15;
+
+	if( netchan_dictArenaActive && netchan_dictArenaUsed + bytes <= sizeof( netchan_dictArena ) )
+	{
+		ptr = ( uint8_t * )netchan_dictArena + netchan_dictArenaUsed;
+		netchan_dictArenaUsed += bytes;
+		return ptr;
+	}
+
+	// the primed state itself, or a zlib that needs more than expected
+	return Mem_ZoneMallocExt( bytes, 0 );
+}
+
+/*
+* Netchan_DictFree
+*/
+static void Netchan_DictFree( voidpf opaque, voidpf ptr )
+{
+	if( ( uint8_t * )ptr >= ( uint8_t * )netchan_dictArena && 
+		( uint8_t * )ptr < ( uint8_t * )netchan_dictArena + sizeof( netchan_dictArena ) )
+		return;
+	Mem_ZoneFree( ptr );
+}
+
+/*
+* Netchan_BeginDictStream
+*
+* Each datagram must still be decompressable on its own, so every message
+* starts from a copy of the primed state. deflateCopy only reads from the
+* source stream, so several threads can copy it at the same time.
+*/
+static int Netchan_BeginDictStream( z_stream *strm, const netchan_dict_t *dict )
+{
+	int zlerror;
+
+	netchan_dictArenaUsed = 0;
+	netchan_dictArenaActive = true;
+
+	zlerror = qzdeflateCopy( strm, ( z_streamp )&dict->stream );
+	if( zlerror != Z_OK )
+		netchan_dictArenaActive = false;
+	return zlerror;
+}
+
+/*
+* Netchan_EndDictStream
+*/
+static void Netchan_EndDictStream( z_stream *strm )
+{
+	qzdeflateEnd( strm );
+	netchan_dictArenaActive = false;
+}
+
 static int Netchan_ZLibCompressChunk( const uint8_t *source, unsigned long sourceLen, uint8_t *dest, unsigned long destLen,
-									 int level, int wbits )
+									 int level, int wbits, const netchan_dict_t *dict )
 {
 	int result, zlerror;
 
-	zlerror = qzcompress2( dest, &destLen, source, sourceLen, level );
+	if( dict )
+	{
+		z_stream strm;
+
+		zlerror = Netchan_BeginDictStream( &strm, dict );
+		if( zlerror == Z_OK )
+		{
+			strm.next_in = ( Bytef * )source;
+			strm.avail_in = sourceLen;
+			strm.next_out = dest;
+			strm.avail_out = destLen;
+
+			zlerror = qzdeflate( &strm, Z_FINISH );
+			if( zlerror == Z_STREAM_END )
+				zlerror = Z_OK;
+			else if( zlerror == Z_OK )
+				zlerror = Z_BUF_ERROR; // ran out of output space
+			destLen = strm.total_out;
+
+			Netchan_EndDictStream( &strm );
+		}
+	}
+	else
+	{
+		zlerror = qzcompress2( dest, &destLen, source, sourceLen, level );
+	}
+
 	switch( zlerror )
 	{
 	case Z_OK:
@@ -182,11 +291,39 @@ static int Netchan_ZLibCompressChunk( const uint8_t *source, unsigned long sourc
 }
 
 static int Netchan_ZLibDecompressChunk( const uint8_t *source, unsigned long sourceLen, uint8_t *dest, unsigned long destLen,
-									   int wbits )
+									   int wbits, const netchan_dict_t *dict )
 {
 	int result, zlerror;
+	z_stream strm;
+
+	memset( &strm, 0, sizeof( strm ) );
+	strm.next_in = ( Bytef * )source;
+	strm.avail_in = sourceLen;
+
+	zlerror = qzinflateInit2( &strm, wbits );
+	if( zlerror == Z_OK )
+	{
+		strm.next_out = dest;
+		strm.avail_out = destLen;
+
+		zlerror = qzinflate( &strm, Z_FINISH );
+		if( zlerror == Z_NEED_DICT && dict )
+		{
+			// fails with Z_DATA_ERROR if the sender used a different dictionary
+			zlerror = qzinflateSetDictionary( &strm, dict->data, dict->size );
+			if( zlerror == Z_OK )
+				zlerror = qzinflate( &strm, Z_FINISH );
+		}
+
+		if( zlerror == Z_STREAM_END )
+			zlerror = Z_OK;
+		else if( zlerror == Z_OK )
+			zlerror = Z_BUF_ERROR;
+		destLen = strm.total_out;
+
+		qzinflateEnd( &strm );
+	}
 
-	zlerror = qzuncompress( dest, &destLen, source, sourceLen );
 	switch( zlerror )
 	{
 	case Z_OK:
@@ -204,6 +341,10 @@ static int Netchan_ZLibDecompressChunk( const uint8_t *source, unsigned long sou
 		Com_DPrintf( "ZLib data error! Z_DATA_ERROR on decompress.\n" );
 		result = -1;
 		break;
+	case Z_NEED_DICT:
+		Com_DPrintf( "ZLib data error! Z_NEED_DICT on decompress.\n" );
+		result = -1;
+		break;
 	default:
 		Com_DPrintf( "ZLib data error! Error code %i on decompress.\n", zlerror );
 		result = -1;
@@ -214,22 +355,26 @@ static int Netchan_ZLibDecompressChunk( const uint8_t *source, unsigned long sou
 }
 
 /*
-* Netchan_CompressMessage
+* Netchan_CompressMessageExt
+*
+* Compresses the message using the given scratch buffer, so that
+* several messages can be compressed at the same time.
+* The preset dictionary is only used if the receiver has agreed on it.
 */
-int Netchan_CompressMessage( msg_t *msg )
+int Netchan_CompressMessageExt( msg_t *msg, uint8_t *buffer, size_t bufferSize, bool dictionary )
 {
 	int length;
 
 	if( msg == NULL || !msg->data )
 		return 0;
 
-	// zero-fill our buffer
-	length = 0;
-	memset( msg_process_data, 0, sizeof( msg_process_data ) );
-
 	//compress the message
-	length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, 
-		msg_process_data, sizeof( msg_process_data ), Z_BEST_COMPRESSION, -MAX_WBITS );
+	if( dictionary && netchan_dict )
+		length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, 
+			buffer, bufferSize, NETCHAN_DICT_LEVEL, NETCHAN_DICT_WBITS, netchan_dict );
+	else
+		length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, 
+			buffer, bufferSize, Z_BEST_COMPRESSION, MAX_WBITS, NULL );
 	if( length < 0 )  // failed to compress, return the error
 		return length;
 
@@ -240,12 +385,20 @@ int Netchan_CompressMessage( msg_t *msg )
 
 	//write it back into the original container
 	MSG_Clear( msg );
-	MSG_CopyData( msg, msg_process_data, length );
+	MSG_CopyData( msg, buffer, length );
 	msg->compressed = true;
 
 	return length; // return the new size
 }
 
+/*
+* Netchan_CompressMessage
+*/
+int Netchan_CompressMessage( msg_t *msg, bool dictionary )
+{
+	return Netchan_CompressMessageExt( msg, msg_process_data, sizeof( msg_process_data ), dictionary );
+}
+
 /*
 * Netchan_DecompressMessage
 */
@@ -259,7 +412,8 @@ int Netchan_DecompressMessage( msg_t *msg )
 	if( msg->compressed == false )
 		return 0;
 
-	length = Netchan_ZLibDecompressChunk( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, ( sizeof( msg_process_data ) - msg->readcount ), -MAX_WBITS );
+	length = Netchan_ZLibDecompressChunk( msg->data + msg->readcount, msg->cursize - msg->readcount, msg_process_data, 
+		( sizeof( msg_process_data ) - msg->readcount ), MAX_WBITS, netchan_dict );
 	if( length < 0 )
 		return length;
 
@@ -277,6 +431,467 @@ int Netchan_DecompressMessage( msg_t *msg )
 	return length;
 }
 
+/*
+* Netchan_DictionaryChecksum
+*
+* Identifies the preset dictionary to the remote side, 0 if there's none.
+*/
+unsigned int Netchan_DictionaryChecksum( void )
+{
+	return netchan_dict ? netchan_dict->checksum : 0;
+}
+
+/*
+* Netchan_FreeDictionary
+*/
+static void Netchan_FreeDictionary( netchan_dict_t *dict )
+{
+	qzdeflateEnd( &dict->stream );
+	Mem_ZoneFree( dict->data );
+	Mem_ZoneFree( dict );
+}
+
+/*
+* Netchan_LoadDictionary
+*
+* Loads the preset dictionary and hashes it into a deflate stream.
+*/
+static netchan_dict_t *Netchan_LoadDictionary( void )
+{
+	int length, zlerror;
+	void *buffer;
+	netchan_dict_t *dict;
+
+	length = FS_LoadFile( NETCHAN_DICT_FILENAME, &buffer, NULL, 0 );
+	if( !buffer )
+		return NULL;
+
+	if( length <= 0 || length > NETCHAN_DICT_MAX_SIZE )
+	{
+		Com_Printf( "Ignoring %s: invalid size %i\n", NETCHAN_DICT_FILENAME, length );
+		FS_FreeFile( buffer );
+		return NULL;
+	}
+
+	dict = Mem_ZoneMalloc( sizeof( *dict ) );
+	dict->data = Mem_ZoneMalloc( length );
+	dict->size = length;
+	memcpy( dict->data, buffer, length );
+	FS_FreeFile( buffer );
+
+	// deflateCopy allocates with the source stream's functions
+	dict->stream.zalloc = Netchan_DictAlloc;
+	dict->stream.zfree = Netchan_DictFree;
+	dict->stream.opaque = dict;
+
+	zlerror = qzdeflateInit2( &dict->stream, NETCHAN_DICT_LEVEL, Z_DEFLATED, NETCHAN_DICT_WBITS, 
+		NETCHAN_DICT_MEMLEVEL, Z_DEFAULT_STRATEGY );
+	if( zlerror == Z_OK )
+		zlerror = qzdeflateSetDictionary( &dict->stream, dict->data, dict->size );
+	if( zlerror != Z_OK )
+	{
+		Com_Printf( "Ignoring %s: ZLib error %i\n", NETCHAN_DICT_FILENAME, zlerror );
+		Netchan_FreeDictionary( dict );
+		return NULL;
+	}
+
+	dict->checksum = qzadler32( qzadler32( 0, NULL, 0 ), dict->data, dict->size );
+	return dict;
+}
+
+//=============================================================
+// Dictionary training and benchmarking over recorded demos
+//=============================================================
+
+#define NETCHAN_TRAIN_MAX_SAMPLES	( 32 * 1024 * 1024 )
+#define NETCHAN_TRAIN_HASH_BITS		20
+#define NETCHAN_TRAIN_NGRAM			8
+#define NETCHAN_TRAIN_SEGMENT		32
+
+typedef void ( *netchan_demomsg_cb_t )( msg_t *msg, void *arg );
+
+/*
+* Netchan_DemoPath
+*/
+static char *Netchan_DemoPath( const char *name )
+{
+	char *path;
+	size_t path_size;
+
+	path_size = strlen( "demos/" ) + strlen( name ) + strlen( APP_DEMO_EXTENSION_STR ) + 1;
+	path = Mem_TempMalloc( path_size );
+	Q_snprintfz( path, path_size, "demos/%s", name );
+	COM_SanitizeFilePath( path );
+	COM_DefaultExtension( path, APP_DEMO_EXTENSION_STR, path_size );
+
+	if( !COM_ValidateRelativeFilename( path ) )
+	{
+		Com_Printf( "Invalid demo name: %s\n", name );
+		Mem_TempFree( path );
+		return NULL;
+	}
+
+	return path;
+}
+
+/*
+* Netchan_ReadDemoMessages
+*/
+static bool Netchan_ReadDemoMessages( const char *path, netchan_demomsg_cb_t cb, void *arg )
+{
+	int demofile, read;
+	msg_t msg;
+	uint8_t msgData[MAX_MSGLEN];
+
+	FS_FOpenFile( path, &demofile, FS_READ|SNAP_DEMO_GZ );
+	if( !demofile )
+	{
+		Com_Printf( "Couldn't open %s\n", path );
+		return false;
+	}
+
+	// don't use SNAP_ReadDemoMessage, it drops on truncated demos
+	// and would leak the caller's buffers and this file handle
+	MSG_Init( &msg, msgData, sizeof( msgData ) );
+	while( ( read = SNAP_ReadDemoMessageChecked( demofile, &msg ) ) > 0 )
+		cb( &msg, arg );
+
+	if( read == -2 )
+		Com_Printf( "%s: truncated or corrupt, skipping the rest\n", path );
+
+	FS_FCloseFile( demofile );
+	return true;
+}
+
+/*
+* Netchan_ForEachDemoMessage
+*
+* Feeds all messages from demos given as command arguments, either names or
+* patterns matched against the demos directory. Returns the number of demos.
+*/
+static int Netchan_ForEachDemoMessage( int firstArg, netchan_demomsg_cb_t cb, void *arg )
+{
+	int i, j, total, numDemos;
+	size_t bufsize;
+	char *buf, *name, *path;
+	const char *pattern;
+
+	numDemos = 0;
+	for( i = firstArg; i < Cmd_Argc(); i++ )
+	{
+		pattern = Cmd_Argv( i );
+
+		if( !strpbrk( pattern, "*?[" ) )
+		{
+			path = Netchan_DemoPath( pattern );
+			if( !path )
+				continue;
+			if( Netchan_ReadDemoMessages( path, cb, arg ) )
+				numDemos++;
+			Mem_TempFree( path );
+			continue;
+		}
+
+		bufsize = 0;
+		total = FS_GetFileListExt( "demos", APP_DEMO_EXTENSION_STR, NULL, &bufsize, 0, 0 );
+		if( !total || !bufsize )
+			continue;
+
+		buf = Mem_TempMalloc( bufsize );
+		FS_GetFileList( "demos", APP_DEMO_EXTENSION_STR, buf, bufsize, 0, 0 );
+
+		for( j = 0, name = buf; j < total; j++, name += strlen( name ) + 1 )
+		{
+			if( !Com_GlobMatch( pattern, name, false ) )
+				continue;
+
+			path = Netchan_DemoPath( name );
+			if( !path )
+				continue;
+			if( Netchan_ReadDemoMessages( path, cb, arg ) )
+				numDemos++;
+			Mem_TempFree( path );
+		}
+
+		Mem_TempFree( buf );
+	}
+
+	return numDemos;
+}
+
+typedef struct
+{
+	uint8_t *data;
+	size_t size;
+	unsigned int numMessages;
+} netchan_samples_t;
+
+/*
+* Netchan_AddTrainingSample
+*/
+static void Netchan_AddTrainingSample( msg_t *msg, void *arg )
+{
+	netchan_samples_t *samples = arg;
+
+	if( samples->size + msg->cursize > NETCHAN_TRAIN_MAX_SAMPLES )
+		return;
+
+	memcpy( samples->data + samples->size, msg->data, msg->cursize );
+	samples->size += msg->cursize;
+	samples->numMessages++;
+}
+
+/*
+* Netchan_NGramHash
+*/
+static inline unsigned int Netchan_NGramHash( const uint8_t *p )
+{
+	uint64_t v;
+
+	memcpy( &v, p, sizeof( v ) );
+	return ( unsigned int )( ( v * 0xCF1BBCDCB7A56463ULL ) >> ( 64 - NETCHAN_TRAIN_HASH_BITS ) );
+}
+
+/*
+* Netchan_TrainDictionary
+*
+* Picks the segments of the samples which share the most byte sequences with other
+* messages, one segment out of each equal slice of the samples. Sequences already
+* covered by a picked segment no longer count, so the segments don't repeat.
+* The best segments go last, as deflate encodes the nearest matches cheaper.
+*/
+static size_t Netchan_TrainDictionary( const netchan_samples_t *samples, uint8_t *dict, size_t dictSize )
+{
+	unsigned int i, j, k;
+	unsigned int *counts;
+	size_t numSegments, epochSize, pos, end, best;
+	uint64_t score, bestScore;
+	const int numNGrams = NETCHAN_TRAIN_SEGMENT - NETCHAN_TRAIN_NGRAM + 1;
+	typedef struct { size_t pos; uint64_t score; } segment_t;
+	segment_t *segments, tmp;
+
+	if( samples->size < NETCHAN_TRAIN_SEGMENT * 2 )
+		return 0;
+
+	// count occurences of each n-gram, every repeated n-gram is likely to repeat across packets
+	counts = Mem_TempMalloc( sizeof( *counts ) << NETCHAN_TRAIN_HASH_BITS );
+	for( pos = 0; pos + NETCHAN_TRAIN_NGRAM <= samples->size; pos++ )
+		counts[Netchan_NGramHash( samples->data + pos )]++;
+
+	numSegments = dictSize / NETCHAN_TRAIN_SEGMENT;
+	epochSize = samples->size / numSegments;
+	if( epochSize < NETCHAN_TRAIN_SEGMENT )
+	{
+		numSegments = samples->size / NETCHAN_TRAIN_SEGMENT;
+		epochSize = NETCHAN_TRAIN_SEGMENT;
+	}
+
+	segments = Mem_TempMalloc( sizeof( *segments ) * numSegments );
+
+	for( i = 0; i < numSegments; i++ )
+	{
+		pos = i * epochSize;
+		end = min( pos + epochSize, samples->size ) - NETCHAN_TRAIN_SEGMENT;
+
+		// sliding window sum of the counts of n-grams within the segment
+		score = 0;
+		for( k = 0; k < numNGrams; k++ )
+			score += counts[Netchan_NGramHash( samples->data + pos + k )];
+
+		best = pos;
+		bestScore = score;
+		for( ; pos < end; pos++ )
+		{
+			score -= counts[Netchan_NGramHash( samples->data + pos )];
+			score += counts[Netchan_NGramHash( samples->data + pos + numNGrams )];
+			if( score > bestScore )
+			{
+				bestScore = score;
+				best = pos + 1;
+			}
+		}
+
+		segments[i].pos = best;
+		segments[i].score = bestScore;
+
+		for( k = 0; k < numNGrams; k++ )
+			counts[Netchan_NGramHash( samples->data + best + k )] = 0;
+	}
+
+	// insertion sort by score, there are only a few hundred segments
+	for( i = 1; i < numSegments; i++ )
+	{
+		tmp = segments[i];
+		for( j = i; j > 0 && segments[j-1].score > tmp.score; j-- )
+			segments[j] = segments[j-1];
+		segments[j] = tmp;
+	}
+
+	for( i = 0; i < numSegments; i++ )
+		memcpy( dict + i * NETCHAN_TRAIN_SEGMENT, samples->data + segments[i].pos, NETCHAN_TRAIN_SEGMENT );
+
+	Mem_TempFree( segments );
+	Mem_TempFree( counts );
+
+	return numSegments * NETCHAN_TRAIN_SEGMENT;
+}
+
+/*
+* Netchan_TrainDictionary_f
+*/
+static void Netchan_TrainDictionary_f( void )
+{
+	int numDemos, file;
+	size_t size;
+	uint8_t *dict;
+	netchan_samples_t samples;
+
+	if( Cmd_Argc() < 2 )
+	{
+		Com_Printf( "Usage: %s <demo|pattern> [...]\n", Cmd_Argv( 0 ) );
+		return;
+	}
+
+	memset( &samples, 0, sizeof( samples ) );
+	samples.data = Mem_TempMalloc( NETCHAN_TRAIN_MAX_SAMPLES );
+
+	numDemos = Netchan_ForEachDemoMessage( 1, Netchan_AddTrainingSample, &samples );
+
+	dict = Mem_TempMalloc( NETCHAN_DICT_TRAIN_SIZE );
+	size = Netchan_TrainDictionary( &samples, dict, NETCHAN_DICT_TRAIN_SIZE );
+	if( !size )
+	{
+		Com_Printf( "Not enough data to train a dictionary\n" );
+	}
+	else if( FS_FOpenFile( NETCHAN_DICT_FILENAME, &file, FS_WRITE ) == -1 )
+	{
+		Com_Printf( "Couldn't open %s for writing\n", NETCHAN_DICT_FILENAME );
+	}
+	else
+	{
+		FS_Write( dict, size, file );
+		FS_FCloseFile( file );
+
+		Com_Printf( "Wrote %s: %i bytes from %u messages (%i bytes) in %i demos\n", NETCHAN_DICT_FILENAME, 
+			(int)size, samples.numMessages, (int)samples.size, numDemos );
+		Com_Printf( "The dictionary is loaded on the next restart and must be the same on both servers and clients\n" );
+	}
+
+	Mem_TempFree( dict );
+	Mem_TempFree( samples.data );
+}
+
+typedef struct
+{
+	const netchan_dict_t *dict;
+	unsigned int numMessages;
+	unsigned int numFailed;
+	uint64_t rawBytes;
+	uint64_t bytes[2];
+	uint64_t usecs[2];
+	uint64_t copyUsecs;
+	uint8_t buffer[MAX_MSGLEN];
+	uint8_t verify[MAX_MSGLEN];
+} netchan_bench_t;
+
+/*
+* Netchan_BenchDemoMessage
+*
+* Compresses the message the way SV_Netchan_Transmit used to
+* and with the preset dictionary, then checks the round trip.
+*/
+static void Netchan_BenchDemoMessage( msg_t *msg, void *arg )
+{
+	int length;
+	uint64_t start;
+	z_stream strm;
+	netchan_bench_t *bench = arg;
+
+	bench->numMessages++;
+	bench->rawBytes += msg->cursize;
+
+	start = Sys_Microseconds();
+	memset( bench->buffer, 0, sizeof( bench->buffer ) );
+	length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, bench->buffer, sizeof( bench->buffer ), 
+		Z_BEST_COMPRESSION, MAX_WBITS, NULL );
+	bench->usecs[0] += Sys_Microseconds() - start;
+	bench->bytes[0] += ( length > 0 && (size_t)length < msg->cursize ) ? length : msg->cursize;
+
+	if( !bench->dict )
+		return;
+
+	start = Sys_Microseconds();
+	length = Netchan_ZLibCompressChunk( msg->data, msg->cursize, bench->buffer, sizeof( bench->buffer ), 
+		NETCHAN_DICT_LEVEL, NETCHAN_DICT_WBITS, bench->dict );
+	bench->usecs[1] += Sys_Microseconds() - start;
+	bench->bytes[1] += ( length > 0 && (size_t)length < msg->cursize ) ? length : msg->cursize;
+
+	// the part of it that goes to restoring the primed state
+	start = Sys_Microseconds();
+	if( Netchan_BeginDictStream( &strm, bench->dict ) == Z_OK )
+		Netchan_EndDictStream( &strm );
+	bench->copyUsecs += Sys_Microseconds() - start;
+
+	if( length > 0 )
+	{
+		if( Netchan_ZLibDecompressChunk( bench->buffer, length, bench->verify, sizeof( bench->verify ), 
+			MAX_WBITS, bench->dict ) != (int)msg->cursize || memcmp( bench->verify, msg->data, msg->cursize ) )
+			bench->numFailed++;
+	}
+}
+
+/*
+* Netchan_BenchDictionary_f
+*
+* Replays recorded server messages through both compression modes.
+*/
+static void Netchan_BenchDictionary_f( void )
+{
+	int i, numDemos;
+	netchan_dict_t *dict;
+	netchan_bench_t *bench;
+	const char *names[2] = { "deflate", "dictionary" };
+
+	if( Cmd_Argc() < 2 )
+	{
+		Com_Printf( "Usage: %s <demo|pattern> [...]\n", Cmd_Argv( 0 ) );
+		return;
+	}
+
+	// load the file again, it may have been retrained since startup
+	dict = Netchan_LoadDictionary();
+	if( !dict )
+		Com_Printf( "No %s, only measuring plain deflate\n", NETCHAN_DICT_FILENAME );
+
+	bench = Mem_TempMalloc( sizeof( *bench ) );
+	bench->dict = dict;
+
+	numDemos = Netchan_ForEachDemoMessage( 1, Netchan_BenchDemoMessage, bench );
+	if( !bench->numMessages )
+	{
+		Com_Printf( "No messages read\n" );
+	}
+	else
+	{
+		Com_Printf( "%u messages from %i demos, %llu bytes uncompressed\n", bench->numMessages, numDemos, 
+			(unsigned long long)bench->rawBytes );
+		for( i = 0; i < ( dict ? 2 : 1 ); i++ )
+		{
+			Com_Printf( "%s: %llu bytes (%.1f%%), %.1f bytes/msg, %.2f usec/msg\n", names[i], (unsigned long long)bench->bytes[i], 
+				100.0 * bench->bytes[i] / bench->rawBytes, (double)bench->bytes[i] / bench->numMessages, 
+				(double)bench->usecs[i] / bench->numMessages );
+		}
+		if( dict )
+			Com_Printf( "dictionary state copy: %.2f usec/msg\n", (double)bench->copyUsecs / bench->numMessages );
+		if( bench->numFailed )
+			Com_Printf( S_COLOR_RED "%u messages failed to decompress\n", bench->numFailed );
+	}
+
+	Mem_TempFree( bench );
+	if( dict )
+		Netchan_FreeDictionary( dict );
+}
+
 /*
 * Netchan_DropAllFragments
 * 
@@ -660,6 +1275,13 @@ void Netchan_Init( void )
 	showpackets = Cvar_Get( "showpackets", "0", 0 );
 	showdrop = Cvar_Get( "showdrop", "0", 0 );
 	net_showfragments = Cvar_Get( "net_showfragments", "0", 0 );
+
+	netchan_dict = Netchan_LoadDictionary();
+	if( netchan_dict )
+		Com_Printf( "Loaded %s: %i bytes, checksum %08x\n", NETCHAN_DICT_FILENAME, (int)netchan_dict->size, netchan_dict->checksum );
+
+	Cmd_AddCommand( "netdict_train", Netchan_TrainDictionary_f );
+	Cmd_AddCommand( "netdict_bench", Netchan_BenchDictionary_f );
 }
 
 /*
@@ -667,4 +1289,12 @@ void Netchan_Init( void )
 */
 void Netchan_Shutdown( void )
 {
+	Cmd_RemoveCommand( "netdict_train" );
+	Cmd_RemoveCommand( "netdict_bench" );
+
+	if( netchan_dict )
+	{
+		Netchan_FreeDictionary( netchan_dict );
+		netchan_dict = NULL;
+	}
 }
@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef __QCOMMON_H
 #define __QCOMMON_H
 
+#include <setjmp.h>
+
 #include "../gameshared/q_arch.h"
 #include "../gameshared/q_math.h"
 #include "../gameshared/q_shared.h"
@@ -49,6 +51,7 @@ struct client_s;
 struct cmodel_state_s;
 struct client_entities_s;
 struct fatvis_s;
+struct snapDeltaCache_s;
 
 //============================================================================
 
@@ -86,6 +89,8 @@ void MSG_WriteString( msg_t *sb, const char *s );
 #define MSG_WriteAngle16( sb, f ) ( MSG_WriteShort( ( sb ), ANGLE2SHORT( ( f ) ) ) )
 void MSG_WriteDeltaUsercmd( msg_t *sb, struct usercmd_s *from, struct usercmd_s *cmd );
 void MSG_WriteDeltaEntity( struct entity_state_s *from, struct entity_state_s *to, msg_t *msg, bool force, bool newentity );
+int MSG_DeltaEntityBits( const struct entity_state_s *from, const struct entity_state_s *to, bool updateOtherOrigin );
+void MSG_WriteDeltaEntityBits( const struct entity_state_s *to, int bits, msg_t *msg, bool force );
 void MSG_WriteDir( msg_t *sb, vec3_t vector );
 
 
@@ -137,23 +142,58 @@ void Com_FreePureList( purelist_t **purelist );
 // define this 0 to disable compression of demo files
 #define SNAP_DEMO_GZ					FS_GZ
 
+// keyframe index written next to server demos, see SNAP_BeginDemoIndex
+#define SNAP_DEMO_INDEX_EXTENSION		".idx"
+
 void SNAP_ParseBaseline( msg_t *msg, entity_state_t *baselines );
 void SNAP_SkipFrame( msg_t *msg, struct snapshot_s *header );
 struct snapshot_s *SNAP_ParseFrame( msg_t *msg, struct snapshot_s *lastFrame, int *suppressCount, struct snapshot_s *backup, entity_state_t *baselines, int showNet );
 
 void SNAP_WriteFrameSnapToClient( struct ginfo_s *gi, struct client_s *client, msg_t *msg, unsigned int frameNum, unsigned int gameTime,
-								 entity_state_t *baselines, struct client_entities_s *client_entities,
+								 entity_state_t *baselines, struct client_entities_s *client_entities, struct snapDeltaCache_s *deltacache,
 								 int numcmds, gcommand_t *commands, const char *commandsData );
 
+// entity delta bits between two consecutive frames, computed once per frame
+// for all entities and looked up by every client that acked the previous one
+struct snapDeltaCache_s *SNAP_CreateDeltaCache( struct mempool_s *mempool );
+void SNAP_DestroyDeltaCache( struct snapDeltaCache_s **pcache );
+void SNAP_UpdateDeltaCache( struct snapDeltaCache_s *cache, struct ginfo_s *gi, unsigned int frameNum );
+void SNAP_DeltaCacheBenchmark( struct snapDeltaCache_s *cache, int numClients, int iterations );
+
+// shared between the clients of a server to avoid culling the same entities
+// against the same visibility sets over and over again
+struct snapVisCache_s *SNAP_CreateVisCache( struct mempool_s *mempool );
+void SNAP_DestroyVisCache( struct snapVisCache_s **pcache );
+
 void SNAP_BuildClientFrameSnap( struct cmodel_state_s *cms, struct ginfo_s *gi, unsigned int frameNum, unsigned int timeStamp,
-							   struct fatvis_s *fatvis, struct client_s *client, 
+							   struct fatvis_s *fatvis, struct snapVisCache_s *viscache, struct client_s *client, 
 							   game_state_t *gameState, struct client_entities_s *client_entities,
 							   bool relay, struct mempool_s *mempool );
 
+#define	SNAP_MAX_SNAPSHOT_ENTITIES		1024
+typedef struct
+{
+	int numSnapshotEntities;
+	int snapshotEntities[SNAP_MAX_SNAPSHOT_ENTITIES];
+	int entityAddedToSnapList[MAX_EDICTS];
+} snapshotEntityNumbers_t;
+
+// SNAP_BuildClientFrameSnap split in two steps: the first one only reads
+// the game state and may run for different clients at the same time, the
+// second one stores entity states in the shared circular buffer
+bool SNAP_BuildClientFrameSnapList( struct cmodel_state_s *cms, struct ginfo_s *gi, unsigned int frameNum, unsigned int timeStamp,
+							   struct fatvis_s *fatvis, struct snapVisCache_s *viscache, struct client_s *client, game_state_t *gameState,
+							   bool relay, struct mempool_s *mempool, snapshotEntityNumbers_t *entsList );
+void SNAP_DumpClientFrameSnapList( struct ginfo_s *gi, struct client_s *client, unsigned int frameNum,
+							   struct client_entities_s *client_entities, const snapshotEntityNumbers_t *entsList );
+
 void SNAP_FreeClientFrames( struct client_s *client );
+void SNAP_UpdateSoundAttenuation( void );
+void SNAP_GetFrameStats( int *numFrames, int *numAllocations );
 
 void SNAP_RecordDemoMessage( int demofile, msg_t *msg, int offset );
 int SNAP_ReadDemoMessage( int demofile, msg_t *msg );
+int SNAP_ReadDemoMessageChecked( int demofile, msg_t *msg );
 void SNAP_BeginDemoRecording( int demofile, unsigned int spawncount, unsigned int snapFrameTime, 
 								const char *sv_name, unsigned int sv_bitflags, purelist_t *purelist, 
 								char *configstrings, entity_state_t *baselines );
@@ -163,6 +203,13 @@ size_t SNAP_ClearDemoMeta( char *meta_data, size_t meta_data_max_size );
 size_t SNAP_SetDemoMetaKeyValue( char *meta_data, size_t meta_data_max_size, size_t meta_data_realsize,
 							  const char *key, const char *value );
 size_t SNAP_ReadDemoMetaData( int demofile, char *meta_data, size_t meta_data_size );
+void SNAP_BeginDemoIndex( int indexfile );
+void SNAP_RecordDemoKeyframe( int indexfile, int offset, unsigned int serverTime, const char *configstrings, 
+							 char *indexconfigstrings );
+typedef void (*snap_demokeyframe_cb_t)( int offset, unsigned int serverTime, void *arg );
+typedef void (*snap_democonfigstring_cb_t)( int offset, int index, const char *string, void *arg );
+bool SNAP_ReadDemoIndex( int indexfile, snap_demokeyframe_cb_t keyframe_cb, snap_democonfigstring_cb_t configstring_cb, 
+						void *arg );
 
 //============================================================================
 
@@ -593,6 +640,7 @@ typedef struct
 	netadr_t remoteAddress;
 
 	socket_handle_t handle;
+	unsigned int serial;        // changes every time a handle is assigned, see NET_PollMonitor
 } socket_t;
 
 typedef enum
@@ -627,8 +675,13 @@ bool		NET_Listen( const socket_t *socket );
 int			NET_Accept( const socket_t *socket, socket_t *newsocket, netadr_t *address );
 #endif
 
+#define NET_MAX_PACKET_BATCH	64
+
 int			NET_GetPacket( const socket_t *socket, netadr_t *address, msg_t *message );
+int			NET_GetPackets( const socket_t *socket, netadr_t *addresses, msg_t *messages, int count );
 bool		NET_SendPacket( const socket_t *socket, const void *data, size_t length, const netadr_t *address );
+void		NET_BeginSendBatch( void );
+void		NET_FlushSendBatch( void );
 
 int			NET_Get( const socket_t *socket, netadr_t *address, void *data, size_t length );
 int         NET_Send( const socket_t *socket, const void *data, size_t length, const netadr_t *address );
@@ -639,11 +692,26 @@ int         NET_Monitor( int msec, socket_t *sockets[],
 				void (*read_cb)(socket_t *socket, void*), 
 				void (*write_cb)(socket_t *socket, void*), 
 				void (*exception_cb)(socket_t *socket, void*), void *privatep[] );
+
+// persistent socket monitors: sockets are only (un)registered with the OS
+// when they join or leave the list passed to NET_PollMonitor, which uses
+// epoll on Linux and falls back to NET_Monitor elsewhere
+typedef struct netpoll_s netpoll_t;
+
+netpoll_t  *NET_CreatePoll( const char *name );
+void	    NET_DestroyPoll( netpoll_t **ppoll );
+void	    NET_PollSleep( netpoll_t *poll, int msec, socket_t *sockets[] );
+int         NET_PollMonitor( netpoll_t *poll, int msec, socket_t *sockets[], 
+				void (*read_cb)(socket_t *socket, void*), 
+				void (*write_cb)(socket_t *socket, void*), 
+				void (*exception_cb)(socket_t *socket, void*), void *privatep[] );
+
 const char *NET_ErrorString( void );
 void	    NET_SetErrorString( const char *format, ... );
 void		NET_SetErrorStringFromLastError( const char *function );
 void	    NET_ShowIP( void );
 int			NET_SetSocketNoDelay( socket_t *socket, int nodelay );
+int			NET_SetSocketLinger( socket_t *socket, int linger );
 
 const char *NET_SocketTypeToString( socket_type_t type );
 const char *NET_SocketToString( const socket_t *socket );
@@ -690,6 +758,8 @@ typedef struct
 	uint8_t unsentBuffer[MAX_MSGLEN];
 	bool unsentIsCompressed;
 
+	bool compressDictionary;	// compress outgoing messages with the preset dictionary, negotiated at connect time
+
 	bool fatal_error;
 } netchan_t;
 
@@ -703,8 +773,10 @@ bool Netchan_Process( netchan_t *chan, msg_t *msg );
 bool Netchan_Transmit( netchan_t *chan, msg_t *msg );
 bool Netchan_PushAllFragments( netchan_t *chan );
 bool Netchan_TransmitNextFragment( netchan_t *chan );
-int Netchan_CompressMessage( msg_t *msg );
+int Netchan_CompressMessage( msg_t *msg, bool dictionary );
+int Netchan_CompressMessageExt( msg_t *msg, uint8_t *buffer, size_t bufferSize, bool dictionary );
 int Netchan_DecompressMessage( msg_t *msg );
+unsigned int Netchan_DictionaryChecksum( void );
 void Netchan_OutOfBand( const socket_t *socket, const netadr_t *address, size_t length, const uint8_t *data );
 void Netchan_OutOfBandPrint( const socket_t *socket, const netadr_t *address, const char *format, ... );
 int Netchan_GamePort( void );
@@ -776,6 +848,10 @@ void	FS_FreeBaseFile( void *buffer );
 #define FS_LoadBaseFile(path,buffer,stack,stacksize) FS_LoadBaseFileExt(path,0,buffer,stack,stacksize,__FILE__,__LINE__)
 #define FS_LoadCacheFile(path,buffer,stack,stacksize) FS_LoadFileExt(path,FS_CACHE,buffer,stack,stacksize,__FILE__,__LINE__)
 
+// read-only, possibly zero-copy, not zero-terminated
+int		FS_LoadMappedFile( const char *path, const void **buffer );
+void	FS_FreeMappedFile( const void *buffer );
+
 /**
 * Maps an existing file on disk for reading. 
 * Does *not* work for compressed virtual files.
@@ -797,6 +873,7 @@ bool    FS_MoveBaseFile( const char *src, const char *dst );
 bool    FS_MoveCacheFile( const char *src, const char *dst );
 bool    FS_RemoveFile( const char *filename );
 bool    FS_RemoveBaseFile( const char *filename );
+bool    FS_RemoveCacheFile( const char *filename );
 bool    FS_RemoveAbsoluteFile( const char *filename );
 bool    FS_RemoveDirectory( const char *dirname );
 bool    FS_RemoveBaseDirectory( const char *dirname );
@@ -843,6 +920,7 @@ void 	    Com_DeferConsoleLogReopen( void );
 void	    Com_Printf( const char *format, ... );
 void	    Com_DPrintf( const char *format, ... );
 void	    Com_Error( com_error_code_t code, const char *format, ... );
+void		Com_SetThreadAbortFrame( jmp_buf *frame );
 void		Com_DeferQuit( void );
 void	    Com_Quit( void );
 
@@ -35,6 +35,9 @@ typedef struct qcondvar_s qcondvar_t;
 struct qbufPipe_s;
 typedef struct qbufPipe_s qbufPipe_t;
 
+struct qthreadpool_s;
+typedef struct qthreadpool_s qthreadpool_t;
+
 qmutex_t *QMutex_Create( void );
 void QMutex_Destroy( qmutex_t **pmutex );
 void QMutex_Lock( qmutex_t *mutex );
@@ -61,4 +64,10 @@ int QBufPipe_ReadCmds( qbufPipe_t *queue, unsigned( **cmdHandlers )(const void *
 void QBufPipe_Wait( qbufPipe_t *queue, int (*read)( qbufPipe_t *, unsigned( ** )(const void *), bool ), 
 	unsigned (**cmdHandlers)( const void * ), unsigned timeout_msec );
 
+qthreadpool_t *QThreadPool_Create( int numThreads );
+void QThreadPool_Destroy( qthreadpool_t **ppool );
+int QThreadPool_NumWorkers( qthreadpool_t *pool );
+bool QThreadPool_IsWorkerThread( void );
+void QThreadPool_Run( qthreadpool_t *pool, void (*job)( void *, int, int ), void *arg, int count );
+
 #endif // Q_THREADS_H
@@ -78,6 +78,41 @@ int SNAP_ReadDemoMessage( int demofile, msg_t *msg )
 	return read;
 }
 
+/*
+* SNAP_ReadDemoMessageChecked
+*
+* Like SNAP_ReadDemoMessage, but a message running past the end of the
+* file doesn't drop. Demos are gzipped, so the file length can't tell how
+* much is left and the bytes actually read are checked instead. Returns
+* -1 at the end of the demo and -2 if it is truncated or corrupt.
+*/
+int SNAP_ReadDemoMessageChecked( int demofile, msg_t *msg )
+{
+	int read, msglen = -1;
+
+	read = FS_Read( &msglen, 4, demofile );
+	if( read <= 0 )
+		return -1;
+	if( read != 4 )
+		return -2;
+
+	msglen = LittleLong( msglen );
+	if( msglen == -1 )
+		return -1;
+
+	if( msglen < 0 || msglen > MAX_MSGLEN || (size_t)msglen > msg->maxsize )
+		return -2;
+
+	read = FS_Read( msg->data, msglen, demofile );
+	if( read != msglen )
+		return -2;
+
+	msg->cursize = msglen;
+	msg->readcount = 0;
+
+	return read;
+}
+
 /*
 * SNAP_DemoMetaDataMessage
 */
@@ -416,3 +451,145 @@ size_t SNAP_ReadDemoMetaData( int demofile, char *meta_data, size_t meta_data_si
 
 	return meta_data_realsize;
 }
+
+/*
+============================================================================
+
+KEYFRAME INDEX
+
+Server demos are written with a nodelta frame every now and then. Their
+file offsets and server times are listed in an index file next to the demo,
+so that playback can seek straight to them in both directions. Each keyframe
+also carries the configstrings that changed since the previous one, as they
+are after its message, so that their state at any keyframe can be rebuilt.
+
+The index uses the same length prefixed messages as demos, holding:
+  byte DEMOINDEX_HEADER, long version
+  byte DEMOINDEX_KEYFRAME, long offset, long server time
+  byte DEMOINDEX_CONFIGSTRING, short index, string (for the last keyframe)
+
+Offsets are uncompressed positions in the demo, as FS_Seek takes them.
+
+============================================================================
+*/
+
+#define DEMOINDEX_VERSION		1
+
+#define DEMOINDEX_HEADER		1
+#define DEMOINDEX_KEYFRAME		2
+#define DEMOINDEX_CONFIGSTRING	3
+
+/*
+* SNAP_BeginDemoIndex
+*/
+void SNAP_BeginDemoIndex( int indexfile )
+{
+	msg_t msg;
+	uint8_t msg_buffer[16];
+
+	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
+
+	MSG_WriteByte( &msg, DEMOINDEX_HEADER );
+	MSG_WriteLong( &msg, DEMOINDEX_VERSION );
+
+	SNAP_RecordDemoMessage( indexfile, &msg, 0 );
+}
+
+/*
+* SNAP_RecordDemoKeyframe
+*
+* Adds the nodelta frame at offset to the index. indexconfigstrings holds the
+* configstrings as of the previous keyframe and is updated to the current ones.
+*/
+void SNAP_RecordDemoKeyframe( int indexfile, int offset, unsigned int serverTime, const char *configstrings, 
+							 char *indexconfigstrings )
+{
+	int i;
+	msg_t msg;
+	uint8_t msg_buffer[MAX_MSGLEN];
+	const char *configstring;
+	char *indexconfigstring;
+
+	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
+
+	MSG_WriteByte( &msg, DEMOINDEX_KEYFRAME );
+	MSG_WriteLong( &msg, offset );
+	MSG_WriteLong( &msg, serverTime );
+
+	for( i = 0; i < MAX_CONFIGSTRINGS; i++ )
+	{
+		configstring = configstrings + i * MAX_CONFIGSTRING_CHARS;
+		indexconfigstring = indexconfigstrings + i * MAX_CONFIGSTRING_CHARS;
+		if( !strcmp( configstring, indexconfigstring ) )
+			continue;
+
+		MSG_WriteByte( &msg, DEMOINDEX_CONFIGSTRING );
+		MSG_WriteShort( &msg, i );
+		MSG_WriteString( &msg, configstring );
+		Q_strncpyz( indexconfigstring, configstring, MAX_CONFIGSTRING_CHARS );
+
+		DEMO_SAFEWRITE( indexfile, &msg, false );
+	}
+
+	DEMO_SAFEWRITE( indexfile, &msg, true );
+}
+
+/*
+* SNAP_ReadDemoIndex
+*
+* Calls back for every keyframe and configstring in the index, in file order.
+* Returns false if the index is from another version or is cut short.
+*/
+bool SNAP_ReadDemoIndex( int indexfile, snap_demokeyframe_cb_t keyframe_cb, snap_democonfigstring_cb_t configstring_cb, 
+						void *arg )
+{
+	int read, cmd, index, offset;
+	unsigned int serverTime;
+	bool header;
+	msg_t msg;
+	static uint8_t msg_buffer[MAX_MSGLEN];
+
+	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
+
+	header = false;
+	offset = -1;
+	while( ( read = SNAP_ReadDemoMessageChecked( indexfile, &msg ) ) >= 0 )
+	{
+		while( ( cmd = MSG_ReadByte( &msg ) ) != -1 )
+		{
+			switch( cmd )
+			{
+			case DEMOINDEX_HEADER:
+				if( MSG_ReadLong( &msg ) != DEMOINDEX_VERSION )
+					return false;
+				header = true;
+				break;
+
+			case DEMOINDEX_KEYFRAME:
+				if( !header )
+					return false;
+				offset = MSG_ReadLong( &msg );
+				serverTime = (unsigned int)MSG_ReadLong( &msg );
+				keyframe_cb( offset, serverTime, arg );
+				break;
+
+			case DEMOINDEX_CONFIGSTRING:
+				if( offset < 0 )
+					return false;
+				index = MSG_ReadShort( &msg );
+				if( index < 0 || index >= MAX_CONFIGSTRINGS )
+					return false;
+				configstring_cb( offset, index, MSG_ReadString( &msg ), arg );
+				break;
+
+			default:
+				return false;
+			}
+
+			if( msg.readcount > msg.cursize )
+				return false;
+		}
+	}
+
+	return read == -1 && header;
+}
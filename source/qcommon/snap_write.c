@@ -19,9 +19,460 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 #include "qcommon.h"
+#include "sys_threads.h"
 
 #include "snap_write.h"
 
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) ) && !defined( SNAP_NO_SIMD )
+#define SNAP_USE_SSE2
+#endif
+
+#ifdef SNAP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+=========================================================================
+
+Entity delta bits shared between the clients
+
+=========================================================================
+*/
+
+// the entity states of a frame, one array per compared field so
+// that 4 entities can be checked at once. MAX_EDICTS must be a
+// multiple of 4.
+typedef struct
+{
+	float origin[3][MAX_EDICTS];
+	float velocity[3][MAX_EDICTS];      // linearMovementVelocity
+	float angles[3][MAX_EDICTS];
+	float origin2[3][MAX_EDICTS];
+	float attenuation[MAX_EDICTS];
+
+	int linearMovement[MAX_EDICTS];
+	int teleported[MAX_EDICTS];
+	int type[MAX_EDICTS];
+	int skinnum[MAX_EDICTS];
+	int frame[MAX_EDICTS];
+	int effects[MAX_EDICTS];
+	int solid[MAX_EDICTS];
+	int events[2][MAX_EDICTS];
+	int modelindex[MAX_EDICTS];
+	int modelindex2[MAX_EDICTS];
+	int sound[MAX_EDICTS];
+	int weapon[MAX_EDICTS];
+	int svflags[MAX_EDICTS];
+	int light[MAX_EDICTS];              // also linearMovementTimeStamp
+	int team[MAX_EDICTS];
+} snapEntityColumns_t;
+
+typedef struct snapDeltaCache_s
+{
+	bool valid;
+	ginfo_t *gi;
+	unsigned int frameNum;
+	int current;                        // index of the frameNum buffers
+
+	int numEntities[2];
+	entity_state_t states[2][MAX_EDICTS];   // as copied by SNAP_DumpClientFrameSnapList
+	snapEntityColumns_t columns[2];
+
+	int numBits;                        // 0 if the previous frame wasn't captured
+	int bits[MAX_EDICTS];               // from frameNum-1 to frameNum, see MSG_DeltaEntityBits
+} snapDeltaCache_t;
+
+/*
+* SNAP_CreateDeltaCache
+*/
+snapDeltaCache_t *SNAP_CreateDeltaCache( mempool_t *mempool )
+{
+	return Mem_Alloc( mempool, sizeof( snapDeltaCache_t ) );
+}
+
+/*
+* SNAP_DestroyDeltaCache
+*/
+void SNAP_DestroyDeltaCache( snapDeltaCache_t **pcache )
+{
+	assert( pcache != NULL );
+	if( !pcache || !*pcache )
+		return;
+
+	Mem_Free( *pcache );
+	*pcache = NULL;
+}
+
+/*
+* SNAP_StoreEntityColumns
+*/
+static void SNAP_StoreEntityColumns( snapEntityColumns_t *c, int i, const entity_state_t *state )
+{
+	int j;
+
+	for( j = 0; j < 3; j++ )
+	{
+		c->origin[j][i] = state->origin[j];
+		c->velocity[j][i] = state->linearMovementVelocity[j];
+		c->angles[j][i] = state->angles[j];
+		c->origin2[j][i] = state->origin2[j];
+	}
+	c->attenuation[i] = state->attenuation;
+
+	c->linearMovement[i] = state->linearMovement ? 1 : 0;
+	c->teleported[i] = state->teleported ? 1 : 0;
+	c->type[i] = state->type;
+	c->skinnum[i] = state->skinnum;
+	c->frame[i] = state->frame;
+	c->effects[i] = (int)state->effects;
+	c->solid[i] = state->solid;
+	c->events[0][i] = state->events[0];
+	c->events[1][i] = state->events[1];
+	c->modelindex[i] = (int)state->modelindex;
+	c->modelindex2[i] = (int)state->modelindex2;
+	c->sound[i] = state->sound;
+	c->weapon[i] = state->weapon;
+	c->svflags[i] = (int)state->svflags;
+	c->light[i] = state->light;
+	c->team[i] = state->team;
+}
+
+#ifdef SNAP_USE_SSE2
+
+/*
+* SNAP_NotEqualPS
+*/
+static inline __m128i SNAP_NotEqualPS( const float *a, const float *b )
+{
+	return _mm_castps_si128( _mm_cmpneq_ps( _mm_loadu_ps( a ), _mm_loadu_ps( b ) ) );
+}
+
+/*
+* SNAP_NonZeroEPI32
+*/
+static inline __m128i SNAP_NonZeroEPI32( __m128i v )
+{
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_andnot_si128( _mm_cmpeq_epi32( v, zero ), _mm_cmpeq_epi32( zero, zero ) );
+}
+
+/*
+* SNAP_NotEqualEPI32
+*/
+static inline __m128i SNAP_NotEqualEPI32( const int *a, const int *b )
+{
+	return SNAP_NonZeroEPI32( _mm_xor_si128( _mm_loadu_si128( (const __m128i *)a ), _mm_loadu_si128( (const __m128i *)b ) ) );
+}
+
+#define SNAP_SSE_SELECT( mask, a, b ) _mm_or_si128( _mm_and_si128( ( mask ), ( a ) ), _mm_andnot_si128( ( mask ), ( b ) ) )
+#define SNAP_SSE_BITS( mask, bits ) _mm_and_si128( ( mask ), _mm_set1_epi32( bits ) )
+
+/*
+* SNAP_ComputeDeltaBits
+*
+* The same tests as MSG_DeltaEntityBits, 4 entities at a time
+*/
+static void SNAP_ComputeDeltaBits( int *bits, const snapEntityColumns_t *to, const snapEntityColumns_t *from, int num )
+{
+	int i, j;
+	__m128i b, v, lm, lmChanged, changed, width;
+
+	for( i = 0; i < num; i += 4 )
+	{
+		v = _mm_add_epi32( _mm_set1_epi32( i ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+		b = SNAP_SSE_BITS( SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( 0xFF00 ) ) ), U_NUMBER16 );
+
+		lm = SNAP_NonZeroEPI32( _mm_loadu_si128( (const __m128i *)( to->linearMovement + i ) ) );
+		lmChanged = SNAP_NotEqualEPI32( to->linearMovement + i, from->linearMovement + i );
+
+		for( j = 0; j < 3; j++ )
+		{
+			changed = SNAP_SSE_SELECT( lm,
+				_mm_or_si128( SNAP_NotEqualPS( to->velocity[j] + i, from->velocity[j] + i ), lmChanged ),
+				SNAP_NotEqualPS( to->origin[j] + i, from->origin[j] + i ) );
+			b = _mm_or_si128( b, SNAP_SSE_BITS( changed, U_ORIGIN1 << j ) );
+		}
+
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualPS( to->angles[0] + i, from->angles[0] + i ), U_ANGLE1 ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualPS( to->angles[1] + i, from->angles[1] + i ), U_ANGLE2 ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualPS( to->angles[2] + i, from->angles[2] + i ), U_ANGLE3 ) );
+
+		v = _mm_loadu_si128( (const __m128i *)( to->skinnum + i ) );
+		width = SNAP_SSE_SELECT( SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( (int)0xFFFF0000 ) ) ), _mm_set1_epi32( U_SKIN8|U_SKIN16 ),
+			SNAP_SSE_SELECT( SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( 0xFF00 ) ) ), _mm_set1_epi32( U_SKIN16 ), _mm_set1_epi32( U_SKIN8 ) ) );
+		b = _mm_or_si128( b, _mm_and_si128( SNAP_NotEqualEPI32( to->skinnum + i, from->skinnum + i ), width ) );
+
+		v = _mm_loadu_si128( (const __m128i *)( to->frame + i ) );
+		width = SNAP_SSE_SELECT( SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( 0xFF00 ) ) ), _mm_set1_epi32( U_FRAME16 ), _mm_set1_epi32( U_FRAME8 ) );
+		b = _mm_or_si128( b, _mm_and_si128( SNAP_NotEqualEPI32( to->frame + i, from->frame + i ), width ) );
+
+		v = _mm_loadu_si128( (const __m128i *)( to->effects + i ) );
+		width = SNAP_SSE_SELECT( SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( (int)0xFFFF0000 ) ) ), _mm_set1_epi32( U_EFFECTS8|U_EFFECTS16 ),
+			SNAP_SSE_SELECT( SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( 0xFF00 ) ) ), _mm_set1_epi32( U_EFFECTS16 ), _mm_set1_epi32( U_EFFECTS8 ) ) );
+		b = _mm_or_si128( b, _mm_and_si128( SNAP_NotEqualEPI32( to->effects + i, from->effects + i ), width ) );
+
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->solid + i, from->solid + i ), U_SOLID ) );
+
+		// events are not delta compressed, just 0 compressed
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NonZeroEPI32( _mm_loadu_si128( (const __m128i *)( to->events[0] + i ) ) ), U_EVENT ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NonZeroEPI32( _mm_loadu_si128( (const __m128i *)( to->events[1] + i ) ) ), U_EVENT2 ) );
+
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->modelindex + i, from->modelindex + i ), U_MODEL ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->modelindex2 + i, from->modelindex2 + i ), U_MODEL2 ) );
+
+		changed = _mm_or_si128( SNAP_NotEqualEPI32( to->type + i, from->type + i ), lmChanged );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( changed, U_TYPE ) );
+
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->sound + i, from->sound + i ), U_SOUND ) );
+
+		// only for entities with SVF_TRANSMITORIGIN2, see SNAP_EmitPacketEntities
+		changed = _mm_or_si128( SNAP_NotEqualPS( to->origin2[0] + i, from->origin2[0] + i ), SNAP_NotEqualPS( to->origin2[1] + i, from->origin2[1] + i ) );
+		changed = _mm_or_si128( changed, SNAP_NotEqualPS( to->origin2[2] + i, from->origin2[2] + i ) );
+		changed = _mm_or_si128( changed, SNAP_NonZeroEPI32( _mm_loadu_si128( (const __m128i *)( to->teleported + i ) ) ) );
+		changed = _mm_or_si128( changed, lmChanged );
+		changed = _mm_or_si128( changed, SNAP_NotEqualEPI32( to->light + i, from->light + i ) );
+		v = _mm_loadu_si128( (const __m128i *)( to->svflags + i ) );
+		changed = _mm_and_si128( changed, SNAP_NonZeroEPI32( _mm_and_si128( v, _mm_set1_epi32( SVF_TRANSMITORIGIN2 ) ) ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( changed, U_OTHERORIGIN ) );
+
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualPS( to->attenuation + i, from->attenuation + i ), U_ATTENUATION ) );
+
+		changed = _mm_or_si128( SNAP_NotEqualEPI32( to->weapon + i, from->weapon + i ), SNAP_NotEqualEPI32( to->teleported + i, from->teleported + i ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( changed, U_WEAPON ) );
+
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->svflags + i, from->svflags + i ), U_SVFLAGS ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->light + i, from->light + i ), U_LIGHT ) );
+		b = _mm_or_si128( b, SNAP_SSE_BITS( SNAP_NotEqualEPI32( to->team + i, from->team + i ), U_TEAM ) );
+
+		_mm_storeu_si128( (__m128i *)( bits + i ), b );
+	}
+}
+
+#else
+
+/*
+* SNAP_ComputeDeltaBits
+*
+* The same tests as MSG_DeltaEntityBits, on the field arrays
+*/
+static void SNAP_ComputeDeltaBits( int *bits, const snapEntityColumns_t *to, const snapEntityColumns_t *from, int num )
+{
+	int i, j, b;
+	bool lmChanged;
+
+	for( i = 0; i < num; i++ )
+	{
+		b = ( i & 0xFF00 ) ? U_NUMBER16 : 0;
+
+		lmChanged = to->linearMovement[i] != from->linearMovement[i];
+		for( j = 0; j < 3; j++ )
+		{
+			if( to->linearMovement[i] ? ( to->velocity[j][i] != from->velocity[j][i] || lmChanged ) : to->origin[j][i] != from->origin[j][i] )
+				b |= U_ORIGIN1 << j;
+		}
+
+		if( to->angles[0][i] != from->angles[0][i] )
+			b |= U_ANGLE1;
+		if( to->angles[1][i] != from->angles[1][i] )
+			b |= U_ANGLE2;
+		if( to->angles[2][i] != from->angles[2][i] )
+			b |= U_ANGLE3;
+
+		if( to->skinnum[i] != from->skinnum[i] )
+			b |= ( to->skinnum[i] & 0xFFFF0000 ) ? ( U_SKIN8|U_SKIN16 ) : ( to->skinnum[i] & 0xFF00 ) ? U_SKIN16 : U_SKIN8;
+		if( to->frame[i] != from->frame[i] )
+			b |= ( to->frame[i] & 0xFF00 ) ? U_FRAME16 : U_FRAME8;
+		if( to->effects[i] != from->effects[i] )
+			b |= ( to->effects[i] & 0xFFFF0000 ) ? ( U_EFFECTS8|U_EFFECTS16 ) : ( to->effects[i] & 0xFF00 ) ? U_EFFECTS16 : U_EFFECTS8;
+
+		if( to->solid[i] != from->solid[i] )
+			b |= U_SOLID;
+
+		// events are not delta compressed, just 0 compressed
+		if( to->events[0][i] )
+			b |= U_EVENT;
+		if( to->events[1][i] )
+			b |= U_EVENT2;
+
+		if( to->modelindex[i] != from->modelindex[i] )
+			b |= U_MODEL;
+		if( to->modelindex2[i] != from->modelindex2[i] )
+			b |= U_MODEL2;
+		if( to->type[i] != from->type[i] || lmChanged )
+			b |= U_TYPE;
+		if( to->sound[i] != from->sound[i] )
+			b |= U_SOUND;
+
+		// only for entities with SVF_TRANSMITORIGIN2, see SNAP_EmitPacketEntities
+		if( to->svflags[i] & SVF_TRANSMITORIGIN2 )
+		{
+			if( to->origin2[0][i] != from->origin2[0][i] || to->origin2[1][i] != from->origin2[1][i] || to->origin2[2][i] != from->origin2[2][i]
+				|| to->teleported[i] || lmChanged || to->light[i] != from->light[i] )
+				b |= U_OTHERORIGIN;
+		}
+
+		if( to->attenuation[i] != from->attenuation[i] )
+			b |= U_ATTENUATION;
+		if( to->weapon[i] != from->weapon[i] || to->teleported[i] != from->teleported[i] )
+			b |= U_WEAPON;
+		if( to->svflags[i] != from->svflags[i] )
+			b |= U_SVFLAGS;
+		if( to->light[i] != from->light[i] )
+			b |= U_LIGHT;
+		if( to->team[i] != from->team[i] )
+			b |= U_TEAM;
+
+		bits[i] = b;
+	}
+}
+
+#endif
+
+/*
+* SNAP_UpdateDeltaCache
+*
+* Captures the entity states of the frame and computes the delta bits
+* from the previous one. Must be called before the client frames are
+* built, while the game isn't running.
+*/
+void SNAP_UpdateDeltaCache( snapDeltaCache_t *cache, ginfo_t *gi, unsigned int frameNum )
+{
+	int i, num, prev;
+	bool hasPrev;
+	edict_t *ent;
+	entity_state_t *state;
+
+	if( !cache )
+		return;
+	if( cache->valid && cache->gi == gi && cache->frameNum == frameNum )
+		return;
+
+	hasPrev = cache->valid && cache->gi == gi && cache->frameNum + 1 == frameNum;
+
+	prev = cache->current;
+	cache->current ^= 1;
+	cache->valid = true;
+	cache->gi = gi;
+	cache->frameNum = frameNum;
+
+	num = min( gi->num_edicts, MAX_EDICTS );
+	for( i = 0; i < num; i++ )
+	{
+		ent = EDICT_NUM( i );
+		state = &cache->states[cache->current][i];
+
+		// same as SNAP_DumpClientFrameSnapList
+		*state = ent->s;
+		state->number = i;
+		state->svflags = ent->r.svflags;
+		if( ent->r.svflags & SVF_PROJECTILE )
+			state->solid = 0;
+
+		SNAP_StoreEntityColumns( &cache->columns[cache->current], i, state );
+	}
+	cache->numEntities[cache->current] = num;
+
+	cache->numBits = 0;
+	if( hasPrev )
+	{
+		cache->numBits = min( num, cache->numEntities[prev] );
+		SNAP_ComputeDeltaBits( cache->bits, &cache->columns[cache->current], &cache->columns[prev], ( cache->numBits + 3 ) & ~3 );
+	}
+}
+
+/*
+* SNAP_DeltaCacheBits
+*
+* Returns the delta bits if they apply to the client's frames
+*/
+static const int *SNAP_DeltaCacheBits( snapDeltaCache_t *cache, ginfo_t *gi, unsigned int frameNum,
+	client_snapshot_t *from, client_snapshot_t *to, int *numBits )
+{
+	*numBits = 0;
+	if( !cache || !cache->valid || !cache->numBits || cache->gi != gi || cache->frameNum != frameNum )
+		return NULL;
+	if( !from || from->frameNum + 1 != frameNum || to->frameNum != frameNum )
+		return NULL;
+
+	*numBits = cache->numBits;
+	return cache->bits;
+}
+
+/*
+* SNAP_DeltaCacheBenchmark
+* 
+* Writes the delta of the last two captured frames for all entities,
+* once per client, comparing MSG_WriteDeltaEntity against the cached bits
+*/
+void SNAP_DeltaCacheBenchmark( snapDeltaCache_t *cache, int numClients, int iterations )
+{
+	int i, j, k, e, num, cur, prev;
+	size_t maxsize, sizes[2];
+	uint64_t start, elapsed[2];
+	uint8_t *data[2];
+	entity_state_t *from, *to;
+	msg_t msg;
+
+	if( !cache || !cache->numBits )
+	{
+		Com_Printf( "No entity deltas captured\n" );
+		return;
+	}
+
+	numClients = max( numClients, 1 );
+	iterations = max( iterations, 1 );
+
+	num = cache->numBits;
+	cur = cache->current;
+	prev = cur ^ 1;
+	from = cache->states[prev];
+	to = cache->states[cur];
+
+	// far more than the largest entity delta
+	maxsize = num * 128;
+	data[0] = Mem_TempMalloc( maxsize );
+	data[1] = Mem_TempMalloc( maxsize );
+
+	for( k = 0; k < 2; k++ )
+	{
+		start = Sys_Microseconds();
+		for( i = 0; i < iterations; i++ )
+		{
+			if( k )
+				SNAP_ComputeDeltaBits( cache->bits, &cache->columns[cur], &cache->columns[prev], ( num + 3 ) & ~3 );
+
+			for( j = 0; j < numClients; j++ )
+			{
+				MSG_Init( &msg, data[k], maxsize );
+				for( e = 1; e < num; e++ )
+				{
+					if( k )
+						MSG_WriteDeltaEntityBits( &to[e], cache->bits[e], &msg, false );
+					else
+						MSG_WriteDeltaEntity( &from[e], &to[e], &msg, false, ( to[e].svflags & SVF_TRANSMITORIGIN2 ) ? true : false );
+				}
+				sizes[k] = msg.cursize;
+			}
+		}
+		elapsed[k] = Sys_Microseconds() - start;
+	}
+
+	Com_Printf( "%i entities x %i clients x %i iterations\n", num - 1, numClients, iterations );
+	Com_Printf( "per client: %.3f ms\n", elapsed[0] / 1000.0 );
+#ifdef SNAP_USE_SSE2
+	Com_Printf( "cached (SSE2): %.3f ms\n", elapsed[1] / 1000.0 );
+#else
+	Com_Printf( "cached: %.3f ms\n", elapsed[1] / 1000.0 );
+#endif
+	if( sizes[0] != sizes[1] || memcmp( data[0], data[1], sizes[0] ) )
+		Com_Printf( "output differs: %i and %i bytes\n", (int)sizes[0], (int)sizes[1] );
+	else
+		Com_Printf( "output identical, %i bytes per client\n", (int)sizes[0] );
+
+	Mem_TempFree( data[1] );
+	Mem_TempFree( data[0] );
+}
+
 /*
 =========================================================================
 
@@ -35,7 +486,8 @@ Encode a client frame onto the network channel
 *
 * Writes a delta update of an entity_state_t list to the message.
 */
-static void SNAP_EmitPacketEntities( ginfo_t *gi, client_snapshot_t *from, client_snapshot_t *to, msg_t *msg, entity_state_t *baselines, entity_state_t *client_entities, int num_client_entities )
+static void SNAP_EmitPacketEntities( ginfo_t *gi, client_snapshot_t *from, client_snapshot_t *to, msg_t *msg, entity_state_t *baselines, entity_state_t *client_entities, int num_client_entities,
+	const int *deltabits, int numdeltabits )
 {
 	entity_state_t *oldent, *newent;
 	int oldindex, newindex;
@@ -83,7 +535,10 @@ static void SNAP_EmitPacketEntities( ginfo_t *gi, client_snapshot_t *from, clien
 			// in any bytes being emited if the entity has not changed at all
 			// note that players are always 'newentities', this updates their oldorigin always
 			// and prevents warping ( wsw : jal : I removed it from the players )
-			MSG_WriteDeltaEntity( oldent, newent, msg, false, ( ( EDICT_NUM( newent->number ) )->r.svflags & SVF_TRANSMITORIGIN2 ) ? true : false );
+			if( newnum < numdeltabits )
+				MSG_WriteDeltaEntityBits( newent, deltabits[newnum], msg, false );
+			else
+				MSG_WriteDeltaEntity( oldent, newent, msg, false, ( ( EDICT_NUM( newent->number ) )->r.svflags & SVF_TRANSMITORIGIN2 ) ? true : false );
 			oldindex++;
 			newindex++;
 			continue;
@@ -622,11 +1077,13 @@ static void SNAP_RelayMultiPOVCommands( ginfo_t *gi, client_t *client, msg_t *ms
 * SNAP_WriteFrameSnapToClient
 */
 void SNAP_WriteFrameSnapToClient( ginfo_t *gi, client_t *client, msg_t *msg, unsigned int frameNum, unsigned int gameTime,
-								 entity_state_t *baselines, client_entities_t *client_entities,
+								 entity_state_t *baselines, client_entities_t *client_entities, snapDeltaCache_t *deltacache,
 								 int numcmds, gcommand_t *commands, const char *commandsData )
 {
 	client_snapshot_t *frame, *oldframe;
 	int flags, i, index, pos, length, supcnt;
+	const int *deltabits;
+	int numdeltabits;
 
 	// this is the frame we are creating
 	frame = &client->snapShots[frameNum & UPDATE_MASK];
@@ -738,7 +1195,9 @@ void SNAP_WriteFrameSnapToClient( ginfo_t *gi, client_t *client, msg_t *msg, uns
 	MSG_WriteByte( msg, 0 );
 
 	// delta encode the entities
-	SNAP_EmitPacketEntities( gi, oldframe, frame, msg, baselines, client_entities ? client_entities->entities : NULL, client_entities ? client_entities->num_entities : 0 );
+	deltabits = SNAP_DeltaCacheBits( deltacache, gi, frameNum, oldframe, frame, &numdeltabits );
+	SNAP_EmitPacketEntities( gi, oldframe, frame, msg, baselines, client_entities ? client_entities->entities : NULL, client_entities ? client_entities->num_entities : 0,
+		deltabits, numdeltabits );
 
 	// write length into reserved space
 	length = msg->cursize - pos - 2;
@@ -799,20 +1258,12 @@ static bool SNAP_BitsCullEntity( cmodel_state_t *cms, edict_t *ent, uint8_t *bit
 
 //=====================================================================
 
-#define	MAX_SNAPSHOT_ENTITIES	1024
-typedef struct
-{
-	int numSnapshotEntities;
-	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
-	int entityAddedToSnapList[MAX_EDICTS];
-} snapshotEntityNumbers_t;
-
 /*
 * SNAP_AddEntNumToSnapList
 */
 static void SNAP_AddEntNumToSnapList( int entNum, snapshotEntityNumbers_t *entsList )
 {
-	if( entsList->numSnapshotEntities >= MAX_SNAPSHOT_ENTITIES )  // silent ignore of overflood
+	if( entsList->numSnapshotEntities >= SNAP_MAX_SNAPSHOT_ENTITIES )  // silent ignore of overflood
 		return;
 
 	// don't double add entities
@@ -839,38 +1290,43 @@ static void SNAP_SortSnapList( snapshotEntityNumbers_t *entsList )
 	}
 }
 
+// the client's attenuation settings in local games, copied on the main thread
+// by SNAP_UpdateSoundAttenuation so that snapshot workers never touch cvars
+static int snap_attenuation_model = S_DEFAULT_ATTENUATION_MODEL;
+static float snap_attenuation_maxdistance = S_DEFAULT_ATTENUATION_MAXDISTANCE;
+static float snap_attenuation_refdistance = S_DEFAULT_ATTENUATION_REFDISTANCE;
+
 /*
-* SNAP_GainForAttenuation
+* SNAP_UpdateSoundAttenuation
+*
+* Must be called from the main thread before the frame's snapshots are built
 */
-static float SNAP_GainForAttenuation( float dist, float attenuation )
+void SNAP_UpdateSoundAttenuation( void )
 {
-	int model = S_DEFAULT_ATTENUATION_MODEL;
-	float maxdistance = S_DEFAULT_ATTENUATION_MAXDISTANCE;
-	float refdistance = S_DEFAULT_ATTENUATION_REFDISTANCE;
-
 #if !defined(PUBLIC_BUILD) && !defined(DEDICATED_ONLY) && !defined(TV_SERVER_ONLY)
-#define DUMMY_CVAR ( cvar_t * )((void *)1)
-	static cvar_t *s_attenuation_model = DUMMY_CVAR;
-	static cvar_t *s_attenuation_maxdistance = DUMMY_CVAR;
-	static cvar_t *s_attenuation_refdistance = DUMMY_CVAR;
+	static cvar_t *s_attenuation_model, *s_attenuation_maxdistance, *s_attenuation_refdistance;
 
-	if( s_attenuation_model == DUMMY_CVAR )
+	// the sound system may register these after the server has started
+	if( !s_attenuation_model )
 		s_attenuation_model = Cvar_Find( "s_attenuation_model" );
-	if( s_attenuation_maxdistance == DUMMY_CVAR )
+	if( !s_attenuation_maxdistance )
 		s_attenuation_maxdistance = Cvar_Find( "s_attenuation_maxdistance" );
-	if( s_attenuation_refdistance == DUMMY_CVAR )
+	if( !s_attenuation_refdistance )
 		s_attenuation_refdistance = Cvar_Find( "s_attenuation_refdistance" );
 
-	if( s_attenuation_model && s_attenuation_model != DUMMY_CVAR )
-		model = s_attenuation_model->integer;
-	if( s_attenuation_maxdistance && s_attenuation_maxdistance != DUMMY_CVAR )
-		maxdistance = s_attenuation_maxdistance->value;
-	if( s_attenuation_refdistance && s_attenuation_refdistance != DUMMY_CVAR )
-		refdistance = s_attenuation_refdistance->value;
-#undef DUMMY_CVAR
+	snap_attenuation_model = s_attenuation_model ? s_attenuation_model->integer : S_DEFAULT_ATTENUATION_MODEL;
+	snap_attenuation_maxdistance = s_attenuation_maxdistance ? s_attenuation_maxdistance->value : S_DEFAULT_ATTENUATION_MAXDISTANCE;
+	snap_attenuation_refdistance = s_attenuation_refdistance ? s_attenuation_refdistance->value : S_DEFAULT_ATTENUATION_REFDISTANCE;
 #endif
+}
 
-	return Q_GainForAttenuation( model, maxdistance, refdistance, dist, attenuation );
+/*
+* SNAP_GainForAttenuation
+*/
+static float SNAP_GainForAttenuation( float dist, float attenuation )
+{
+	return Q_GainForAttenuation( snap_attenuation_model, snap_attenuation_maxdistance, snap_attenuation_refdistance, 
+		dist, attenuation );
 }
 
 /*
@@ -959,13 +1415,365 @@ static bool SNAP_SnapCullEntity( cmodel_state_t *cms, edict_t *ent, edict_t *cle
 	return snd_culled && SNAP_PVSCullEntity( cms, fatpvs, ent );	// cull by PVS
 }
 
+/*
+=============================================================================
+
+Per-frame visibility cache
+
+Most entities are culled by areaportals and PVS alone. Clients sharing the
+same merged visibility sets (same cluster, area and visible portals) get
+exactly the same set of such entities, so it is computed only once per frame
+for every distinct set. Entities depending on the client's team or number,
+or subject to sound attenuation culling, are still checked per client.
+
+=============================================================================
+*/
+
+#define SNAP_VISCACHE_MAX_ENTRIES	64
+
+typedef struct
+{
+	unsigned int hash;
+	int clientarea;
+	uint8_t *pvs;                       // [pvsbytes]
+	uint8_t *areabits;                  // [arearowbytes], row of clientarea
+	int numEntities;
+	int entities[MAX_EDICTS];
+} snapVisCacheEntry_t;
+
+typedef struct snapVisCache_s
+{
+	mempool_t *mempool;
+	qmutex_t *mutex;
+
+	bool valid;
+	unsigned int frameNum;
+	unsigned int timeStamp;
+	ginfo_t *gi;
+
+	int pvsbytes;
+	int arearowbytes;
+	int areabytes;
+	uint8_t *areabits;                  // [areabytes], shared areaportals matrix
+
+	int numPortals;
+	int portals[MAX_EDICTS];
+	int numSimple;
+	int simple[MAX_EDICTS];             // culled by areas and PVS only
+	int numComplex;
+	int complex[MAX_EDICTS];            // need per-client checks
+
+	int numEntries;
+	snapVisCacheEntry_t entries[SNAP_VISCACHE_MAX_ENTRIES];
+} snapVisCache_t;
+
+/*
+* SNAP_CreateVisCache
+*/
+snapVisCache_t *SNAP_CreateVisCache( mempool_t *mempool )
+{
+	snapVisCache_t *cache;
+
+	cache = Mem_Alloc( mempool, sizeof( *cache ) );
+	cache->mempool = mempool;
+	cache->mutex = QMutex_Create();
+	return cache;
+}
+
+/*
+* SNAP_FreeVisCacheBuffers
+*/
+static void SNAP_FreeVisCacheBuffers( snapVisCache_t *cache )
+{
+	int i;
+
+	for( i = 0; i < SNAP_VISCACHE_MAX_ENTRIES; i++ )
+	{
+		if( cache->entries[i].pvs )
+		{
+			Mem_Free( cache->entries[i].pvs );
+			cache->entries[i].pvs = NULL;
+			cache->entries[i].areabits = NULL;
+		}
+	}
+
+	if( cache->areabits )
+	{
+		Mem_Free( cache->areabits );
+		cache->areabits = NULL;
+	}
+
+	cache->pvsbytes = cache->arearowbytes = cache->areabytes = 0;
+}
+
+/*
+* SNAP_DestroyVisCache
+*/
+void SNAP_DestroyVisCache( snapVisCache_t **pcache )
+{
+	snapVisCache_t *cache;
+
+	assert( pcache != NULL );
+	if( !pcache || !*pcache )
+		return;
+
+	cache = *pcache;
+	*pcache = NULL;
+
+	SNAP_FreeVisCacheBuffers( cache );
+	QMutex_Destroy( &cache->mutex );
+	Mem_Free( cache );
+}
+
+/*
+* SNAP_IsSimpleVisEntity
+*
+* Returns true if only areaportals and PVS take part in the entity
+* culling, see SNAP_SnapCullEntity.
+*/
+static bool SNAP_IsSimpleVisEntity( edict_t *ent )
+{
+	if( ent->r.svflags & ( SVF_ONLYTEAM|SVF_ONLYOWNER|SVF_BROADCAST|SVF_FORCETEAM|SVF_SOUNDCULL ) )
+		return false;
+	if( ent->s.events[0] || ent->s.sound )
+		return false;
+	return true;
+}
+
+/*
+* SNAP_PrepareVisCache
+*
+* Sorts the entities into groups and grabs the areaportals state
+* the first time a snapshot is built for the frame. Must be
+* called with the cache mutex held.
+*/
+static void SNAP_PrepareVisCache( snapVisCache_t *cache, cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp )
+{
+	int i, entNum;
+	int pvsbytes, arearowbytes, areabytes;
+	edict_t *ent;
+
+	if( cache->valid && cache->frameNum == frameNum && cache->timeStamp == timeStamp && cache->gi == gi )
+		return;
+
+	cache->valid = true;
+	cache->frameNum = frameNum;
+	cache->timeStamp = timeStamp;
+	cache->gi = gi;
+	cache->numEntries = 0;
+
+	pvsbytes = CM_ClusterRowSize( cms );
+	arearowbytes = CM_AreaRowSize( cms );
+	areabytes = arearowbytes * CM_NumAreas( cms );
+	if( pvsbytes != cache->pvsbytes || arearowbytes != cache->arearowbytes || areabytes != cache->areabytes )
+	{
+		SNAP_FreeVisCacheBuffers( cache );
+
+		cache->pvsbytes = pvsbytes;
+		cache->arearowbytes = arearowbytes;
+		cache->areabytes = areabytes;
+		cache->areabits = Mem_Alloc( cache->mempool, max( areabytes, 1 ) );
+		for( i = 0; i < SNAP_VISCACHE_MAX_ENTRIES; i++ )
+		{
+			cache->entries[i].pvs = Mem_Alloc( cache->mempool, pvsbytes + arearowbytes );
+			cache->entries[i].areabits = cache->entries[i].pvs + pvsbytes;
+		}
+	}
+
+	CM_WriteAreaBits( cms, cache->areabits );
+
+	cache->numPortals = cache->numSimple = cache->numComplex = 0;
+	for( entNum = 1; entNum < gi->num_edicts; entNum++ )
+	{
+		ent = EDICT_NUM( entNum );
+
+		// fix number if broken
+		if( ent->s.number != entNum )
+		{
+			Com_Printf( "FIXING ENT->S.NUMBER: %i %i!!!\n", ent->s.number, entNum );
+			ent->s.number = entNum;
+		}
+
+		// make sure owner number is valid too
+		if( ( ent->r.svflags & SVF_FORCEOWNER ) && !( ent->s.ownerNum > 0 && ent->s.ownerNum < gi->num_edicts ) )
+		{
+			Com_Printf( "FIXING ENT->S.OWNERNUM: %i %i!!!\n", ent->s.type, ent->s.ownerNum );
+			ent->s.ownerNum = 0;
+		}
+
+		if( ent->r.svflags & SVF_PORTAL )
+			cache->portals[cache->numPortals++] = entNum;
+
+		if( ent->r.svflags & SVF_NOCLIENT )
+			continue;
+
+		if( SNAP_IsSimpleVisEntity( ent ) )
+			cache->simple[cache->numSimple++] = entNum;
+		else
+			cache->complex[cache->numComplex++] = entNum;
+	}
+}
+
+/*
+* SNAP_VisCacheHash
+*/
+static unsigned int SNAP_VisCacheHash( int clientarea, const uint8_t *pvs, int pvsbytes, const uint8_t *areabits, int arearowbytes )
+{
+	int i;
+	unsigned int hash = 2166136261u ^ (unsigned int)clientarea;
+
+	for( i = 0; i < pvsbytes; i++ )
+		hash = ( hash ^ pvs[i] ) * 16777619u;
+	for( i = 0; i < arearowbytes; i++ )
+		hash = ( hash ^ areabits[i] ) * 16777619u;
+	return hash;
+}
+
+/*
+* SNAP_CullSimpleVisEntities
+*
+* SNAP_SnapCullEntity for entities, which passed SNAP_IsSimpleVisEntity
+*/
+static int SNAP_CullSimpleVisEntities( cmodel_state_t *cms, ginfo_t *gi, snapVisCache_t *cache, client_snapshot_t *frame, uint8_t *fatpvs, int *entities )
+{
+	int i, numEntities;
+	edict_t *ent;
+	uint8_t *areabits;
+
+	areabits = frame->clientarea >= 0 ? frame->areabits + frame->clientarea * CM_AreaRowSize( cms ) : NULL;
+
+	numEntities = 0;
+	for( i = 0; i < cache->numSimple; i++ )
+	{
+		ent = EDICT_NUM( cache->simple[i] );
+
+		if( ent->r.areanum < 0 )
+			continue;
+		if( areabits )
+		{
+			if( !( areabits[ent->r.areanum>>3] & ( 1<<( ent->r.areanum&7 ) ) ) )
+			{
+				// doors can legally straddle two areas, so we may need to check another one
+				if( ent->r.areanum2 < 0 || !( areabits[ent->r.areanum2>>3] & ( 1<<( ent->r.areanum2&7 ) ) ) )
+					continue; // blocked by a door
+			}
+		}
+
+		if( SNAP_PVSCullEntity( cms, fatpvs, ent ) )
+			continue;
+
+		entities[numEntities++] = cache->simple[i];
+	}
+
+	return numEntities;
+}
+
+/*
+* SNAP_AddForcedOwnerToSnapList
+*/
+static void SNAP_AddForcedOwnerToSnapList( ginfo_t *gi, edict_t *ent, snapshotEntityNumbers_t *entsList )
+{
+	if( !( ent->r.svflags & SVF_FORCEOWNER ) )
+		return;
+	if( ent->s.ownerNum > 0 && ent->s.ownerNum < gi->num_edicts )
+		SNAP_AddEntNumToSnapList( ent->s.ownerNum, entsList );
+}
+
+/*
+* SNAP_AddVisCachedEntities
+*
+* The cached equivalent of the last pass of SNAP_BuildSnapEntitiesList
+*/
+static void SNAP_AddVisCachedEntities( cmodel_state_t *cms, ginfo_t *gi, snapVisCache_t *cache, edict_t *clent, vec3_t vieworg,
+									  uint8_t *fatpvs, client_snapshot_t *frame, snapshotEntityNumbers_t *entsList )
+{
+	int i, entNum;
+	int numEntities, *entities;
+	unsigned int hash;
+	uint8_t *areabits;
+	edict_t *ent;
+	snapVisCacheEntry_t *entry;
+	int culled[MAX_EDICTS];
+
+	areabits = frame->areabits + max( frame->clientarea, 0 ) * cache->arearowbytes;
+	hash = SNAP_VisCacheHash( frame->clientarea, fatpvs, cache->pvsbytes, areabits, cache->arearowbytes );
+
+	entry = NULL;
+	QMutex_Lock( cache->mutex );
+	for( i = 0; i < cache->numEntries; i++ )
+	{
+		if( cache->entries[i].hash == hash && cache->entries[i].clientarea == frame->clientarea &&
+			!memcmp( cache->entries[i].pvs, fatpvs, cache->pvsbytes ) &&
+			!memcmp( cache->entries[i].areabits, areabits, cache->arearowbytes ) )
+		{
+			entry = &cache->entries[i];
+			break;
+		}
+	}
+	QMutex_Unlock( cache->mutex );
+
+	// entries are never modified once published, until the next frame
+	if( entry )
+	{
+		numEntities = entry->numEntities;
+		entities = entry->entities;
+	}
+	else
+	{
+		numEntities = SNAP_CullSimpleVisEntities( cms, gi, cache, frame, fatpvs, culled );
+		entities = culled;
+
+		QMutex_Lock( cache->mutex );
+		if( cache->numEntries < SNAP_VISCACHE_MAX_ENTRIES )
+		{
+			entry = &cache->entries[cache->numEntries];
+			entry->hash = hash;
+			entry->clientarea = frame->clientarea;
+			memcpy( entry->pvs, fatpvs, cache->pvsbytes );
+			memcpy( entry->areabits, areabits, cache->arearowbytes );
+			entry->numEntities = numEntities;
+			memcpy( entry->entities, culled, numEntities * sizeof( *culled ) );
+			cache->numEntries++;
+		}
+		QMutex_Unlock( cache->mutex );
+	}
+
+	for( i = 0; i < numEntities; i++ )
+	{
+		SNAP_AddEntNumToSnapList( entities[i], entsList );
+		SNAP_AddForcedOwnerToSnapList( gi, EDICT_NUM( entities[i] ), entsList );
+	}
+
+	for( i = 0; i < cache->numComplex; i++ )
+	{
+		ent = EDICT_NUM( cache->complex[i] );
+		if( ent == clent || SNAP_SnapCullEntity( cms, ent, clent, frame, vieworg, fatpvs ) )
+			continue;
+
+		SNAP_AddEntNumToSnapList( cache->complex[i], entsList );
+		SNAP_AddForcedOwnerToSnapList( gi, ent, entsList );
+	}
+
+	// always add the client entity, even if SVF_NOCLIENT
+	if( clent )
+	{
+		entNum = NUM_FOR_EDICT( clent );
+		if( entNum > 0 && entNum < gi->num_edicts )
+		{
+			SNAP_AddEntNumToSnapList( entNum, entsList );
+			SNAP_AddForcedOwnerToSnapList( gi, clent, entsList );
+		}
+	}
+}
+
 /*
 * SNAP_BuildSnapEntitiesList
 */
-static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_t *clent, vec3_t vieworg, vec3_t skyorg, uint8_t *fatpvs, client_snapshot_t *frame, snapshotEntityNumbers_t *entsList )
+static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, edict_t *clent, vec3_t vieworg, vec3_t skyorg,
+									   uint8_t *fatpvs, snapVisCache_t *viscache, client_snapshot_t *frame, snapshotEntityNumbers_t *entsList )
 {
 	int leafnum = -1, clusternum = -1, clientarea = -1;
-	int entNum;
+	int i, entNum;
 	edict_t	*ent;
 
 	// find the client's PVS
@@ -981,7 +1789,23 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 	}
 
 	frame->clientarea = clientarea;
-	frame->areabytes = CM_WriteAreaBits( cms, frame->areabits );
+
+	// the cache doesn't help when sending the whole level
+	if( frame->allentities )
+		viscache = NULL;
+
+	if( viscache )
+	{
+		QMutex_Lock( viscache->mutex );
+		SNAP_PrepareVisCache( viscache, cms, gi, frameNum, frame->sentTimeStamp );
+		memcpy( frame->areabits, viscache->areabits, viscache->areabytes );
+		frame->areabytes = viscache->areabytes;
+		QMutex_Unlock( viscache->mutex );
+	}
+	else
+	{
+		frame->areabytes = CM_WriteAreaBits( cms, frame->areabits );
+	}
 
 	if( clent )
 	{
@@ -1010,10 +1834,11 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 		if( skyorg )
 			CM_MergeVisSets( cms, skyorg, fatpvs, frame->areabits + clientarea * CM_AreaRowSize( cms ) );
 
-		for( entNum = 1; entNum < gi->num_edicts; entNum++ )
+		for( i = 0; i < ( viscache ? viscache->numPortals : gi->num_edicts ); i++ )
 		{
+			entNum = viscache ? viscache->portals[i] : i;
 			ent = EDICT_NUM( entNum );
-			if( ent->r.svflags & SVF_PORTAL )
+			if( entNum > 0 && ( ent->r.svflags & SVF_PORTAL ) )
 			{
 				// merge visibility sets if portal
 				if( SNAP_SnapCullEntity( cms, ent, clent, frame, vieworg, fatpvs ) )
@@ -1025,6 +1850,13 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 		}
 	}
 
+	if( viscache )
+	{
+		SNAP_AddVisCachedEntities( cms, gi, viscache, clent, vieworg, fatpvs, frame, entsList );
+		SNAP_SortSnapList( entsList );
+		return;
+	}
+
 	// add the entities to the list
 	for( entNum = 1; entNum < gi->num_edicts; entNum++ )
 	{
@@ -1062,30 +1894,97 @@ static void SNAP_BuildSnapEntitiesList( cmodel_state_t *cms, ginfo_t *gi, edict_
 	SNAP_SortSnapList( entsList );
 }
 
+static volatile int snap_numFrames;          // client frames built
+static volatile int snap_numAllocations;     // frame storage allocations, see SNAP_AllocClientFrames
+
 /*
-* SNAP_BuildClientFrameSnap
+* SNAP_AllocClientFrames
+*
+* Carves the areabits and player states of all the client frames out of
+* a single block, sized for the map and the maximum number of players in
+* a frame. It is only reallocated when the map or the client change, so
+* building frames doesn't touch the allocator.
+*/
+static void SNAP_AllocClientFrames( cmodel_state_t *cms, ginfo_t *gi, client_t *client, mempool_t *mempool )
+{
+	int i, numareas, ps_size;
+	size_t areabytes, psbytes;
+	uint8_t *arena, *oldArena;
+	client_snapshot_t *frame;
+
+	numareas = CM_NumAreas( cms );
+	ps_size = client->mv ? gi->max_clients : 1;
+
+	if( client->snapArena && client->snapShots[0].numareas >= numareas && client->snapShots[0].ps_size >= ps_size )
+		return;
+
+	numareas = max( numareas, client->snapShots[0].numareas );
+	ps_size = max( ps_size, client->snapShots[0].ps_size );
+	areabytes = ALIGN( numareas * CM_AreaRowSize( cms ), 16 );
+	psbytes = sizeof( player_state_t ) * ps_size;
+
+	arena = ( uint8_t * )Mem_Alloc( mempool, ( psbytes + areabytes ) * UPDATE_BACKUP );
+
+	// keep whatever older frames are still to be delta compressed from
+	oldArena = client->snapArena;
+	for( i = 0; i < UPDATE_BACKUP; i++ )
+	{
+		player_state_t *ps = ( player_state_t * )( arena + psbytes * i );
+		uint8_t *areabits = arena + psbytes * UPDATE_BACKUP + areabytes * i;
+
+		frame = &client->snapShots[i];
+		if( oldArena )
+		{
+			memcpy( ps, frame->ps, sizeof( player_state_t ) * frame->ps_size );
+			memcpy( areabits, frame->areabits, frame->areabytes );
+		}
+
+		frame->ps = ps;
+		frame->ps_size = ps_size;
+		frame->areabits = areabits;
+		frame->numareas = numareas;
+	}
+
+	if( oldArena )
+		Mem_Free( oldArena );
+	client->snapArena = arena;
+
+	Sys_Atomic_Add( &snap_numAllocations, 1, NULL );
+}
+
+/*
+* SNAP_GetFrameStats
+*
+* Number of client frames built and allocations made to store them
+*/
+void SNAP_GetFrameStats( int *numFrames, int *numAllocations )
+{
+	*numFrames = snap_numFrames;
+	*numAllocations = snap_numAllocations;
+}
+
+/*
+* SNAP_BuildClientFrameSnapList
 *
 * Decides which entities are going to be visible to the client, and
-* copies off the playerstat and areabits.
+* copies off the playerstat and areabits. Returns false if the client
+* is not in game yet.
 */
-void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp,
-							   fatvis_t *fatvis, client_t *client,
-							   game_state_t *gameState, client_entities_t *client_entities,
-							   bool relay, mempool_t *mempool )
+bool SNAP_BuildClientFrameSnapList( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp,
+							   fatvis_t *fatvis, snapVisCache_t *viscache, client_t *client, game_state_t *gameState,
+							   bool relay, mempool_t *mempool, snapshotEntityNumbers_t *entsList )
 {
-	int e, i, ne;
+	int e, i;
 	vec3_t org;
 	edict_t	*ent, *clent;
 	client_snapshot_t *frame;
-	entity_state_t *state;
-	int numplayers, numareas;
-	snapshotEntityNumbers_t entsList;
+	int numplayers;
 
 	assert( gameState );
 
 	clent = client->edict;
 	if( clent && !clent->r.client )		// allow NULL ent for server record
-		return;		// not in game yet
+		return false;		// not in game yet
 
 	if( clent )
 	{
@@ -1115,21 +2014,6 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 		frame->allentities = false;
 	}
 
-	// areaportals matrix
-	numareas = CM_NumAreas( cms );
-	if( frame->numareas < numareas )
-	{
-		frame->numareas = numareas;
-
-		numareas *= CM_AreaRowSize( cms );
-		if( frame->areabits )
-		{
-			Mem_Free( frame->areabits );
-			frame->areabits = NULL;
-		}
-		frame->areabits = (uint8_t*)Mem_Alloc( mempool, numareas );
-	}
-
 	// grab the current player_state_t
 	if( frame->multipov )
 	{
@@ -1146,17 +2030,9 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 		frame->numplayers = 1;
 	}
 
-	if( frame->ps_size < frame->numplayers )
-	{
-		if( frame->ps )
-		{
-			Mem_Free( frame->ps );
-			frame->ps = NULL;
-		}
-
-		frame->ps = ( player_state_t* )Mem_Alloc( mempool, sizeof( player_state_t )*frame->numplayers );
-		frame->ps_size = frame->numplayers;
-	}
+	// areaportals matrix and player states, only allocated the first time
+	SNAP_AllocClientFrames( cms, gi, client, mempool );
+	assert( frame->ps_size >= frame->numplayers );
 
 	if( frame->multipov )
 	{
@@ -1180,37 +2056,58 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 
 	// build up the list of visible entities
 	//=============================
-	entsList.numSnapshotEntities = 0;
-	memset( entsList.entityAddedToSnapList, 0, sizeof( entsList.entityAddedToSnapList ) );
-	SNAP_BuildSnapEntitiesList( cms, gi, clent, org, fatvis->skyorg, fatvis->pvs, frame, &entsList );
+	entsList->numSnapshotEntities = 0;
+	memset( entsList->entityAddedToSnapList, 0, sizeof( entsList->entityAddedToSnapList ) );
+	SNAP_BuildSnapEntitiesList( cms, gi, frameNum, clent, org, fatvis->skyorg, fatvis->pvs, viscache, frame, entsList );
 
 	//Com_Printf( "Snap NumEntities:%i\n", entsList.numSnapshotEntities );
 
 	if( developer->integer )
 	{
 		int olde = -1;
-		for( e = 0; e < entsList.numSnapshotEntities; e++ )
+		for( e = 0; e < entsList->numSnapshotEntities; e++ )
 		{
-			if( olde >= entsList.snapshotEntities[e] )
+			if( olde >= entsList->snapshotEntities[e] )
 				Com_Printf( "WARNING 'SV_BuildClientFrameSnap': Unsorted entities list\n" );
-			olde = entsList.snapshotEntities[e];
+			olde = entsList->snapshotEntities[e];
 		}
 	}
 
 	// store current match state information
 	frame->gameState = *gameState;
 
-	//=============================
+	Sys_Atomic_Add( &snap_numFrames, 1, NULL );
+
+	return true;
+}
+
+/*
+* SNAP_DumpClientFrameSnapList
+*
+* Copies the entity states picked by SNAP_BuildClientFrameSnapList
+* to the circular client_entities array.
+*/
+void SNAP_DumpClientFrameSnapList( ginfo_t *gi, client_t *client, unsigned int frameNum,
+							   client_entities_t *client_entities, const snapshotEntityNumbers_t *entsList )
+{
+	int e, ne;
+	edict_t	*ent;
+	client_snapshot_t *frame;
+	entity_state_t *state;
+
+	// this is the frame we are creating
+	frame = &client->snapShots[frameNum & UPDATE_MASK];
 
 	// dump the entities list
 	ne = client_entities->next_entities;
 	frame->num_entities = 0;
 	frame->first_entity = ne;
+	frame->frameNum = frameNum;
 
-	for( e = 0; e < entsList.numSnapshotEntities; e++ )
+	for( e = 0; e < entsList->numSnapshotEntities; e++ )
 	{
 		// add it to the circular client_entities array
-		ent = EDICT_NUM( entsList.snapshotEntities[e] );
+		ent = EDICT_NUM( entsList->snapshotEntities[e] );
 		state = &client_entities->entities[ne%client_entities->num_entities];
 
 		*state = ent->s;
@@ -1228,25 +2125,19 @@ void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int f
 }
 
 /*
-* SNAP_FreeClientFrame
-*
-* Free structs and arrays we allocated in SNAP_BuildClientFrameSnap
+* SNAP_BuildClientFrameSnap
 */
-static void SNAP_FreeClientFrame( client_snapshot_t *frame )
+void SNAP_BuildClientFrameSnap( cmodel_state_t *cms, ginfo_t *gi, unsigned int frameNum, unsigned int timeStamp,
+							   fatvis_t *fatvis, snapVisCache_t *viscache, client_t *client,
+							   game_state_t *gameState, client_entities_t *client_entities,
+							   bool relay, mempool_t *mempool )
 {
-	if( frame->areabits )
-	{
-		Mem_Free( frame->areabits );
-		frame->areabits = NULL;
-	}
-	frame->numareas = 0;
+	snapshotEntityNumbers_t entsList;
 
-	if( frame->ps )
-	{
-		Mem_Free( frame->ps );
-		frame->ps = NULL;
-	}
-	frame->ps_size = 0;
+	if( !SNAP_BuildClientFrameSnapList( cms, gi, frameNum, timeStamp, fatvis, viscache, client, gameState, relay, mempool, &entsList ) )
+		return;
+
+	SNAP_DumpClientFrameSnapList( gi, client, frameNum, client_entities, &entsList );
 }
 
 /*
@@ -1261,6 +2152,15 @@ void SNAP_FreeClientFrames( client_t *client )
 	for( i = 0; i < UPDATE_BACKUP; i++ )
 	{
 		frame = &client->snapShots[i];
-		SNAP_FreeClientFrame( frame );
+		frame->areabits = NULL;
+		frame->numareas = 0;
+		frame->ps = NULL;
+		frame->ps_size = 0;
+	}
+
+	if( client->snapArena )
+	{
+		Mem_Free( client->snapArena );
+		client->snapArena = NULL;
 	}
 }
@@ -421,3 +421,217 @@ void QBufPipe_Wait( qbufPipe_t *pipe, int (*read)( qbufPipe_t *, unsigned( ** )(
 		}
 	}
 }
+
+// ============================================================================
+
+#define QTHREADPOOL_MAX_THREADS	32
+
+typedef struct
+{
+	struct qthreadpool_s *pool;
+	int num;
+} qthreadpoolworker_t;
+
+typedef struct qthreadpool_s
+{
+	int numThreads;
+	qthread_t *threads[QTHREADPOOL_MAX_THREADS];
+	qthreadpoolworker_t workers[QTHREADPOOL_MAX_THREADS];
+
+	qmutex_t *mutex;
+	qcondvar_t *wake_condvar;
+	qcondvar_t *done_condvar;
+
+	volatile int terminated;
+	volatile int generation;
+	volatile int busy;
+
+	void (*job)( void *, int, int );
+	void *arg;
+	int count;
+	volatile int next;
+} qthreadpool_t;
+
+static ATTRIBUTE_THREAD_LOCAL bool qthreadpool_isworker;
+
+/*
+* QThreadPool_RunJobs
+*
+* Grabs job indices until none are left.
+*/
+static void QThreadPool_RunJobs( qthreadpool_t *pool, int worker )
+{
+	int i;
+
+	while( true ) {
+		i = Sys_Atomic_Add( &pool->next, 1, pool->mutex );
+		if( i >= pool->count )
+			break;
+		pool->job( pool->arg, i, worker );
+	}
+}
+
+/*
+* QThreadPool_WorkerProc
+*/
+static void *QThreadPool_WorkerProc( void *param )
+{
+	qthreadpoolworker_t *worker = param;
+	qthreadpool_t *pool = worker->pool;
+	int generation = 0;
+
+	qthreadpool_isworker = true;
+
+	QMutex_Lock( pool->mutex );
+
+	while( true ) {
+		while( pool->generation == generation && !pool->terminated ) {
+			QCondVar_Wait( pool->wake_condvar, pool->mutex, Q_THREADS_WAIT_INFINITE );
+		}
+		if( pool->terminated ) {
+			break;
+		}
+		generation = pool->generation;
+
+		QMutex_Unlock( pool->mutex );
+
+		QThreadPool_RunJobs( pool, worker->num );
+
+		QMutex_Lock( pool->mutex );
+
+		pool->busy--;
+		if( !pool->busy ) {
+			QCondVar_Wake( pool->done_condvar );
+		}
+	}
+
+	QMutex_Unlock( pool->mutex );
+
+	return NULL;
+}
+
+/*
+* QThreadPool_Create
+*
+* Creates a pool of persistent worker threads. The thread calling
+* QThreadPool_Run participates in the work as well.
+*/
+qthreadpool_t *QThreadPool_Create( int numThreads )
+{
+	int i;
+	qthreadpool_t *pool;
+
+	clamp( numThreads, 0, QTHREADPOOL_MAX_THREADS );
+
+	pool = malloc( sizeof( *pool ) );
+	memset( pool, 0, sizeof( *pool ) );
+	pool->mutex = QMutex_Create();
+	pool->wake_condvar = QCondVar_Create();
+	pool->done_condvar = QCondVar_Create();
+
+	pool->numThreads = numThreads;
+	for( i = 0; i < numThreads; i++ ) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].num = i + 1;
+		pool->threads[i] = QThread_Create( QThreadPool_WorkerProc, &pool->workers[i] );
+	}
+
+	return pool;
+}
+
+/*
+* QThreadPool_Destroy
+*/
+void QThreadPool_Destroy( qthreadpool_t **ppool )
+{
+	int i;
+	qthreadpool_t *pool;
+
+	assert( ppool != NULL );
+	if( !ppool || !*ppool ) {
+		return;
+	}
+
+	pool = *ppool;
+	*ppool = NULL;
+
+	QMutex_Lock( pool->mutex );
+	pool->terminated = 1;
+	for( i = 0; i < pool->numThreads; i++ ) {
+		QCondVar_Wake( pool->wake_condvar );
+	}
+	QMutex_Unlock( pool->mutex );
+
+	for( i = 0; i < pool->numThreads; i++ ) {
+		QThread_Join( pool->threads[i] );
+	}
+
+	QCondVar_Destroy( &pool->done_condvar );
+	QCondVar_Destroy( &pool->wake_condvar );
+	QMutex_Destroy( &pool->mutex );
+	free( pool );
+}
+
+/*
+* QThreadPool_NumWorkers
+*
+* Returns the number of distinct worker indices passed to jobs,
+* including the calling thread, which always gets index 0.
+*/
+int QThreadPool_NumWorkers( qthreadpool_t *pool )
+{
+	return pool ? pool->numThreads + 1 : 1;
+}
+
+/*
+* QThreadPool_IsWorkerThread
+*
+* True when called from one of the threads owned by a pool,
+* false on the thread calling QThreadPool_Run.
+*/
+bool QThreadPool_IsWorkerThread( void )
+{
+	return qthreadpool_isworker;
+}
+
+/*
+* QThreadPool_Run
+*
+* Calls job( arg, index, worker ) for every index in [0, count) and blocks
+* until all of them have completed. The order of execution is undefined.
+*/
+void QThreadPool_Run( qthreadpool_t *pool, void (*job)( void *, int, int ), void *arg, int count )
+{
+	int i;
+
+	if( count <= 0 ) {
+		return;
+	}
+
+	if( !pool || !pool->numThreads || count == 1 ) {
+		for( i = 0; i < count; i++ ) {
+			job( arg, i, 0 );
+		}
+		return;
+	}
+
+	QMutex_Lock( pool->mutex );
+	pool->job = job;
+	pool->arg = arg;
+	pool->count = count;
+	pool->next = 0;
+	pool->busy = pool->numThreads;
+	pool->generation++;
+	for( i = 0; i < pool->numThreads; i++ ) {
+		QCondVar_Wake( pool->wake_condvar );
+	}
+	QMutex_Unlock( pool->mutex );
+
+	QThreadPool_RunJobs( pool, 0 );
+
+	QMutex_Lock( pool->mutex );
+	while( pool->busy > 0 ) {
+		QCondVar_Wait( pool->done_condvar, pool->mutex, Q_THREADS_WAIT_INFINITE );
+	}
+	QMutex_Unlock( pool->mutex );
+}
@@ -366,6 +366,8 @@ extern cvar_t *r_subdivisions;
 extern cvar_t *r_showtris;
 extern cvar_t *r_shownormals;
 extern cvar_t *r_draworder;
+extern cvar_t *r_sortincremental;
+extern cvar_t *r_skmsimd;
 extern cvar_t *r_leafvis;
 
 extern cvar_t *r_fastsky;
@@ -659,6 +661,7 @@ vboSlice_t *R_GetVBOSlice( unsigned int index );
 void R_InitDrawLists( void );
 
 void R_SortDrawList( drawList_t *list );
+void R_SortBench_f( void );
 void R_DrawSurfaces( drawList_t *list );
 void R_DrawOutlinedSurfaces( drawList_t *list );
 
@@ -751,6 +754,7 @@ bool		R_SkeletalModelLerpTag( orientation_t *orient, const mskmodel_t *skmodel,
 
 void		R_InitSkeletalCache( void );
 void		R_ClearSkeletalCache( void );
+void		R_SkeletalBench_f( void );
 void		R_ShutdownSkeletalCache( void );
 
 //
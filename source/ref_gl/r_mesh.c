@@ -27,6 +27,19 @@ drawList_t r_shadowlist;
 drawList_t r_portalmasklist;
 drawList_t r_portallist, r_skyportallist;
 
+typedef struct
+{
+	uint64_t			key;
+	unsigned int		index;
+} drawSurfKey_t;
+
+// scratch buffers shared by all draw lists, sorting only happens on the render thread
+static unsigned int r_maxSortSurfs;
+static drawSurfKey_t *r_sortKeys, *r_sortKeysTemp;
+static sortedDrawSurf_t *r_sortDrawSurfs;
+
+static int r_sortBenchIterations;
+
 /*
 * R_InitDrawList
 */
@@ -45,6 +58,12 @@ void R_InitDrawLists( void )
 	R_InitDrawList( &r_portallist );
 	R_InitDrawList( &r_skyportallist );
 	R_InitDrawList( &r_shadowlist );
+
+	// the memory pool has been freed, if there was one
+	r_maxSortSurfs = 0;
+	r_sortKeys = r_sortKeysTemp = NULL;
+	r_sortDrawSurfs = NULL;
+	r_sortBenchIterations = 0;
 }
 
 /*
@@ -239,7 +258,7 @@ void R_UpdateDrawListSurf( void *psds, unsigned order )
 /*
 * R_DrawSurfCompare
 *
-* Comparison callback function for R_SortDrawList
+* Comparison callback function for qsort, only used by the sorting benchmark
 */
 static int R_DrawSurfCompare( const sortedDrawSurf_t *sbs1, const sortedDrawSurf_t *sbs2 )
 {
@@ -256,20 +275,307 @@ static int R_DrawSurfCompare( const sortedDrawSurf_t *sbs1, const sortedDrawSurf
 	return 0;
 }
 
+/*
+* R_PackDrawSurfKey
+*
+* Combines the keys from R_PackDistKey and R_PackSortKey into a single
+* integer which orders the same way R_DrawSurfCompare does.
+*/
+static inline uint64_t R_PackDrawSurfKey( const sortedDrawSurf_t *sds )
+{
+	return ( (uint64_t)sds->distKey << 32 ) | sds->sortKey;
+}
+
+/*
+* R_ReserveSortBuffers
+*/
+static void R_ReserveSortBuffers( unsigned int numSurfs )
+{
+	if( numSurfs <= r_maxSortSurfs ) {
+		return;
+	}
+
+	if( r_sortKeys ) {
+		R_Free( r_sortKeys );
+		R_Free( r_sortKeysTemp );
+		R_Free( r_sortDrawSurfs );
+	}
+
+	r_maxSortSurfs = max( numSurfs, r_maxSortSurfs * 2 );
+	r_sortKeys = R_Malloc( r_maxSortSurfs * sizeof( drawSurfKey_t ) );
+	r_sortKeysTemp = R_Malloc( r_maxSortSurfs * sizeof( drawSurfKey_t ) );
+	r_sortDrawSurfs = R_Malloc( r_maxSortSurfs * sizeof( sortedDrawSurf_t ) );
+}
+
+/*
+* R_InsertionSortDrawSurfKeys
+*
+* Sorts keys in place, giving up when more than maxMoves elements had to be shifted.
+* Returns false in the latter case, leaving the keys partially sorted.
+*/
+static bool R_InsertionSortDrawSurfKeys( drawSurfKey_t *keys, unsigned int numKeys, unsigned int maxMoves )
+{
+	unsigned int i, j;
+	unsigned int moves = 0;
+	drawSurfKey_t k;
+
+	for( i = 1; i < numKeys; i++ ) {
+		if( keys[i-1].key <= keys[i].key ) {
+			continue;
+		}
+
+		k = keys[i];
+		for( j = i; j > 0 && keys[j-1].key > k.key; j-- ) {
+			keys[j] = keys[j-1];
+		}
+		keys[j] = k;
+
+		moves += i - j;
+		if( moves > maxMoves ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+* R_RadixSortDrawSurfKeys
+*
+* Stable LSD radix sort, one byte per pass. Passes in which all keys share the same
+* byte value are skipped, which is the case for most of the high bits in practice.
+* Returns the buffer that holds the sorted keys, either keys or temp.
+*/
+static drawSurfKey_t *R_RadixSortDrawSurfKeys( drawSurfKey_t *keys, drawSurfKey_t *temp, unsigned int numKeys )
+{
+	unsigned int i, pass;
+	unsigned int counts[8][256];
+	drawSurfKey_t *src = keys, *dst = temp, *swap;
+
+	if( numKeys < 32 ) {
+		R_InsertionSortDrawSurfKeys( keys, numKeys, UINT_MAX );
+		return keys;
+	}
+
+	memset( counts, 0, sizeof( counts ) );
+	for( i = 0; i < numKeys; i++ ) {
+		uint64_t key = keys[i].key;
+		for( pass = 0; pass < 8; pass++ ) {
+			counts[pass][( key >> ( pass << 3 ) ) & 0xFF]++;
+		}
+	}
+
+	for( pass = 0; pass < 8; pass++ ) {
+		unsigned int *count = counts[pass];
+		unsigned int shift = pass << 3;
+		unsigned int offset, c;
+
+		if( count[( src[0].key >> shift ) & 0xFF] == numKeys ) {
+			continue;
+		}
+
+		// turn the histogram into starting offsets
+		for( i = 0, offset = 0; i < 256; i++ ) {
+			c = count[i];
+			count[i] = offset;
+			offset += c;
+		}
+
+		for( i = 0; i < numKeys; i++ ) {
+			dst[count[( src[i].key >> shift ) & 0xFF]++] = src[i];
+		}
+
+		swap = src; src = dst; dst = swap;
+	}
+
+	return src;
+}
+
+/*
+* R_SortDrawSurfs
+*
+* Fills keys with the sorted order of drawSurfs and returns the buffer holding it. If order
+* is not NULL, it's tried as a starting point first, sorting the surfaces in the order from
+* the previous frame only needs a few moves when the visible set has barely changed.
+*/
+static drawSurfKey_t *R_SortDrawSurfs( const sortedDrawSurf_t *drawSurfs, unsigned int numDrawSurfs, 
+	const unsigned int *order, drawSurfKey_t *keys, drawSurfKey_t *temp )
+{
+	unsigned int i;
+
+	if( order ) {
+		for( i = 0; i < numDrawSurfs; i++ ) {
+			keys[i].key = R_PackDrawSurfKey( drawSurfs + order[i] );
+			keys[i].index = order[i];
+		}
+		if( R_InsertionSortDrawSurfKeys( keys, numDrawSurfs, numDrawSurfs / 4 + 32 ) ) {
+			return keys;
+		}
+	}
+
+	for( i = 0; i < numDrawSurfs; i++ ) {
+		keys[i].key = R_PackDrawSurfKey( drawSurfs + i );
+		keys[i].index = i;
+	}
+	return R_RadixSortDrawSurfKeys( keys, temp, numDrawSurfs );
+}
+
+/*
+* R_ApplyDrawSurfOrder
+*/
+static void R_ApplyDrawSurfOrder( sortedDrawSurf_t *drawSurfs, unsigned int numDrawSurfs, 
+	const drawSurfKey_t *keys, sortedDrawSurf_t *temp )
+{
+	unsigned int i;
+
+	for( i = 0; i < numDrawSurfs; i++ ) {
+		temp[i] = drawSurfs[keys[i].index];
+	}
+	memcpy( drawSurfs, temp, numDrawSurfs * sizeof( sortedDrawSurf_t ) );
+}
+
+/*
+* R_BenchDrawList
+*
+* Times different sorting methods on a copy of the list, nothing is sent to the GPU.
+*/
+static void R_BenchDrawList( const drawList_t *list, int iterations )
+{
+	int i;
+	unsigned int j;
+	unsigned int numDrawSurfs = list->numDrawSurfs;
+	size_t size = numDrawSurfs * sizeof( sortedDrawSurf_t );
+	sortedDrawSurf_t *copy;
+	drawSurfKey_t *sorted;
+	unsigned int *order;
+	uint64_t start, qsortTime, radixTime, incrementalTime;
+	bool identical = true;
+
+	if( !numDrawSurfs ) {
+		Com_Printf( "sortbench: the draw list is empty\n" );
+		return;
+	}
+
+	copy = R_Malloc( size * 2 );
+	order = R_Malloc( numDrawSurfs * sizeof( *order ) );
+
+	start = ri.Sys_Microseconds();
+	for( i = 0; i < iterations; i++ ) {
+		memcpy( copy, list->drawSurfs, size );
+		qsort( copy, numDrawSurfs, sizeof( sortedDrawSurf_t ), 
+			(int (*)(const void *, const void *))R_DrawSurfCompare );
+	}
+	qsortTime = ri.Sys_Microseconds() - start;
+
+	// the order the incremental sort starts from
+	memcpy( copy + numDrawSurfs, list->drawSurfs, size );
+	sorted = R_SortDrawSurfs( copy + numDrawSurfs, numDrawSurfs, NULL, r_sortKeys, r_sortKeysTemp );
+	for( j = 0; j < numDrawSurfs; j++ ) {
+		order[j] = sorted[j].index;
+	}
+
+	start = ri.Sys_Microseconds();
+	for( i = 0; i < iterations; i++ ) {
+		memcpy( copy + numDrawSurfs, list->drawSurfs, size );
+		sorted = R_SortDrawSurfs( copy + numDrawSurfs, numDrawSurfs, NULL, r_sortKeys, r_sortKeysTemp );
+		R_ApplyDrawSurfOrder( copy + numDrawSurfs, numDrawSurfs, sorted, r_sortDrawSurfs );
+	}
+	radixTime = ri.Sys_Microseconds() - start;
+
+	for( j = 0; j < numDrawSurfs; j++ ) {
+		if( R_PackDrawSurfKey( copy + j ) != R_PackDrawSurfKey( copy + numDrawSurfs + j ) ) {
+			identical = false;
+			break;
+		}
+	}
+
+	// resort an unchanged list, starting from the previous order
+	start = ri.Sys_Microseconds();
+	for( i = 0; i < iterations; i++ ) {
+		memcpy( copy + numDrawSurfs, list->drawSurfs, size );
+		sorted = R_SortDrawSurfs( copy + numDrawSurfs, numDrawSurfs, order, r_sortKeys, r_sortKeysTemp );
+		R_ApplyDrawSurfOrder( copy + numDrawSurfs, numDrawSurfs, sorted, r_sortDrawSurfs );
+	}
+	incrementalTime = ri.Sys_Microseconds() - start;
+
+	Com_Printf( "sortbench: %u surfaces, %i iterations%s\n", numDrawSurfs, iterations, 
+		identical ? "" : S_COLOR_RED " (radix sort order mismatch)" );
+	Com_Printf( "qsort: %.2f usec\n", (double)qsortTime / iterations );
+	Com_Printf( "radix: %.2f usec\n", (double)radixTime / iterations );
+	Com_Printf( "incremental: %.2f usec\n", (double)incrementalTime / iterations );
+
+	R_Free( order );
+	R_Free( copy );
+}
+
+/*
+* R_SortBench_f
+*
+* Captures the next world draw list and benchmarks sorting it.
+*/
+void R_SortBench_f( void )
+{
+	int iterations = 1000;
+
+	if( ri.Cmd_Argc() > 1 ) {
+		iterations = max( atoi( ri.Cmd_Argv( 1 ) ), 1 );
+	}
+	r_sortBenchIterations = iterations;
+}
+
 /*
 * R_SortDrawList
 *
-* Regular quicksort. Note that for all kinds of transparent meshes
-* you probably want to set distance or draw order to prevent flickering
-* due to quicksort's unstable nature.
+* Radix sort on the packed 64-bit key. With r_sortincremental, the permutation
+* from the previous sort of the same list is tried first.
 */
 void R_SortDrawList( drawList_t *list )
 {
+	unsigned int i;
+	unsigned int numDrawSurfs = list->numDrawSurfs;
+	const unsigned int *order = NULL;
+	drawSurfKey_t *sorted;
+
 	if( r_draworder->integer ) {
 		return;
 	}
-	qsort( list->drawSurfs, list->numDrawSurfs, sizeof( sortedDrawSurf_t ), 
-		(int (*)(const void *, const void *))R_DrawSurfCompare );
+
+	R_ReserveSortBuffers( numDrawSurfs );
+
+	if( r_sortBenchIterations && list == &r_worldlist && !( rn.renderFlags & RF_NONVIEWERREF ) ) {
+		R_BenchDrawList( list, r_sortBenchIterations );
+		r_sortBenchIterations = 0;
+	}
+
+	if( numDrawSurfs < 2 ) {
+		list->numDrawOrder = 0;
+		return;
+	}
+
+	if( r_sortincremental->integer && list->numDrawOrder == numDrawSurfs ) {
+		order = list->drawOrder;
+	}
+
+	sorted = R_SortDrawSurfs( list->drawSurfs, numDrawSurfs, order, r_sortKeys, r_sortKeysTemp );
+	R_ApplyDrawSurfOrder( list->drawSurfs, numDrawSurfs, sorted, r_sortDrawSurfs );
+
+	if( !r_sortincremental->integer ) {
+		list->numDrawOrder = 0;
+		return;
+	}
+
+	if( numDrawSurfs > list->maxDrawOrder ) {
+		if( list->drawOrder ) {
+			R_Free( list->drawOrder );
+		}
+		list->maxDrawOrder = max( numDrawSurfs, list->maxDrawSurfs );
+		list->drawOrder = R_Malloc( list->maxDrawOrder * sizeof( *list->drawOrder ) );
+	}
+
+	for( i = 0; i < numDrawSurfs; i++ ) {
+		list->drawOrder[i] = sorted[i].index;
+	}
+	list->numDrawOrder = numDrawSurfs;
 }
 
 /*
@@ -62,6 +62,9 @@ typedef struct
 	unsigned int		numDrawSurfs, maxDrawSurfs;
 	sortedDrawSurf_t	*drawSurfs;
 
+	unsigned int		numDrawOrder, maxDrawOrder;
+	unsigned int		*drawOrder;			// permutation applied by the last sort, used by r_sortincremental
+
 	unsigned int		maxVboSlices;
 	vboSlice_t			*vboSlices;
 
@@ -49,6 +49,8 @@ cvar_t *r_subdivisions;
 cvar_t *r_showtris;
 cvar_t *r_shownormals;
 cvar_t *r_draworder;
+cvar_t *r_sortincremental;
+cvar_t *r_skmsimd;
 cvar_t *r_leafvis;
 
 cvar_t *r_fastsky;
@@ -1045,6 +1047,8 @@ static void R_Register( const char *screenshotsPrefix )
 	r_subdivisions = ri.Cvar_Get( "r_subdivisions", STR_TOSTR( SUBDIVISIONS_DEFAULT ), CVAR_ARCHIVE|CVAR_LATCH_VIDEO );
 	r_shownormals = ri.Cvar_Get( "r_shownormals", "0", CVAR_CHEAT );
 	r_draworder = ri.Cvar_Get( "r_draworder", "0", CVAR_CHEAT );
+	r_sortincremental = ri.Cvar_Get( "r_sortincremental", "1", CVAR_ARCHIVE );
+	r_skmsimd = ri.Cvar_Get( "r_skmsimd", "1", CVAR_ARCHIVE );
 
 	r_fastsky = ri.Cvar_Get( "r_fastsky", "0", CVAR_ARCHIVE );
 	r_portalonly = ri.Cvar_Get( "r_portalonly", "0", 0 );
@@ -1147,6 +1151,8 @@ static void R_Register( const char *screenshotsPrefix )
 	ri.Cmd_AddCommand( "gfxinfo", R_GfxInfo_f );
 	ri.Cmd_AddCommand( "glslprogramlist", RP_ProgramList_f );
 	ri.Cmd_AddCommand( "cinlist", R_CinList_f );
+	ri.Cmd_AddCommand( "sortbench", R_SortBench_f );
+	ri.Cmd_AddCommand( "skmbench", R_SkeletalBench_f );
 }
 
 /*
@@ -1517,6 +1523,8 @@ void R_Shutdown( bool verbose )
 	ri.Cmd_RemoveCommand( "shaderlist" );
 	ri.Cmd_RemoveCommand( "glslprogramlist" );
 	ri.Cmd_RemoveCommand( "cinlist" );
+	ri.Cmd_RemoveCommand( "sortbench" );
+	ri.Cmd_RemoveCommand( "skmbench" );
 
 	// free shaders, models, etc.
 
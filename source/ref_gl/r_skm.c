@@ -23,6 +23,19 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "r_local.h"
 #include "iqm.h"
 
+// transform 4 components of a vertex or 4 floats of a pose row at once
+#if ( defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 ) ) && !defined( SKM_NO_SIMD )
+#define SKM_USE_SSE
+#include <xmmintrin.h>
+#elif ( defined( __ARM_NEON ) || defined( __ARM_NEON__ ) ) && !defined( SKM_NO_SIMD )
+#define SKM_USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined( SKM_USE_SSE ) || defined( SKM_USE_NEON )
+#define SKM_USE_SIMD
+#endif
+
 // typedefs
 typedef struct iqmheader iqmheader_t;
 typedef struct iqmvertexarray iqmvertexarray_t;
@@ -1057,9 +1070,9 @@ void R_ShutdownSkeletalCache( void )
 #endif
 
 /*
-* R_SkeletalBlendPoses
+* R_SkeletalBlendPoses_C
 */
-static void R_SkeletalBlendPoses( unsigned int numblends, mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose )
+static void R_SkeletalBlendPoses_C( unsigned int numblends, mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose )
 {
 	unsigned int i, j, k;
 	float *pose;
@@ -1091,9 +1104,9 @@ static void R_SkeletalBlendPoses( unsigned int numblends, mskblend_t *blends, un
 }
 
 /*
-* R_SkeletalTransformVerts
+* R_SkeletalTransformVerts_C
 */
-static void R_SkeletalTransformVerts( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+static void R_SkeletalTransformVerts_C( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
 {
 	const float *pose;
 
@@ -1108,9 +1121,9 @@ static void R_SkeletalTransformVerts( int numverts, const unsigned int *blends,
 }
 
 /*
-* R_SkeletalTransformNormals
+* R_SkeletalTransformNormals_C
 */
-static void R_SkeletalTransformNormals( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+static void R_SkeletalTransformNormals_C( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
 {
 	const float *pose;
 
@@ -1125,9 +1138,9 @@ static void R_SkeletalTransformNormals( int numverts, const unsigned int *blends
 }
 
 /*
-* R_SkeletalTransformNormalsAndSVecs
+* R_SkeletalTransformNormalsAndSVecs_C
 */
-static void R_SkeletalTransformNormalsAndSVecs( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv )
+static void R_SkeletalTransformNormalsAndSVecs_C( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv )
 {
 	const float *pose;
 
@@ -1146,6 +1159,192 @@ static void R_SkeletalTransformNormalsAndSVecs( int numverts, const unsigned int
 	}
 }
 
+#ifdef SKM_USE_SIMD
+
+#ifdef SKM_USE_SSE
+typedef __m128 skmvec_t;
+#define SKM_Load( p )				_mm_loadu_ps( p )
+#define SKM_Store( p, v )			_mm_storeu_ps( ( p ), ( v ) )
+#define SKM_Splat( f )				_mm_set1_ps( f )
+#define SKM_Mul( a, b )				_mm_mul_ps( ( a ), ( b ) )
+#define SKM_MulAdd( a, b, c )		_mm_add_ps( _mm_mul_ps( ( a ), ( b ) ), ( c ) )
+#define SKM_SetW( v, w )			_mm_or_ps( _mm_and_ps( ( v ), skm_xyzmask ), _mm_set_ps( ( w ), 0, 0, 0 ) )
+
+static const union { unsigned int u[4]; __m128 v; } skm_xyzmask_u = { { ~0u, ~0u, ~0u, 0 } };
+#define skm_xyzmask					skm_xyzmask_u.v
+#else
+typedef float32x4_t skmvec_t;
+#define SKM_Load( p )				vld1q_f32( p )
+#define SKM_Store( p, v )			vst1q_f32( ( p ), ( v ) )
+#define SKM_Splat( f )				vdupq_n_f32( f )
+#define SKM_Mul( a, b )				vmulq_f32( ( a ), ( b ) )
+#define SKM_MulAdd( a, b, c )		vmlaq_f32( ( c ), ( a ), ( b ) )
+#define SKM_SetW( v, w )			vsetq_lane_f32( ( w ), ( v ), 3 )
+#endif
+
+/*
+* R_SkeletalBlendPoses_SIMD
+*
+* Unlike the scalar version, this also blends the 4th column of the matrices.
+*/
+static void R_SkeletalBlendPoses_SIMD( unsigned int numblends, mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose )
+{
+	unsigned int i, j, k;
+	float *pose;
+	mskblend_t *blend;
+
+	for( i = 0, j = numbones, blend = blends; i < numblends; i++, j++, blend++ ) {
+		const float *b;
+		skmvec_t f, r0, r1, r2, r3;
+
+		pose = relbonepose[j];
+
+		b = relbonepose[blend->indices[0]];
+		f = SKM_Splat( blend->weights[0] * (1.0f / 255.0f) );
+
+		r0 = SKM_Mul( f, SKM_Load( b +  0 ) );
+		r1 = SKM_Mul( f, SKM_Load( b +  4 ) );
+		r2 = SKM_Mul( f, SKM_Load( b +  8 ) );
+		r3 = SKM_Mul( f, SKM_Load( b + 12 ) );
+
+		for( k = 1; k < SKM_MAX_WEIGHTS && blend->weights[k]; k++ ) {
+			b = relbonepose[blend->indices[k]];
+			f = SKM_Splat( blend->weights[k] * (1.0f / 255.0f) );
+
+			r0 = SKM_MulAdd( f, SKM_Load( b +  0 ), r0 );
+			r1 = SKM_MulAdd( f, SKM_Load( b +  4 ), r1 );
+			r2 = SKM_MulAdd( f, SKM_Load( b +  8 ), r2 );
+			r3 = SKM_MulAdd( f, SKM_Load( b + 12 ), r3 );
+		}
+
+		SKM_Store( pose +  0, r0 );
+		SKM_Store( pose +  4, r1 );
+		SKM_Store( pose +  8, r2 );
+		SKM_Store( pose + 12, r3 );
+	}
+}
+
+/*
+* R_SkeletalTransformVerts_SIMD
+*/
+static void R_SkeletalTransformVerts_SIMD( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+{
+	const float *pose;
+	skmvec_t r;
+
+	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		r = SKM_MulAdd( SKM_Splat( v[0] ), SKM_Load( pose + 0 ), SKM_Load( pose + 12 ) );
+		r = SKM_MulAdd( SKM_Splat( v[1] ), SKM_Load( pose + 4 ), r );
+		r = SKM_MulAdd( SKM_Splat( v[2] ), SKM_Load( pose + 8 ), r );
+		SKM_Store( ov, SKM_SetW( r, 1.0f ) );
+	}
+}
+
+/*
+* R_SkeletalTransformNormals_SIMD
+*/
+static void R_SkeletalTransformNormals_SIMD( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+{
+	const float *pose;
+	skmvec_t r;
+
+	for( ; numverts; numverts--, v += 4, ov += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		r = SKM_Mul( SKM_Splat( v[0] ), SKM_Load( pose + 0 ) );
+		r = SKM_MulAdd( SKM_Splat( v[1] ), SKM_Load( pose + 4 ), r );
+		r = SKM_MulAdd( SKM_Splat( v[2] ), SKM_Load( pose + 8 ), r );
+		SKM_Store( ov, SKM_SetW( r, 0.0f ) );
+	}
+}
+
+/*
+* R_SkeletalTransformNormalsAndSVecs_SIMD
+*/
+static void R_SkeletalTransformNormalsAndSVecs_SIMD( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv )
+{
+	const float *pose;
+	skmvec_t c0, c1, c2, r, sr;
+
+	for( ; numverts; numverts--, v += 4, ov += 4, sv += 4, osv += 4, blends++ ) {
+		pose = relbonepose[*blends];
+
+		c0 = SKM_Load( pose + 0 );
+		c1 = SKM_Load( pose + 4 );
+		c2 = SKM_Load( pose + 8 );
+
+		r = SKM_Mul( SKM_Splat( v[0] ), c0 );
+		r = SKM_MulAdd( SKM_Splat( v[1] ), c1, r );
+		r = SKM_MulAdd( SKM_Splat( v[2] ), c2, r );
+		SKM_Store( ov, SKM_SetW( r, 0.0f ) );
+
+		sr = SKM_Mul( SKM_Splat( sv[0] ), c0 );
+		sr = SKM_MulAdd( SKM_Splat( sv[1] ), c1, sr );
+		sr = SKM_MulAdd( SKM_Splat( sv[2] ), c2, sr );
+		SKM_Store( osv, SKM_SetW( sr, sv[3] ) );
+	}
+}
+
+#endif // SKM_USE_SIMD
+
+/*
+* R_SkeletalBlendPoses
+*/
+static void R_SkeletalBlendPoses( unsigned int numblends, mskblend_t *blends, unsigned int numbones, mat4_t *relbonepose )
+{
+#ifdef SKM_USE_SIMD
+	if( r_skmsimd->integer ) {
+		R_SkeletalBlendPoses_SIMD( numblends, blends, numbones, relbonepose );
+		return;
+	}
+#endif
+	R_SkeletalBlendPoses_C( numblends, blends, numbones, relbonepose );
+}
+
+/*
+* R_SkeletalTransformVerts
+*/
+static void R_SkeletalTransformVerts( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+{
+#ifdef SKM_USE_SIMD
+	if( r_skmsimd->integer ) {
+		R_SkeletalTransformVerts_SIMD( numverts, blends, relbonepose, v, ov );
+		return;
+	}
+#endif
+	R_SkeletalTransformVerts_C( numverts, blends, relbonepose, v, ov );
+}
+
+/*
+* R_SkeletalTransformNormals
+*/
+static void R_SkeletalTransformNormals( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov )
+{
+#ifdef SKM_USE_SIMD
+	if( r_skmsimd->integer ) {
+		R_SkeletalTransformNormals_SIMD( numverts, blends, relbonepose, v, ov );
+		return;
+	}
+#endif
+	R_SkeletalTransformNormals_C( numverts, blends, relbonepose, v, ov );
+}
+
+/*
+* R_SkeletalTransformNormalsAndSVecs
+*/
+static void R_SkeletalTransformNormalsAndSVecs( int numverts, const unsigned int *blends, mat4_t *relbonepose, const vec_t *v, vec_t *ov, const vec_t *sv, vec_t *osv )
+{
+#ifdef SKM_USE_SIMD
+	if( r_skmsimd->integer ) {
+		R_SkeletalTransformNormalsAndSVecs_SIMD( numverts, blends, relbonepose, v, ov, sv, osv );
+		return;
+	}
+#endif
+	R_SkeletalTransformNormalsAndSVecs_C( numverts, blends, relbonepose, v, ov, sv, osv );
+}
+
 // set the FP precision back to whatever value it was
 #if defined ( _WIN32 ) && ( _MSC_VER >= 1400 ) && defined( NDEBUG )
 # pragma float_control(pop)
@@ -1364,6 +1563,162 @@ void R_DrawSkeletalSurf( const entity_t *e, const shader_t *shader, const mfog_t
 	}
 }
 
+/*
+* R_SkeletalBench_f
+*
+* Runs the scalar and SIMD skinning kernels on all meshes of a skeletal model
+* and compares both their timings and results. Nothing is sent to the GPU.
+*/
+void R_SkeletalBench_f( void )
+{
+#ifdef SKM_USE_SIMD
+	unsigned int i, j, n;
+	int it, iterations;
+	int framenum;
+	const char *name;
+	const model_t *mod;
+	const mskmodel_t *skmodel;
+	bonepose_t *bonepose;
+	dualquat_t dq;
+	mat4_t *mats[2];
+	vec4_t *xyz[2], *normals[2], *svecs[2];
+	unsigned int numverts;
+	double err[4];
+	uint64_t start, blendTime[2], xyzTime[2], normalsTime[2];
+
+	if( ri.Cmd_Argc() < 2 ) {
+		Com_Printf( "Usage: %s <model> [iterations]\n", ri.Cmd_Argv( 0 ) );
+		return;
+	}
+
+	name = ri.Cmd_Argv( 1 );
+	iterations = ri.Cmd_Argc() > 2 ? max( atoi( ri.Cmd_Argv( 2 ) ), 1 ) : 1000;
+
+	mod = R_RegisterModel( name );
+	if( !mod || mod->type != mod_skeletal ) {
+		Com_Printf( "%s is not a skeletal model\n", name );
+		return;
+	}
+
+	skmodel = ( const mskmodel_t * )mod->extradata;
+	framenum = skmodel->numframes / 2;
+
+	// same as R_DrawSkeletalSurf without lerping
+	bonepose = R_Malloc( sizeof( *bonepose ) * skmodel->numbones );
+	for( i = 0; i < skmodel->numbones; i++ ) {
+		const bonepose_t *bp = skmodel->frames[framenum].boneposes + i;
+
+		if( skmodel->bones[i].parent >= 0 ) {
+			DualQuat_Multiply( bonepose[skmodel->bones[i].parent].dualquat, bp->dualquat, bonepose[i].dualquat );
+		}
+		else {
+			DualQuat_Copy( bp->dualquat, bonepose[i].dualquat );
+		}
+	}
+
+	numverts = 0;
+	for( i = 0; i < skmodel->nummeshes; i++ ) {
+		numverts = max( numverts, skmodel->meshes[i].numverts );
+	}
+
+	for( n = 0; n < 2; n++ ) {
+		mats[n] = R_Malloc( sizeof( mat4_t ) * ( skmodel->numbones + skmodel->numblends ) );
+		xyz[n] = R_Malloc( sizeof( vec4_t ) * numverts );
+		normals[n] = R_Malloc( sizeof( vec4_t ) * numverts );
+		svecs[n] = R_Malloc( sizeof( vec4_t ) * numverts );
+
+		for( i = 0; i < skmodel->numbones; i++ ) {
+			DualQuat_Multiply( bonepose[i].dualquat, skmodel->invbaseposes[i].dualquat, dq );
+			DualQuat_Normalize( dq );
+			Matrix4_FromDualQuaternion( dq, mats[n][i] );
+		}
+	}
+
+	memset( blendTime, 0, sizeof( blendTime ) );
+	memset( xyzTime, 0, sizeof( xyzTime ) );
+	memset( normalsTime, 0, sizeof( normalsTime ) );
+	memset( err, 0, sizeof( err ) );
+
+	for( n = 0; n < 2; n++ ) {
+		start = ri.Sys_Microseconds();
+		for( it = 0; it < iterations; it++ ) {
+			if( n ) {
+				R_SkeletalBlendPoses_SIMD( skmodel->numblends, skmodel->blends, skmodel->numbones, mats[n] );
+			} else {
+				R_SkeletalBlendPoses_C( skmodel->numblends, skmodel->blends, skmodel->numbones, mats[n] );
+			}
+		}
+		blendTime[n] = ri.Sys_Microseconds() - start;
+	}
+
+	for( i = 0; i < skmodel->nummeshes; i++ ) {
+		const mskmesh_t *skmesh = skmodel->meshes + i;
+
+		for( n = 0; n < 2; n++ ) {
+			start = ri.Sys_Microseconds();
+			for( it = 0; it < iterations; it++ ) {
+				if( n ) {
+					R_SkeletalTransformVerts_SIMD( skmesh->numverts, skmesh->vertexBlends, mats[n],
+						( vec_t * )skmesh->xyzArray[0], ( vec_t * )xyz[n][0] );
+				} else {
+					R_SkeletalTransformVerts_C( skmesh->numverts, skmesh->vertexBlends, mats[n],
+						( vec_t * )skmesh->xyzArray[0], ( vec_t * )xyz[n][0] );
+				}
+			}
+			xyzTime[n] += ri.Sys_Microseconds() - start;
+
+			start = ri.Sys_Microseconds();
+			for( it = 0; it < iterations; it++ ) {
+				if( n ) {
+					R_SkeletalTransformNormalsAndSVecs_SIMD( skmesh->numverts, skmesh->vertexBlends, mats[n],
+						( vec_t * )skmesh->normalsArray[0], ( vec_t * )normals[n][0],
+						( vec_t * )skmesh->sVectorsArray[0], ( vec_t * )svecs[n][0] );
+				} else {
+					R_SkeletalTransformNormalsAndSVecs_C( skmesh->numverts, skmesh->vertexBlends, mats[n],
+						( vec_t * )skmesh->normalsArray[0], ( vec_t * )normals[n][0],
+						( vec_t * )skmesh->sVectorsArray[0], ( vec_t * )svecs[n][0] );
+				}
+			}
+			normalsTime[n] += ri.Sys_Microseconds() - start;
+		}
+
+		for( j = 0; j < skmesh->numverts * 4; j++ ) {
+			err[1] = max( err[1], fabs( xyz[0][0][j] - xyz[1][0][j] ) );
+			err[2] = max( err[2], fabs( normals[0][0][j] - normals[1][0][j] ) );
+			err[3] = max( err[3], fabs( svecs[0][0][j] - svecs[1][0][j] ) );
+		}
+	}
+
+	// the scalar version leaves the 4th column of blended matrices untouched
+	for( i = skmodel->numbones; i < skmodel->numbones + skmodel->numblends; i++ ) {
+		for( j = 0; j < 16; j++ ) {
+			if( ( j & 3 ) != 3 ) {
+				err[0] = max( err[0], fabs( mats[0][i][j] - mats[1][i][j] ) );
+			}
+		}
+	}
+
+	Com_Printf( "%s: %u bones, %u blends, %u meshes, %u verts, frame %i, %i iterations\n", mod->name, 
+		skmodel->numbones, skmodel->numblends, skmodel->nummeshes, skmodel->numverts, framenum, iterations );
+	Com_Printf( "blend poses: %.2f / %.2f usec, max error %g\n", 
+		(double)blendTime[0] / iterations, (double)blendTime[1] / iterations, err[0] );
+	Com_Printf( "vertices: %.2f / %.2f usec, max error %g\n", 
+		(double)xyzTime[0] / iterations, (double)xyzTime[1] / iterations, err[1] );
+	Com_Printf( "normals and svecs: %.2f / %.2f usec, max error %g / %g\n", 
+		(double)normalsTime[0] / iterations, (double)normalsTime[1] / iterations, err[2], err[3] );
+
+	for( n = 0; n < 2; n++ ) {
+		R_Free( svecs[n] );
+		R_Free( normals[n] );
+		R_Free( xyz[n] );
+		R_Free( mats[n] );
+	}
+	R_Free( bonepose );
+#else
+	Com_Printf( "SIMD skinning kernels are not available in this build\n" );
+#endif
+}
+
 /*
 * R_SkeletalModelLerpTag
 */
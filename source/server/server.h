@@ -100,6 +100,7 @@ typedef struct
 	player_state_t *ps;                 // [numplayers]
 	int num_entities;
 	int first_entity;                   // into the circular sv.client_entities[]
+	unsigned int frameNum;              // server frame the entity states were copied in
 	unsigned int sentTimeStamp;         // time at what this frame snap was sent to the clients
 	unsigned int UcmdExecuted;
 	game_state_t gameState;
@@ -175,6 +176,7 @@ typedef struct client_s
 	char session[HTTP_CLIENT_SESSION_SIZE];  // session id for HTTP requests
 
 	client_snapshot_t snapShots[UPDATE_BACKUP]; // updates can be delta'd from here
+	uint8_t *snapArena;             // storage for the areabits and player states of snapShots
 
 	client_download_t download;
 
@@ -221,6 +223,9 @@ typedef struct
 	char *tempname;
 	time_t localtime;
 	unsigned int basetime, duration;
+	unsigned int keyframetime;      // gametime of the last nodelta frame
+	int indexfile;                  // keyframe index, next to the demo
+	char *indexconfigstrings;       // configstrings as of the last indexed keyframe
 	client_t client;                // special client for writing the messages
 	char meta_data[SNAP_MAX_DEMO_META_DATA_SIZE];
 	size_t meta_data_realsize;
@@ -289,6 +294,8 @@ typedef struct
 	cmodel_state_t *cms;                // passed to CM-functions
 
 	fatvis_t fatvis;
+	struct snapVisCache_s *viscache;    // shared entity culling results
+	struct snapDeltaCache_s *deltacache;    // shared entity delta bits
 
 	char *motd;
 
@@ -334,6 +341,8 @@ extern cvar_t *sv_http_port;
 extern cvar_t *sv_http_upstream_baseurl;
 extern cvar_t *sv_http_upstream_ip;
 extern cvar_t *sv_http_upstream_realip_header;
+extern cvar_t *sv_http_maxrate;                 // bytes per second for each download, 0 is unlimited
+extern cvar_t *sv_http_maxtotalrate;            // bytes per second for all downloads, 0 is unlimited
 #endif
 
 extern cvar_t *sv_skilllevel;
@@ -344,11 +353,15 @@ extern cvar_t *sv_enforcetime;
 extern cvar_t *sv_showRcon;
 extern cvar_t *sv_showChallenge;
 extern cvar_t *sv_showInfoQueries;
+extern cvar_t *sv_queryRate;
+extern cvar_t *sv_queryBurst;
 extern cvar_t *sv_highchars;
 
 //wsw : jal
 extern cvar_t *sv_maxrate;
 extern cvar_t *sv_compresspackets;
+extern cvar_t *sv_snapthreads;
+extern cvar_t *sv_snapdeltacache;
 extern cvar_t *sv_public;         // should heartbeats be sent
 
 // wsw : debug netcode
@@ -373,6 +386,7 @@ extern cvar_t *sv_lastAutoUpdate;
 extern cvar_t *sv_defaultmap;
 
 extern cvar_t *sv_demodir;
+extern cvar_t *sv_demokeyframeinterval;
 
 extern cvar_t *sv_mm_authkey;
 extern cvar_t *sv_mm_loginonly;
@@ -409,6 +423,7 @@ void SV_UpdateActivity( void );
 // sv_oob.c
 //
 void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, msg_t *msg );
+void SV_InvalidateInfoCache( void );
 void SV_InitMaster( void );
 void SV_UpdateMaster( void );
 
@@ -462,6 +477,7 @@ typedef struct
 
 void SV_FlushRedirect( int sv_redirected, const char *outputbuf, const void *extra );
 void SV_SendClientMessages( void );
+void SV_ShutdownSnapThreads( void );
 
 void SV_Multicast( vec3_t origin, multicast_t to );
 void SV_BroadcastCommand( const char *format, ... );
@@ -475,6 +491,7 @@ bool SV_ClientConnect( const socket_t *socket, const netadr_t *address, client_t
                            unsigned int ticket_id, int session_id );
 void SV_DropClient( client_t *drop, int type, const char *format, ... );
 void SV_ExecuteClientThinks( int clientNum );
+int SV_GetPendingClientThinks( int clientNum, usercmd_t *ucmds, int maxucmds );
 void SV_ClientResetCommandBuffers( client_t *client );
 void SV_ClientCloseDownload( client_t *client );
 
@@ -565,3 +582,6 @@ const char *SV_Web_UpstreamBaseUrl( void );
 bool SV_Web_AddGameClient( const char *session, int clientNum, const netadr_t *netAdr );
 void SV_Web_RemoveGameClient( const char *session );
 void SV_Web_GameFrame( http_game_query_cb cb );
+void SV_Web_Benchmark( const char *filename, int numConnections, int seconds );
+bool SV_Web_BenchmarkRunning( void );
+void SV_Web_BenchmarkFrame( uint64_t frameStart );
@@ -307,6 +307,65 @@ void SV_Status_f( void )
 	Com_Printf( "\n" );
 }
 
+/*
+* SV_SnapStats_f
+*/
+static void SV_SnapStats_f( void )
+{
+	int numFrames, numAllocations;
+
+	SNAP_GetFrameStats( &numFrames, &numAllocations );
+	Com_Printf( "%i client frames built, %i frame storage allocations\n", numFrames, numAllocations );
+}
+
+/*
+* SV_TraceBench_f
+*/
+static void SV_TraceBench_f( void )
+{
+	if( !svs.cms )
+	{
+		Com_Printf( "No map loaded.\n" );
+		return;
+	}
+
+	CM_TraceBenchmark( svs.cms, Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 1 );
+}
+
+/*
+* SV_SnapDeltaBench_f
+*/
+static void SV_SnapDeltaBench_f( void )
+{
+	if( Cmd_Argc() < 2 )
+	{
+		Com_Printf( "Usage: snapdeltabench <clients> [iterations]\n" );
+		return;
+	}
+
+	SNAP_DeltaCacheBenchmark( svs.deltacache, atoi( Cmd_Argv( 1 ) ), Cmd_Argc() > 2 ? atoi( Cmd_Argv( 2 ) ) : 1 );
+}
+
+/*
+* SV_HTTPBench_f
+*/
+static void SV_HTTPBench_f( void )
+{
+	if( Cmd_Argc() < 3 )
+	{
+		Com_Printf( "Usage: httpbench <file> <connections> [seconds]\n" );
+		return;
+	}
+
+	if( !svs.initialized )
+	{
+		Com_Printf( "No map loaded.\n" );
+		return;
+	}
+
+	SV_Web_Benchmark( Cmd_Argv( 1 ), atoi( Cmd_Argv( 2 ) ), Cmd_Argc() > 3 ? atoi( Cmd_Argv( 3 ) ) : 10 );
+}
+
 /*
 * SV_Heartbeat_f
 */
@@ -412,6 +471,10 @@ void SV_InitOperatorCommands( void )
 {
 	Cmd_AddCommand( "heartbeat", SV_Heartbeat_f );
 	Cmd_AddCommand( "status", SV_Status_f );
+	Cmd_AddCommand( "snapstats", SV_SnapStats_f );
+	Cmd_AddCommand( "tracebench", SV_TraceBench_f );
+	Cmd_AddCommand( "snapdeltabench", SV_SnapDeltaBench_f );
+	Cmd_AddCommand( "httpbench", SV_HTTPBench_f );
 	Cmd_AddCommand( "serverinfo", SV_Serverinfo_f );
 	Cmd_AddCommand( "dumpuser", SV_DumpUser_f );
 
@@ -447,6 +510,10 @@ void SV_ShutdownOperatorCommands( void )
 {
 	Cmd_RemoveCommand( "heartbeat" );
 	Cmd_RemoveCommand( "status" );
+	Cmd_RemoveCommand( "snapstats" );
+	Cmd_RemoveCommand( "tracebench" );
+	Cmd_RemoveCommand( "snapdeltabench" );
+	Cmd_RemoveCommand( "httpbench" );
 	Cmd_RemoveCommand( "serverinfo" );
 	Cmd_RemoveCommand( "dumpuser" );
 
@@ -988,8 +988,9 @@ USER CMD EXECUTION
 
 /*
 * SV_FindNextUserCommand - Returns the next valid usercmd_t in execution list
+* issued after ucmdTime
 */
-usercmd_t *SV_FindNextUserCommand( client_t *client )
+static usercmd_t *SV_FindNextUserCommand( client_t *client, unsigned int ucmdTime )
 {
 	usercmd_t *ucmd;
 	unsigned int higherTime = 0xFFFFFFFF;
@@ -1002,7 +1003,7 @@ usercmd_t *SV_FindNextUserCommand( client_t *client )
 		for( i = client->UcmdExecuted + 1; i <= client->UcmdReceived; i++ )
 		{
 			// skip backups if already executed
-			if( client->UcmdTime >= client->ucmds[i & CMD_MASK].serverTimeStamp )
+			if( ucmdTime >= client->ucmds[i & CMD_MASK].serverTimeStamp )
 				continue;
 
 			if( client->ucmds[i & CMD_MASK].serverTimeStamp < higherTime )
@@ -1017,32 +1018,54 @@ usercmd_t *SV_FindNextUserCommand( client_t *client )
 }
 
 /*
-* SV_ExecuteClientThinks - Execute all pending usercmd_t
+* SV_ClientThinksStartTime
 */
-void SV_ExecuteClientThinks( int clientNum )
+static unsigned int SV_ClientThinksStartTime( client_t *client )
 {
-	unsigned int msec;
 	unsigned int minUcmdTime;
-	int timeDelta;
+
+	// don't let client command time delay too far away in the past
+	minUcmdTime = ( svs.gametime > 999 ) ? ( svs.gametime - 999 ) : 0;
+	return max( client->UcmdTime, minUcmdTime );
+}
+
+/*
+* SV_ThinkingClient
+*/
+static client_t *SV_ThinkingClient( int clientNum )
+{
 	client_t *client;
-	usercmd_t *ucmd;
 
 	if( clientNum >= sv_maxclients->integer || clientNum < 0 )
-		return;
+		return NULL;
 
 	client = svs.clients + clientNum;
 	if( client->state < CS_SPAWNED )
-		return;
+		return NULL;
 
 	if( client->edict->r.svflags & SVF_FAKECLIENT )
+		return NULL;
+
+	return client;
+}
+
+/*
+* SV_ExecuteClientThinks - Execute all pending usercmd_t
+*/
+void SV_ExecuteClientThinks( int clientNum )
+{
+	unsigned int msec;
+	int timeDelta;
+	client_t *client;
+	usercmd_t *ucmd;
+
+	client = SV_ThinkingClient( clientNum );
+	if( !client )
 		return;
 
-	// don't let client command time delay too far away in the past
-	minUcmdTime = ( svs.gametime > 999 ) ? ( svs.gametime - 999 ) : 0;
-	if( client->UcmdTime < minUcmdTime )
-		client->UcmdTime = minUcmdTime;
+	client->UcmdTime = SV_ClientThinksStartTime( client );
 
-	while( ( ucmd = SV_FindNextUserCommand( client ) ) != NULL )
+	while( ( ucmd = SV_FindNextUserCommand( client, client->UcmdTime ) ) != NULL )
 	{
 		msec = ucmd->serverTimeStamp - client->UcmdTime;
 		clamp( msec, 1, 200 );
@@ -1060,6 +1083,41 @@ void SV_ExecuteClientThinks( int clientNum )
 	client->UcmdExecuted = client->UcmdReceived;
 }
 
+/*
+* SV_GetPendingClientThinks
+* 
+* Copies the usercmds the next SV_ExecuteClientThinks call for the client
+* will execute, in order and with msec set, so that the game can work on
+* them ahead of time. Returns how many were copied.
+*/
+int SV_GetPendingClientThinks( int clientNum, usercmd_t *ucmds, int maxucmds )
+{
+	int numucmds;
+	unsigned int msec, ucmdTime;
+	client_t *client;
+	usercmd_t *ucmd;
+
+	client = SV_ThinkingClient( clientNum );
+	if( !client )
+		return 0;
+
+	ucmdTime = SV_ClientThinksStartTime( client );
+
+	numucmds = 0;
+	while( numucmds < maxucmds && ( ucmd = SV_FindNextUserCommand( client, ucmdTime ) ) != NULL )
+	{
+		msec = ucmd->serverTimeStamp - ucmdTime;
+		clamp( msec, 1, 200 );
+		ucmds[numucmds] = *ucmd;
+		ucmds[numucmds].msec = msec;
+		numucmds++;
+
+		ucmdTime = ucmd->serverTimeStamp;
+	}
+
+	return numucmds;
+}
+
 /*
 * SV_ParseMoveCommand
 */
@@ -53,7 +53,8 @@ static void SV_Demo_WriteStartMessages( void )
 */
 void SV_Demo_WriteSnap( void )
 {
-	int i;
+	int i, offset;
+	bool keyframe;
 	msg_t msg;
 	uint8_t msg_buffer[MAX_MSGLEN];
 
@@ -75,14 +76,28 @@ void SV_Demo_WriteSnap( void )
 
 	MSG_Init( &msg, msg_buffer, sizeof( msg_buffer ) );
 
+	// write a nodelta frame every now and then, so playback can seek
+	// to it instead of parsing the demo from the start
+	if( sv_demokeyframeinterval->integer > 0 &&
+		svs.gametime >= svs.demo.keyframetime + sv_demokeyframeinterval->integer * 1000 )
+		svs.demo.client.nodelta = true;
+	keyframe = svs.demo.client.nodelta;
+	if( keyframe )
+		svs.demo.keyframetime = svs.gametime;
+
 	SV_BuildClientFrameSnap( &svs.demo.client );
 
 	SV_WriteFrameSnapToClient( &svs.demo.client, &msg );
 
 	SV_AddReliableCommandsToMessage( &svs.demo.client, &msg );
 
+	offset = FS_Tell( svs.demo.file );
 	SV_Demo_WriteMessage( &msg );
 
+	// the configstring commands in the message are already in sv.configstrings
+	if( keyframe && svs.demo.indexfile )
+		SNAP_RecordDemoKeyframe( svs.demo.indexfile, offset, svs.gametime, sv.configstrings[0], svs.demo.indexconfigstrings );
+
 	svs.demo.duration = svs.gametime - svs.demo.basetime;
 	svs.demo.client.lastframe = sv.framenum; // FIXME: is this needed?
 }
@@ -186,6 +201,18 @@ void SV_Demo_Start_f( void )
 
 	Com_Printf( "Recording server demo: %s\n", svs.demo.filename );
 
+	// playback can do without the index, so don't give up if it can't be written
+	if( FS_FOpenFile( va( "%s" SNAP_DEMO_INDEX_EXTENSION, svs.demo.tempname ), &svs.demo.indexfile, FS_WRITE ) == -1 )
+	{
+		Com_Printf( "Warning: Couldn't open the keyframe index for %s\n", svs.demo.tempname );
+		svs.demo.indexfile = 0;
+	}
+	else
+	{
+		svs.demo.indexconfigstrings = Mem_ZoneMalloc( sizeof( sv.configstrings ) );
+		SNAP_BeginDemoIndex( svs.demo.indexfile );
+	}
+
 	SV_Demo_InitClient();
 
 	// write serverdata, configstrings and baselines
@@ -227,6 +254,23 @@ static void SV_Demo_Stop( bool cancel, bool silent )
 	FS_FCloseFile( svs.demo.file );
 	svs.demo.file = 0;
 
+	if( svs.demo.indexfile )
+	{
+		if( !cancel )
+			SNAP_StopDemoRecording( svs.demo.indexfile );
+		FS_FCloseFile( svs.demo.indexfile );
+		svs.demo.indexfile = 0;
+
+		Mem_ZoneFree( svs.demo.indexconfigstrings );
+		svs.demo.indexconfigstrings = NULL;
+
+		if( cancel )
+			FS_RemoveFile( va( "%s" SNAP_DEMO_INDEX_EXTENSION, svs.demo.tempname ) );
+		else if( !FS_MoveFile( va( "%s" SNAP_DEMO_INDEX_EXTENSION, svs.demo.tempname ), 
+			va( "%s" SNAP_DEMO_INDEX_EXTENSION, svs.demo.filename ) ) )
+			Com_Printf( "Error: Failed to rename the server demo keyframe index\n" );
+	}
+
 	if( cancel )
 	{
 		if( !FS_RemoveFile( svs.demo.tempname ) )
@@ -363,6 +407,7 @@ void SV_Demo_Purge_f( void )
 			Com_Printf( "Error, couldn't remove file: %s\n", path );
 			continue;
 		}
+		FS_RemoveFile( va( "%s" SNAP_DEMO_INDEX_EXTENSION, path ) );
 
 		if( --numautodemos == maxautodemos )
 			break;
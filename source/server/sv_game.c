@@ -260,6 +260,10 @@ static void PF_ConfigString( int index, const char *val )
 	// change the string in sv
 	Q_strncpyz( sv.configstrings[index], val, sizeof( sv.configstrings[index] ) );
 
+	// the gametype name is shown to server browsers
+	if( index == CS_GAMETYPETITLE || index == CS_GAMETYPENAME )
+		SV_InvalidateInfoCache();
+
 	if( sv.state != ss_loading )
 		SV_SendServerCommand( NULL, "cs %i \"%s\"", index, val );
 }
@@ -548,6 +552,12 @@ void SV_InitGameProgs( void )
 	import.DropClient = PF_DropClient;
 	import.GetClientState = PF_GetClientState;
 	import.ExecuteClientThinks = SV_ExecuteClientThinks;
+	import.GetPendingClientThinks = SV_GetPendingClientThinks;
+
+	import.ThreadPool_Create = QThreadPool_Create;
+	import.ThreadPool_Destroy = QThreadPool_Destroy;
+	import.ThreadPool_NumWorkers = QThreadPool_NumWorkers;
+	import.ThreadPool_Run = QThreadPool_Run;
 
 	import.LocateEntities = SV_LocateEntities;
 
@@ -354,6 +354,8 @@ void SV_InitGame( void )
 	svs.clients = Mem_Alloc( sv_mempool, sizeof( client_t )*sv_maxclients->integer );
 	svs.client_entities.num_entities = sv_maxclients->integer * UPDATE_BACKUP * MAX_SNAP_ENTITIES;
 	svs.client_entities.entities = Mem_Alloc( sv_mempool, sizeof( entity_state_t ) * svs.client_entities.num_entities );
+	svs.viscache = SNAP_CreateVisCache( sv_mempool );
+	svs.deltacache = SNAP_CreateDeltaCache( sv_mempool );
 
 	// init network stuff
 
@@ -549,6 +551,12 @@ void SV_ShutdownGame( const char *finalmsg, bool reconnect )
 		memset( &svs.client_entities, 0, sizeof( svs.client_entities ) );
 	}
 
+	if( svs.viscache )
+		SNAP_DestroyVisCache( &svs.viscache );
+
+	if( svs.deltacache )
+		SNAP_DestroyDeltaCache( &svs.deltacache );
+
 	if( svs.cms )
 	{
 		// CM_ReleaseReference will take care of freeing up the memory
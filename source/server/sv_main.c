@@ -62,12 +62,18 @@ cvar_t *sv_http_port;
 cvar_t *sv_http_upstream_baseurl;
 cvar_t *sv_http_upstream_ip;
 cvar_t *sv_http_upstream_realip_header;
+cvar_t *sv_http_maxrate;
+cvar_t *sv_http_maxtotalrate;
 #endif
 
+static netpoll_t *sv_netpoll;       // for sleeping on the game sockets
+
 cvar_t *sv_showclamp;
 cvar_t *sv_showRcon;
 cvar_t *sv_showChallenge;
 cvar_t *sv_showInfoQueries;
+cvar_t *sv_queryRate;
+cvar_t *sv_queryBurst;
 cvar_t *sv_highchars;
 
 cvar_t *sv_hostname;
@@ -82,6 +88,8 @@ cvar_t *sv_reconnectlimit; // minimum seconds between connect messages
 
 cvar_t *sv_maxrate;
 cvar_t *sv_compresspackets;
+cvar_t *sv_snapthreads;
+cvar_t *sv_snapdeltacache;
 cvar_t *sv_masterservers;
 cvar_t *sv_masterservers_steam;
 cvar_t *sv_skilllevel;
@@ -97,6 +105,7 @@ cvar_t *sv_autoUpdate;
 cvar_t *sv_lastAutoUpdate;
 
 cvar_t *sv_demodir;
+cvar_t *sv_demokeyframeinterval;
 
 //============================================================================
 
@@ -177,12 +186,14 @@ static bool SV_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	return true;
 }
 
+#define SV_PACKET_BATCH	16
+
 /*
 * SV_ReadPackets
 */
 static void SV_ReadPackets( void )
 {
-	int i, socketind, ret;
+	int i, p, socketind, ret;
 	client_t *cl;
 #ifdef TCP_ALLOW_CONNECT
 	socket_t newsocket;
@@ -194,6 +205,11 @@ static void SV_ReadPackets( void )
 	static msg_t msg;
 	static uint8_t msgData[MAX_MSGLEN];
 
+	// datagrams are drained from the sockets in batches
+	static msg_t packets[SV_PACKET_BATCH];
+	static netadr_t packetAddresses[SV_PACKET_BATCH];
+	static uint8_t packetData[SV_PACKET_BATCH][MAX_MSGLEN];
+
 #ifdef TCP_ALLOW_CONNECT
 	socket_t* tcpsockets [] =
 	{
@@ -210,6 +226,8 @@ static void SV_ReadPackets( void )
 	};
 
 	MSG_Init( &msg, msgData, sizeof( msgData ) );
+	for( p = 0; p < SV_PACKET_BATCH; p++ )
+		MSG_Init( &packets[p], packetData[p], sizeof( packetData[p] ) );
 
 #ifdef TCP_ALLOW_CONNECT
 	for( socketind = 0; socketind < sizeof( tcpsockets ) / sizeof( tcpsockets[0] ); socketind++ )
@@ -283,7 +301,7 @@ static void SV_ReadPackets( void )
 		if( !socket->open )
 			continue;
 
-		while( ( ret = NET_GetPacket( socket, &address, &msg ) ) != 0 )
+		while( ( ret = NET_GetPackets( socket, packetAddresses, packets, SV_PACKET_BATCH ) ) != 0 )
 		{
 			if( ret == -1 )
 			{
@@ -291,48 +309,54 @@ static void SV_ReadPackets( void )
 				continue;
 			}
 
-			// check for connectionless packet (0xffffffff) first
-			if( *(int *)msg.data == -1 )
+			for( p = 0; p < ret; p++ )
 			{
-				SV_ConnectionlessPacket( socket, &address, &msg );
-				continue;
-			}
-
-			// read the game port out of the message so we can fix up
-			// stupid address translating routers
-			MSG_BeginReading( &msg );
-			MSG_ReadLong( &msg ); // sequence number
-			MSG_ReadLong( &msg ); // sequence number
-			game_port = MSG_ReadShort( &msg ) & 0xffff;
-			// data follows
-
-			// check for packets from connected clients
-			for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
-			{
-				unsigned short addr_port;
-
-				if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
-					continue;
-				if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) )
-					continue;
-				if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
-					continue;
-				if( cl->netchan.game_port != game_port )
-					continue;
+				address = packetAddresses[p];
+				msg = packets[p];
 
-				addr_port = NET_GetAddressPort( &address );
-				if( NET_GetAddressPort( &cl->netchan.remoteAddress ) != addr_port )
+				// check for connectionless packet (0xffffffff) first
+				if( *(int *)msg.data == -1 )
 				{
-					Com_Printf( "SV_ReadPackets: fixing up a translated port\n" );
-					NET_SetAddressPort( &cl->netchan.remoteAddress, addr_port );
+					SV_ConnectionlessPacket( socket, &address, &msg );
+					continue;
 				}
 
-				if( SV_ProcessPacket( &cl->netchan, &msg ) ) // this is a valid, sequenced packet, so process it
+				// read the game port out of the message so we can fix up
+				// stupid address translating routers
+				MSG_BeginReading( &msg );
+				MSG_ReadLong( &msg ); // sequence number
+				MSG_ReadLong( &msg ); // sequence number
+				game_port = MSG_ReadShort( &msg ) & 0xffff;
+				// data follows
+
+				// check for packets from connected clients
+				for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
 				{
-					cl->lastPacketReceivedTime = svs.realtime;
-					SV_ParseClientMessage( cl, &msg );
+					unsigned short addr_port;
+
+					if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
+						continue;
+					if( cl->edict && ( cl->edict->r.svflags & SVF_FAKECLIENT ) )
+						continue;
+					if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
+						continue;
+					if( cl->netchan.game_port != game_port )
+						continue;
+
+					addr_port = NET_GetAddressPort( &address );
+					if( NET_GetAddressPort( &cl->netchan.remoteAddress ) != addr_port )
+					{
+						Com_Printf( "SV_ReadPackets: fixing up a translated port\n" );
+						NET_SetAddressPort( &cl->netchan.remoteAddress, addr_port );
+					}
+
+					if( SV_ProcessPacket( &cl->netchan, &msg ) ) // this is a valid, sequenced packet, so process it
+					{
+						cl->lastPacketReceivedTime = svs.realtime;
+						SV_ParseClientMessage( cl, &msg );
+					}
+					break;
 				}
-				break;
 			}
 		}
 	}
@@ -522,7 +546,7 @@ static bool SV_RunGameFrame( int msec )
 			}
 			opened_sockets[open_ind] = NULL;
 
-			NET_Sleep( sleeptime, opened_sockets );
+			NET_PollSleep( sv_netpoll, sleeptime, opened_sockets );
 		}
 	}
 
@@ -749,6 +773,7 @@ static void SV_CheckMatchUUID( void )
 void SV_Frame( int realmsec, int gamemsec )
 {
 	const unsigned int wrappingPoint = 0x70000000;
+	uint64_t frameStart = SV_Web_BenchmarkRunning() ? Sys_Microseconds() : 0;
 
 	time_before_game = time_after_game = 0;
 
@@ -798,6 +823,10 @@ void SV_Frame( int realmsec, int gamemsec )
 
 		// clear teleport flags, etc for next frame
 		ge->ClearSnap();
+
+		// sample the frame time for httpbench
+		if( frameStart )
+			SV_Web_BenchmarkFrame( frameStart );
 	}
 
 	// handle HTTP connections
@@ -872,6 +901,7 @@ void SV_UserinfoChanged( client_t *client )
 		return;
 	}
 	Q_strncpyz( client->name, val, sizeof( client->name ) );
+	SV_InvalidateInfoCache();
 
 #ifndef RATEKILLED
 	// rate command
@@ -947,6 +977,8 @@ void SV_Init( void )
 	sv_http_upstream_baseurl =	Cvar_Get( "sv_http_upstream_baseurl", "", CVAR_ARCHIVE | CVAR_LATCH );
 	sv_http_upstream_realip_header = Cvar_Get( "sv_http_upstream_realip_header", "", CVAR_ARCHIVE );
 	sv_http_upstream_ip = Cvar_Get( "sv_http_upstream_ip", "", CVAR_ARCHIVE );
+	sv_http_maxrate =	Cvar_Get( "sv_http_maxrate", "0", CVAR_ARCHIVE );
+	sv_http_maxtotalrate =	Cvar_Get( "sv_http_maxtotalrate", "0", CVAR_ARCHIVE );
 #endif
 
 	rcon_password =		    Cvar_Get( "rcon_password", "", 0 );
@@ -958,6 +990,8 @@ void SV_Init( void )
 	sv_showRcon =		    Cvar_Get( "sv_showRcon", "1", 0 );
 	sv_showChallenge =	    Cvar_Get( "sv_showChallenge", "0", 0 );
 	sv_showInfoQueries =	Cvar_Get( "sv_showInfoQueries", "0", 0 );
+	sv_queryRate =			Cvar_Get( "sv_queryRate", "10", CVAR_ARCHIVE );
+	sv_queryBurst =			Cvar_Get( "sv_queryBurst", "20", CVAR_ARCHIVE );
 	sv_highchars =			Cvar_Get( "sv_highchars", "1", 0 );
 
 	sv_uploads_http	=       Cvar_Get( "sv_uploads_http", "1", CVAR_READONLY );
@@ -1010,9 +1044,13 @@ void SV_Init( void )
 		Cvar_ForceSet( "sv_demodir", "" );
 	}
 
+	sv_demokeyframeinterval = Cvar_Get( "sv_demokeyframeinterval", "10", CVAR_ARCHIVE );
+
 	// wsw : jal : cap client's exceding server rules
 	sv_maxrate =		    Cvar_Get( "sv_maxrate", "0", CVAR_DEVELOPER );
 	sv_compresspackets =	    Cvar_Get( "sv_compresspackets", "1", CVAR_DEVELOPER );
+	sv_snapthreads =		    Cvar_Get( "sv_snapthreads", "0", CVAR_ARCHIVE );
+	sv_snapdeltacache =	    Cvar_Get( "sv_snapdeltacache", "1", CVAR_ARCHIVE );
 	sv_skilllevel =		    Cvar_Get( "sv_skilllevel", "2", CVAR_SERVERINFO|CVAR_ARCHIVE|CVAR_LATCH );
 
 	if( sv_skilllevel->integer > 2 )
@@ -1071,6 +1109,8 @@ void SV_Init( void )
 
 	SV_Web_Init();
 
+	sv_netpoll = NET_CreatePoll( "server" );
+
 	sv_initialized = true;
 }
 
@@ -1089,8 +1129,11 @@ void SV_Shutdown( const char *finalmsg )
 	ML_Shutdown();
 	SV_MM_Shutdown( true );
 	SV_ShutdownGame( finalmsg, false );
+	SV_ShutdownSnapThreads();
 
 	SV_ShutdownOperatorCommands();
 
+	NET_DestroyPoll( &sv_netpoll );
+
 	Mem_FreePool( &sv_mempool );
 }
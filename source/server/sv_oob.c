@@ -247,6 +247,79 @@ void SV_MasterSendQuit( void )
 
 //============================================================================
 
+/*
+* Info strings are requested over and over by server browsers and
+* trackers, so they are only rebuilt when something they show changes.
+* The key of a cached string holds everything it was built from that
+* doesn't bump info_modcount: the map, the userinfo generation and the
+* state (and optionally score) of every client slot.
+*/
+
+#define INFOCACHE_KEY_HEADER	4
+#define INFOCACHE_KEY_SIZE		( INFOCACHE_KEY_HEADER + MAX_CLIENTS * 4 )
+
+typedef struct
+{
+	bool valid;
+	int keySize;
+	int key[INFOCACHE_KEY_SIZE];
+} sv_infocache_t;
+
+static unsigned int sv_infocache_modcount;	// userinfo and configstring changes
+
+/*
+* SV_InvalidateInfoCache
+* Called when something the info strings show changes outside of cvars
+*/
+void SV_InvalidateInfoCache( void )
+{
+	sv_infocache_modcount++;
+}
+
+/*
+* SV_InfoCacheIsValid
+* Returns true if the cached string is still up to date, otherwise
+* stores the new key and returns false so the caller rebuilds it
+*/
+static bool SV_InfoCacheIsValid( sv_infocache_t *cache, bool scores )
+{
+	int i, keySize;
+	int key[INFOCACHE_KEY_SIZE];
+	client_t *cl;
+
+	key[0] = (int)info_modcount;
+	key[1] = (int)sv_infocache_modcount;
+	key[2] = svs.spawncount;
+	key[3] = ( sv.state << 1 ) | ( SV_MM_Initialized() ? 1 : 0 );
+	keySize = INFOCACHE_KEY_HEADER;
+
+	for( i = 0; i < sv_maxclients->integer && i < MAX_CLIENTS; i++ )
+	{
+		cl = &svs.clients[i];
+		if( cl->state < CS_CONNECTED )
+		{
+			key[keySize++] = 0;
+			continue;
+		}
+
+		key[keySize++] = 1 | ( ( cl->edict->r.svflags & SVF_FAKECLIENT ) ? 2 : 0 ) | ( cl->tvclient ? 4 : 0 );
+		if( scores )
+		{
+			key[keySize++] = cl->edict->r.client->r.frags;
+			key[keySize++] = cl->ping;
+			key[keySize++] = cl->edict->s.team;
+		}
+	}
+
+	if( cache->valid && cache->keySize == keySize && !memcmp( cache->key, key, keySize * sizeof( int ) ) )
+		return true;
+
+	cache->valid = true;
+	cache->keySize = keySize;
+	memcpy( cache->key, key, keySize * sizeof( int ) );
+	return false;
+}
+
 /*
 * SV_LongInfoString
 * Builds the string that is sent as heartbeats and status replies
@@ -255,13 +328,19 @@ static char *SV_LongInfoString( bool fullStatus )
 {
 	char tempstr[1024] = { 0 };
 	const char *gametype;
-	static char status[MAX_MSGLEN - 16];
+	static char statuses[2][MAX_MSGLEN - 16];
+	static sv_infocache_t caches[2];
+	char *status = statuses[fullStatus ? 1 : 0];
+	const size_t status_size = sizeof( statuses[0] );
 	int i, bots, count;
 	client_t *cl;
 	size_t statusLength;
 	size_t tempstrLength;
 
-	Q_strncpyz( status, Cvar_Serverinfo(), sizeof( status ) );
+	if( SV_InfoCacheIsValid( &caches[fullStatus ? 1 : 0], fullStatus ) )
+		return status;
+
+	Q_strncpyz( status, Cvar_Serverinfo(), status_size );
 
 	// convert "g_gametype" to "gametype"
 	gametype = Info_ValueForKey( status, "g_gametype" );
@@ -290,9 +369,9 @@ static char *SV_LongInfoString( bool fullStatus )
 		Q_snprintfz( tempstr, sizeof( tempstr ), "\\bots\\%i", bots );
 	Q_snprintfz( tempstr + strlen( tempstr ), sizeof( tempstr ) - strlen( tempstr ), "\\clients\\%i%s", count, fullStatus ? "\n" : "" );
 	tempstrLength = strlen( tempstr );
-	if( statusLength + tempstrLength >= sizeof( status ) )
+	if( statusLength + tempstrLength >= status_size )
 		return status; // can't hold any more
-	Q_strncpyz( status + statusLength, tempstr, sizeof( status ) - statusLength );
+	Q_strncpyz( status + statusLength, tempstr, status_size - statusLength );
 	statusLength += tempstrLength;
 
 	if ( fullStatus )
@@ -305,9 +384,9 @@ static char *SV_LongInfoString( bool fullStatus )
 				Q_snprintfz( tempstr, sizeof( tempstr ), "%i %i \"%s\" %i\n",
 					cl->edict->r.client->r.frags, cl->ping, cl->name, cl->edict->s.team );
 				tempstrLength = strlen( tempstr );
-				if( statusLength + tempstrLength >= sizeof( status ) )
+				if( statusLength + tempstrLength >= status_size )
 					break; // can't hold any more
-				Q_strncpyz( status + statusLength, tempstr, sizeof( status ) - statusLength );
+				Q_strncpyz( status + statusLength, tempstr, status_size - statusLength );
 				statusLength += tempstrLength;
 			}
 		}
@@ -325,6 +404,7 @@ static char *SV_LongInfoString( bool fullStatus )
 static char *SV_ShortInfoString( void )
 {
 	static char string[MAX_STRING_SVCINFOSTRING];
+	static sv_infocache_t cache;
 	char hostname[64];
 	char entry[20];
 	size_t len;
@@ -332,6 +412,9 @@ static char *SV_ShortInfoString( void )
 	int maxcount;
 	const char *password;
 
+	if( SV_InfoCacheIsValid( &cache, false ) )
+		return string;
+
 	bots = 0;
 	count = 0;
 	for( i = 0; i < sv_maxclients->integer; i++ )
@@ -648,6 +731,8 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 	char *session_id_str;
 	unsigned int ticket_id;
 	bool tv_client;
+	bool compress_dictionary;
+	char *dictionary_str;
 	unsigned int time;
 
 	Com_DPrintf( "SVC_DirectConnect (%s)\n", Cmd_Args() );
@@ -715,6 +800,13 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 		session_id = 0;
 	}
 
+	// only compress with the preset dictionary if the client has the same one
+	compress_dictionary = false;
+	dictionary_str = Info_ValueForKey( userinfo, "cl_netdict" );
+	if( dictionary_str && Netchan_DictionaryChecksum() )
+		compress_dictionary = strtoul( dictionary_str, NULL, 16 ) == Netchan_DictionaryChecksum() ? true : false;
+	Info_RemoveKey( userinfo, "cl_netdict" );
+
 #ifdef TCP_ALLOW_CONNECT
 	if( socket->type == SOCKET_TCP )
 	{
@@ -860,6 +952,8 @@ static void SVC_DirectConnect( const socket_t *socket, const netadr_t *address )
 		return;
 	}
 
+	newcl->netchan.compressDictionary = compress_dictionary;
+
 	// send the connect packet to the client
 	Netchan_OutOfBandPrint( socket, address, "client_connect\n%s", newcl->session );
 
@@ -1067,73 +1161,78 @@ bool SV_SteamServerQuery( const char *s, const socket_t *socket, const netadr_t
 		int i, players = 0, bots = 0, maxclients = 0;
 		int flags = 0x80 | 0x01; // game port | game ID containing app ID
 		client_t *cl;
-		msg_t msg;
-		uint8_t msgbuf[MAX_STEAMQUERY_PACKETLEN - sizeof( int32_t )];
+		static msg_t msg;
+		static uint8_t msgbuf[MAX_STEAMQUERY_PACKETLEN - sizeof( int32_t )];
+		static sv_infocache_t cache;
 
 		if( sv_showInfoQueries->integer )
 			Com_Printf( "Steam Info Packet %s\n", NET_AddressToString( address ) );
 
-		Q_strncpyz( hostname, COM_RemoveColorTokens( sv_hostname->string ), sizeof( hostname ) );
-		if( !hostname[0] )
-			Q_strncpyz( hostname, sv_hostname->dvalue, sizeof( hostname ) );
-		Q_strncpyz( gamedir, FS_GameDirectory(), sizeof( gamedir ) );
-
-		Q_strncpyz( gamename, APPLICATION, sizeof( gamename ) );
-		if( Cvar_Value( "g_instagib" ) )
-			Q_strncatz( gamename, " IG", sizeof( gamename ) );
-		if( sv.configstrings[CS_GAMETYPETITLE][0] || sv.configstrings[CS_GAMETYPENAME][0] )
+		if( !SV_InfoCacheIsValid( &cache, false ) )
 		{
-			Q_strncatz( gamename, " ", sizeof( gamename ) );
-			Q_strncatz( gamename,
-				sv.configstrings[sv.configstrings[CS_GAMETYPETITLE][0] ? CS_GAMETYPETITLE : CS_GAMETYPENAME],
-				sizeof( gamename ) );
-		}
+			Q_strncpyz( hostname, COM_RemoveColorTokens( sv_hostname->string ), sizeof( hostname ) );
+			if( !hostname[0] )
+				Q_strncpyz( hostname, sv_hostname->dvalue, sizeof( hostname ) );
+			Q_strncpyz( gamedir, FS_GameDirectory(), sizeof( gamedir ) );
+
+			Q_strncpyz( gamename, APPLICATION, sizeof( gamename ) );
+			if( Cvar_Value( "g_instagib" ) )
+				Q_strncatz( gamename, " IG", sizeof( gamename ) );
+			if( sv.configstrings[CS_GAMETYPETITLE][0] || sv.configstrings[CS_GAMETYPENAME][0] )
+			{
+				Q_strncatz( gamename, " ", sizeof( gamename ) );
+				Q_strncatz( gamename,
+					sv.configstrings[sv.configstrings[CS_GAMETYPETITLE][0] ? CS_GAMETYPETITLE : CS_GAMETYPENAME],
+					sizeof( gamename ) );
+			}
 
-		for( i = 0; i < sv_maxclients->integer; i++ )
-		{
-			cl = &svs.clients[i];
-			if( cl->state >= CS_CONNECTED )
+			for( i = 0; i < sv_maxclients->integer; i++ )
 			{
-				if( cl->tvclient ) // exclude TV from the max players count
-					continue;
-				if( cl->edict->r.svflags & SVF_FAKECLIENT )
-					bots++;
-				players++;
+				cl = &svs.clients[i];
+				if( cl->state >= CS_CONNECTED )
+				{
+					if( cl->tvclient ) // exclude TV from the max players count
+						continue;
+					if( cl->edict->r.svflags & SVF_FAKECLIENT )
+						bots++;
+					players++;
+				}
+				maxclients++;
 			}
-			maxclients++;
-		}
 
-		Q_snprintfz( version, sizeof( version ), "%i.%i.0.0", APP_VERSION_MAJOR, APP_VERSION_MINOR );
+			Q_snprintfz( version, sizeof( version ), "%i.%i.0.0", APP_VERSION_MAJOR, APP_VERSION_MINOR );
+
+			SV_GetSteamTags( tags );
+			if( tags[0] )
+				flags |= 0x20;
+
+			MSG_Init( &msg, msgbuf, sizeof( msgbuf ) );
+			MSG_WriteByte( &msg, 'I' );
+			MSG_WriteByte( &msg, APP_PROTOCOL_VERSION );
+			MSG_WriteString( &msg, hostname );
+			MSG_WriteString( &msg, sv.mapname );
+			MSG_WriteString( &msg, gamedir );
+			MSG_WriteString( &msg, gamename );
+			MSG_WriteShort( &msg, 0 ); // app ID specified later
+			MSG_WriteByte( &msg, min( players, 99 ) );
+			MSG_WriteByte( &msg, min( maxclients, 99 ) );
+			MSG_WriteByte( &msg, min( bots, 99 ) );
+			MSG_WriteByte( &msg, ( dedicated && dedicated->integer ) ? 'd' : 'l' );
+			MSG_WriteByte( &msg, STEAMQUERY_OS );
+			MSG_WriteByte( &msg, Cvar_String( "password" )[0] ? 1 : 0 );
+			MSG_WriteByte( &msg, 0 ); // VAC insecure
+			MSG_WriteString( &msg, version );
+			MSG_WriteByte( &msg, flags );
+			// port
+			MSG_WriteShort( &msg, sv_port->integer );
+			// tags
+			if( flags & 0x20 )
+				MSG_WriteString( &msg, tags );
+			// 64-bit game ID - needed to specify app ID
+			MSG_WriteLong( &msg, APP_STEAMID & 0xffffff );
+			MSG_WriteLong( &msg, 0 );
+		}
 
-		SV_GetSteamTags( tags );
-		if( tags[0] )
-			flags |= 0x20;
-
-		MSG_Init( &msg, msgbuf, sizeof( msgbuf ) );
-		MSG_WriteByte( &msg, 'I' );
-		MSG_WriteByte( &msg, APP_PROTOCOL_VERSION );
-		MSG_WriteString( &msg, hostname );
-		MSG_WriteString( &msg, sv.mapname );
-		MSG_WriteString( &msg, gamedir );
-		MSG_WriteString( &msg, gamename );
-		MSG_WriteShort( &msg, 0 ); // app ID specified later
-		MSG_WriteByte( &msg, min( players, 99 ) );
-		MSG_WriteByte( &msg, min( maxclients, 99 ) );
-		MSG_WriteByte( &msg, min( bots, 99 ) );
-		MSG_WriteByte( &msg, ( dedicated && dedicated->integer ) ? 'd' : 'l' );
-		MSG_WriteByte( &msg, STEAMQUERY_OS );
-		MSG_WriteByte( &msg, Cvar_String( "password" )[0] ? 1 : 0 );
-		MSG_WriteByte( &msg, 0 ); // VAC insecure
-		MSG_WriteString( &msg, version );
-		MSG_WriteByte( &msg, flags );
-		// port
-		MSG_WriteShort( &msg, sv_port->integer );
-		// tags
-		if( flags & 0x20 )
-			MSG_WriteString( &msg, tags );
-		// 64-bit game ID - needed to specify app ID
-		MSG_WriteLong( &msg, APP_STEAMID & 0xffffff );
-		MSG_WriteLong( &msg, 0 );
 		Netchan_OutOfBand( socket, address, msg.cursize, msg.data );
 		return true;
 	}
@@ -1141,41 +1240,69 @@ bool SV_SteamServerQuery( const char *s, const socket_t *socket, const netadr_t
 	if( s[0] == 'U' )
 	{
 		// players
-		msg_t msg;
-		uint8_t msgbuf[MAX_STEAMQUERY_PACKETLEN - sizeof( int32_t )];
-		int i, players = 0;
+		static msg_t msg;
+		static uint8_t msgbuf[MAX_STEAMQUERY_PACKETLEN - sizeof( int32_t )];
+		static sv_infocache_t cache;
+		static int numPlayers;
+		static size_t durationOffsets[99];
+		static unsigned int connectTimes[99];
+		int i;
 		client_t *cl;
 		char name[MAX_NAME_BYTES];
 		unsigned int time = Sys_Milliseconds();
+		union {
+			float f;
+			int l;
+		} duration;
 
 		if( sv_showInfoQueries->integer )
 			Com_Printf( "Steam Players Packet %s\n", NET_AddressToString( address ) );
 
-		MSG_Init( &msg, msgbuf, sizeof( msgbuf ) );
-		MSG_WriteByte( &msg, 'D' );
-		MSG_WriteByte( &msg, 0 );
-
-		for( i = 0; i < sv_maxclients->integer; i++ )
+		if( !SV_InfoCacheIsValid( &cache, true ) )
 		{
-			cl = &svs.clients[i];
-			if( ( cl->state < CS_CONNECTED ) || cl->tvclient )
-				continue;
+			MSG_Init( &msg, msgbuf, sizeof( msgbuf ) );
+			MSG_WriteByte( &msg, 'D' );
+			MSG_WriteByte( &msg, 0 );
 
-			Q_strncpyz( name, COM_RemoveColorTokens( cl->name ), sizeof( name ) );
-			if( ( msg.cursize + 10 + strlen( name ) ) > sizeof( msgbuf ) )
-				break;
+			numPlayers = 0;
+			for( i = 0; i < sv_maxclients->integer; i++ )
+			{
+				cl = &svs.clients[i];
+				if( ( cl->state < CS_CONNECTED ) || cl->tvclient )
+					continue;
 
-			MSG_WriteByte( &msg, i );
-			MSG_WriteString( &msg, name );
-			MSG_WriteLong( &msg, cl->edict->r.client->r.frags );
-			MSG_WriteFloat( &msg, ( float )( time - cl->lastconnect ) * 0.001f );
+				Q_strncpyz( name, COM_RemoveColorTokens( cl->name ), sizeof( name ) );
+				if( ( msg.cursize + 10 + strlen( name ) ) > sizeof( msgbuf ) )
+					break;
 
-			players++;
-			if( players == 99 )
-				break;
+				MSG_WriteByte( &msg, i );
+				MSG_WriteString( &msg, name );
+				MSG_WriteLong( &msg, cl->edict->r.client->r.frags );
+
+				// the duration is filled in for each response
+				durationOffsets[numPlayers] = msg.cursize;
+				connectTimes[numPlayers] = cl->lastconnect;
+				MSG_WriteLong( &msg, 0 );
+
+				numPlayers++;
+				if( numPlayers == 99 )
+					break;
+			}
+
+			msgbuf[1] = numPlayers;
+		}
+
+		for( i = 0; i < numPlayers; i++ )
+		{
+			uint8_t *buf = msgbuf + durationOffsets[i];
+
+			duration.f = ( float )( time - connectTimes[i] ) * 0.001f;
+			buf[0] = ( uint8_t )( duration.l & 0xff );
+			buf[1] = ( uint8_t )( ( duration.l >> 8 ) & 0xff );
+			buf[2] = ( uint8_t )( ( duration.l >> 16 ) & 0xff );
+			buf[3] = ( uint8_t )( duration.l >> 24 );
 		}
 
-		msgbuf[1] = players;
 		Netchan_OutOfBand( socket, address, msg.cursize, msg.data );
 		return true;
 	}
@@ -1190,6 +1317,8 @@ bool SV_SteamServerQuery( const char *s, const socket_t *socket, const netadr_t
 		int players = 0, bots = 0, maxclients = 0;
 		client_t *cl;
 		char msg[MAX_STEAMQUERY_PACKETLEN];
+		static char info[MAX_STEAMQUERY_PACKETLEN];
+		static sv_infocache_t cache;
 
 		for( i = 0; i < MAX_MASTERS; i++ )
 		{
@@ -1207,43 +1336,48 @@ bool SV_SteamServerQuery( const char *s, const socket_t *socket, const netadr_t
 
 		challenge = MSG_ReadLong( inmsg );
 
-		Q_strncpyz( gamedir, FS_GameDirectory(), sizeof( gamedir ) );
-		Q_strncpyz( basedir, FS_BaseGameDirectory(), sizeof( basedir ) );
-		SV_GetSteamTags( tags );
-
-		for( i = 0; i < sv_maxclients->integer; i++ )
+		if( !SV_InfoCacheIsValid( &cache, false ) )
 		{
-			cl = &svs.clients[i];
-			if( cl->state >= CS_CONNECTED )
+			Q_strncpyz( gamedir, FS_GameDirectory(), sizeof( gamedir ) );
+			Q_strncpyz( basedir, FS_BaseGameDirectory(), sizeof( basedir ) );
+			SV_GetSteamTags( tags );
+
+			for( i = 0; i < sv_maxclients->integer; i++ )
 			{
-				if( cl->tvclient ) // exclude TV from the max players count
-					continue;
-				if( cl->edict->r.svflags & SVF_FAKECLIENT )
-					bots++;
-				players++;
+				cl = &svs.clients[i];
+				if( cl->state >= CS_CONNECTED )
+				{
+					if( cl->tvclient ) // exclude TV from the max players count
+						continue;
+					if( cl->edict->r.svflags & SVF_FAKECLIENT )
+						bots++;
+					players++;
+				}
+				maxclients++;
 			}
-			maxclients++;
+
+			// everything but the challenge
+			Q_snprintfz( info, sizeof( info ),
+				"\\players\\%i\\max\\%i\\bots\\%i"
+				"\\gamedir\\%s\\map\\%s"
+				"\\password\\%i\\os\\%c"
+				"\\lan\\%i\\region\\255"
+				"%s%s"
+				"\\type\\%c\\secure\\0"
+				"\\version\\%i.%i.0.0"
+				"\\product\\%s\n",
+				min( players, 99 ), min( maxclients, 99 ), min( bots, 99 ),
+				gamedir, sv.mapname,
+				Cvar_String( "password" )[0] ? 1 : 0, STEAMQUERY_OS,
+				sv_public->integer ? 0 : 1,
+				tags[0] ? "\\gametype\\" /* legacy - "gametype", not "tags" */ : "", tags,
+				( dedicated && dedicated->integer ) ? 'd' : 'l',
+				APP_VERSION_MAJOR, APP_VERSION_MINOR,
+				basedir );
 		}
 
-		Q_snprintfz( msg, sizeof( msg ),
-			"0\n\\protocol\\7\\challenge\\%i" // protocol must be 7 to match Source
-			"\\players\\%i\\max\\%i\\bots\\%i"
-			"\\gamedir\\%s\\map\\%s"
-			"\\password\\%i\\os\\%c"
-			"\\lan\\%i\\region\\255"
-			"%s%s"
-			"\\type\\%c\\secure\\0"
-			"\\version\\%i.%i.0.0"
-			"\\product\\%s\n",
-			challenge,
-			min( players, 99 ), min( maxclients, 99 ), min( bots, 99 ),
-			gamedir, sv.mapname,
-			Cvar_String( "password" )[0] ? 1 : 0, STEAMQUERY_OS,
-			sv_public->integer ? 0 : 1,
-			tags[0] ? "\\gametype\\" /* legacy - "gametype", not "tags" */ : "", tags,
-			( dedicated && dedicated->integer ) ? 'd' : 'l',
-			APP_VERSION_MAJOR, APP_VERSION_MINOR,
-			basedir );
+		Q_snprintfz( msg, sizeof( msg ), "0\n\\protocol\\7\\challenge\\%i%s", // protocol must be 7 to match Source
+			challenge, info );
 		NET_SendPacket( socket, ( const uint8_t * )msg, strlen( msg ), address );
 
 		return true;
@@ -1273,6 +1407,90 @@ bool SV_SteamServerQuery( const char *s, const socket_t *socket, const netadr_t
 	return false;
 }
 
+/*
+* Every source address gets a bucket of sv_queryBurst connectionless
+* packets that refills at sv_queryRate packets per second. Tokens are
+* counted in thousandths so that the refill needs no floating point.
+*/
+
+#define MAX_QUERY_SOURCES	1024	// must be a power of two
+
+typedef struct
+{
+	netadr_t address;
+	unsigned int time;
+	int tokens;
+} querysource_t;
+
+static querysource_t sv_querysources[MAX_QUERY_SOURCES];
+
+/*
+* SV_QuerySourceHash
+*/
+static unsigned int SV_QuerySourceHash( const uint8_t *ip, size_t len )
+{
+	size_t i;
+	unsigned int hash = 2166136261u;
+
+	for( i = 0; i < len; i++ )
+		hash = ( hash ^ ip[i] ) * 16777619u;
+
+	return hash & ( MAX_QUERY_SOURCES - 1 );
+}
+
+/*
+* SV_QueryRateLimited
+* Returns true if the source address has used up its share of packets
+*/
+static bool SV_QueryRateLimited( const netadr_t *address )
+{
+	querysource_t *source;
+	unsigned int now;
+	int64_t refill;
+	int burst;
+
+	if( sv_queryRate->integer <= 0 )
+		return false;
+
+	switch( address->type )
+	{
+	case NA_IP:
+		source = &sv_querysources[SV_QuerySourceHash( address->address.ipv4.ip, sizeof( address->address.ipv4.ip ) )];
+		break;
+	case NA_IP6:
+		source = &sv_querysources[SV_QuerySourceHash( address->address.ipv6.ip, sizeof( address->address.ipv6.ip ) )];
+		break;
+	default:
+		return false;
+	}
+
+	now = Sys_Milliseconds();
+	burst = max( sv_queryBurst->integer, 1 ) * 1000;
+
+	if( source->address.type == NA_NOTRANSMIT )
+	{
+		// unused slot
+		source->tokens = burst;
+	}
+	else
+	{
+		refill = (int64_t)( now - source->time ) * sv_queryRate->integer;
+		source->tokens = ( refill >= burst - source->tokens ) ? burst : source->tokens + (int)refill;
+	}
+	source->time = now;
+
+	// another source hashing to the same slot takes over the bucket as it is,
+	// so that alternating between colliding addresses doesn't refill it
+	if( !NET_CompareBaseAddress( &source->address, address ) )
+		source->address = *address;
+
+	if( source->tokens < 1000 )
+		return true;
+
+	source->tokens -= 1000;
+	return false;
+}
+
 typedef struct
 {
 	char *name;
@@ -1307,6 +1525,13 @@ void SV_ConnectionlessPacket( const socket_t *socket, const netadr_t *address, m
 	connectionless_cmd_t *cmd;
 	char *s, *c;
 
+	if( SV_QueryRateLimited( address ) )
+	{
+		if( sv_showInfoQueries->integer )
+			Com_Printf( "Rate limited packet from %s\n", NET_AddressToString( address ) );
+		return;
+	}
+
 	MSG_BeginReading( msg );
 	MSG_ReadLong( msg );    // skip the -1 marker
 
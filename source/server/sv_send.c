@@ -297,9 +297,10 @@ bool SV_Netchan_Transmit( netchan_t *netchan, msg_t *msg )
 	if( !Netchan_PushAllFragments( netchan ) )
 		return false;
 
-	if( sv_compresspackets->integer )
+	// the message may have already been compressed by a snapshot worker thread
+	if( sv_compresspackets->integer && !msg->compressed )
 	{
-		zerror = Netchan_CompressMessage( msg );
+		zerror = Netchan_CompressMessage( msg, netchan->compressDictionary );
 		if( zerror < 0 )
 		{          // it's compression error, just send uncompressed
 			Com_DPrintf( "SV_Netchan_Transmit (ignoring compression): Compression error %i\n", zerror );
@@ -370,16 +371,14 @@ void SV_ResetClientFrameCounters( void )
 void SV_WriteFrameSnapToClient( client_t *client, msg_t *msg )
 {
 	SNAP_WriteFrameSnapToClient( &sv.gi, client, msg, sv.framenum, svs.gametime, sv.baselines,
-		&svs.client_entities, 0, NULL, NULL );
+		&svs.client_entities, sv_snapdeltacache->integer ? svs.deltacache : NULL, 0, NULL, NULL );
 }
 
 /*
-* SV_BuildClientFrameSnap
+* SV_SkyOrigin
 */
-void SV_BuildClientFrameSnap( client_t *client )
+static vec_t *SV_SkyOrigin( vec3_t origin )
 {
-	vec_t *skyorg = NULL, origin[3];
-
 	if( sv.configstrings[CS_SKYBOX][0] != '\0' )
 	{
 		int noents = 0;
@@ -388,13 +387,23 @@ void SV_BuildClientFrameSnap( client_t *client )
 		if( sscanf( sv.configstrings[CS_SKYBOX], "%f %f %f %f %f %i", &origin[0], &origin[1], &origin[2], &f1, &f2, &noents ) >= 3 )
 		{
 			if( !noents )
-				skyorg = origin;
+				return origin;
 		}
 	}
 
-	svs.fatvis.skyorg = skyorg;		// HACK HACK HACK
+	return NULL;
+}
+
+/*
+* SV_BuildClientFrameSnap
+*/
+void SV_BuildClientFrameSnap( client_t *client )
+{
+	vec3_t origin;
+
+	svs.fatvis.skyorg = SV_SkyOrigin( origin );		// HACK HACK HACK
 	SNAP_BuildClientFrameSnap( svs.cms, &sv.gi, sv.framenum, svs.gametime,
-		&svs.fatvis, client, ge->GetGameState(), 
+		&svs.fatvis, svs.viscache, client, ge->GetGameState(), 
 		&svs.client_entities,
 		false, sv_mempool );
 	svs.fatvis.skyorg = NULL;
@@ -421,14 +430,198 @@ static bool SV_SendClientDatagram( client_t *client )
 	return SV_SendMessageToClient( client, &tmpMessage );
 }
 
+//===============================================================================
+//
+//PARALLEL SNAPSHOTS
+//
+//===============================================================================
+
+// With sv_snapthreads > 0, culling, delta encoding and compression of the
+// client snapshots are spread over a pool of worker threads, which only
+// read the game state. Entity states are stored into the circular buffer
+// and the messages are sent in client order, from the main thread.
+
+#define SV_MAX_SNAP_THREADS	16
+
+typedef struct
+{
+	client_t *client;
+	bool built;
+	snapshotEntityNumbers_t entsList;
+	msg_t msg;
+	uint8_t msgData[MAX_MSGLEN];
+} sv_snapjob_t;
+
+typedef struct
+{
+	fatvis_t fatvis;
+	uint8_t compressData[MAX_MSGLEN];
+} sv_snapworker_t;
+
+typedef struct
+{
+	vec_t *skyorg;
+	game_state_t *gameState;
+} sv_snapframe_t;
+
+static qthreadpool_t *sv_snapPool;
+static int sv_numSnapWorkers;
+static sv_snapworker_t *sv_snapWorkers;     // [sv_numSnapWorkers]
+static int sv_maxSnapJobs;
+static sv_snapjob_t *sv_snapJobs;           // [sv_maxSnapJobs]
+
+/*
+* SV_ShutdownSnapThreads
+*/
+void SV_ShutdownSnapThreads( void )
+{
+	QThreadPool_Destroy( &sv_snapPool );
+
+	if( sv_snapWorkers )
+	{
+		Mem_Free( sv_snapWorkers );
+		sv_snapWorkers = NULL;
+	}
+	sv_numSnapWorkers = 0;
+
+	if( sv_snapJobs )
+	{
+		Mem_Free( sv_snapJobs );
+		sv_snapJobs = NULL;
+	}
+	sv_maxSnapJobs = 0;
+}
+
+/*
+* SV_CheckSnapThreads
+*/
+static void SV_CheckSnapThreads( void )
+{
+	int numThreads;
+
+	if( !sv_snapthreads->modified && ( !sv_snapPool || sv_maxSnapJobs == sv_maxclients->integer ) )
+		return;
+	sv_snapthreads->modified = false;
+
+	SV_ShutdownSnapThreads();
+
+	numThreads = sv_snapthreads->integer;
+	if( numThreads <= 0 )
+		return;
+	clamp_high( numThreads, SV_MAX_SNAP_THREADS );
+
+	sv_snapPool = QThreadPool_Create( numThreads );
+
+	sv_numSnapWorkers = QThreadPool_NumWorkers( sv_snapPool );
+	sv_snapWorkers = Mem_Alloc( sv_mempool, sizeof( *sv_snapWorkers ) * sv_numSnapWorkers );
+
+	sv_maxSnapJobs = sv_maxclients->integer;
+	sv_snapJobs = Mem_Alloc( sv_mempool, sizeof( *sv_snapJobs ) * sv_maxSnapJobs );
+}
+
+/*
+* SV_BuildSnapJob
+*/
+static void SV_BuildSnapJob( void *arg, int index, int worker )
+{
+	sv_snapframe_t *snapFrame = arg;
+	sv_snapjob_t *job = &sv_snapJobs[index];
+	fatvis_t *fatvis = &sv_snapWorkers[worker].fatvis;
+
+	fatvis->skyorg = snapFrame->skyorg;
+	job->built = SNAP_BuildClientFrameSnapList( svs.cms, &sv.gi, sv.framenum, svs.gametime,
+		fatvis, svs.viscache, job->client, snapFrame->gameState, false, sv_mempool, &job->entsList );
+	fatvis->skyorg = NULL;
+}
+
+/*
+* SV_WriteSnapJob
+*/
+static void SV_WriteSnapJob( void *arg, int index, int worker )
+{
+	int zerror;
+	sv_snapjob_t *job = &sv_snapJobs[index];
+	sv_snapworker_t *snapWorker = &sv_snapWorkers[worker];
+
+	SV_InitClientMessage( job->client, &job->msg, job->msgData, sizeof( job->msgData ) );
+
+	SV_AddReliableCommandsToMessage( job->client, &job->msg );
+
+	SV_WriteFrameSnapToClient( job->client, &job->msg );
+
+	if( sv_compresspackets->integer )
+	{
+		zerror = Netchan_CompressMessageExt( &job->msg, snapWorker->compressData, sizeof( snapWorker->compressData ), 
+			job->client->netchan.compressDictionary );
+		if( zerror < 0 )
+		{          // it's compression error, just send uncompressed
+			Com_DPrintf( "SV_WriteSnapJob (ignoring compression): Compression error %i\n", zerror );
+		}
+	}
+}
+
+/*
+* SV_SendClientDatagrams
+*
+* Parallel version of SV_SendClientDatagram for all queued clients
+*/
+static void SV_SendClientDatagrams( int numJobs )
+{
+	int i;
+	vec3_t skyorigin;
+	sv_snapjob_t *job;
+	sv_snapframe_t snapFrame;
+
+	snapFrame.skyorg = SV_SkyOrigin( skyorigin );
+	snapFrame.gameState = ge->GetGameState();
+
+	QThreadPool_Run( sv_snapPool, SV_BuildSnapJob, &snapFrame, numJobs );
+
+	// entity states are appended to the shared circular buffer in client order,
+	// so that all clients end up with exactly the same data as in serial mode
+	for( i = 0, job = sv_snapJobs; i < numJobs; i++, job++ )
+	{
+		if( job->built )
+			SNAP_DumpClientFrameSnapList( &sv.gi, job->client, sv.framenum, &svs.client_entities, &job->entsList );
+	}
+
+	QThreadPool_Run( sv_snapPool, SV_WriteSnapJob, NULL, numJobs );
+
+	for( i = 0, job = sv_snapJobs; i < numJobs; i++, job++ )
+	{
+		if( !SV_SendMessageToClient( job->client, &job->msg ) )
+		{
+			Com_Printf( "Error sending message to %s: %s\n", job->client->name, NET_ErrorString() );
+			if( job->client->reliable )
+			{
+				SV_DropClient( job->client, DROP_TYPE_GENERAL, "Error sending message: %s\n", NET_ErrorString() );
+			}
+		}
+	}
+}
+
 /*
 * SV_SendClientMessages
 */
 void SV_SendClientMessages( void )
 {
 	int i;
+	int numJobs;
 	client_t *client;
 
+	SV_CheckSnapThreads();
+
+	// sound culling on the snapshot workers can't read cvars
+	SNAP_UpdateSoundAttenuation();
+
+	if( sv_snapdeltacache->integer )
+		SNAP_UpdateDeltaCache( svs.deltacache, &sv.gi, sv.framenum );
+
+	// all the datagrams of the frame go out together
+	NET_BeginSendBatch();
+
+	numJobs = 0;
+
 	// send a message to each connected client
 	for( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
 	{
@@ -447,7 +640,12 @@ void SV_SendClientMessages( void )
 
 		if( client->state == CS_SPAWNED )
 		{
-			if( !SV_SendClientDatagram( client ) )
+			if( sv_snapPool )
+			{
+				// deferred to worker threads
+				sv_snapJobs[numJobs++].client = client;
+			}
+			else if( !SV_SendClientDatagram( client ) )
 			{
 				Com_Printf( "Error sending message to %s: %s\n", client->name, NET_ErrorString() );
 				if( client->reliable )
@@ -475,4 +673,9 @@ void SV_SendClientMessages( void )
 			}
 		}
 	}
+
+	if( numJobs )
+		SV_SendClientDatagrams( numJobs );
+
+	NET_FlushSendBatch();
 }
@@ -24,7 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #ifdef HTTP_SUPPORT
 
-#define MAX_INCOMING_HTTP_CONNECTIONS			48
+#define MAX_INCOMING_HTTP_CONNECTIONS			256
 #define MAX_INCOMING_HTTP_CONNECTIONS_PER_ADDR	3
 
 #define MAX_INCOMING_CONTENT_LENGTH				0x2800
@@ -33,6 +33,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define INCOMING_HTTP_CONNECTION_SEND_TIMEOUT	15 // seconds
 
 #define HTTP_SERVER_SLEEP_TIME					50 // milliseconds
+#define HTTP_SERVER_THROTTLE_TIME				10 // milliseconds, poll timeout while downloads are held back by rate limits
+
+#define HTTP_RATE_BURST_TIME					250 // milliseconds worth of bytes a download may save up
+#define HTTP_MIN_SEND_SIZE						4096 // don't wake up throttled downloads for less than this
+
+#define MAX_HTTP_CACHED_FILES					MAX_INCOMING_HTTP_CONNECTIONS
+#define HTTP_CACHED_FILE_TIMEOUT				60 // seconds
 
 typedef enum
 {
@@ -88,6 +95,23 @@ typedef struct {
 	bool close_after_resp;
 } sv_http_request_t;
 
+typedef struct {
+	char *filename;
+	int file;
+	int fileno;
+	size_t data_offset;
+	size_t length;
+	time_t mtime;
+	int refcount;
+	bool stale;                     // changed on disk, closed once the last download is done
+	unsigned int last_used;
+} sv_http_cachedfile_t;
+
+typedef struct {
+	int64_t tokens;                 // in 1/1000 of a byte
+	unsigned int time;
+} sv_http_rate_t;
+
 typedef struct {
 	uint64_t request_id;
 	http_response_code_t code;
@@ -97,9 +121,7 @@ typedef struct {
 	char *content;
 	size_t content_length;
 
-	int file;
-	int fileno;
-	size_t file_data_offset;
+	sv_http_cachedfile_t *file;
 	size_t file_send_pos;
 	char *filename;
 } sv_http_response_t;
@@ -115,6 +137,9 @@ typedef struct sv_http_connection_s
 
 	unsigned int last_active;
 
+	sv_http_rate_t rate;
+	size_t send_budget;             // file content bytes that may be sent this frame
+
 	sv_http_request_t request;
 	sv_http_response_t response;
 
@@ -140,9 +165,13 @@ static sv_http_connection_t sv_http_connection_headnode, *sv_free_http_connectio
 
 static socket_t sv_socket_http;
 static socket_t sv_socket_http6;
+static netpoll_t *sv_http_poll;
 
 static netadr_t sv_web_upstream_addr;
 
+static sv_http_cachedfile_t sv_http_cachedfiles[MAX_HTTP_CACHED_FILES];
+static sv_http_rate_t sv_http_totalrate;
+
 static uint64_t sv_http_request_autoicr;
 
 static trie_t *sv_http_clients = NULL;
@@ -223,6 +252,121 @@ static uint64_t SV_Web_GetNewRequestId( void )
 	return sv_http_request_autoicr++;
 }
 
+/*
+* SV_Web_CloseCachedFile
+*/
+static void SV_Web_CloseCachedFile( sv_http_cachedfile_t *cf )
+{
+	FS_FCloseFile( cf->file );
+	Mem_Free( cf->filename );
+	memset( cf, 0, sizeof( *cf ) );
+}
+
+/*
+* SV_Web_OpenCachedFile
+*
+* Downloads of the same file share a single handle, sendfile is given
+* explicit offsets so the file position is never touched
+*/
+static sv_http_cachedfile_t *SV_Web_OpenCachedFile( const char *filename )
+{
+	int i, file, length;
+	time_t mtime;
+	sv_http_cachedfile_t *cf, *slot = NULL;
+
+	mtime = FS_BaseFileMTime( filename );
+
+	for( i = 0, cf = sv_http_cachedfiles; i < MAX_HTTP_CACHED_FILES; i++, cf++ ) {
+		if( !cf->filename ) {
+			if( !slot || slot->filename ) {
+				slot = cf;
+			}
+			continue;
+		}
+		if( cf->stale || strcmp( cf->filename, filename ) ) {
+			// remember the least recently used idle file in case there are no free slots
+			if( !cf->refcount && ( !slot || ( slot->filename && cf->last_used < slot->last_used ) ) ) {
+				slot = cf;
+			}
+			continue;
+		}
+
+		if( cf->mtime == mtime ) {
+			cf->refcount++;
+			cf->last_used = Sys_Milliseconds();
+			return cf;
+		}
+
+		// replaced on disk, let the running downloads finish with the old file
+		if( cf->refcount ) {
+			cf->stale = true;
+			continue;
+		}
+		SV_Web_CloseCachedFile( cf );
+		slot = cf;
+	}
+
+	// every connection holds at most one file so there's always a slot
+	assert( slot != NULL );
+	if( !slot ) {
+		return NULL;
+	}
+
+	length = FS_FOpenBaseFile( filename, &file, FS_READ );
+	if( !file ) {
+		return NULL;
+	}
+
+	if( slot->filename ) {
+		SV_Web_CloseCachedFile( slot );
+	}
+
+	slot->fileno = FS_FileNo( file, &slot->data_offset );
+	if( slot->fileno == -1 ) {
+		FS_FCloseFile( file );
+		return NULL;
+	}
+
+	slot->filename = ZoneCopyString( filename );
+	slot->file = file;
+	slot->length = length;
+	slot->mtime = mtime;
+	slot->stale = false;
+	slot->refcount = 1;
+	slot->last_used = Sys_Milliseconds();
+	return slot;
+}
+
+/*
+* SV_Web_ReleaseCachedFile
+*/
+static void SV_Web_ReleaseCachedFile( sv_http_cachedfile_t *cf )
+{
+	assert( cf->refcount > 0 );
+
+	cf->refcount--;
+	cf->last_used = Sys_Milliseconds();
+	if( !cf->refcount && cf->stale ) {
+		SV_Web_CloseCachedFile( cf );
+	}
+}
+
+/*
+* SV_Web_ExpireCachedFiles
+*/
+static void SV_Web_ExpireCachedFiles( bool all )
+{
+	int i;
+	sv_http_cachedfile_t *cf;
+	unsigned int now = Sys_Milliseconds();
+
+	for( i = 0, cf = sv_http_cachedfiles; i < MAX_HTTP_CACHED_FILES; i++, cf++ ) {
+		if( cf->filename && !cf->refcount && ( all || now > cf->last_used + HTTP_CACHED_FILE_TIMEOUT*1000 ) ) {
+			SV_Web_CloseCachedFile( cf );
+		}
+	}
+}
+
 /*
 * SV_Web_ResetResponse
 */
@@ -233,11 +377,9 @@ static void SV_Web_ResetResponse( sv_http_response_t *response )
 		response->filename = NULL;
 	}
 	if( response->file ) {
-		FS_FCloseFile( response->file );
-		response->file = 0;
+		SV_Web_ReleaseCachedFile( response->file );
+		response->file = NULL;
 	}
-	response->fileno = -1;
-	response->file_data_offset = 0;
 	response->file_send_pos = 0;
 
 	response->content_state = CONTENT_STATE_DEFAULT;
@@ -278,6 +420,9 @@ static sv_http_connection_t *SV_Web_AllocConnection( void )
 	con->state = HTTP_CONN_STATE_NONE;
 	con->close_after_resp = false;
 	con->is_upstream = false;
+	con->rate.tokens = (int64_t)max( sv_http_maxrate->integer, 0 ) * HTTP_RATE_BURST_TIME;
+	con->rate.time = Sys_Milliseconds();
+	con->send_budget = 0;
 	return con;
 }
 
@@ -313,7 +458,7 @@ static void SV_Web_InitConnections( void )
 	sv_free_http_connections = sv_http_connections;
 	sv_http_connection_headnode.prev = &sv_http_connection_headnode;
 	sv_http_connection_headnode.next = &sv_http_connection_headnode;
-	for( i = 0; i < MAX_INCOMING_HTTP_CONNECTIONS - 2; i++ ) {
+	for( i = 0; i < MAX_INCOMING_HTTP_CONNECTIONS - 1; i++ ) {
 		sv_http_connections[i].next = &sv_http_connections[i+1];
 	}
 }
@@ -531,6 +676,136 @@ static int64_t SV_Web_SendFile( sv_http_connection_t *con, int fileno, size_t fi
 	return sent;
 }
 
+// ============================================================================
+// Download rate limits
+
+/*
+* SV_Web_RefillRate
+*/
+static void SV_Web_RefillRate( sv_http_rate_t *rate, int maxrate, unsigned int now )
+{
+	int64_t burst;
+
+	if( maxrate <= 0 ) {
+		rate->tokens = 0;
+		rate->time = now;
+		return;
+	}
+
+	burst = (int64_t)maxrate * HTTP_RATE_BURST_TIME;
+	rate->tokens += (int64_t)( now - rate->time ) * maxrate;
+	if( rate->tokens > burst ) {
+		rate->tokens = burst;
+	}
+	rate->time = now;
+}
+
+/*
+* SV_Web_IsThrottled
+*
+* Throttled connections are left out of polling until their budget refills
+*/
+static bool SV_Web_IsThrottled( const sv_http_connection_t *con )
+{
+	return con->state == HTTP_CONN_STATE_SEND && con->response.file
+		&& con->response.stream.header_done && !con->send_budget;
+}
+
+/*
+* SV_Web_UpdateSendBudgets
+*
+* Refills the per-connection and global download rates and hands out
+* this frame's budgets. The global rate is split evenly between the
+* connections sending files, starting from a different one each frame
+* when there isn't enough for everyone. Returns the number of connections
+* that have to wait.
+*/
+static int SV_Web_UpdateSendBudgets( void )
+{
+	static unsigned int rotation;
+	int i, numsending, numthrottled;
+	int maxrate, maxtotalrate;
+	int64_t avail, share, budget, threshold, remaining;
+	unsigned int now = Sys_Milliseconds();
+	sv_http_connection_t *con;
+
+	maxrate = sv_http_maxrate->integer;
+	maxtotalrate = sv_http_maxtotalrate->integer;
+
+	SV_Web_RefillRate( &sv_http_totalrate, maxtotalrate, now );
+
+	numsending = 0;
+	for( i = 0, con = sv_http_connections; i < MAX_INCOMING_HTTP_CONNECTIONS; i++, con++ ) {
+		if( con->state == HTTP_CONN_STATE_SEND && con->response.file ) {
+			numsending++;
+		}
+	}
+
+	avail = max( sv_http_totalrate.tokens, 0 ) / 1000;
+	share = max( avail / max( numsending, 1 ), HTTP_MIN_SEND_SIZE );
+
+	numthrottled = 0;
+	rotation++;
+	for( i = 0; i < MAX_INCOMING_HTTP_CONNECTIONS; i++ ) {
+		con = &sv_http_connections[( rotation + i ) % MAX_INCOMING_HTTP_CONNECTIONS];
+		if( con->state == HTTP_CONN_STATE_NONE ) {
+			continue;
+		}
+
+		SV_Web_RefillRate( &con->rate, maxrate, now );
+
+		if( maxrate <= 0 && maxtotalrate <= 0 ) {
+			con->send_budget = SIZE_MAX;
+			continue;
+		}
+
+		// don't bother with tiny sends unless that's all the limits will ever allow
+		remaining = con->response.stream.content_length - con->response.stream.content_p;
+		threshold = max( min( remaining, HTTP_MIN_SEND_SIZE ), 1 );
+
+		budget = INT64_MAX;
+		if( maxrate > 0 ) {
+			budget = max( con->rate.tokens, 0 ) / 1000;
+			threshold = min( threshold, (int64_t)maxrate * HTTP_RATE_BURST_TIME / 1000 );
+		}
+		if( maxtotalrate > 0 ) {
+			budget = min( budget, min( share, avail ) );
+			threshold = min( threshold, (int64_t)maxtotalrate * HTTP_RATE_BURST_TIME / 1000 );
+		}
+
+		if( budget < threshold ) {
+			con->send_budget = 0;
+			if( con->state == HTTP_CONN_STATE_SEND && con->response.file ) {
+				numthrottled++;
+			}
+			continue;
+		}
+
+		con->send_budget = (size_t)budget;
+		if( con->state == HTTP_CONN_STATE_SEND && con->response.file ) {
+			avail -= budget;
+		}
+	}
+
+	return numthrottled;
+}
+
+/*
+* SV_Web_ChargeRate
+*/
+static void SV_Web_ChargeRate( sv_http_connection_t *con, size_t sent )
+{
+	if( con->send_budget != SIZE_MAX ) {
+		con->send_budget -= min( con->send_budget, sent );
+	}
+	if( sv_http_maxrate->integer > 0 ) {
+		con->rate.tokens -= (int64_t)sent * 1000;
+	}
+	if( sv_http_maxtotalrate->integer > 0 ) {
+		sv_http_totalrate.tokens -= (int64_t)sent * 1000;
+	}
+}
+
 // ============================================================================
 // Inter-threading communication
 // Passes queries and responses from the web thread to the main thread and back.
@@ -798,42 +1073,38 @@ static void SV_Web_AnalyzeHeader( sv_http_request_t *request, const char *key, c
 			request->error = HTTP_RESP_BAD_REQUEST;
 		}
 		else {
-			bool neg_end = false;
-			const char *p = value;
+			const char *p;
+			bool suffix = ( delim == value + 6 );
+			bool open_end = ( *(delim+1) == '\0' );
 
 			// first byte pos
-			while( *p && p < delim ) {
+			for( p = value + 6; p < delim; p++ ) {
 				if( *p >= '0' && *p <= '9' )
 					stream->content_range.begin = stream->content_range.begin*10 + *p - '0';
-				p++;
 			}
-			p++;
 
 			// last byte pos
-			if( *p == '-' ) {
-				if( value != delim ) {
-					request->error = HTTP_RESP_REQUESTED_RANGE_NOT_SATISFIABLE;
-					return;
-				}
-				neg_end = true;
-				p++;
-			}
-			while( *p ) {
+			for( p = delim + 1; *p; p++ ) {
 				if( *p >= '0' && *p <= '9' )
-				stream->content_range.end = stream->content_range.end*10 + *p++ - '0';
+					stream->content_range.end = stream->content_range.end*10 + *p - '0';
 			}
 
 			// partial content request
-			if( neg_end && stream->content_range.end ) {
+			if( suffix ) {
 				// bytes=-100
+				if( !stream->content_range.end ) {
+					request->error = HTTP_RESP_REQUESTED_RANGE_NOT_SATISFIABLE;
+					return;
+				}
 				request->partial = true;
 				stream->content_range.end = -stream->content_range.end;
+			} else if( open_end ) {
+				// bytes=200-
+				request->partial = true;
+				stream->content_range.end = LONG_MAX;
 			} else if( stream->content_range.end >= stream->content_range.begin ) {
 				// bytes=200-300
 				request->partial = true;
-			} else if( stream->content_range.begin >= 0 && *(delim+1) == '\0' ) {
-				// bytes=200-
-				request->partial = true;
 			}
 
 			if( request->partial ) {
@@ -1108,16 +1379,12 @@ static void SV_Web_RouteRequest( const sv_http_request_t *request, sv_http_respo
 				return;
 			}
 
-			*content_length = FS_FOpenBaseFile( filename, &response->file, FS_READ );
-			response->fileno = -1;
-			if( response->file ) {
-				response->fileno = FS_FileNo( response->file, &response->file_data_offset );
-			}
-			if( response->fileno == -1 ) {
+			response->file = SV_Web_OpenCachedFile( filename );
+			if( !response->file ) {
 				response->code = HTTP_RESP_NOT_FOUND;
-				*content_length = 0;
 			}
 			else {
+				*content_length = response->file->length;
 				response->code = HTTP_RESP_OK;
 			}
 		}
@@ -1167,31 +1434,38 @@ static void SV_Web_RespondToQuery( sv_http_connection_t *con )
 			Com_Printf( "HTTP serving file '%s' to '%s'\n", response->filename, NET_AddressToString( &con->address ) );
 		}
 
-		// serve range requests
+		// serve range requests, the file handle is shared so only the send position is set
 		if( request->partial && response->file ) {
-			// seek to first byte pos and clamp the last byte pos to content length
-			if( request->partial_content_range.begin > 0 ) { 
-				FS_Seek( response->file, request->partial_content_range.begin, FS_SEEK_SET );
-				// range.end may be set to 0 for 'bytes=100-' style requests
-				response->stream.content_range.end = request->partial_content_range.end 
-					? request->partial_content_range.end : content_length;
-
-			} else if( request->partial_content_range.end < 0 ) {
-				// seek to N last bytes in the file
-				FS_Seek( response->file, request->partial_content_range.end, FS_SEEK_END );
-				response->stream.content_range.end = -request->partial_content_range.end;
+			long begin, last;
+
+			if( request->partial_content_range.end < 0 ) {
+				// N last bytes in the file
+				begin = max( (long)content_length + request->partial_content_range.end, 0 );
+				last = (long)content_length - 1;
+			}
+			else {
+				// range.end is LONG_MAX for 'bytes=100-' style requests
+				begin = request->partial_content_range.begin;
+				last = min( request->partial_content_range.end, (long)content_length - 1 );
 			}
 
-			// Content-Range header values
-			response->file_send_pos = FS_Tell( response->file );
-			response->stream.content_range.begin = response->file_send_pos;
-			response->stream.content_range.end = min( (int)content_length, response->stream.content_range.end );
-			response->code = HTTP_RESP_PARTIAL_CONTENT;
+			if( begin >= (long)content_length || last < begin ) {
+				response->code = HTTP_RESP_REQUESTED_RANGE_NOT_SATISFIABLE;
+				SV_Web_ReleaseCachedFile( response->file );
+				response->file = NULL;
+			}
+			else {
+				// Content-Range header values, the last byte pos is inclusive
+				response->file_send_pos = begin;
+				response->stream.content_range.begin = begin;
+				response->stream.content_range.end = last;
+				response->code = HTTP_RESP_PARTIAL_CONTENT;
+			}
 		}
 
 		if( request->method == HTTP_METHOD_HEAD && response->file ) {
-			FS_FCloseFile( response->file );
-			response->file = 0;
+			SV_Web_ReleaseCachedFile( response->file );
+			response->file = NULL;
 		}
 	}
 
@@ -1204,12 +1478,20 @@ static void SV_Web_RespondToQuery( sv_http_connection_t *con )
 	Q_strncatz( resp_stream->header_buf, "Accept-Ranges: bytes\r\n", 
 			sizeof( resp_stream->header_buf ) );
 
-	if( response->code == HTTP_RESP_REQUESTED_RANGE_NOT_SATISFIABLE ) {
-		int file_length = FS_FOpenBaseFile( request->resource, NULL, FS_READ );
+	if( con->close_after_resp ) {
+		Q_strncatz( resp_stream->header_buf, "Connection: close\r\n", 
+			sizeof( resp_stream->header_buf ) );
+	}
+	else {
+		// HTTP/1.1 connections stay open for the next request until they idle out
+		Q_snprintfz( vastr, sizeof( vastr ), "Keep-Alive: timeout=%i\r\n", INCOMING_HTTP_CONNECTION_RECV_TIMEOUT );
+		Q_strncatz( resp_stream->header_buf, vastr, sizeof( resp_stream->header_buf ) );
+	}
 
+	if( response->code == HTTP_RESP_REQUESTED_RANGE_NOT_SATISFIABLE ) {
 		// in accordance with RFC 2616, send the Content-Range entity header,
 		// specifying the length of the resource
-		if( file_length < 0 ) {
+		if( !content_length ) {
 			Q_strncatz( resp_stream->header_buf, "Content-Range: bytes */*\r\n",
 				sizeof( resp_stream->header_buf ) );
 		}
@@ -1219,10 +1501,10 @@ static void SV_Web_RespondToQuery( sv_http_connection_t *con )
 		}
 	}
 	else if( response->code == HTTP_RESP_PARTIAL_CONTENT ) {
-		Q_snprintfz( vastr, sizeof( vastr ), "Content-Range: bytes %i-%i/%i\r\n", 
+		Q_snprintfz( vastr, sizeof( vastr ), "Content-Range: bytes %li-%li/%i\r\n", 
 			response->stream.content_range.begin, response->stream.content_range.end, content_length );
 		Q_strncatz( resp_stream->header_buf, vastr, sizeof( resp_stream->header_buf ) );
-		content_length = response->stream.content_range.end - response->stream.content_range.begin;
+		content_length = response->stream.content_range.end - response->stream.content_range.begin + 1;
 	}
 
 	if( response->code >= HTTP_RESP_BAD_REQUEST || !content_length ) {
@@ -1294,8 +1576,15 @@ static size_t SV_Web_SendResponse( sv_http_connection_t *con )
 	if( stream->header_done && stream->content_length ) {
 		while( stream->content_p < stream->content_length && sv_http_running ) {
 			if( response->file ) {
-				sendbuf_size = stream->content_length - stream->content_p;
-				sent = SV_Web_SendFile( con, response->fileno, response->file_data_offset, &response->file_send_pos, sendbuf_size );
+				sendbuf_size = min( stream->content_length - stream->content_p, con->send_budget );
+				if( !sendbuf_size ) {
+					// out of budget for this frame
+					break;
+				}
+				sent = SV_Web_SendFile( con, response->file->fileno, response->file->data_offset, &response->file_send_pos, sendbuf_size );
+				if( sent > 0 ) {
+					SV_Web_ChargeRate( con, sent );
+				}
 			}
 			else {
 				if( !stream->content ) {
@@ -1437,6 +1726,8 @@ static void SV_Web_Listen( socket_t *socket )
 			if( !con ) {
 				break;
 			}
+			// don't let closing a stalled download hold up the web thread
+			NET_SetSocketLinger( &newsocket, -1 );
 			con->socket = newsocket;
 			con->address = newaddress;
 			con->last_active = Sys_Milliseconds();
@@ -1462,6 +1753,10 @@ void SV_Web_Init( void )
 
 	SV_Web_InitConnections();
 
+	memset( sv_http_cachedfiles, 0, sizeof( sv_http_cachedfiles ) );
+	sv_http_totalrate.tokens = 0;
+	sv_http_totalrate.time = Sys_Milliseconds();
+
 	if( !sv_http->integer ) {
 		return;
 	}
@@ -1493,6 +1788,7 @@ static void SV_Web_Frame( void )
 	socket_t *sockets[MAX_INCOMING_HTTP_CONNECTIONS+1];
 	void *connections[MAX_INCOMING_HTTP_CONNECTIONS];
 	int num_sockets = 0;
+	int timeout;
 	bool upstream_is_set;
 
 	if( !sv_http_initialized ) {
@@ -1522,6 +1818,9 @@ static void SV_Web_Frame( void )
 		SV_Web_Listen( &sv_socket_http6 );
 	}
 
+	// wake up more often while downloads are held back by the rate limits
+	timeout = SV_Web_UpdateSendBudgets() ? HTTP_SERVER_THROTTLE_TIME : HTTP_SERVER_SLEEP_TIME;
+
 	// handle incoming data
 	num_sockets = 0;
 	for( con = hnode->prev; con != hnode; con = next )
@@ -1531,6 +1830,9 @@ static void SV_Web_Frame( void )
 			case HTTP_CONN_STATE_RECV:
 			case HTTP_CONN_STATE_RESP:
 			case HTTP_CONN_STATE_SEND:
+				if( SV_Web_IsThrottled( con ) ) {
+					break;
+				}
 				sockets[num_sockets] = &con->socket;
 				connections[num_sockets] = con;
 				num_sockets++;
@@ -1545,7 +1847,7 @@ static void SV_Web_Frame( void )
 	SV_Web_ReadOutgoingQueueCmds();
 
 	if( num_sockets != 0 ) {
-		NET_Monitor( HTTP_SERVER_SLEEP_TIME, sockets,
+		NET_PollMonitor( sv_http_poll, timeout, sockets,
 			(void (*)(socket_t *, void*))SV_Web_ReceiveRequest,
 			(void (*)(socket_t *, void*))SV_Web_WriteResponse,
 			NULL, connections );
@@ -1559,9 +1861,11 @@ static void SV_Web_Frame( void )
 			sockets[num_sockets++] = &sv_socket_http6;
 		}
 		sockets[num_sockets] = NULL;
-		NET_Sleep( HTTP_SERVER_SLEEP_TIME, sockets );
+		NET_PollSleep( sv_http_poll, timeout, sockets );
 	}
 
+	SV_Web_ExpireCachedFiles( false );
+
 	// close dead connections
 	for( con = hnode->prev; con != hnode; con = next )
 	{
@@ -1598,6 +1902,389 @@ static void SV_Web_Frame( void )
 	}
 }
 
+/*
+* HTTP download load test
+*
+* Runs the server for a while without downloads and then while a separate thread
+* keeps the given number of loopback downloads going, and compares the server
+* frame times of both phases. The downloads use a session of their own, like a
+* connected client would, and request the file over and over on the same
+* keep-alive connections.
+*/
+
+#define HTTP_BENCH_MAX_SECONDS		60
+#define HTTP_BENCH_MAX_HEADER		1024
+
+typedef struct
+{
+	socket_t socket;
+	bool sent;
+	unsigned int requests;		// completed on this connection
+	unsigned int last_active;
+	size_t received;			// including the header
+	size_t expected;			// header and content, 0 until the header is complete
+	size_t header_length;
+	char header[HTTP_BENCH_MAX_HEADER];
+} sv_http_benchcon_t;
+
+typedef struct
+{
+	unsigned int count;
+	double sum, sumsq, max;
+} sv_http_benchstats_t;
+
+typedef struct
+{
+	int phase;					// 0 = not running, 1 = idle, 2 = downloading
+	unsigned int phase_end;
+	unsigned int seconds;
+	uint64_t last_frame;
+	sv_http_benchstats_t frametime[2];
+	sv_http_benchstats_t interval[2];
+
+	char filename[MAX_QPATH];
+	char request[MAX_QPATH + 128];
+	char session[HTTP_CLIENT_SESSION_SIZE];
+	netadr_t address;
+	int num_connections;
+
+	// owned by the download thread while it runs
+	volatile bool running;
+	qthread_t *thread;
+	sv_http_benchcon_t cons[MAX_INCOMING_HTTP_CONNECTIONS];
+	uint64_t bytes;
+	unsigned int downloads, connects, errors;
+} sv_http_bench_t;
+
+static sv_http_bench_t sv_http_bench;
+
+/*
+* SV_Web_BenchAddSample
+*/
+static void SV_Web_BenchAddSample( sv_http_benchstats_t *stats, double usec )
+{
+	stats->count++;
+	stats->sum += usec;
+	stats->sumsq += usec * usec;
+	if( usec > stats->max ) {
+		stats->max = usec;
+	}
+}
+
+/*
+* SV_Web_BenchCloseCon
+*/
+static void SV_Web_BenchCloseCon( sv_http_benchcon_t *bc )
+{
+	if( bc->socket.open ) {
+		NET_CloseSocket( &bc->socket );
+	}
+	bc->sent = false;
+	bc->requests = 0;
+	bc->received = bc->expected = bc->header_length = 0;
+}
+
+/*
+* SV_Web_BenchParseHeader
+*
+* Returns false on errors, sets expected once the whole header is in
+*/
+static bool SV_Web_BenchParseHeader( sv_http_benchcon_t *bc, const char *data, size_t length )
+{
+	char *end, *value;
+	size_t copy;
+
+	copy = min( length, sizeof( bc->header ) - 1 - bc->header_length );
+	memcpy( bc->header + bc->header_length, data, copy );
+	bc->header_length += copy;
+	bc->header[bc->header_length] = '\0';
+
+	end = strstr( bc->header, "\r\n\r\n" );
+	if( !end ) {
+		return bc->header_length < sizeof( bc->header ) - 1;
+	}
+	end[2] = '\0';
+
+	if( strncmp( bc->header, "HTTP/", 5 ) || !strstr( bc->header, " 200 " ) ) {
+		return false;
+	}
+
+	value = strstr( bc->header, "Content-Length:" );
+	if( !value ) {
+		return false;
+	}
+
+	bc->expected = end + 4 - bc->header + (size_t)atoi( value + strlen( "Content-Length:" ) );
+	return true;
+}
+
+/*
+* SV_Web_BenchPollCon
+*
+* Returns true if the connection is waiting for data
+*/
+static bool SV_Web_BenchPollCon( sv_http_bench_t *bench, sv_http_benchcon_t *bc, uint8_t *buf, size_t buf_size )
+{
+	int ret;
+	size_t length;
+	netadr_t address;
+	connection_status_t status;
+	unsigned int now = Sys_Milliseconds();
+
+	if( !bc->socket.open ) {
+		NET_InitAddress( &address, bench->address.type );
+		if( !NET_OpenSocket( &bc->socket, SOCKET_TCP, &address, false ) ) {
+			bench->errors++;
+			return false;
+		}
+		NET_SetSocketLinger( &bc->socket, -1 );
+		bc->last_active = now;
+		bench->connects++;
+		status = NET_Connect( &bc->socket, &bench->address );
+	}
+	else {
+		status = NET_CheckConnect( &bc->socket );
+	}
+
+	if( status == CONNECTION_INPROGRESS ) {
+		return false;
+	}
+	if( status == CONNECTION_FAILED ) {
+		bench->errors++;
+		SV_Web_BenchCloseCon( bc );
+		return false;
+	}
+
+	if( !bc->sent ) {
+		length = strlen( bench->request );
+		if( NET_Send( &bc->socket, bench->request, length, &bench->address ) != (int)length ) {
+			bench->errors++;
+			SV_Web_BenchCloseCon( bc );
+			return false;
+		}
+		bc->sent = true;
+	}
+
+	// NET_Get doesn't tell a closed connection from one without data,
+	// so rely on the content length and a timeout
+	while( ( ret = NET_Get( &bc->socket, NULL, buf, buf_size ) ) > 0 ) {
+		bc->last_active = now;
+		bc->received += ret;
+		bench->bytes += ret;
+
+		if( !bc->expected && !SV_Web_BenchParseHeader( bc, (char *)buf, ret ) ) {
+			ret = -1;
+			break;
+		}
+		if( bc->expected && bc->received >= bc->expected ) {
+			// keep the connection for the next request
+			bench->downloads++;
+			bc->requests++;
+			bc->sent = false;
+			bc->received = bc->expected = bc->header_length = 0;
+			return false;
+		}
+	}
+
+	if( ret < 0 || now > bc->last_active + INCOMING_HTTP_CONNECTION_SEND_TIMEOUT*1000 ) {
+		bench->errors++;
+		SV_Web_BenchCloseCon( bc );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+* SV_Web_BenchThreadProc
+*/
+static void *SV_Web_BenchThreadProc( void *param )
+{
+	int i, num_sockets;
+	uint8_t buf[0x4000];
+	socket_t *sockets[MAX_INCOMING_HTTP_CONNECTIONS+1];
+	sv_http_bench_t *bench = param;
+	netpoll_t *poll = NET_CreatePoll( "httpbench" );
+
+	while( bench->running ) {
+		num_sockets = 0;
+		for( i = 0; i < bench->num_connections; i++ ) {
+			if( SV_Web_BenchPollCon( bench, &bench->cons[i], buf, sizeof( buf ) ) ) {
+				sockets[num_sockets++] = &bench->cons[i].socket;
+			}
+		}
+		sockets[num_sockets] = NULL;
+
+		if( num_sockets ) {
+			NET_PollSleep( poll, 1, sockets );
+		}
+		else {
+			Sys_Sleep( 1 );
+		}
+	}
+
+	for( i = 0; i < bench->num_connections; i++ ) {
+		SV_Web_BenchCloseCon( &bench->cons[i] );
+	}
+
+	NET_DestroyPoll( &poll );
+	return NULL;
+}
+
+/*
+* SV_Web_StopBenchmark
+*/
+static void SV_Web_StopBenchmark( void )
+{
+	sv_http_bench_t *bench = &sv_http_bench;
+
+	if( bench->thread ) {
+		bench->running = false;
+		QThread_Join( bench->thread );
+		bench->thread = NULL;
+	}
+	if( bench->session[0] ) {
+		SV_Web_RemoveGameClient( bench->session );
+		bench->session[0] = '\0';
+	}
+	bench->phase = 0;
+}
+
+/*
+* SV_Web_PrintBenchStats
+*/
+static void SV_Web_PrintBenchStats( const char *name, const sv_http_benchstats_t *stats )
+{
+	double mean, variance;
+
+	if( !stats->count ) {
+		Com_Printf( "%-16s no frames\n", name );
+		return;
+	}
+
+	mean = stats->sum / stats->count;
+	variance = max( stats->sumsq / stats->count - mean * mean, 0 );
+	Com_Printf( "%-16s %6u frames, mean %7.3f ms, stddev %7.3f ms, max %7.3f ms\n", name, stats->count, 
+		mean / 1000.0, sqrt( variance ) / 1000.0, stats->max / 1000.0 );
+}
+
+/*
+* SV_Web_BenchmarkRunning
+*/
+bool SV_Web_BenchmarkRunning( void )
+{
+	return sv_http_bench.phase != 0;
+}
+
+/*
+* SV_Web_BenchmarkFrame
+*
+* Called by SV_Frame after each game frame with the time the frame started
+*/
+void SV_Web_BenchmarkFrame( uint64_t frameStart )
+{
+	uint64_t now;
+	sv_http_bench_t *bench = &sv_http_bench;
+
+	if( !bench->phase ) {
+		return;
+	}
+
+	now = Sys_Microseconds();
+	SV_Web_BenchAddSample( &bench->frametime[bench->phase - 1], now - frameStart );
+	if( bench->last_frame ) {
+		SV_Web_BenchAddSample( &bench->interval[bench->phase - 1], frameStart - bench->last_frame );
+	}
+	bench->last_frame = frameStart;
+
+	if( Sys_Milliseconds() < bench->phase_end ) {
+		return;
+	}
+
+	if( bench->phase == 1 ) {
+		bench->phase = 2;
+		bench->phase_end = Sys_Milliseconds() + bench->seconds * 1000;
+		bench->last_frame = 0;
+		bench->running = true;
+		bench->thread = QThread_Create( SV_Web_BenchThreadProc, bench );
+		return;
+	}
+
+	SV_Web_StopBenchmark();
+
+	Com_Printf( "httpbench: %i downloads of %s, %u seconds each phase\n", bench->num_connections, 
+		bench->filename, bench->seconds );
+	SV_Web_PrintBenchStats( "idle time", &bench->frametime[0] );
+	SV_Web_PrintBenchStats( "loaded time", &bench->frametime[1] );
+	SV_Web_PrintBenchStats( "idle interval", &bench->interval[0] );
+	SV_Web_PrintBenchStats( "loaded interval", &bench->interval[1] );
+	Com_Printf( "%u downloads completed over %u connections, %.1f MB received (%.1f MB/s), %u errors\n", 
+		bench->downloads, bench->connects, bench->bytes / ( 1024.0 * 1024.0 ), 
+		bench->bytes / ( 1024.0 * 1024.0 ) / bench->seconds, bench->errors );
+}
+
+/*
+* SV_Web_Benchmark
+*/
+void SV_Web_Benchmark( const char *filename, int numConnections, int seconds )
+{
+	unsigned int i;
+	sv_http_bench_t *bench = &sv_http_bench;
+	const socket_t *socket;
+	const char *extension;
+
+	if( !sv_http_running ) {
+		Com_Printf( "The HTTP server is not running\n" );
+		return;
+	}
+	if( bench->phase ) {
+		Com_Printf( "httpbench is already running\n" );
+		return;
+	}
+	if( !COM_ValidateRelativeFilename( filename ) || strlen( filename ) >= sizeof( bench->filename ) ) {
+		Com_Printf( "Invalid file name: %s\n", filename );
+		return;
+	}
+	extension = COM_FileExtension( filename );
+	if( !extension || !( FS_CheckPakExtension( filename ) || !Q_stricmp( extension, APP_DEMO_EXTENSION_STR ) ) ) {
+		Com_Printf( "Only pack and demo files are served over HTTP\n" );
+		return;
+	}
+
+	socket = sv_socket_http.address.type == NA_IP ? &sv_socket_http : &sv_socket_http6;
+
+	memset( bench, 0, sizeof( *bench ) );
+	bench->address = socket->address;
+	if( NET_IsAnyAddress( &bench->address ) ) {
+		NET_StringToAddress( bench->address.type == NA_IP ? "127.0.0.1" : "::1", &bench->address );
+		NET_SetAddressPort( &bench->address, NET_GetAddressPort( &socket->address ) );
+	}
+
+	// downloads are only served to connected clients, so register a session for client 0
+	for( i = 0; i < sizeof( bench->session ) - 1; i++ ) {
+		bench->session[i] = 'a' + rand() % 26;
+	}
+	bench->session[i] = '\0';
+	if( !SV_Web_AddGameClient( bench->session, 0, &bench->address ) ) {
+		Com_Printf( "Couldn't register the httpbench session\n" );
+		bench->session[0] = '\0';
+		return;
+	}
+
+	Q_strncpyz( bench->filename, filename, sizeof( bench->filename ) );
+	Q_snprintfz( bench->request, sizeof( bench->request ), 
+		"GET /files/%s HTTP/1.1\r\nHost: %s\r\nX-Client: 0\r\nX-Session: %s\r\n\r\n", 
+		filename, NET_AddressToString( &bench->address ), bench->session );
+
+	bench->num_connections = bound( 1, numConnections, MAX_INCOMING_HTTP_CONNECTIONS );
+	bench->seconds = bound( 1, seconds, HTTP_BENCH_MAX_SECONDS );
+	bench->phase = 1;
+	bench->phase_end = Sys_Milliseconds() + bench->seconds * 1000;
+
+	Com_Printf( "httpbench: measuring %u seconds idle, then %u seconds with %i downloads\n", 
+		bench->seconds, bench->seconds, bench->num_connections );
+}
+
 /*
 * SV_Web_Running
 */
@@ -1619,11 +2306,16 @@ void SV_Web_GameFrame( http_game_query_cb cb )
 */
 static void *SV_Web_ThreadProc( void *param )
 {
+	sv_http_poll = NET_CreatePoll( "http" );
+
 	while( sv_http_running ) {
 		SV_Web_Frame();
 	}
 
 	SV_Web_ShutdownConnections();
+	SV_Web_ExpireCachedFiles( true );
+
+	NET_DestroyPoll( &sv_http_poll );
 	return NULL;
 }
 
@@ -1636,6 +2328,8 @@ void SV_Web_Shutdown( void )
 		return;
 	}
 
+	SV_Web_StopBenchmark();
+
 	sv_http_running = false;
 	QThread_Join( sv_http_thread );
 
@@ -1686,6 +2380,29 @@ bool SV_Web_Running( void )
 	return false;
 }
 
+/*
+* SV_Web_Benchmark
+*/
+void SV_Web_Benchmark( const char *filename, int numConnections, int seconds )
+{
+	Com_Printf( "HTTP support is disabled\n" );
+}
+
+/*
+* SV_Web_BenchmarkRunning
+*/
+bool SV_Web_BenchmarkRunning( void )
+{
+	return false;
+}
+
+/*
+* SV_Web_BenchmarkFrame
+*/
+void SV_Web_BenchmarkFrame( uint64_t frameStart )
+{
+}
+
 /*
 * SV_Web_UpstreamBaseUrl
 */
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "tv_upstream.h"
 #include "tv_upstream_demos.h"
+#include "tv_demoanalyze.h"
 
 static char *TV_ConnstateToString( connstate_t state )
 {
@@ -142,6 +143,17 @@ static void TV_Status( void )
 		Com_Printf( "- No downstream connections\n" );
 }
 
+/*
+* TV_SnapStats_f
+*/
+static void TV_SnapStats_f( void )
+{
+	int numFrames, numAllocations;
+
+	SNAP_GetFrameStats( &numFrames, &numAllocations );
+	Com_Printf( "%i client frames built, %i frame storage allocations\n", numFrames, numAllocations );
+}
+
 /*
 * TV_Status_f
 */
@@ -492,8 +504,10 @@ static cmd_function_t cmdlist[] =
 	{ "demo", TV_Demo_f },
 	{ "record", TV_Record_f },
 	{ "stop", TV_Stop_f },
+	{ "demoanalyze", TV_DemoAnalyze_f },
 
 	{ "status", TV_Status_f },
+	{ "snapstats", TV_SnapStats_f },
 	{ "cmd", TV_Cmd_f },
 
 	{ "rename", TV_Rename_f },
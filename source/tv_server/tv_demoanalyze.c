@@ -0,0 +1,751 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "tv_local.h"
+#include "tv_demoanalyze.h"
+
+/*
+============================================================================
+
+DEMO ANALYSIS
+
+Decodes demos as fast as they can be read, without any relay or
+real time playback, and writes the snapshots out as column blocks.
+Demos are spread over tv_demoanalyze_threads worker threads, each
+with its own decoding state, and every demo gets its own file:
+
+header:
+  "DCOL", int version, string demo name
+  for each table: byte number of columns, then for each column
+  a string name and a byte type ('i' for int, 'f' for float)
+blocks:
+  byte table, int number of rows, then each column as an array
+  of 32 bit little endian values
+  the file ends with a 255 table byte
+
+Strings are a short length followed by the characters.
+
+============================================================================
+*/
+
+#define DEMOANALYZE_VERSION		1
+#define DEMOANALYZE_DIR			"demos/analysis"
+#define DEMOANALYZE_EXTENSION	".dcol"
+#define DEMOANALYZE_BLOCK_ROWS	4096
+#define DEMOANALYZE_END_TABLE	255
+#define DEMOANALYZE_MAX_AREABYTES	256	// areabits size is sent as a byte
+
+typedef struct
+{
+	const char *name;
+	char type;
+} dacolumn_t;
+
+enum
+{
+	DA_TABLE_FRAMES,
+	DA_TABLE_PLAYERS,
+	DA_TABLE_ENTITIES,
+
+	DA_NUM_TABLES
+};
+
+static const dacolumn_t da_framecolumns[] =
+{
+	{ "serverTime", 'i' }, { "serverFrame", 'i' }, { "delta", 'i' },
+	{ "numPlayers", 'i' }, { "numEntities", 'i' },
+	{ NULL, 0 }
+};
+
+static const dacolumn_t da_playercolumns[] =
+{
+	{ "serverFrame", 'i' }, { "playerNum", 'i' }, { "POVnum", 'i' },
+	{ "pm_type", 'i' }, { "pm_flags", 'i' },
+	{ "origin_x", 'f' }, { "origin_y", 'f' }, { "origin_z", 'f' },
+	{ "velocity_x", 'f' }, { "velocity_y", 'f' }, { "velocity_z", 'f' },
+	{ "pitch", 'f' }, { "yaw", 'f' }, { "roll", 'f' },
+	{ "weaponState", 'i' },
+	{ NULL, 0 }
+};
+
+static const dacolumn_t da_entitycolumns[] =
+{
+	{ "serverFrame", 'i' }, { "number", 'i' }, { "type", 'i' },
+	{ "modelindex", 'i' }, { "team", 'i' }, { "effects", 'i' },
+	{ "origin_x", 'f' }, { "origin_y", 'f' }, { "origin_z", 'f' },
+	{ "pitch", 'f' }, { "yaw", 'f' }, { "roll", 'f' },
+	{ "event0", 'i' }, { "event1", 'i' },
+	{ NULL, 0 }
+};
+
+static const dacolumn_t *da_tables[DA_NUM_TABLES] =
+{
+	da_framecolumns,
+	da_playercolumns,
+	da_entitycolumns
+};
+
+typedef struct
+{
+	int numColumns;
+	int numRows;
+	unsigned int totalRows;
+	uint32_t *columns;				// numColumns arrays of DEMOANALYZE_BLOCK_ROWS
+} datable_t;
+
+typedef struct
+{
+	int filehandle;
+	int outfile;
+	char *outname;
+	bool reliable;
+
+	msg_t msg;
+	uint8_t msgbuf[MAX_MSGLEN];
+
+	entity_state_t baselines[MAX_EDICTS];
+	snapshot_t frames[UPDATE_BACKUP];
+	uint8_t areabits[UPDATE_BACKUP][DEMOANALYZE_MAX_AREABYTES];
+	snapshot_t *lastFrame;
+
+	datable_t tables[DA_NUM_TABLES];
+} demoanalysis_t;
+
+typedef struct
+{
+	char *path;
+	int bytes;
+	unsigned int numFrames;
+	bool failed;
+} dademo_t;
+
+typedef struct
+{
+	int numDemos, maxDemos;
+	dademo_t *demos;
+	char *filelist;
+
+	qthreadpool_t *pool;
+	int numWorkers;
+	demoanalysis_t **workers;		// decoding state of each worker
+} demoanalyzerun_t;
+
+// kept around so that a run aborted by ERR_DROP can be cleaned up later
+static demoanalyzerun_t *tv_demoanalysis;
+
+/*
+* TV_DemoAnalyze_WriteString
+*/
+static void TV_DemoAnalyze_WriteString( int file, const char *s )
+{
+	short len = LittleShort( (short)strlen( s ) );
+
+	FS_Write( &len, sizeof( len ), file );
+	FS_Write( s, strlen( s ), file );
+}
+
+/*
+* TV_DemoAnalyze_WriteHeader
+*/
+static void TV_DemoAnalyze_WriteHeader( demoanalysis_t *da, const char *demoname )
+{
+	int i, version;
+	uint8_t numColumns;
+	const dacolumn_t *column;
+
+	version = LittleLong( DEMOANALYZE_VERSION );
+	FS_Write( "DCOL", 4, da->outfile );
+	FS_Write( &version, sizeof( version ), da->outfile );
+	TV_DemoAnalyze_WriteString( da->outfile, demoname );
+
+	for( i = 0; i < DA_NUM_TABLES; i++ )
+	{
+		numColumns = (uint8_t)da->tables[i].numColumns;
+		FS_Write( &numColumns, 1, da->outfile );
+
+		for( column = da_tables[i]; column->name; column++ )
+		{
+			TV_DemoAnalyze_WriteString( da->outfile, column->name );
+			FS_Write( &column->type, 1, da->outfile );
+		}
+	}
+}
+
+/*
+* TV_DemoAnalyze_FlushTable
+*/
+static void TV_DemoAnalyze_FlushTable( demoanalysis_t *da, int tablenum )
+{
+	int i;
+	uint8_t table;
+	int numRows;
+	datable_t *t = &da->tables[tablenum];
+
+	if( !t->numRows )
+		return;
+
+	table = (uint8_t)tablenum;
+	numRows = LittleLong( t->numRows );
+	FS_Write( &table, 1, da->outfile );
+	FS_Write( &numRows, sizeof( numRows ), da->outfile );
+
+	for( i = 0; i < t->numColumns; i++ )
+		FS_Write( t->columns + i * DEMOANALYZE_BLOCK_ROWS, t->numRows * sizeof( uint32_t ), da->outfile );
+
+	t->totalRows += t->numRows;
+	t->numRows = 0;
+}
+
+/*
+* TV_DemoAnalyze_Row
+*
+* Returns the first column cell of a new row, cells of
+* the following columns are DEMOANALYZE_BLOCK_ROWS apart
+*/
+static uint32_t *TV_DemoAnalyze_Row( demoanalysis_t *da, int tablenum )
+{
+	datable_t *t = &da->tables[tablenum];
+
+	if( t->numRows == DEMOANALYZE_BLOCK_ROWS )
+		TV_DemoAnalyze_FlushTable( da, tablenum );
+
+	return t->columns + t->numRows++;
+}
+
+#define DA_INT(row,col,v) ( (row)[(col) * DEMOANALYZE_BLOCK_ROWS] = (uint32_t)LittleLong( (int)(v) ) )
+#define DA_FLOAT(row,col,v) do { union { float f; uint32_t u; } cell_; cell_.f = LittleFloat( (v) ); (row)[(col) * DEMOANALYZE_BLOCK_ROWS] = cell_.u; } while( 0 )
+
+/*
+* TV_DemoAnalyze_AddFrame
+*/
+static void TV_DemoAnalyze_AddFrame( demoanalysis_t *da, const snapshot_t *frame )
+{
+	int i, j;
+	uint32_t *row;
+	const player_state_t *ps;
+	const entity_state_t *es;
+
+	row = TV_DemoAnalyze_Row( da, DA_TABLE_FRAMES );
+	DA_INT( row, 0, frame->serverTime );
+	DA_INT( row, 1, frame->serverFrame );
+	DA_INT( row, 2, frame->delta );
+	DA_INT( row, 3, frame->numplayers );
+	DA_INT( row, 4, frame->numEntities );
+
+	for( i = 0; i < frame->numplayers; i++ )
+	{
+		ps = &frame->playerStates[i];
+
+		row = TV_DemoAnalyze_Row( da, DA_TABLE_PLAYERS );
+		DA_INT( row, 0, frame->serverFrame );
+		DA_INT( row, 1, ps->playerNum );
+		DA_INT( row, 2, ps->POVnum );
+		DA_INT( row, 3, ps->pmove.pm_type );
+		DA_INT( row, 4, ps->pmove.pm_flags );
+		for( j = 0; j < 3; j++ )
+		{
+			DA_FLOAT( row, 5 + j, ps->pmove.origin[j] );
+			DA_FLOAT( row, 8 + j, ps->pmove.velocity[j] );
+			DA_FLOAT( row, 11 + j, ps->viewangles[j] );
+		}
+		DA_INT( row, 14, ps->weaponState );
+	}
+
+	for( i = 0; i < frame->numEntities; i++ )
+	{
+		es = &frame->parsedEntities[i & ( MAX_PARSE_ENTITIES-1 )];
+
+		row = TV_DemoAnalyze_Row( da, DA_TABLE_ENTITIES );
+		DA_INT( row, 0, frame->serverFrame );
+		DA_INT( row, 1, es->number );
+		DA_INT( row, 2, es->type );
+		DA_INT( row, 3, es->modelindex );
+		DA_INT( row, 4, es->team );
+		DA_INT( row, 5, es->effects );
+		for( j = 0; j < 3; j++ )
+		{
+			DA_FLOAT( row, 6 + j, es->origin[j] );
+			DA_FLOAT( row, 9 + j, es->angles[j] );
+		}
+		DA_INT( row, 12, es->events[0] );
+		DA_INT( row, 13, es->events[1] );
+	}
+}
+
+/*
+* TV_DemoAnalyze_ParseServerData
+*/
+static bool TV_DemoAnalyze_ParseServerData( demoanalysis_t *da, msg_t *msg )
+{
+	int protocol, numpure, sv_bitflags;
+
+	protocol = MSG_ReadLong( msg );
+	if( protocol != APP_DEMO_PROTOCOL_VERSION && protocol != APP_PROTOCOL_VERSION )
+	{
+		Com_Printf( "Unsupported demo protocol %i\n", protocol );
+		return false;
+	}
+
+	MSG_ReadLong( msg );	// servercount
+	MSG_ReadShort( msg );	// snapFrameTime
+	MSG_ReadString( msg );	// basegame
+	MSG_ReadString( msg );	// game
+	MSG_ReadShort( msg );	// playernum
+	MSG_ReadString( msg );	// level name
+
+	sv_bitflags = MSG_ReadByte( msg );
+	da->reliable = ( ( sv_bitflags & SV_BITFLAGS_RELIABLE ) ? true : false );
+
+	if( sv_bitflags & SV_BITFLAGS_HTTP )
+	{
+		if( sv_bitflags & SV_BITFLAGS_HTTP_BASEURL )
+			MSG_ReadString( msg );
+		else
+			MSG_ReadShort( msg );
+	}
+
+	for( numpure = MSG_ReadShort( msg ); numpure > 0; numpure-- )
+	{
+		MSG_ReadString( msg );
+		MSG_ReadLong( msg );
+	}
+
+	return true;
+}
+
+/*
+* TV_DemoAnalyze_ParseMessage
+*/
+static bool TV_DemoAnalyze_ParseMessage( demoanalysis_t *da, msg_t *msg )
+{
+	int cmd, len;
+	snapshot_t *frame;
+
+	while( 1 )
+	{
+		if( msg->readcount > msg->cursize )
+		{
+			Com_Printf( "Bad demo message\n" );
+			return false;
+		}
+
+		cmd = MSG_ReadByte( msg );
+		if( cmd == -1 )
+			return true;
+
+		switch( cmd )
+		{
+		default:
+			Com_Printf( "Illegible demo message: %i\n", cmd );
+			return false;
+
+		case svc_nop:
+			break;
+
+		case svc_servercmd:
+			if( !da->reliable )
+				MSG_ReadLong( msg );
+			// fall through
+		case svc_servercs:
+			MSG_ReadString( msg );
+			break;
+
+		case svc_serverdata:
+			if( !TV_DemoAnalyze_ParseServerData( da, msg ) )
+				return false;
+			break;
+
+		case svc_spawnbaseline:
+			SNAP_ParseBaseline( msg, da->baselines );
+			break;
+
+		case svc_clcack:
+			MSG_ReadLong( msg );
+			MSG_ReadLong( msg );
+			break;
+
+		case svc_frame:
+			frame = SNAP_ParseFrame( msg, da->lastFrame, NULL, da->frames, da->baselines, 0 );
+			if( frame->valid )
+			{
+				da->lastFrame = frame;
+				TV_DemoAnalyze_AddFrame( da, frame );
+			}
+			break;
+
+		case svc_demoinfo:
+			len = MSG_ReadLong( msg );
+			MSG_SkipData( msg, len );
+			break;
+
+		case svc_extension:
+			MSG_ReadByte( msg );			// extension id
+			MSG_ReadByte( msg );			// version number
+			len = MSG_ReadShort( msg );		// command length
+			MSG_SkipData( msg, len );		// command data
+			break;
+		}
+	}
+}
+
+/*
+* TV_DemoAnalyze_CloseDemo
+*/
+static void TV_DemoAnalyze_CloseDemo( demoanalysis_t *da )
+{
+	if( da->outfile )
+	{
+		FS_FCloseFile( da->outfile );
+		da->outfile = 0;
+	}
+	if( da->filehandle )
+	{
+		FS_FCloseFile( da->filehandle );
+		da->filehandle = 0;
+	}
+	if( da->outname )
+	{
+		Mem_TempFree( da->outname );
+		da->outname = NULL;
+	}
+}
+
+/*
+* TV_DemoAnalyze_Demo
+*/
+static bool TV_DemoAnalyze_Demo( demoanalysis_t *da, dademo_t *demo )
+{
+	int i, filelen, demofile, outfile, read;
+	const char *demoname = demo->path;
+	char *outname;
+	const char *relname;
+	size_t outname_size;
+	uint8_t end;
+	unsigned int numFrames;
+
+	filelen = FS_FOpenFile( demoname, &demofile, FS_READ|SNAP_DEMO_GZ );
+	if( !demofile )
+	{
+		Com_Printf( "Couldn't open %s\n", demoname );
+		return false;
+	}
+	da->filehandle = demofile;
+
+	// keep the path under the demos directory, so that demos with
+	// the same name in different subdirectories don't collide
+	relname = demoname;
+	if( !Q_strnicmp( relname, "demos/", strlen( "demos/" ) ) )
+		relname += strlen( "demos/" );
+
+	outname_size = strlen( DEMOANALYZE_DIR ) + 1 + strlen( relname ) + strlen( DEMOANALYZE_EXTENSION ) + 1;
+	outname = da->outname = Mem_TempMalloc( outname_size );
+	Q_snprintfz( outname, outname_size, "%s/%s", DEMOANALYZE_DIR, relname );
+	COM_ReplaceExtension( outname, DEMOANALYZE_EXTENSION, outname_size );
+
+	if( FS_FOpenFile( outname, &outfile, FS_WRITE ) == -1 )
+	{
+		Com_Printf( "Couldn't open %s for writing\n", outname );
+		TV_DemoAnalyze_CloseDemo( da );
+		return false;
+	}
+
+	// reset the decoding state, keeping the column storage
+	da->outfile = outfile;
+	da->reliable = false;
+	da->lastFrame = NULL;
+	memset( da->baselines, 0, sizeof( da->baselines ) );
+	for( i = 0; i < UPDATE_BACKUP; i++ )
+	{
+		memset( &da->frames[i], 0, sizeof( da->frames[i] ) );
+		da->frames[i].areabits = da->areabits[i];
+		da->frames[i].areabytes = DEMOANALYZE_MAX_AREABYTES;
+	}
+	for( i = 0; i < DA_NUM_TABLES; i++ )
+		da->tables[i].numRows = da->tables[i].totalRows = 0;
+
+	TV_DemoAnalyze_WriteHeader( da, demoname );
+
+	// demos that are still being recorded or were cut short end with
+	// a partial message, stop there instead of dropping
+	MSG_Init( &da->msg, da->msgbuf, sizeof( da->msgbuf ) );
+	while( ( read = SNAP_ReadDemoMessageChecked( demofile, &da->msg ) ) >= 0 )
+	{
+		if( !TV_DemoAnalyze_ParseMessage( da, &da->msg ) )
+			break;
+	}
+	if( read == -2 )
+		Com_Printf( "%s: truncated or corrupt, skipping the rest\n", demoname );
+
+	for( i = 0; i < DA_NUM_TABLES; i++ )
+		TV_DemoAnalyze_FlushTable( da, i );
+
+	end = DEMOANALYZE_END_TABLE;
+	FS_Write( &end, 1, outfile );
+
+	numFrames = da->tables[DA_TABLE_FRAMES].totalRows;
+	demo->bytes = filelen;
+	demo->numFrames = numFrames;
+	Com_Printf( "%s: %i bytes, %u frames, %u player rows, %u entity rows -> %s\n", demoname, filelen,
+		numFrames, da->tables[DA_TABLE_PLAYERS].totalRows, da->tables[DA_TABLE_ENTITIES].totalRows, outname );
+
+	TV_DemoAnalyze_CloseDemo( da );
+	return numFrames > 0 && read != -2;
+}
+
+/*
+* TV_DemoAnalyze_DemoPath
+*/
+static char *TV_DemoAnalyze_DemoPath( const char *name )
+{
+	char *path;
+	size_t path_size;
+
+	path_size = strlen( "demos/" ) + strlen( name ) + strlen( APP_DEMO_EXTENSION_STR ) + 1;
+	path = Mem_TempMalloc( path_size );
+	Q_snprintfz( path, path_size, "demos/%s", name );
+	COM_SanitizeFilePath( path );
+	COM_DefaultExtension( path, APP_DEMO_EXTENSION_STR, path_size );
+
+	if( !COM_ValidateRelativeFilename( path ) )
+	{
+		Com_Printf( "Invalid demo name: %s\n", name );
+		Mem_TempFree( path );
+		return NULL;
+	}
+
+	return path;
+}
+
+/*
+* TV_DemoAnalyze_AllocWorker
+*/
+static demoanalysis_t *TV_DemoAnalyze_AllocWorker( void )
+{
+	int i;
+	const dacolumn_t *column;
+	demoanalysis_t *da;
+
+	da = Mem_TempMalloc( sizeof( *da ) );
+	for( i = 0; i < DA_NUM_TABLES; i++ )
+	{
+		for( column = da_tables[i]; column->name; column++ )
+			da->tables[i].numColumns++;
+		da->tables[i].columns = Mem_TempMalloc( da->tables[i].numColumns * DEMOANALYZE_BLOCK_ROWS * sizeof( uint32_t ) );
+	}
+
+	return da;
+}
+
+/*
+* TV_DemoAnalyze_FreeWorker
+*/
+static void TV_DemoAnalyze_FreeWorker( demoanalysis_t *da )
+{
+	int i;
+
+	TV_DemoAnalyze_CloseDemo( da );
+	for( i = 0; i < DA_NUM_TABLES; i++ )
+	{
+		if( da->tables[i].columns )
+			Mem_TempFree( da->tables[i].columns );
+	}
+	Mem_TempFree( da );
+}
+
+/*
+* TV_DemoAnalyze_AddDemo
+*/
+static void TV_DemoAnalyze_AddDemo( demoanalyzerun_t *run, const char *name )
+{
+	char *path;
+
+	path = TV_DemoAnalyze_DemoPath( name );
+	if( !path )
+		return;
+
+	if( run->numDemos == run->maxDemos )
+	{
+		run->maxDemos = max( run->maxDemos * 2, 64 );
+		if( run->demos )
+			run->demos = Mem_Realloc( run->demos, run->maxDemos * sizeof( *run->demos ) );
+		else
+			run->demos = Mem_TempMalloc( run->maxDemos * sizeof( *run->demos ) );
+	}
+
+	memset( &run->demos[run->numDemos], 0, sizeof( run->demos[0] ) );
+	run->demos[run->numDemos++].path = path;
+}
+
+/*
+* TV_DemoAnalyze_Job
+*
+* Runs on the worker threads, a demo that fails to parse is dropped on its own
+*/
+static void TV_DemoAnalyze_Job( void *arg, int index, int worker )
+{
+	jmp_buf abortframe;
+	demoanalyzerun_t *run = arg;
+	demoanalysis_t *da = run->workers[worker];
+	dademo_t *demo = &run->demos[index];
+
+	if( setjmp( abortframe ) )
+	{
+		Com_SetThreadAbortFrame( NULL );
+		Com_Printf( "%s: failed to parse, skipping the rest\n", demo->path );
+		TV_DemoAnalyze_CloseDemo( da );
+		demo->failed = true;
+		return;
+	}
+	Com_SetThreadAbortFrame( &abortframe );
+
+	demo->failed = !TV_DemoAnalyze_Demo( da, demo );
+
+	Com_SetThreadAbortFrame( NULL );
+}
+
+/*
+* TV_DemoAnalyze_Shutdown
+*
+* Releases the analysis state, including whatever a run aborted by ERR_DROP left behind
+*/
+void TV_DemoAnalyze_Shutdown( void )
+{
+	int i;
+	demoanalyzerun_t *run = tv_demoanalysis;
+
+	if( !run )
+		return;
+
+	QThreadPool_Destroy( &run->pool );
+
+	if( run->workers )
+	{
+		for( i = 0; i < run->numWorkers; i++ )
+		{
+			if( run->workers[i] )
+				TV_DemoAnalyze_FreeWorker( run->workers[i] );
+		}
+		Mem_TempFree( run->workers );
+	}
+	if( run->demos )
+	{
+		for( i = 0; i < run->numDemos; i++ )
+			Mem_TempFree( run->demos[i].path );
+		Mem_TempFree( run->demos );
+	}
+	if( run->filelist )
+		Mem_TempFree( run->filelist );
+	Mem_TempFree( run );
+
+	tv_demoanalysis = NULL;
+}
+
+/*
+* TV_DemoAnalyze_f
+*
+* demoanalyze <demo or pattern> [...]
+*/
+void TV_DemoAnalyze_f( void )
+{
+	int i, j, total, numFailed;
+	unsigned int start, msecs, numFrames;
+	uint64_t numBytes;
+	size_t bufsize;
+	const char *arg, *name;
+	demoanalyzerun_t *run;
+
+	if( Cmd_Argc() < 2 )
+	{
+		Com_Printf( "Usage: %s <demo or pattern> [...]\n", Cmd_Argv( 0 ) );
+		return;
+	}
+
+	TV_DemoAnalyze_Shutdown();
+
+	run = tv_demoanalysis = Mem_TempMalloc( sizeof( *run ) );
+
+	for( i = 1; i < Cmd_Argc(); i++ )
+	{
+		arg = Cmd_Argv( i );
+
+		if( !strpbrk( arg, "*?[" ) )
+		{
+			TV_DemoAnalyze_AddDemo( run, arg );
+			continue;
+		}
+
+		// match the pattern against the demos directory
+		bufsize = 0;
+		total = FS_GetFileListExt( "demos", APP_DEMO_EXTENSION_STR, NULL, &bufsize, 0, 0 );
+		if( !total || !bufsize )
+			continue;
+
+		run->filelist = Mem_TempMalloc( bufsize );
+		FS_GetFileList( "demos", APP_DEMO_EXTENSION_STR, run->filelist, bufsize, 0, 0 );
+
+		for( j = 0, name = run->filelist; j < total; j++, name += strlen( name ) + 1 )
+		{
+			if( Com_GlobMatch( arg, name, false ) )
+				TV_DemoAnalyze_AddDemo( run, name );
+		}
+
+		Mem_TempFree( run->filelist );
+		run->filelist = NULL;
+	}
+
+	if( !run->numDemos )
+	{
+		Com_Printf( "No demos to analyze\n" );
+		TV_DemoAnalyze_Shutdown();
+		return;
+	}
+
+	// the calling thread decodes demos as well
+	run->pool = QThreadPool_Create( min( tv_demoanalyze_threads->integer, run->numDemos - 1 ) );
+	run->numWorkers = QThreadPool_NumWorkers( run->pool );
+	run->workers = Mem_TempMalloc( run->numWorkers * sizeof( *run->workers ) );
+	for( i = 0; i < run->numWorkers; i++ )
+		run->workers[i] = TV_DemoAnalyze_AllocWorker();
+
+	start = Sys_Milliseconds();
+
+	QThreadPool_Run( run->pool, TV_DemoAnalyze_Job, run, run->numDemos );
+
+	msecs = Sys_Milliseconds() - start;
+
+	numFailed = 0;
+	numFrames = 0;
+	numBytes = 0;
+	for( i = 0; i < run->numDemos; i++ )
+	{
+		if( run->demos[i].failed )
+			numFailed++;
+		numFrames += run->demos[i].numFrames;
+		numBytes += run->demos[i].bytes;
+	}
+
+	Com_Printf( "Analyzed %i demos (%i failed), %u frames in %u msec on %i threads\n", run->numDemos, numFailed,
+		numFrames, msecs, run->numWorkers );
+	if( msecs )
+		Com_Printf( "%.1f demos/s, %.0f frames/s, %.1f MB/s\n", run->numDemos * 1000.0 / msecs,
+			numFrames * 1000.0 / msecs, numBytes / ( 1024.0 * 1024.0 ) * 1000.0 / msecs );
+
+	TV_DemoAnalyze_Shutdown();
+}
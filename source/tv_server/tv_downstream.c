@@ -308,7 +308,7 @@ static bool TV_Downstream_Netchan_Transmit( netchan_t *netchan, msg_t *msg )
 
 	if( tv_compresspackets->integer )
 	{
-		zerror = Netchan_CompressMessage( msg );
+		zerror = Netchan_CompressMessage( msg, netchan->compressDictionary );
 		if( zerror < 0 )
 		{
 			// it's compression error, just send uncompressed
@@ -618,12 +618,14 @@ static bool TV_Downstream_ProcessPacket( netchan_t *netchan, msg_t *msg )
 	return true;
 }
 
+#define TV_PACKET_BATCH	16
+
 /*
 * TV_Downstream_ReadPackets
 */
 void TV_Downstream_ReadPackets( void )
 {
-	int i, socketind, ret, game_port;
+	int i, p, socketind, ret, game_port;
 	client_t *cl;
 #ifdef TCP_ALLOW_TVCONNECT
 	socket_t newsocket;
@@ -633,6 +635,11 @@ void TV_Downstream_ReadPackets( void )
 	msg_t msg;
 	uint8_t msgData[MAX_MSGLEN];
 
+	// datagrams are drained from the sockets in batches
+	static msg_t packets[TV_PACKET_BATCH];
+	static netadr_t packetAddresses[TV_PACKET_BATCH];
+	static uint8_t packetData[TV_PACKET_BATCH][MAX_MSGLEN];
+
 #ifdef TCP_ALLOW_TVCONNECT
 	socket_t* tcpsockets [] =
 	{
@@ -648,6 +655,8 @@ void TV_Downstream_ReadPackets( void )
 	};
 
 	MSG_Init( &msg, msgData, sizeof( msgData ) );
+	for( p = 0; p < TV_PACKET_BATCH; p++ )
+		MSG_Init( &packets[p], packetData[p], sizeof( packetData[p] ) );
 
 #ifdef TCP_ALLOW_TVCONNECT
 	for( socketind = 0; socketind < sizeof( tcpsockets ) / sizeof( tcpsockets[0] ); socketind++ )
@@ -713,7 +722,7 @@ void TV_Downstream_ReadPackets( void )
 	{
 		socket = sockets[socketind];
 
-		while( socket->open && ( ret = NET_GetPacket( socket, &address, &msg ) ) != 0 )
+		while( socket->open && ( ret = NET_GetPackets( socket, packetAddresses, packets, TV_PACKET_BATCH ) ) != 0 )
 		{
 			if( ret == -1 )
 			{
@@ -721,48 +730,54 @@ void TV_Downstream_ReadPackets( void )
 				continue;
 			}
 
-			// check for upstreamless packet (0xffffffff) first
-			if( *(int *)msg.data == -1 )
+			for( p = 0; p < ret; p++ )
 			{
-				TV_Downstream_UpstreamlessPacket( socket, &address, &msg );
-				continue;
-			}
-
-			// read the game port out of the message so we can fix up
-			// stupid address translating routers
-			MSG_BeginReading( &msg );
-			MSG_ReadLong( &msg ); // sequence number
-			MSG_ReadLong( &msg ); // sequence number
-			game_port = MSG_ReadShort( &msg ) & 0xffff;
-			// data follows
+				address = packetAddresses[p];
+				msg = packets[p];
 
-			// check for packets from connected clients
-			for( i = 0, cl = tvs.clients; i < tv_maxclients->integer; i++, cl++ )
-			{
-				unsigned short remoteaddr_port, addr_port;
-
-				if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
-					continue;
-				if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
-					continue;
-				if( cl->netchan.game_port != game_port )
+				// check for upstreamless packet (0xffffffff) first
+				if( *(int *)msg.data == -1 )
+				{
+					TV_Downstream_UpstreamlessPacket( socket, &address, &msg );
 					continue;
+				}
+
+				// read the game port out of the message so we can fix up
+				// stupid address translating routers
+				MSG_BeginReading( &msg );
+				MSG_ReadLong( &msg ); // sequence number
+				MSG_ReadLong( &msg ); // sequence number
+				game_port = MSG_ReadShort( &msg ) & 0xffff;
+				// data follows
 
-				remoteaddr_port = NET_GetAddressPort( &cl->netchan.remoteAddress );
-				addr_port = NET_GetAddressPort( &address );
-				if( remoteaddr_port != addr_port )
+				// check for packets from connected clients
+				for( i = 0, cl = tvs.clients; i < tv_maxclients->integer; i++, cl++ )
 				{
-					Com_DPrintf( "%s" S_COLOR_WHITE ": Fixing up a translated port from %i to %i\n", cl->name,
-						remoteaddr_port, addr_port );
-					NET_SetAddressPort( &cl->netchan.remoteAddress, addr_port );
-				}
+					unsigned short remoteaddr_port, addr_port;
+
+					if( cl->state == CS_FREE || cl->state == CS_ZOMBIE )
+						continue;
+					if( !NET_CompareBaseAddress( &address, &cl->netchan.remoteAddress ) )
+						continue;
+					if( cl->netchan.game_port != game_port )
+						continue;
+
+					remoteaddr_port = NET_GetAddressPort( &cl->netchan.remoteAddress );
+					addr_port = NET_GetAddressPort( &address );
+					if( remoteaddr_port != addr_port )
+					{
+						Com_DPrintf( "%s" S_COLOR_WHITE ": Fixing up a translated port from %i to %i\n", cl->name,
+							remoteaddr_port, addr_port );
+						NET_SetAddressPort( &cl->netchan.remoteAddress, addr_port );
+					}
 
-				if( TV_Downstream_ProcessPacket( &cl->netchan, &msg ) )
-				{                                           // this is a valid, sequenced packet, so process it
-					cl->lastPacketReceivedTime = tvs.realtime;
-					TV_Downstream_ParseClientMessage( cl, &msg );
+					if( TV_Downstream_ProcessPacket( &cl->netchan, &msg ) )
+					{                                           // this is a valid, sequenced packet, so process it
+						cl->lastPacketReceivedTime = tvs.realtime;
+						TV_Downstream_ParseClientMessage( cl, &msg );
+					}
+					break;
 				}
-				break;
 			}
 		}
 	}
@@ -276,6 +276,8 @@ static void TV_Downstream_GetStatusResponse( const socket_t *socket, const netad
 static bool TV_Downstream_ClientConnect( const socket_t *socket, const netadr_t *address, client_t *client,
 											char *userinfo, int game_port, int challenge, bool tv_client )
 {
+	char *dictionary_str;
+
 	assert( socket );
 	assert( address );
 	assert( client );
@@ -332,6 +334,12 @@ static bool TV_Downstream_ClientConnect( const socket_t *socket, const netadr_t
 	else
 		Netchan_Setup( &client->netchan, socket, address, game_port );
 
+	// only compress with the preset dictionary if the client has the same one
+	dictionary_str = Info_ValueForKey( userinfo, "cl_netdict" );
+	if( dictionary_str && Netchan_DictionaryChecksum() )
+		client->netchan.compressDictionary = strtoul( dictionary_str, NULL, 16 ) == Netchan_DictionaryChecksum() ? true : false;
+	Info_RemoveKey( userinfo, "cl_netdict" );
+
 	// parse some info from the info strings
 	Q_strncpyz( client->userinfo, userinfo, sizeof( client->userinfo ) );
 	TV_Downstream_UserinfoChanged( client );
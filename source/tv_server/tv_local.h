@@ -100,6 +100,7 @@ typedef struct
 	player_state_t *ps;                 // [numplayers]
 	int num_entities;
 	int first_entity;                   // into the circular sv_packet_entities[]
+	unsigned int frameNum;              // server frame the entity states were copied in
 	unsigned int sentTimeStamp;         // time at what this frame snap was sent to the clients
 	unsigned int UcmdExecuted;
 	game_state_t gameState;
@@ -184,6 +185,7 @@ typedef struct client_s
 	uint8_t soundsmsgData[MAX_MSGLEN];
 
 	client_snapshot_t snapShots[UPDATE_BACKUP]; // updates can be delta'd from here
+	uint8_t *snapArena;             // storage for the areabits and player states of snapShots
 
 	client_download_t download;
 
@@ -262,6 +264,8 @@ extern cvar_t *tv_floodprotection_messages;
 extern cvar_t *tv_floodprotection_seconds;
 extern cvar_t *tv_floodprotection_penalty;
 
+extern cvar_t *tv_demoanalyze_threads;
+
 extern cvar_t *tv_port;
 
 extern tv_t tvs;
@@ -26,11 +26,16 @@
 #include "tv_cmds.h"
 #include "tv_downstream.h"
 #include "tv_lobby.h"
+#include "tv_demoanalyze.h"
 
 tv_t tvs;
 
 mempool_t *tv_mempool;
 
+static netpoll_t *tv_netpoll;
+static socket_t **tv_pollsockets;
+static int tv_maxpollsockets;
+
 cvar_t *tv_password;
 
 cvar_t *tv_rcon_password;
@@ -63,6 +68,8 @@ cvar_t *tv_floodprotection_messages;
 cvar_t *tv_floodprotection_seconds;
 cvar_t *tv_floodprotection_penalty;
 
+cvar_t *tv_demoanalyze_threads;
+
 /*
 * TV_Init
 * 
@@ -119,6 +126,9 @@ void TV_Init( void )
 	tv_floodprotection_penalty = Cvar_Get( "tv_floodprotection_delay", "20", 0 );
 	tv_floodprotection_penalty->modified = true;
 
+	// extra threads for demoanalyze, the calling thread works as well
+	tv_demoanalyze_threads = Cvar_Get( "tv_demoanalyze_threads", "0", CVAR_ARCHIVE );
+
 	if( tv_maxclients->integer < 0 )
 		Cvar_ForceSet( "tv_maxclients", "0" );
 
@@ -209,6 +219,73 @@ void TV_Init( void )
 #endif
 
 	TV_Downstream_InitMaster();
+
+	tv_netpoll = NET_CreatePoll( "tv" );
+}
+
+/*
+* TV_AddPollSocket
+*/
+static void TV_AddPollSocket( socket_t *socket, int *numsockets )
+{
+	if( !socket->open )
+		return;
+
+	if( *numsockets + 1 >= tv_maxpollsockets )
+	{
+		tv_maxpollsockets = max( 64, tv_maxpollsockets * 2 );
+		if( tv_pollsockets )
+			tv_pollsockets = Mem_Realloc( tv_pollsockets, sizeof( socket_t * ) * tv_maxpollsockets );
+		else
+			tv_pollsockets = Mem_Alloc( tv_mempool, sizeof( socket_t * ) * tv_maxpollsockets );
+	}
+
+	tv_pollsockets[( *numsockets )++] = socket;
+}
+
+/*
+* TV_Sleep
+*
+* Sleeps until a packet arrives on any of the upstream or downstream sockets
+*/
+static void TV_Sleep( int msec )
+{
+	int i, numsockets = 0;
+	client_t *cl;
+
+	TV_AddPollSocket( &tvs.socket_udp, &numsockets );
+	TV_AddPollSocket( &tvs.socket_udp6, &numsockets );
+#ifdef TCP_ALLOW_TVCONNECT
+	TV_AddPollSocket( &tvs.socket_tcp, &numsockets );
+	TV_AddPollSocket( &tvs.socket_tcp6, &numsockets );
+
+	for( i = 0; i < MAX_INCOMING_CONNECTIONS; i++ )
+	{
+		if( tvs.incoming[i].active )
+			TV_AddPollSocket( &tvs.incoming[i].socket, &numsockets );
+	}
+#endif
+
+	for( i = 0, cl = tvs.clients; i < tv_maxclients->integer; i++, cl++ )
+	{
+		if( cl->state != CS_FREE && cl->individual_socket )
+			TV_AddPollSocket( &cl->socket, &numsockets );
+	}
+
+	for( i = 0; i < tvs.numupstreams; i++ )
+	{
+		if( tvs.upstreams[i] && tvs.upstreams[i]->individual_socket )
+			TV_AddPollSocket( tvs.upstreams[i]->socket, &numsockets );
+	}
+
+	if( !numsockets )
+	{
+		Sys_Sleep( msec );
+		return;
+	}
+
+	tv_pollsockets[numsockets] = NULL;
+	NET_PollSleep( tv_netpoll, msec, tv_pollsockets );
 }
 
 /*
@@ -220,6 +297,9 @@ void TV_Frame( int realmsec, int gamemsec )
 
 	tvs.realtime += realmsec;
 
+	// the datagrams of the frame, downstream and upstream, go out together
+	NET_BeginSendBatch();
+
 	TV_Lobby_Run();
 
 	for( i = 0; i < tvs.numupstreams; i++ )
@@ -243,7 +323,9 @@ void TV_Frame( int realmsec, int gamemsec )
 
 	TV_Downstream_MasterHeartbeat();
 
-	Sys_Sleep( 5 );
+	NET_FlushSendBatch();
+
+	TV_Sleep( 5 );
 }
 
 /*
@@ -266,6 +348,15 @@ void TV_Shutdown( const char *finalmsg )
 	tvs.upstreams = NULL;
 	tvs.numupstreams = 0;
 
+	NET_DestroyPoll( &tv_netpoll );
+	if( tv_pollsockets )
+	{
+		Mem_Free( tv_pollsockets );
+		tv_pollsockets = NULL;
+		tv_maxpollsockets = 0;
+	}
+
+	TV_DemoAnalyze_Shutdown();
 	TV_RemoveCommands();
 }
 
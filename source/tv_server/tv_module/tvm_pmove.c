@@ -35,8 +35,6 @@ typedef struct
 	float forwardPush, sidePush, upPush;
 } pml_t;
 
-pmove_t	*pm;
-pml_t pml;
 
 vec3_t playerbox_stand_mins = { -16, -16, -24 };
 vec3_t playerbox_stand_maxs = { 16, 16, 40 };
@@ -56,7 +54,7 @@ const float pm_decelerate = 12; // user intended deceleration when on ground
 /*
 * TVM_PM_ClampAngles
 */
-static void TVM_PM_FlyMove( void )
+static void TVM_PM_FlyMove( pmove_t *pm, pml_t *pml )
 {
 	float speed, drop, friction, control, newspeed;
 	float currentspeed, addspeed, accelspeed, maxspeed;
@@ -66,16 +64,16 @@ static void TVM_PM_FlyMove( void )
 	vec3_t wishdir;
 	float wishspeed;
 
-	maxspeed = pml.maxPlayerSpeed * 1.5;
+	maxspeed = pml->maxPlayerSpeed * 1.5;
 
 	if( pm->cmd.buttons & BUTTON_SPECIAL )
 		maxspeed *= 2;
 
 	// friction
-	speed = VectorLength( pml.velocity );
+	speed = VectorLength( pml->velocity );
 	if( speed < 1 )
 	{
-		VectorClear( pml.velocity );
+		VectorClear( pml->velocity );
 	}
 	else
 	{
@@ -83,7 +81,7 @@ static void TVM_PM_FlyMove( void )
 
 		friction = pm_friction*1.5; // extra friction
 		control = speed < pm_decelerate ? pm_decelerate : speed;
-		drop += control * friction * pml.frametime;
+		drop += control * friction * pml->frametime;
 
 		// scale the velocity
 		newspeed = speed - drop;
@@ -91,12 +89,12 @@ static void TVM_PM_FlyMove( void )
 			newspeed = 0;
 		newspeed /= speed;
 
-		VectorScale( pml.velocity, newspeed, pml.velocity );
+		VectorScale( pml->velocity, newspeed, pml->velocity );
 	}
 
 	// accelerate
-	fmove = pml.forwardPush;
-	smove = pml.sidePush;
+	fmove = pml->forwardPush;
+	smove = pml->sidePush;
 
 	if( pm->cmd.buttons & BUTTON_SPECIAL )
 	{
@@ -104,12 +102,12 @@ static void TVM_PM_FlyMove( void )
 		smove *= 2;
 	}
 
-	VectorNormalize( pml.forward );
-	VectorNormalize( pml.right );
+	VectorNormalize( pml->forward );
+	VectorNormalize( pml->right );
 
 	for( i = 0; i < 3; i++ )
-		wishvel[i] = pml.forward[i]*fmove + pml.right[i]*smove;
-	wishvel[2] += pml.upPush;
+		wishvel[i] = pml->forward[i]*fmove + pml->right[i]*smove;
+	wishvel[2] += pml->upPush;
 
 	VectorCopy( wishvel, wishdir );
 	wishspeed = VectorNormalize( wishdir );
@@ -124,20 +122,20 @@ static void TVM_PM_FlyMove( void )
 		wishspeed = maxspeed;
 	}
 
-	currentspeed = DotProduct( pml.velocity, wishdir );
+	currentspeed = DotProduct( pml->velocity, wishdir );
 	addspeed = wishspeed - currentspeed;
 	if( addspeed > 0 )
 	{
-		accelspeed = pm_accelerate * pml.frametime * wishspeed;
+		accelspeed = pm_accelerate * pml->frametime * wishspeed;
 		if( accelspeed > addspeed )
 			accelspeed = addspeed;
 
 		for( i = 0; i < 3; i++ )
-			pml.velocity[i] += accelspeed * wishdir[i];
+			pml->velocity[i] += accelspeed * wishdir[i];
 	}
 
 	// move
-	VectorMA( pml.origin, pml.frametime, pml.velocity, pml.origin );
+	VectorMA( pml->origin, pml->frametime, pml->velocity, pml->origin );
 }
 
 /*
@@ -147,7 +145,7 @@ static void TVM_PM_FlyMove( void )
 #pragma warning( push )
 #pragma warning( disable : 4310 )   // cast truncates constant value
 #endif
-static void TVM_PM_ClampAngles( void )
+static void TVM_PM_ClampAngles( pmove_t *pm, pml_t *pml )
 {
 	int i;
 	short temp;
@@ -173,11 +171,11 @@ static void TVM_PM_ClampAngles( void )
 		pm->playerState->viewangles[i] = SHORT2ANGLE( temp );
 	}
 
-	AngleVectors( pm->playerState->viewangles, pml.forward, pml.right, pml.up );
+	AngleVectors( pm->playerState->viewangles, pml->forward, pml->right, pml->up );
 
-	VectorCopy( pml.forward, pml.flatforward );
-	pml.flatforward[2] = 0.0f;
-	VectorNormalize( pml.flatforward );
+	VectorCopy( pml->forward, pml->flatforward );
+	pml->flatforward[2] = 0.0f;
+	VectorNormalize( pml->flatforward );
 }
 #if defined ( _WIN32 ) && ( _MSC_VER >= 1400 )
 #pragma warning( pop )
@@ -189,7 +187,7 @@ static void TVM_PM_ClampAngles( void )
 * On exit, the origin will have a value that is pre-quantized to the (1.0/16.0)
 * precision of the network channel and in a valid position.
 */
-static void TVM_PM_SnapPosition( void )
+static void TVM_PM_SnapPosition( pmove_t *pm, pml_t *pml )
 {
 	int sign[3];
 	int i, j, bits;
@@ -201,18 +199,18 @@ static void TVM_PM_SnapPosition( void )
 	// snap velocity to sixteenths
 	for( i = 0; i < 3; i++ )
 	{
-		velint[i] = (int)( pml.velocity[i]*PM_VECTOR_SNAP );
+		velint[i] = (int)( pml->velocity[i]*PM_VECTOR_SNAP );
 		pm->playerState->pmove.velocity[i] = velint[i]*( 1.0/PM_VECTOR_SNAP );
 	}
 
 	for( i = 0; i < 3; i++ )
 	{
-		if( pml.origin[i] >= 0 )
+		if( pml->origin[i] >= 0 )
 			sign[i] = 1;
 		else
 			sign[i] = -1;
-		origint[i] = (int)( pml.origin[i]*PM_VECTOR_SNAP );
-		if( origint[i]*( 1.0/PM_VECTOR_SNAP ) == pml.origin[i] )
+		origint[i] = (int)( pml->origin[i]*PM_VECTOR_SNAP );
+		if( origint[i]*( 1.0/PM_VECTOR_SNAP ) == pml->origin[i] )
 			sign[i] = 0;
 	}
 	VectorCopy( origint, base );
@@ -235,7 +233,7 @@ static void TVM_PM_SnapPosition( void )
 	}
 
 	// go back to the last position
-	VectorCopy( pml.previous_origin, pm->playerState->pmove.origin );
+	VectorCopy( pml->previous_origin, pm->playerState->pmove.origin );
 	VectorClear( pm->playerState->pmove.velocity );
 }
 
@@ -244,11 +242,11 @@ static void TVM_PM_SnapPosition( void )
 * 
 * Can be called by either the server or the client
 */
-void TVM_Pmove( pmove_t *pmove )
+void TVM_Pmove( pmove_t *pm )
 {
-	pm = pmove;
+	pml_t locals, *pml = &locals;
 
-	if( !pmove->playerState )
+	if( !pm->playerState )
 		return;
 
 	// clear results
@@ -259,19 +257,19 @@ void TVM_Pmove( pmove_t *pmove )
 	pm->step = false;
 
 	// clear all pmove local vars
-	memset( &pml, 0, sizeof( pml ) );
+	memset( pml, 0, sizeof( *pml ) );
 
-	VectorCopy( pm->playerState->pmove.origin, pml.origin );
-	VectorCopy( pm->playerState->pmove.velocity, pml.velocity );
+	VectorCopy( pm->playerState->pmove.origin, pml->origin );
+	VectorCopy( pm->playerState->pmove.velocity, pml->velocity );
 
 	// save old org in case we get stuck
-	VectorCopy( pm->playerState->pmove.origin, pml.previous_origin );
+	VectorCopy( pm->playerState->pmove.origin, pml->previous_origin );
 
-	pml.frametime = pm->cmd.msec * 0.001;
+	pml->frametime = pm->cmd.msec * 0.001;
 
-	pml.maxPlayerSpeed = pm->playerState->pmove.stats[PM_STAT_MAXSPEED];
-	if( pml.maxPlayerSpeed < 0 )
-		pml.maxPlayerSpeed = DEFAULT_PLAYERSPEED;
+	pml->maxPlayerSpeed = pm->playerState->pmove.stats[PM_STAT_MAXSPEED];
+	if( pml->maxPlayerSpeed < 0 )
+		pml->maxPlayerSpeed = DEFAULT_PLAYERSPEED;
 
 	// drop timing counters
 	if( pm->playerState->pmove.pm_time )
@@ -301,15 +299,15 @@ void TVM_Pmove( pmove_t *pmove )
 
 	pm->playerState->viewheight = playerbox_stand_viewheight;
 
-	pml.forwardPush = pm->cmd.forwardmove * SPEEDKEY;
-	pml.sidePush = pm->cmd.sidemove * SPEEDKEY;
-	pml.upPush = pm->cmd.upmove * SPEEDKEY;
+	pml->forwardPush = pm->cmd.forwardmove * SPEEDKEY;
+	pml->sidePush = pm->cmd.sidemove * SPEEDKEY;
+	pml->upPush = pm->cmd.upmove * SPEEDKEY;
 
 	if( pm->playerState->pmove.stats[PM_STAT_NOUSERCONTROL] > 0 )
 	{
-		pml.forwardPush = 0;
-		pml.sidePush = 0;
-		pml.upPush = 0;
+		pml->forwardPush = 0;
+		pml->sidePush = 0;
+		pml->upPush = 0;
 		pm->cmd.buttons = 0;
 	}
 
@@ -317,8 +315,8 @@ void TVM_Pmove( pmove_t *pmove )
 	{
 		pm->playerState->pmove.pm_flags &= ~PMF_NO_PREDICTION;
 
-		TVM_PM_ClampAngles();
-		TVM_PM_FlyMove();
+		TVM_PM_ClampAngles( pm, pml );
+		TVM_PM_FlyMove( pm, pml );
 	}
 	else if( pm->playerState->pmove.pm_type != PM_NORMAL ) 
 	{
@@ -327,9 +325,9 @@ void TVM_Pmove( pmove_t *pmove )
 		if( pm->playerState->pmove.pm_type == PM_FREEZE ) {
 			pm->playerState->viewheight = 0;
 		}
-		pml.forwardPush = pml.sidePush = pml.upPush = 0;		
+		pml->forwardPush = pml->sidePush = pml->upPush = 0;		
 		pm->cmd.buttons = 0;
 	}
 
-	TVM_PM_SnapPosition();
+	TVM_PM_SnapPosition( pm, pml );
 }
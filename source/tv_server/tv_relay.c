@@ -236,6 +236,9 @@ void TV_Relay_Shutdown( relay_t *relay, const char *format, ... )
 		memset( &relay->client_entities, 0, sizeof( relay->client_entities ) );
 	}
 
+	if( relay->viscache )
+		SNAP_DestroyVisCache( &relay->viscache );
+
 	CM_ReleaseReference( relay->cms );
 	relay->cms = NULL;
 
@@ -442,6 +445,7 @@ void TV_Relay_Init( relay_t *relay, upstream_t *upstream, int delay )
 
 	relay->client_entities.num_entities = tv_maxclients->integer * UPDATE_BACKUP * MAX_SNAP_ENTITIES;
 	relay->client_entities.entities = Mem_Alloc( upstream->mempool, sizeof( entity_state_t ) * relay->client_entities.num_entities );
+	relay->viscache = SNAP_CreateVisCache( upstream->mempool );
 
 	relay->cms = CM_New( upstream->mempool );
 	CM_AddReference( relay->cms );
@@ -85,6 +85,7 @@ struct relay_s
 
 	cmodel_state_t *cms;
 	fatvis_t fatvis;
+	struct snapVisCache_s *viscache;
 
 	ginfo_t gi;
 	int num_active_specs;
@@ -78,7 +78,7 @@ void TV_Relay_BuildClientFrameSnap( relay_t *relay, client_t *client )
 
 	relay->fatvis.skyorg = skyorg;		// HACK HACK HACK
 	SNAP_BuildClientFrameSnap( relay->cms, &relay->gi, relay->framenum, relay->realtime, &relay->fatvis,
-		client, relay->module_export->GetGameState( relay->module ),
+		relay->viscache, client, relay->module_export->GetGameState( relay->module ),
 		&relay->client_entities,
 		true, tv_mempool );
 
@@ -113,7 +113,7 @@ static bool TV_Relay_SendClientDatagram( relay_t *relay, client_t *client )
 
 	frame = relay->curFrame;
 	SNAP_WriteFrameSnapToClient( &relay->gi, client, &msg, relay->framenum, relay->serverTime, relay->baselines,
-		&relay->client_entities, frame->numgamecommands, frame->gamecommands, frame->gamecommandsData );
+		&relay->client_entities, NULL, frame->numgamecommands, frame->gamecommands, frame->gamecommandsData );
 
 	return TV_Downstream_SendMessageToClient( client, &msg );
 }
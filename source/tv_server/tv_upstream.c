@@ -165,7 +165,7 @@ static void TV_Upstream_Netchan_Transmit( upstream_t *upstream, msg_t *msg )
 
 	// do not enable client compression until I fix the compression+fragmentation rare case bug
 	/*if( cl_compresspackets->integer ) {
-	zerror = Netchan_CompressMessage( msg );
+	zerror = Netchan_CompressMessage( msg, false );
 	if( zerror < 0 ) {  // it's compression error, just send uncompressed
 	Com_DPrintf( "TV_Upstream_Netchan_Transmit (ignoring compression): Compression error %i\n", zerror );
 	}
@@ -586,10 +586,17 @@ static void TV_Upstream_ReadPackets( upstream_t *upstream )
 */
 void TV_Upstream_SendConnectPacket( upstream_t *upstream )
 {
+	char userinfo[MAX_INFO_STRING];
+
 	upstream->userinfo_modified = false;
 
+	// let the server know which preset compression dictionary we have
+	Q_strncpyz( userinfo, TV_Upstream_Userinfo( upstream ), sizeof( userinfo ) );
+	if( Netchan_DictionaryChecksum() )
+		Info_SetValueForKey( userinfo, "cl_netdict", va( "%08x", Netchan_DictionaryChecksum() ) );
+
 	Netchan_OutOfBandPrint( upstream->socket, &upstream->serveraddress, "connect %i %i %i \"%s\" %i\n",
-		APP_PROTOCOL_VERSION, Netchan_GamePort(), upstream->challenge, TV_Upstream_Userinfo( upstream ), 1 );
+		APP_PROTOCOL_VERSION, Netchan_GamePort(), upstream->challenge, userinfo, 1 );
 }
 
 /*